@@ -25,8 +25,8 @@ git checkout 6bdb39f96fe8b897aff12bf3416e32515792e318
 cd ..
 
 # This is a dirty hack to guarantee that I can use the fatfs-sdk submodule
-echo "Patching the fatfs-sdk... to use chmod"
-sed -i.bak 's/#define FF_USE_CHMOD[[:space:]]*0/#define FF_USE_CHMOD 1/' fatfs-sdk/src/include/ffconf.h && mv fatfs-sdk/src/include/ffconf.h.bak .
+echo "Patching the fatfs-sdk... to use chmod and expand"
+sed -i.bak -e 's/#define FF_USE_CHMOD[[:space:]]*0/#define FF_USE_CHMOD 1/' -e 's/#define FF_USE_EXPAND[[:space:]]*0/#define FF_USE_EXPAND 1/' fatfs-sdk/src/include/ffconf.h && mv fatfs-sdk/src/include/ffconf.h.bak .
 
 # Set the environment variables of the SDKs
 export PICO_SDK_PATH=$PWD/pico-sdk
@@ -0,0 +1,135 @@
+"""Decoder of the recording of the bus made in Ripper mode.
+
+With the BUS_TRACE setting on ('bus on' in the setup screen), Ripper mode
+records every access of the computer to the ROM to /bustrace.bin in the
+microSD card, until SELECT is pressed:
+
+    python3 bustracedec.py /path/to/bustrace.bin
+
+Prints one access per line: the microseconds since the start, the
+microseconds since the previous access, the ROM (3 or 4) and the address
+of the computer. --summary only prints the counts and the addresses read
+most. The format of the file is described in bustrace.h.
+"""
+
+import argparse
+import collections
+import struct
+import sys
+
+BUSTRACE_FILE_MAGIC = 0x31535542  # "BUS1"
+BUSTRACE_FILE_VERSION = 1
+
+HEADER = struct.Struct("<IHHIIII")
+
+# Bit 16 of the capture is !ROM4 inverted: set for ROM3
+ROM3_BIT = 0x10000
+ROM4_BASE = 0xFA0000
+ROM3_BASE = 0xFB0000
+
+
+def read_varints(data, offset):
+    value = 0
+    shift = 0
+    for position in range(offset, len(data)):
+        byte = data[position]
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            yield value
+            value = 0
+            shift = 0
+    if shift:
+        raise ValueError("truncated varint at the end")
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def read_accesses(path):
+    """Yields (time_us, address) for each access, and None for each gap."""
+    with open(path, "rb") as trace:
+        data = trace.read()
+    if len(data) < HEADER.size:
+        raise ValueError("too short for a recording")
+    magic, version, _, start_us, accesses, gaps, size = \
+        HEADER.unpack_from(data)
+    if magic != BUSTRACE_FILE_MAGIC:
+        raise ValueError("not a recording of the bus, magic 0x%08X" % magic)
+    if version != BUSTRACE_FILE_VERSION:
+        raise ValueError("version %d not supported" % version)
+    header = {"start": start_us, "accesses": accesses, "gaps": gaps,
+              "bytes": size, "stored": len(data) - HEADER.size}
+
+    def accesses_of(varints):
+        address = 0
+        time_us = start_us
+        delta = None
+        for head in varints:
+            if head & 1 == 0:
+                address_delta = unzigzag(head >> 1)
+                time_delta = next(varints)
+                delta = (address_delta, time_delta)
+            elif head >> 1 == 0:
+                address = 0
+                time_us = start_us
+                delta = None
+                yield None
+                continue
+            elif delta is None:
+                raise ValueError("run without a previous access")
+            count = 1 if head & 1 == 0 else head >> 1
+            for _ in range(count):
+                address += delta[0]
+                time_us = (time_us + delta[1]) & 0xFFFFFFFF
+                yield time_us, address
+
+    return header, accesses_of(read_varints(data, HEADER.size))
+
+
+def computer_address(address):
+    base = ROM3_BASE if address & ROM3_BIT else ROM4_BASE
+    return base + (address & 0xFFFF), 3 if address & ROM3_BIT else 4
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace", help="bustrace.bin of the microSD card")
+    parser.add_argument("--summary", action="store_true",
+                        help="only the counts and the addresses read most")
+    parser.add_argument("--top", type=int, default=16,
+                        help="addresses of the summary (default: %(default)s)")
+    args = parser.parse_args()
+
+    try:
+        header, accesses = read_accesses(args.trace)
+        print("# %d accesses, %d gaps, %d bytes"
+              % (header["accesses"], header["gaps"], header["stored"]))
+        if header["bytes"] == 0 and header["stored"] > 0:
+            print("# not closed: SELECT was not pressed before the power off")
+        counts = collections.Counter()
+        previous = header["start"]
+        for access in accesses:
+            if access is None:
+                print("# accesses lost")
+                continue
+            time_us, address = access
+            where, rom = computer_address(address)
+            if args.summary:
+                counts[where] += 1
+                continue
+            print("%12d %+8d ROM%d 0x%06X"
+                  % ((time_us - header["start"]) & 0xFFFFFFFF,
+                     (time_us - previous) & 0xFFFFFFFF, rom, where))
+            previous = time_us
+    except (OSError, ValueError) as error:
+        sys.exit("%s: %s" % (args.trace, error))
+
+    if args.summary:
+        for where, count in counts.most_common(args.top):
+            print("0x%06X %10d" % (where, count))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,326 @@
+/**
+ * File: dlbench.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Benchmark and regression check of the download engine on the
+ * host, against the local server dlserver.py. Runs the same download.c,
+ * dlqueue.c, httpconn.c and httpresp.c of the firmware over the shims.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <ftw.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "dlqueue.h"
+#include "httpconn.h"
+#include "mbedtls/md5.h"
+#include "mbedtls/sha256.h"
+#include "shim.h"
+
+#define DLBENCH_DEFAULT_SERVER "127.0.0.1:8080"
+#define DLBENCH_DEFAULT_SIZE (4 * 1024 * 1024)
+#define DLBENCH_ROMS_FOLDER "/roms"
+#define DLBENCH_ROM_ADDRESS (XIP_BASE + FLASH_ROM_LOAD_OFFSET)
+#define DLBENCH_URL_SIZE 200
+#define DLBENCH_MB (1024 * 1024)
+
+typedef enum {
+  DLBENCH_EXPECT_OK,
+  DLBENCH_EXPECT_RESUME,        // Fails the first time, then resumes
+  DLBENCH_EXPECT_HASH_ERROR,    // Digest does not match
+  DLBENCH_EXPECT_NOT_MODIFIED,  // Second download is a 304
+  DLBENCH_EXPECT_NOSPACE        // Does not fit in the SD card
+} dlbench_expect_t;
+
+typedef struct {
+  const char *name;
+  const char *mode;  // Of dlserver.py
+  uint32_t size;     // Zero for the size of the command line
+  int files;         // Downloaded one after the other
+  download_target_t target;
+  bool md5;  // MD5 instead of SHA-256
+  dlbench_expect_t expect;
+} dlbench_scenario_t;
+
+// Totals of the downloads of a scenario
+typedef struct {
+  uint32_t jobs;
+  uint32_t failed;  // Jobs that ended with an error
+  download_err_t lastError;
+  uint64_t bytes;
+  uint64_t resumed;  // Bytes kept from interrupted downloads
+  uint64_t hashUs;
+  uint32_t notModified;
+} dlbench_totals_t;
+
+static const dlbench_scenario_t scenarios[] = {
+    {"normal", "normal", 0, 1, DOWNLOAD_TARGET_SDCARD, false,
+     DLBENCH_EXPECT_OK},
+    {"chunked", "chunked", 0, 1, DOWNLOAD_TARGET_SDCARD, false,
+     DLBENCH_EXPECT_OK},
+    {"keep-alive", "normal", 65536, 8, DOWNLOAD_TARGET_SDCARD, false,
+     DLBENCH_EXPECT_OK},
+    {"close", "close", 65536, 8, DOWNLOAD_TARGET_SDCARD, false,
+     DLBENCH_EXPECT_OK},
+    {"slow", "slow", 262144, 1, DOWNLOAD_TARGET_SDCARD, false,
+     DLBENCH_EXPECT_OK},
+    {"truncated", "truncated-once", 1048576, 1, DOWNLOAD_TARGET_SDCARD, false,
+     DLBENCH_EXPECT_RESUME},
+    {"reset", "reset-once", 1048576, 1, DOWNLOAD_TARGET_SDCARD, false,
+     DLBENCH_EXPECT_RESUME},
+    {"corrupt", "corrupt", 1048576, 1, DOWNLOAD_TARGET_SDCARD, false,
+     DLBENCH_EXPECT_HASH_ERROR},
+    {"not-modified", "normal", 1048576, 1, DOWNLOAD_TARGET_SDCARD, false,
+     DLBENCH_EXPECT_NOT_MODIFIED},
+    {"rom", "normal", DOWNLOAD_ROM_MAX_SIZE, 1, DOWNLOAD_TARGET_ROM, true,
+     DLBENCH_EXPECT_OK},
+    {"rom+sd", "chunked", DOWNLOAD_ROM_MAX_SIZE, 1,
+     DOWNLOAD_TARGET_ROM_SDCARD, true, DLBENCH_EXPECT_OK},
+    {"no-space", "normal", 0, 1, DOWNLOAD_TARGET_SDCARD, false,
+     DLBENCH_EXPECT_NOSPACE},
+};
+
+static dlbench_totals_t totals;
+
+// Content of the files of the server. Same as pattern() of dlserver.py, and
+// the first bytes are not zero, so they are not taken as a cartridge header.
+static uint8_t pattern(uint32_t offset) {
+  return (uint8_t)(offset * 131 + (offset >> 9) + 1);
+}
+
+static void toHex(const uint8_t *digest, size_t size, char *hex) {
+  for (size_t i = 0; i < size; i++) {
+    sprintf(&hex[i * 2], "%02x", digest[i]);
+  }
+}
+
+// Digest of the file, computed here and not counted as allocations of the
+// download
+static void expectedHash(uint32_t size, bool md5, char *hex) {
+  uint8_t block[4096];
+  uint8_t digest[DOWNLOAD_SHA256_SIZE];
+  mbedtls_sha256_context sha256;
+  mbedtls_md5_context md5ctx;
+  shim_allocPause();
+  mbedtls_sha256_init(&sha256);
+  mbedtls_md5_init(&md5ctx);
+  mbedtls_sha256_starts(&sha256, 0);
+  mbedtls_md5_starts(&md5ctx);
+  for (uint32_t done = 0; done < size; done += sizeof(block)) {
+    uint32_t len = (size - done < sizeof(block)) ? size - done : sizeof(block);
+    for (uint32_t i = 0; i < len; i++) {
+      block[i] = pattern(done + i);
+    }
+    mbedtls_sha256_update(&sha256, block, len);
+    mbedtls_md5_update(&md5ctx, block, len);
+  }
+  if (md5) {
+    mbedtls_md5_finish(&md5ctx, digest);
+    toHex(digest, DOWNLOAD_MD5_SIZE, hex);
+  } else {
+    mbedtls_sha256_finish(&sha256, digest);
+    toHex(digest, DOWNLOAD_SHA256_SIZE, hex);
+  }
+  mbedtls_sha256_free(&sha256);
+  mbedtls_md5_free(&md5ctx);
+  shim_allocResume();
+}
+
+static void jobDone(const dlqueue_job_t *job) {
+  const download_stats_t *stats = download_getStats();
+  totals.jobs++;
+  totals.lastError = job->error;
+  if (job->error != DOWNLOAD_OK) {
+    totals.failed++;
+    return;
+  }
+  totals.bytes += stats->bytes;
+  totals.resumed += stats->offset;
+  totals.hashUs += stats->hashUs;
+  if (download_isNotModified()) {
+    totals.notModified++;
+  }
+}
+
+static void runQueue(void) {
+  do {
+    dlqueue_poll();
+  } while (dlqueue_isBusy());
+}
+
+static bool download(const char *server, const dlbench_scenario_t *scenario,
+                     uint32_t size, int index) {
+  char url[DLBENCH_URL_SIZE];
+  char hash[DOWNLOAD_HASH_LENGTH];
+  snprintf(url, sizeof(url), "http://%s/%s/%u/%s-%d.bin", server,
+           scenario->mode, (unsigned int)size, scenario->name, index);
+  expectedHash(size, scenario->md5, hash);
+  if (dlqueue_add(url, scenario->target, DLBENCH_ROM_ADDRESS, hash, jobDone) !=
+      DLQUEUE_OK) {
+    return false;
+  }
+  runQueue();
+  return true;
+}
+
+// The ROM area has the file in 16-bit words swapped, as the bus reads them
+static bool romMatches(uint32_t size) {
+  const uint8_t *rom = shim_getFlash() + FLASH_ROM_LOAD_OFFSET;
+  for (uint32_t i = 0; i < size; i++) {
+    if (rom[i ^ 1] != pattern(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool check(const dlbench_scenario_t *scenario, uint32_t size) {
+  switch (scenario->expect) {
+    case DLBENCH_EXPECT_OK:
+      return (totals.failed == 0) &&
+             ((scenario->target == DOWNLOAD_TARGET_SDCARD) ||
+              romMatches(size));
+    case DLBENCH_EXPECT_RESUME:
+      return (totals.failed == 1) && (totals.jobs == 2) &&
+             (totals.resumed > 0) &&
+             (totals.bytes + totals.resumed == size);
+    case DLBENCH_EXPECT_HASH_ERROR:
+      return (totals.failed == 1) &&
+             (totals.lastError == DOWNLOAD_HASHMISMATCH_ERROR);
+    case DLBENCH_EXPECT_NOT_MODIFIED:
+      return (totals.failed == 0) && (totals.notModified == 1);
+    case DLBENCH_EXPECT_NOSPACE:
+      return (totals.failed == 1) &&
+             (totals.lastError == DOWNLOAD_NOSPACE_ERROR);
+  }
+  return false;
+}
+
+static bool runScenario(const char *server,
+                        const dlbench_scenario_t *scenario, uint32_t size) {
+  memset(&totals, 0, sizeof(totals));
+  shim_resetFsStats();
+  shim_resetNetStats();
+  shim_resetAllocStats();
+  httpconn_stats_t httpBefore = *httpconn_getStats();
+  if (scenario->expect == DLBENCH_EXPECT_NOSPACE) {
+    shim_setFreeBytes(size / 2);
+  }
+
+  absolute_time_t start = get_absolute_time();
+  bool queued = true;
+  for (int i = 0; (i < scenario->files) && queued; i++) {
+    queued = download(server, scenario, size, i);
+  }
+  if (queued && ((scenario->expect == DLBENCH_EXPECT_RESUME) ||
+                 (scenario->expect == DLBENCH_EXPECT_NOT_MODIFIED))) {
+    queued = download(server, scenario, size, 0);
+  }
+  int64_t elapsedUs = absolute_time_diff_us(start, get_absolute_time());
+  shim_setFreeBytes(0);
+
+  const shim_fs_stats_t *fs = shim_getFsStats();
+  const shim_alloc_stats_t *allocs = shim_getAllocStats();
+  const httpconn_stats_t *http = httpconn_getStats();
+  bool passed = queued && check(scenario, size);
+  char requests[32];
+  snprintf(requests, sizeof(requests), "%u/%u/%u",
+           (unsigned int)(http->requests - httpBefore.requests),
+           (unsigned int)(http->connections - httpBefore.connections),
+           (unsigned int)(http->reused - httpBefore.reused));
+  double mb = (double)totals.bytes / DLBENCH_MB;
+  double hashed = (double)(totals.bytes + totals.resumed) / 1024;
+  printf("%-13s %-4s %9.2f %8.1f %6u %5u %3u %8.1f %-12s %6.1f\n",
+         scenario->name, passed ? "ok" : "FAIL", mb,
+         (elapsedUs > 0) ? mb * 1000000 / (double)elapsedUs : 0,
+         (unsigned int)fs->writes, (unsigned int)fs->syncs,
+         (unsigned int)fs->expands,
+         (totals.bytes > 0) ? (double)allocs->count / mb : 0, requests,
+         (hashed > 0) ? (double)totals.hashUs / hashed : 0);
+  if (!passed) {
+    printf("  %u jobs, %u failed, last error %d, %u bytes resumed\n",
+           (unsigned int)totals.jobs, (unsigned int)totals.failed,
+           totals.lastError, (unsigned int)totals.resumed);
+  }
+  return passed;
+}
+
+static int removeEntry(const char *path, __unused const struct stat *info,
+                       __unused int flag, __unused struct FTW *ftwInfo) {
+  return remove(path);
+}
+
+static void usage(const char *name) {
+  printf("Usage: %s [-s host:port] [-n bytes] [-d folder] [-k] [scenario...]\n"
+         "  -s  Server, dlserver.py. Default %s\n"
+         "  -n  Size of the large files. Default %u\n"
+         "  -d  Folder of the SD card. Default a new temporary folder\n"
+         "  -k  Keep the folder of the SD card\n",
+         name, DLBENCH_DEFAULT_SERVER, (unsigned int)DLBENCH_DEFAULT_SIZE);
+}
+
+int main(int argc, char **argv) {
+  const char *server = DLBENCH_DEFAULT_SERVER;
+  uint32_t size = DLBENCH_DEFAULT_SIZE;
+  char folder[256] = "";
+  bool keep = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:n:d:kh")) != -1) {
+    switch (opt) {
+      case 's':
+        server = optarg;
+        break;
+      case 'n':
+        size = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        snprintf(folder, sizeof(folder), "%s", optarg);
+        keep = true;
+        break;
+      case 'k':
+        keep = true;
+        break;
+      default:
+        usage(argv[0]);
+        return (opt == 'h') ? 0 : 2;
+    }
+  }
+  if ((folder[0] == '\0') &&
+      (mkdtemp(strcpy(folder, "/tmp/dlbench.XXXXXX")) == NULL)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  char roms[sizeof(folder) + sizeof(DLBENCH_ROMS_FOLDER)];
+  snprintf(roms, sizeof(roms), "%s%s", folder, DLBENCH_ROMS_FOLDER);
+  mkdir(roms, 0755);
+  shim_setSdcardRoot(folder);
+  shim_setSetting(ACONFIG_PARAM_ROMS_FOLDER, DLBENCH_ROMS_FOLDER);
+
+  printf("Server %s, SD card in %s\n", server, folder);
+  printf("%-13s %-4s %9s %8s %6s %5s %3s %7s %-12s %6s\n", "scenario",
+         "", "MB", "MB/s", "writes", "syncs", "exp", "alloc/MB",
+         "req/conn/reu", "us/KB");
+  int failed = 0;
+  int run = 0;
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    bool selected = (optind == argc);
+    for (int arg = optind; arg < argc; arg++) {
+      selected = selected || (strcmp(argv[arg], scenarios[i].name) == 0);
+    }
+    if (selected) {
+      uint32_t fileSize = (scenarios[i].size > 0) ? scenarios[i].size : size;
+      failed += runScenario(server, &scenarios[i], fileSize) ? 0 : 1;
+      run++;
+    }
+  }
+  httpconn_close();
+  if (!keep) {
+    nftw(folder, removeEntry, 8, FTW_DEPTH | FTW_PHYS);
+  }
+  printf("%d of %d scenarios passed\n", run - failed, run);
+  return (failed == 0) ? 0 : 1;
+}
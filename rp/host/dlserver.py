@@ -0,0 +1,191 @@
+"""Local HTTP/1.1 server for the host build of the download engine.
+
+Serves generated files of any size, and misbehaves on request. The path of
+the URL selects the behaviour, the size and the name of the file:
+
+    /<mode>/<size>/<name>
+
+Modes:
+    normal          Content-Length and keep-alive.
+    chunked         Transfer-Encoding: chunked, chunks of varying sizes.
+    close           Content-Length, then closes the connection.
+    slow            Small pieces with pauses, like a slow Wi-Fi link.
+    truncated-once  First request of each file: half the body, then closes.
+    reset-once      First request of each file: half the body, then a RST.
+    corrupt         One byte of the body changed, so the digest fails.
+
+Every file has a strong ETag, so If-None-Match gets a 304 and a Range
+request with a matching If-Range gets a 206, as the ROM server does.
+"""
+
+import argparse
+import socket
+import socketserver
+import struct
+import threading
+import time
+
+SLOW_PIECE = 512
+SLOW_PAUSE = 0.002
+CHUNK_SIZES = (1000, 4096, 17, 8192, 1460)
+
+failed_once = set()
+failed_once_lock = threading.Lock()
+
+
+def pattern_period():
+    """Content of the files, (i * 131 + (i >> 9) + 1) & 0xFF as pattern() of
+    dlbench.c. It repeats every 256 blocks of 512 bytes."""
+    block = bytes((i * 131) & 0xFF for i in range(512))
+    return b"".join(block.translate(bytes((v + k + 1) & 0xFF
+                                          for v in range(256)))
+                    for k in range(256))
+
+
+PERIOD = pattern_period()
+
+
+def pattern(size):
+    return (PERIOD * (size // len(PERIOD) + 1))[:size]
+
+
+def etag(mode, size):
+    # The corrupt file is another file for the caches
+    return '"%x-%s"' % (size, "corrupt" if mode == "corrupt" else "ok")
+
+
+def fail_first_time(path):
+    with failed_once_lock:
+        if path in failed_once:
+            return False
+        failed_once.add(path)
+        return True
+
+
+class Handler(socketserver.StreamRequestHandler):
+    def read_request(self):
+        line = self.rfile.readline()
+        if not line:
+            return None
+        method, path, version = line.decode("latin-1").split()
+        headers = {}
+        while True:
+            header = self.rfile.readline().decode("latin-1").strip()
+            if not header:
+                break
+            name, _, value = header.partition(":")
+            headers[name.strip().lower()] = value.strip()
+        return method, path, version, headers
+
+    def send_head(self, status, headers):
+        reason = {200: "OK", 206: "Partial Content", 304: "Not Modified",
+                  400: "Bad Request", 404: "Not Found"}[status]
+        head = "HTTP/1.1 %d %s\r\n" % (status, reason)
+        head += "".join("%s: %s\r\n" % header for header in headers)
+        self.wfile.write((head + "\r\n").encode("latin-1"))
+
+    def reset(self):
+        self.connection.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER,
+                                   struct.pack("ii", 1, 0))
+        self.connection.close()
+
+    def handle(self):
+        try:
+            while True:
+                request = self.read_request()
+                if request is None or not self.respond(*request):
+                    return
+        except ConnectionError:
+            pass  # The client gave up, e.g. the file does not fit
+
+    # Returns False when the connection must be closed
+    def respond(self, method, path, version, headers):
+        parts = path.split("/")
+        if method != "GET" or len(parts) != 4 or not parts[2].isdigit():
+            self.send_head(400, [("Content-Length", "0")])
+            return True
+        mode, size = parts[1], int(parts[2])
+        if mode not in ("normal", "chunked", "close", "slow", "truncated-once",
+                        "reset-once", "corrupt"):
+            self.send_head(404, [("Content-Length", "0")])
+            return True
+        tag = etag(mode, size)
+        keep_alive = (version == "HTTP/1.1" and mode != "close" and
+                      headers.get("connection", "").lower() != "close")
+
+        if headers.get("if-none-match") == tag:
+            self.send_head(304, [("ETag", tag)])
+            return keep_alive
+
+        body = pattern(size)
+        if mode == "corrupt" and size > 0:
+            body = bytearray(body)
+            body[size // 2] ^= 0xFF
+            body = bytes(body)
+
+        status, offset = 200, 0
+        extra = [("ETag", tag)]
+        ranges = headers.get("range", "")
+        if (ranges.startswith("bytes=") and ranges.endswith("-") and
+                headers.get("if-range", tag) == tag):
+            offset = int(ranges[len("bytes="):-1])
+            if 0 < offset < size:
+                status = 206
+                extra.append(("Content-Range",
+                              "bytes %d-%d/%d" % (offset, size - 1, size)))
+            else:
+                offset = 0
+        body = body[offset:]
+
+        if mode == "chunked":
+            extra.append(("Transfer-Encoding", "chunked"))
+        else:
+            extra.append(("Content-Length", str(len(body))))
+        if not keep_alive:
+            extra.append(("Connection", "close"))
+        self.send_head(status, extra)
+
+        if mode in ("truncated-once", "reset-once") and fail_first_time(path):
+            self.wfile.write(body[:len(body) // 2])
+            self.wfile.flush()
+            if mode == "reset-once":
+                self.reset()
+            return False
+
+        if mode == "chunked":
+            sent, index = 0, 0
+            while sent < len(body):
+                piece = body[sent:sent + CHUNK_SIZES[index % len(CHUNK_SIZES)]]
+                self.wfile.write(b"%x\r\n" % len(piece) + piece + b"\r\n")
+                sent += len(piece)
+                index += 1
+            self.wfile.write(b"0\r\n\r\n")
+        elif mode == "slow":
+            for sent in range(0, len(body), SLOW_PIECE):
+                self.wfile.write(body[sent:sent + SLOW_PIECE])
+                self.wfile.flush()
+                time.sleep(SLOW_PAUSE)
+        else:
+            self.wfile.write(body)
+        self.wfile.flush()
+        return keep_alive
+
+
+class Server(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Local HTTP server for the download benchmark.")
+    parser.add_argument("--port", type=int, default=8080,
+                        help="Port to listen on. Default 8080.")
+    args = parser.parse_args()
+    with Server(("127.0.0.1", args.port), Handler) as server:
+        print("Serving on 127.0.0.1:%d" % args.port, flush=True)
+        server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+"""Memory report of the firmware, from the linker map and the stack usage.
+
+Run after each link by the firmware build:
+
+    python3 memreport.py rp.elf.map CMakeFiles/rp.dir
+
+Shows the static RAM, the room left for the heap below the ROM in RAM, the
+stacks of both cores in the scratch banks, and the largest stack frames of
+the firmware from the .su files of -fstack-usage. The frames are per
+function; the deepest call chain adds several of them, so a frame close to
+the stack of its core is a warning on its own.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+REGION_LINE = re.compile(r"^(\w+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+SYMBOL_LINE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+(\w+) = ")
+SU_LINE = re.compile(r"^(.*):(\d+):\d+:(\S+)\s+(\d+)\s+(\S+)")
+
+# Bytes of a single frame that deserve a warning
+FRAME_WARNING = 1024
+
+
+def read_map(path):
+    regions = {}
+    symbols = {}
+    in_regions = False
+    with open(path, encoding="utf-8", errors="replace") as lines:
+        for line in lines:
+            if line.startswith("Memory Configuration"):
+                in_regions = True
+                continue
+            if line.startswith("Linker script and memory map"):
+                in_regions = False
+                continue
+            if in_regions:
+                match = REGION_LINE.match(line)
+                if match:
+                    regions[match.group(1)] = (int(match.group(2), 16),
+                                               int(match.group(3), 16))
+                continue
+            match = SYMBOL_LINE.match(line)
+            if match:
+                symbols[match.group(2)] = int(match.group(1), 16)
+    return regions, symbols
+
+
+def read_frames(folder):
+    frames = []
+    for root, _, files in os.walk(folder):
+        for name in files:
+            if not name.endswith(".su"):
+                continue
+            with open(os.path.join(root, name), encoding="utf-8") as lines:
+                for line in lines:
+                    match = SU_LINE.match(line)
+                    if match:
+                        source, number, function, size, kind = match.groups()
+                        frames.append((int(size), kind, function,
+                                       "%s:%s" % (os.path.basename(source),
+                                                  number)))
+    frames.sort(reverse=True)
+    return frames
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="map file of the link")
+    parser.add_argument("objects", nargs="?",
+                        help="folder with the .su files of the firmware")
+    parser.add_argument("--top", type=int, default=10,
+                        help="largest frames shown (default: %(default)s)")
+    args = parser.parse_args()
+
+    try:
+        regions, symbols = read_map(args.map)
+        ram_origin, ram_length = regions["RAM"]
+        static = symbols["__end__"] - ram_origin
+        heap = symbols["__rom_in_ram_start__"] - symbols["__end__"]
+        core0_room = symbols["__StackTop"] - symbols["__scratch_y_end__"]
+        core0_reserved = symbols["__StackTop"] - symbols["__StackBottom"]
+        core1_reserved = symbols["__stack1_end__"] - symbols["__stack1_start__"]
+    except (OSError, KeyError) as error:
+        sys.exit("%s: no memory report: %s" % (args.map, error))
+
+    print("RAM:      %6d bytes of data and bss, of %d" % (static, ram_length))
+    print("Heap:     %6d bytes up to the ROM in RAM" % heap)
+    print("Stack c0: %6d bytes reserved, %d up to the data of SCRATCH_Y"
+          % (core0_reserved, core0_room))
+    print("Stack c1: %6d bytes reserved, the data of SCRATCH_X below"
+          % core1_reserved)
+
+    if not args.objects:
+        return
+    frames = read_frames(args.objects)
+    if not frames:
+        print("No .su files in %s" % args.objects)
+        return
+    print("Largest stack frames:")
+    for size, kind, function, where in frames[:args.top]:
+        print("  %6d %-8s %-32s %s" % (size, kind, function, where))
+    smallest = min(core0_room, core1_reserved)
+    for size, kind, function, where in frames:
+        if size >= FRAME_WARNING or size * 2 >= smallest:
+            print("WARNING: %s (%s) takes %d bytes of stack"
+                  % (function, where, size))
+
+
+if __name__ == "__main__":
+    main()
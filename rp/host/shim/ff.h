@@ -0,0 +1,94 @@
+/**
+ * File: ff.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Stand-in of the FatFs API for the host build, over the files
+ * of a folder of the host. Only the functions of the download path.
+ */
+
+#ifndef SHIM_FF_H
+#define SHIM_FF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FF_MAX_SS 512
+#define FF_USE_EXPAND 1
+
+typedef unsigned int UINT;
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint32_t FSIZE_t;
+typedef char TCHAR;
+
+typedef enum {
+  FR_OK = 0,
+  FR_DISK_ERR,
+  FR_INT_ERR,
+  FR_NOT_READY,
+  FR_NO_FILE,
+  FR_NO_PATH,
+  FR_INVALID_NAME,
+  FR_DENIED,
+  FR_EXIST,
+  FR_INVALID_OBJECT,
+  FR_WRITE_PROTECTED,
+  FR_INVALID_DRIVE,
+  FR_NOT_ENABLED,
+  FR_NO_FILESYSTEM,
+  FR_MKFS_ABORTED,
+  FR_TIMEOUT,
+  FR_LOCKED,
+  FR_NOT_ENOUGH_CORE,
+  FR_TOO_MANY_OPEN_FILES,
+  FR_INVALID_PARAMETER
+} FRESULT;
+
+#define FA_READ 0x01
+#define FA_WRITE 0x02
+#define FA_OPEN_EXISTING 0x00
+#define FA_CREATE_NEW 0x04
+#define FA_CREATE_ALWAYS 0x08
+#define FA_OPEN_ALWAYS 0x10
+#define FA_OPEN_APPEND 0x30
+
+#define AM_RDO 0x01
+#define AM_DIR 0x10
+
+typedef struct {
+  WORD csize;      // Sectors per cluster
+  DWORD n_fatent;  // Clusters + 2
+} FATFS;
+
+typedef struct {
+  bool open;
+  int fd;
+} FIL;
+
+typedef struct {
+  FSIZE_t fsize;
+  WORD fdate;
+  WORD ftime;
+  BYTE fattrib;
+  TCHAR fname[256];
+} FILINFO;
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_truncate(FIL *fp);
+FRESULT f_sync(FIL *fp);
+FRESULT f_expand(FIL *fp, FSIZE_t fsz, BYTE opt);
+FRESULT f_stat(const TCHAR *path, FILINFO *fno);
+FRESULT f_unlink(const TCHAR *path);
+FRESULT f_rename(const TCHAR *pathOld, const TCHAR *pathNew);
+FRESULT f_chmod(const TCHAR *path, BYTE attr, BYTE mask);
+FRESULT f_getfree(const TCHAR *path, DWORD *nclst, FATFS **fatfs);
+FSIZE_t f_size(FIL *fp);
+FSIZE_t f_tell(FIL *fp);
+
+#endif  // SHIM_FF_H
@@ -0,0 +1,242 @@
+/**
+ * File: ffshim.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: FatFs over the files of a folder of the host. Plain system
+ * calls, so the host C library allocates nothing per file.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include "ff.h"
+#include "sdcard.h"
+#include "shim.h"
+
+#define FFSHIM_PATH_SIZE 512
+#define FFSHIM_CLUSTER_SECTORS 64  // 32 KB clusters, as a card formatted
+
+static char root[FFSHIM_PATH_SIZE] = ".";
+static uint64_t freeBytesLimit = 0;
+static shim_fs_stats_t stats;
+static FATFS volume = {FFSHIM_CLUSTER_SECTORS, 0};
+
+static void hostPath(const TCHAR *path, char *dest) {
+  snprintf(dest, FFSHIM_PATH_SIZE, "%s/%s", root,
+           (path[0] == '/') ? &path[1] : path);
+}
+
+static FRESULT toResult(int error) {
+  switch (error) {
+    case 0:
+      return FR_OK;
+    case ENOENT:
+      return FR_NO_FILE;
+    case ENOTDIR:
+      return FR_NO_PATH;
+    case EEXIST:
+      return FR_EXIST;
+    case EACCES:
+    case EPERM:
+    case ENOSPC:
+      return FR_DENIED;
+    default:
+      return FR_DISK_ERR;
+  }
+}
+
+void shim_setSdcardRoot(const char *folder) {
+  snprintf(root, sizeof(root), "%s", folder);
+}
+
+void shim_setFreeBytes(uint64_t bytes) { freeBytesLimit = bytes; }
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode) {
+  char name[FFSHIM_PATH_SIZE];
+  hostPath(path, name);
+  int flags = O_RDONLY;
+  if ((mode & FA_READ) && (mode & FA_WRITE)) {
+    flags = O_RDWR;
+  } else if (mode & FA_WRITE) {
+    flags = O_WRONLY;
+  }
+  if (mode & FA_CREATE_ALWAYS) {
+    flags |= O_CREAT | O_TRUNC;
+  } else if (mode & FA_CREATE_NEW) {
+    flags |= O_CREAT | O_EXCL;
+  } else if (mode & FA_OPEN_ALWAYS) {
+    flags |= O_CREAT;
+  }
+  int fd = open(name, flags, 0644);
+  if (fd < 0) {
+    return toResult(errno);
+  }
+  if ((mode & FA_OPEN_APPEND) == FA_OPEN_APPEND) {
+    lseek(fd, 0, SEEK_END);
+  }
+  fp->fd = fd;
+  fp->open = true;
+  return FR_OK;
+}
+
+FRESULT f_close(FIL *fp) {
+  if (!fp->open) {
+    return FR_INVALID_OBJECT;
+  }
+  fp->open = false;
+  return (close(fp->fd) == 0) ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br) {
+  *br = 0;
+  if (!fp->open) {
+    return FR_INVALID_OBJECT;
+  }
+  ssize_t bytes = read(fp->fd, buff, btr);
+  if (bytes < 0) {
+    return toResult(errno);
+  }
+  *br = (UINT)bytes;
+  return FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw) {
+  *bw = 0;
+  if (!fp->open) {
+    return FR_INVALID_OBJECT;
+  }
+  ssize_t bytes = write(fp->fd, buff, btw);
+  if (bytes < 0) {
+    return toResult(errno);
+  }
+  *bw = (UINT)bytes;
+  stats.writes++;
+  stats.bytes += (uint64_t)bytes;
+  return FR_OK;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs) {
+  if (!fp->open) {
+    return FR_INVALID_OBJECT;
+  }
+  return (lseek(fp->fd, (off_t)ofs, SEEK_SET) >= 0) ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_truncate(FIL *fp) {
+  if (!fp->open) {
+    return FR_INVALID_OBJECT;
+  }
+  return (ftruncate(fp->fd, lseek(fp->fd, 0, SEEK_CUR)) == 0)
+             ? FR_OK
+             : toResult(errno);
+}
+
+FRESULT f_sync(FIL *fp) {
+  if (!fp->open) {
+    return FR_INVALID_OBJECT;
+  }
+  stats.syncs++;
+  return FR_OK;
+}
+
+// Only checks the rules of FatFs: the file must be empty
+FRESULT f_expand(FIL *fp, FSIZE_t fsz, __unused BYTE opt) {
+  if (!fp->open) {
+    return FR_INVALID_OBJECT;
+  }
+  if ((fsz == 0) || (f_size(fp) != 0)) {
+    return FR_DENIED;
+  }
+  stats.expands++;
+  return FR_OK;
+}
+
+FRESULT f_stat(const TCHAR *path, FILINFO *fno) {
+  char name[FFSHIM_PATH_SIZE];
+  struct stat info;
+  hostPath(path, name);
+  if (stat(name, &info) != 0) {
+    return toResult(errno);
+  }
+  memset(fno, 0, sizeof(FILINFO));
+  fno->fsize = (FSIZE_t)info.st_size;
+  fno->fattrib = S_ISDIR(info.st_mode) ? AM_DIR : 0;
+  const char *base = strrchr(name, '/');
+  snprintf(fno->fname, sizeof(fno->fname), "%s",
+           (base != NULL) ? base + 1 : name);
+  return FR_OK;
+}
+
+FRESULT f_unlink(const TCHAR *path) {
+  char name[FFSHIM_PATH_SIZE];
+  hostPath(path, name);
+  return (unlink(name) == 0) ? FR_OK : toResult(errno);
+}
+
+// FatFs does not replace an existing file
+FRESULT f_rename(const TCHAR *pathOld, const TCHAR *pathNew) {
+  char oldName[FFSHIM_PATH_SIZE];
+  char newName[FFSHIM_PATH_SIZE];
+  struct stat info;
+  hostPath(pathOld, oldName);
+  hostPath(pathNew, newName);
+  if (stat(newName, &info) == 0) {
+    return FR_EXIST;
+  }
+  return (rename(oldName, newName) == 0) ? FR_OK : toResult(errno);
+}
+
+FRESULT f_chmod(__unused const TCHAR *path, __unused BYTE attr,
+                __unused BYTE mask) {
+  return FR_OK;
+}
+
+FRESULT f_getfree(__unused const TCHAR *path, DWORD *nclst, FATFS **fatfs) {
+  struct statvfs info;
+  if (statvfs(root, &info) != 0) {
+    return FR_DISK_ERR;
+  }
+  uint64_t clusterBytes = (uint64_t)volume.csize * NUM_BYTES_PER_SECTOR;
+  uint64_t freeBytes = (uint64_t)info.f_bavail * info.f_frsize;
+  if ((freeBytesLimit > 0) && (freeBytes > freeBytesLimit)) {
+    freeBytes = freeBytesLimit;
+  }
+  volume.n_fatent =
+      (DWORD)((uint64_t)info.f_blocks * info.f_frsize / clusterBytes) + 2;
+  *nclst = (DWORD)(freeBytes / clusterBytes);
+  *fatfs = &volume;
+  return FR_OK;
+}
+
+FSIZE_t f_size(FIL *fp) {
+  struct stat info;
+  return (fp->open && (fstat(fp->fd, &info) == 0)) ? (FSIZE_t)info.st_size
+                                                     : 0;
+}
+
+FSIZE_t f_tell(FIL *fp) {
+  return fp->open ? (FSIZE_t)lseek(fp->fd, 0, SEEK_CUR) : 0;
+}
+
+// Same as the firmware, over the shim of f_getfree
+FRESULT sdcard_getFreeBytes(uint64_t *freeBytes) {
+  DWORD freClust;
+  FATFS *fsPtr;
+  *freeBytes = 0;
+  FRESULT res = f_getfree("", &freClust, &fsPtr);
+  if (res != FR_OK) {
+    return res;
+  }
+  *freeBytes = (uint64_t)freClust * fsPtr->csize * NUM_BYTES_PER_SECTOR;
+  return FR_OK;
+}
+
+const shim_fs_stats_t *shim_getFsStats(void) { return &stats; }
+
+void shim_resetFsStats(void) { memset(&stats, 0, sizeof(stats)); }
@@ -0,0 +1,24 @@
+/**
+ * File: flash.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Stand-in of the Pico SDK flash functions for the host build.
+ * The flash is an array in RAM.
+ */
+
+#ifndef SHIM_HARDWARE_FLASH_H
+#define SHIM_HARDWARE_FLASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define XIP_BASE 0x10000000
+#define FLASH_PAGE_SIZE 256
+#define FLASH_SECTOR_SIZE 4096
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+void flash_range_erase(uint32_t flashOffs, size_t count);
+void flash_range_program(uint32_t flashOffs, const uint8_t *data, size_t count);
+
+#endif  // SHIM_HARDWARE_FLASH_H
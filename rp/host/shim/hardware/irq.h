@@ -0,0 +1,13 @@
+/**
+ * File: irq.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Empty stand-in of the Pico SDK header for the host build. Only
+ * needed by the headers of the firmware, not by the download path.
+ */
+
+#ifndef SHIM_HARDWARE_IRQ_H
+#define SHIM_HARDWARE_IRQ_H
+
+#endif  // SHIM_HARDWARE_IRQ_H
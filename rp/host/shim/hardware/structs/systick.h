@@ -0,0 +1,24 @@
+/**
+ * File: systick.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Stand-in of the SysTick registers for the host build. Declared
+ * for the inline functions of perf.h, never read.
+ */
+
+#ifndef SHIM_HARDWARE_STRUCTS_SYSTICK_H
+#define SHIM_HARDWARE_STRUCTS_SYSTICK_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t csr;
+  uint32_t rvr;
+  uint32_t cvr;
+  uint32_t calib;
+} systick_hw_t;
+
+extern systick_hw_t *systick_hw;
+
+#endif  // SHIM_HARDWARE_STRUCTS_SYSTICK_H
@@ -0,0 +1,18 @@
+/**
+ * File: sync.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Stand-in of the Pico SDK interrupt masking for the host build
+ */
+
+#ifndef SHIM_HARDWARE_SYNC_H
+#define SHIM_HARDWARE_SYNC_H
+
+#include <stdint.h>
+
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+#endif  // SHIM_HARDWARE_SYNC_H
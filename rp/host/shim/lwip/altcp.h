@@ -0,0 +1,81 @@
+/**
+ * File: altcp.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Stand-in of the lwIP application layered TCP API for the host
+ * build, over non-blocking sockets. Same callbacks and error codes as lwIP,
+ * with the receive window and segment size of lwipopts.h.
+ */
+
+#ifndef SHIM_LWIP_ALTCP_H
+#define SHIM_LWIP_ALTCP_H
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+
+// Error codes of lwIP (lwip/err.h)
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_BUF -2
+#define ERR_TIMEOUT -3
+#define ERR_RTE -4
+#define ERR_INPROGRESS -5
+#define ERR_VAL -6
+#define ERR_WOULDBLOCK -7
+#define ERR_USE -8
+#define ERR_ALREADY -9
+#define ERR_ISCONN -10
+#define ERR_CONN -11
+#define ERR_IF -12
+#define ERR_ABRT -13
+#define ERR_RST -14
+#define ERR_CLSD -15
+#define ERR_ARG -16
+
+#define TCP_WRITE_FLAG_COPY 0x01
+
+// IPv4 only
+typedef struct {
+  uint32_t addr;  // Network byte order
+} ip_addr_t;
+
+#define IPADDR_TYPE_V4 0
+#define IP_GET_TYPE(ipaddr) IPADDR_TYPE_V4
+
+struct pbuf {
+  struct pbuf *next;
+  void *payload;
+  u16_t tot_len;  // Of this pbuf and the rest of the chain
+  u16_t len;
+};
+
+struct altcp_pcb;
+
+typedef err_t (*altcp_recv_fn)(void *arg, struct altcp_pcb *conn,
+                               struct pbuf *p, err_t err);
+typedef err_t (*altcp_connected_fn)(void *arg, struct altcp_pcb *conn,
+                                    err_t err);
+typedef err_t (*altcp_poll_fn)(void *arg, struct altcp_pcb *conn);
+typedef void (*altcp_err_fn)(void *arg, err_t err);
+
+struct altcp_pcb *altcp_new_ip_type(void *allocator, u8_t ipType);
+void altcp_arg(struct altcp_pcb *conn, void *arg);
+void altcp_recv(struct altcp_pcb *conn, altcp_recv_fn recv);
+void altcp_err(struct altcp_pcb *conn, altcp_err_fn err);
+void altcp_poll(struct altcp_pcb *conn, altcp_poll_fn poll, u8_t interval);
+err_t altcp_connect(struct altcp_pcb *conn, const ip_addr_t *ipaddr,
+                    u16_t port, altcp_connected_fn connected);
+err_t altcp_write(struct altcp_pcb *conn, const void *dataptr, u16_t len,
+                  u8_t apiflags);
+err_t altcp_output(struct altcp_pcb *conn);
+void altcp_recved(struct altcp_pcb *conn, u16_t len);
+err_t altcp_close(struct altcp_pcb *conn);
+void altcp_abort(struct altcp_pcb *conn);
+
+u8_t pbuf_free(struct pbuf *p);
+
+#endif  // SHIM_LWIP_ALTCP_H
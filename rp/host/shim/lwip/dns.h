@@ -0,0 +1,28 @@
+/**
+ * File: dns.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Stand-in of the lwIP DNS client for the host build
+ */
+
+#ifndef SHIM_LWIP_DNS_H
+#define SHIM_LWIP_DNS_H
+
+#include "lwip/altcp.h"
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr,
+                                   void *callbackArg);
+
+/**
+ * @brief Resolves a host name. IP addresses are answered at once, like the
+ * names in the cache of lwIP. Names are answered later from the async
+ * context, like a query to the DNS server.
+ *
+ * @return ERR_OK with the address, ERR_INPROGRESS if the callback will be
+ * called, or ERR_VAL if another query is in progress.
+ */
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                        dns_found_callback found, void *callbackArg);
+
+#endif  // SHIM_LWIP_DNS_H
@@ -0,0 +1,351 @@
+/**
+ * File: netshim.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: lwIP altcp and DNS over non-blocking sockets of the host. The
+ * callbacks run from async_context_poll(), as they run from the background
+ * worker of the firmware.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "lwip/altcp.h"
+#include "lwip/dns.h"
+#include "pico/cyw43_arch.h"
+#include "pico/stdlib.h"
+#include "shim.h"
+
+// Same as lwipopts.h of the firmware
+#define NETSHIM_MSS 1460
+#define NETSHIM_WINDOW (4 * NETSHIM_MSS)
+#define NETSHIM_MAX_PCBS 4
+#define NETSHIM_TICK_MS 500   // Coarse TCP timer of lwIP
+#define NETSHIM_MAX_READS 16  // Per connection and poll
+#define NETSHIM_HOSTNAME_SIZE 256
+
+struct altcp_pcb {
+  bool inUse;
+  unsigned int generation;  // Changes when closed, to detect reuse
+  int fd;
+  bool connecting;
+  bool remoteClosed;
+  void *arg;
+  altcp_recv_fn recv;
+  altcp_err_fn err;
+  altcp_poll_fn poll;
+  altcp_connected_fn connected;
+  u8_t pollInterval;
+  absolute_time_t lastPoll;
+  size_t window;  // Bytes that can be received before altcp_recved()
+};
+
+struct async_context {
+  int unused;
+};
+
+static struct altcp_pcb pcbs[NETSHIM_MAX_PCBS];
+static async_context_t context;
+static shim_net_stats_t stats;
+
+// Segments of the last read, passed as a pbuf chain
+static uint8_t recvBuffer[NETSHIM_WINDOW];
+static struct pbuf recvChain[(NETSHIM_WINDOW + NETSHIM_MSS - 1) / NETSHIM_MSS];
+
+// One DNS query at a time, like the firmware needs
+static struct {
+  bool pending;
+  char name[NETSHIM_HOSTNAME_SIZE];
+  bool found;
+  ip_addr_t addr;
+  dns_found_callback fn;
+  void *arg;
+} dnsQuery;
+
+static void freePcb(struct altcp_pcb *pcb, bool reset) {
+  if (reset) {
+    struct linger lingerOpt = {1, 0};  // Send a RST
+    setsockopt(pcb->fd, SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof(lingerOpt));
+  }
+  close(pcb->fd);
+  pcb->inUse = false;
+  pcb->generation++;
+}
+
+// lwIP frees the connection before calling the error callback
+static void failPcb(struct altcp_pcb *pcb, err_t err) {
+  altcp_err_fn errFn = pcb->err;
+  void *arg = pcb->arg;
+  freePcb(pcb, false);
+  if (errFn != NULL) {
+    errFn(arg, err);
+  }
+}
+
+static bool resolve(const char *hostname, ip_addr_t *addr) {
+  struct addrinfo hints;
+  struct addrinfo *result = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  shim_allocPause();
+  bool found = (getaddrinfo(hostname, NULL, &hints, &result) == 0) &&
+               (result != NULL);
+  if (found) {
+    addr->addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr;
+  }
+  if (result != NULL) {
+    freeaddrinfo(result);
+  }
+  shim_allocResume();
+  return found;
+}
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                        dns_found_callback found, void *callbackArg) {
+  struct in_addr numeric;
+  if (inet_pton(AF_INET, hostname, &numeric) == 1) {
+    addr->addr = numeric.s_addr;
+    return ERR_OK;
+  }
+  if (dnsQuery.pending) {
+    return ERR_VAL;
+  }
+  snprintf(dnsQuery.name, sizeof(dnsQuery.name), "%s", hostname);
+  dnsQuery.found = resolve(hostname, &dnsQuery.addr);
+  dnsQuery.fn = found;
+  dnsQuery.arg = callbackArg;
+  dnsQuery.pending = true;
+  return ERR_INPROGRESS;
+}
+
+struct altcp_pcb *altcp_new_ip_type(__unused void *allocator,
+                                    __unused u8_t ipType) {
+  for (int i = 0; i < NETSHIM_MAX_PCBS; i++) {
+    struct altcp_pcb *pcb = &pcbs[i];
+    if (pcb->inUse) {
+      continue;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+      return NULL;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    unsigned int generation = pcb->generation;
+    memset(pcb, 0, sizeof(struct altcp_pcb));
+    pcb->generation = generation;
+    pcb->inUse = true;
+    pcb->fd = fd;
+    pcb->window = NETSHIM_WINDOW;
+    return pcb;
+  }
+  return NULL;
+}
+
+void altcp_arg(struct altcp_pcb *conn, void *arg) { conn->arg = arg; }
+
+void altcp_recv(struct altcp_pcb *conn, altcp_recv_fn recv) {
+  conn->recv = recv;
+}
+
+void altcp_err(struct altcp_pcb *conn, altcp_err_fn err) { conn->err = err; }
+
+void altcp_poll(struct altcp_pcb *conn, altcp_poll_fn poll, u8_t interval) {
+  conn->poll = poll;
+  conn->pollInterval = interval;
+  conn->lastPoll = get_absolute_time();
+}
+
+err_t altcp_connect(struct altcp_pcb *conn, const ip_addr_t *ipaddr,
+                    u16_t port, altcp_connected_fn connected) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = ipaddr->addr;
+  if ((connect(conn->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) &&
+      (errno != EINPROGRESS)) {
+    return ERR_RTE;
+  }
+  // Reported from the async context, as lwIP does
+  conn->connecting = true;
+  conn->connected = connected;
+  return ERR_OK;
+}
+
+err_t altcp_write(struct altcp_pcb *conn, const void *dataptr, u16_t len,
+                  __unused u8_t apiflags) {
+  const uint8_t *data = dataptr;
+  while (len > 0) {
+    ssize_t sent = send(conn->fd, data, len, MSG_NOSIGNAL);
+    if (sent > 0) {
+      data += sent;
+      len -= (u16_t)sent;
+    } else if ((sent < 0) && (errno == EAGAIN)) {
+      struct pollfd pfd = {conn->fd, POLLOUT, 0};
+      poll(&pfd, 1, NETSHIM_TICK_MS);
+    } else {
+      return ERR_CONN;
+    }
+  }
+  return ERR_OK;
+}
+
+err_t altcp_output(__unused struct altcp_pcb *conn) { return ERR_OK; }
+
+void altcp_recved(struct altcp_pcb *conn, u16_t len) {
+  conn->window += len;
+  if (conn->window > NETSHIM_WINDOW) {
+    conn->window = NETSHIM_WINDOW;
+  }
+}
+
+err_t altcp_close(struct altcp_pcb *conn) {
+  freePcb(conn, false);
+  return ERR_OK;
+}
+
+void altcp_abort(struct altcp_pcb *conn) {
+  altcp_err_fn errFn = conn->err;
+  void *arg = conn->arg;
+  freePcb(conn, true);
+  if (errFn != NULL) {
+    errFn(arg, ERR_ABRT);
+  }
+}
+
+u8_t pbuf_free(__unused struct pbuf *p) { return 1; }
+
+// Pass the data received as a chain of segments
+static void deliver(struct altcp_pcb *pcb, size_t len) {
+  int count = 0;
+  for (size_t offset = 0; offset < len; offset += NETSHIM_MSS) {
+    size_t segment = len - offset;
+    if (segment > NETSHIM_MSS) {
+      segment = NETSHIM_MSS;
+    }
+    recvChain[count].payload = &recvBuffer[offset];
+    recvChain[count].len = (u16_t)segment;
+    recvChain[count].tot_len = (u16_t)(len - offset);
+    recvChain[count].next = NULL;
+    if (count > 0) {
+      recvChain[count - 1].next = &recvChain[count];
+    }
+    count++;
+  }
+  pcb->window -= len;
+  stats.segments += (uint32_t)count;
+  stats.bytes += len;
+  pcb->recv(pcb->arg, pcb, recvChain, ERR_OK);
+}
+
+static void pollConnecting(struct altcp_pcb *pcb) {
+  struct pollfd pfd = {pcb->fd, POLLOUT, 0};
+  if (poll(&pfd, 1, 0) <= 0) {
+    return;
+  }
+  int error = 0;
+  socklen_t errorLen = sizeof(error);
+  getsockopt(pcb->fd, SOL_SOCKET, SO_ERROR, &error, &errorLen);
+  if (error != 0) {
+    failPcb(pcb, ERR_RST);
+    return;
+  }
+  pcb->connecting = false;
+  stats.connections++;
+  if (pcb->connected != NULL) {
+    pcb->connected(pcb->arg, pcb, ERR_OK);
+  }
+}
+
+static void pollReceive(struct altcp_pcb *pcb) {
+  unsigned int generation = pcb->generation;
+  for (int reads = 0; (reads < NETSHIM_MAX_READS) && pcb->inUse &&
+                      (pcb->generation == generation) && (pcb->window > 0) &&
+                      !pcb->remoteClosed && (pcb->recv != NULL);
+       reads++) {
+    ssize_t received = recv(pcb->fd, recvBuffer, pcb->window, MSG_DONTWAIT);
+    if (received > 0) {
+      deliver(pcb, (size_t)received);
+    } else if (received == 0) {
+      pcb->remoteClosed = true;
+      pcb->recv(pcb->arg, pcb, NULL, ERR_OK);
+    } else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+      break;
+    } else {
+      failPcb(pcb, ERR_RST);  // Reset by the server
+    }
+  }
+}
+
+static void pollTimer(struct altcp_pcb *pcb) {
+  if ((pcb->poll == NULL) || (pcb->pollInterval == 0)) {
+    return;
+  }
+  absolute_time_t now = get_absolute_time();
+  if (absolute_time_diff_us(pcb->lastPoll, now) >=
+      (int64_t)pcb->pollInterval * NETSHIM_TICK_MS * 1000) {
+    pcb->lastPoll = now;
+    pcb->poll(pcb->arg, pcb);
+  }
+}
+
+async_context_t *cyw43_arch_async_context(void) { return &context; }
+
+void async_context_poll(__unused async_context_t *ctx) {
+  if (dnsQuery.pending) {
+    dnsQuery.pending = false;
+    dnsQuery.fn(dnsQuery.name, dnsQuery.found ? &dnsQuery.addr : NULL,
+                dnsQuery.arg);
+  }
+  // A callback can close a connection and open another one in its slot
+  for (int i = 0; i < NETSHIM_MAX_PCBS; i++) {
+    struct altcp_pcb *pcb = &pcbs[i];
+    unsigned int generation = pcb->generation;
+    if (pcb->inUse && pcb->connecting) {
+      pollConnecting(pcb);
+    } else if (pcb->inUse) {
+      pollReceive(pcb);
+    }
+    if (pcb->inUse && (pcb->generation == generation)) {
+      pollTimer(pcb);
+    }
+  }
+}
+
+void async_context_wait_for_work_ms(__unused async_context_t *ctx,
+                                    uint32_t ms) {
+  if (dnsQuery.pending) {
+    return;
+  }
+  struct pollfd fds[NETSHIM_MAX_PCBS];
+  nfds_t count = 0;
+  for (int i = 0; i < NETSHIM_MAX_PCBS; i++) {
+    const struct altcp_pcb *pcb = &pcbs[i];
+    if (!pcb->inUse) {
+      continue;
+    }
+    if (pcb->connecting) {
+      fds[count++] = (struct pollfd){pcb->fd, POLLOUT, 0};
+    } else if ((pcb->window > 0) && !pcb->remoteClosed) {
+      fds[count++] = (struct pollfd){pcb->fd, POLLIN, 0};
+    }
+  }
+  if (count > 0) {
+    poll(fds, count, (int)ms);
+  } else {
+    usleep(ms * 1000);
+  }
+}
+
+const shim_net_stats_t *shim_getNetStats(void) { return &stats; }
+
+void shim_resetNetStats(void) { memset(&stats, 0, sizeof(stats)); }
@@ -0,0 +1,46 @@
+/**
+ * File: cyw43_arch.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Stand-in of the CYW43 architecture for the host build. The
+ * async context runs the socket shim of lwIP.
+ */
+
+#ifndef SHIM_PICO_CYW43_ARCH_H
+#define SHIM_PICO_CYW43_ARCH_H
+
+#include <stdint.h>
+
+typedef struct async_context async_context_t;
+
+/**
+ * @brief Provides the only async context of the host build.
+ *
+ * @return A pointer to the async context.
+ */
+async_context_t *cyw43_arch_async_context(void);
+
+/**
+ * @brief Runs the pending work: DNS answers, connections established, data
+ * received and the periodic poll of each connection. The lwIP callbacks are
+ * called from here, like from the background worker of the firmware.
+ *
+ * @param context The async context.
+ */
+void async_context_poll(async_context_t *context);
+
+/**
+ * @brief Waits until there is work to do, or the timeout expires.
+ *
+ * @param context The async context.
+ * @param ms Maximum time to wait in milliseconds.
+ */
+void async_context_wait_for_work_ms(async_context_t *context, uint32_t ms);
+
+// The callbacks only run inside async_context_poll(). Nothing to lock.
+static inline void cyw43_arch_lwip_begin(void) {}
+
+static inline void cyw43_arch_lwip_end(void) {}
+
+#endif  // SHIM_PICO_CYW43_ARCH_H
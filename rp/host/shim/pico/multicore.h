@@ -0,0 +1,13 @@
+/**
+ * File: multicore.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Empty stand-in of the Pico SDK header for the host build. The
+ * worker of the secondary core is not built.
+ */
+
+#ifndef SHIM_PICO_MULTICORE_H
+#define SHIM_PICO_MULTICORE_H
+
+#endif  // SHIM_PICO_MULTICORE_H
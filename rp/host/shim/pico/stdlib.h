@@ -0,0 +1,51 @@
+/**
+ * File: stdlib.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Stand-in of the Pico SDK standard library for the host build:
+ * types and the microsecond clock
+ */
+
+#ifndef SHIM_PICO_STDLIB_H
+#define SHIM_PICO_STDLIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#ifndef __unused
+#define __unused __attribute__((unused))
+#endif
+
+#define NUM_CORES 2
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;  // Microseconds
+
+static inline absolute_time_t get_absolute_time(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from,
+                                            absolute_time_t to) {
+  return (int64_t)(to - from);
+}
+
+static inline uint32_t time_us_32(void) {
+  return (uint32_t)get_absolute_time();
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+  return (uint32_t)(t / 1000);
+}
+
+static inline void tight_loop_contents(void) {}
+
+#endif  // SHIM_PICO_STDLIB_H
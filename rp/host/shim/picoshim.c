@@ -0,0 +1,123 @@
+/**
+ * File: picoshim.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Flash memory, settings of the app, counted memory
+ * allocations, and the worker and counters left out of the host build
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "aconfig.h"
+#include "hardware/flash.h"
+#include "perf.h"
+#include "settings.h"
+#include "shim.h"
+#include "worker.h"
+
+#define PICOSHIM_MAX_SETTINGS 8
+
+static uint8_t flash[PICO_FLASH_SIZE_BYTES];
+
+static SettingsConfigEntry entries[PICOSHIM_MAX_SETTINGS];
+static SettingsContext context = {{0, entries, 0}, 0, 0};
+
+static shim_alloc_stats_t allocStats;
+static int allocPaused = 0;
+
+void flash_range_erase(uint32_t flashOffs, size_t count) {
+  if (flashOffs + count <= sizeof(flash)) {
+    memset(&flash[flashOffs], 0xFF, count);
+  }
+}
+
+// Like the flash, bits can only go from 1 to 0
+void flash_range_program(uint32_t flashOffs, const uint8_t *data,
+                         size_t count) {
+  if (flashOffs + count <= sizeof(flash)) {
+    for (size_t i = 0; i < count; i++) {
+      flash[flashOffs + i] &= data[i];
+    }
+  }
+}
+
+const uint8_t *shim_getFlash(void) { return flash; }
+
+// There is no core1 to park while the flash is programmed
+void worker_lockoutStart(void) {}
+
+void worker_lockoutEnd(void) {}
+
+// dlbench reports the throughput itself
+void perf_add(perf_timer_id_t id, uint32_t elapsed, uint32_t bytes) {}
+
+void shim_setSetting(const char *key, const char *value) {
+  SettingsConfigEntry *entry = settings_find_entry(&context, key);
+  if (entry == NULL) {
+    if (context.configData.count >= PICOSHIM_MAX_SETTINGS) {
+      return;
+    }
+    entry = &entries[context.configData.count++];
+    snprintf(entry->key, sizeof(entry->key), "%s", key);
+    entry->dataType = SETTINGS_TYPE_STRING;
+  }
+  snprintf(entry->value, sizeof(entry->value), "%s", value);
+}
+
+SettingsConfigEntry *settings_find_entry(SettingsContext *ctx,
+                                         const char *key) {
+  for (size_t i = 0; i < ctx->configData.count; i++) {
+    if (strcmp(ctx->configData.entries[i].key, key) == 0) {
+      return &ctx->configData.entries[i];
+    }
+  }
+  return NULL;
+}
+
+SettingsContext *aconfig_getContext(void) { return &context; }
+
+// Linked with --wrap, so every allocation of the download path is counted
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static void countAlloc(size_t bytes) {
+  if (allocPaused == 0) {
+    allocStats.count++;
+    allocStats.bytes += bytes;
+  }
+}
+
+void *__wrap_malloc(size_t size) {
+  countAlloc(size);
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+  countAlloc(nmemb * size);
+  return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  countAlloc(size);
+  return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr) { __real_free(ptr); }
+
+void shim_allocPause(void) { allocPaused++; }
+
+void shim_allocResume(void) {
+  if (allocPaused > 0) {
+    allocPaused--;
+  }
+}
+
+const shim_alloc_stats_t *shim_getAllocStats(void) { return &allocStats; }
+
+void shim_resetAllocStats(void) {
+  memset(&allocStats, 0, sizeof(allocStats));
+}
@@ -0,0 +1,19 @@
+/**
+ * File: sd_card.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Stand-in of the SD card driver header for the host build. Only
+ * the types named by sdcard.h, the download path does not use the driver.
+ */
+
+#ifndef SHIM_SD_CARD_H
+#define SHIM_SD_CARD_H
+
+#include "ff.h"
+
+// Only pointers to them in sdcard.h
+typedef struct sd_card_t sd_card_t;
+typedef struct spi_t spi_t;
+
+#endif  // SHIM_SD_CARD_H
@@ -0,0 +1,88 @@
+/**
+ * File: shim.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Controls and counters of the host stand-ins of the SDK, lwIP
+ * and FatFs
+ */
+
+#ifndef SHIM_H
+#define SHIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ff.h"
+#include "hardware/flash.h"
+
+typedef struct {
+  uint32_t writes;   // f_write calls
+  uint32_t syncs;    // f_sync calls
+  uint32_t expands;  // f_expand calls that reserved space
+  uint64_t bytes;    // Bytes written
+} shim_fs_stats_t;
+
+typedef struct {
+  uint32_t connections;  // Sockets connected
+  uint32_t segments;     // pbufs delivered to the receive callbacks
+  uint64_t bytes;        // Bytes received
+} shim_net_stats_t;
+
+typedef struct {
+  uint32_t count;  // malloc, calloc and realloc calls
+  uint64_t bytes;  // Bytes requested
+} shim_alloc_stats_t;
+
+/**
+ * @brief Sets the folder of the host that holds the SD card. FatFs paths are
+ * relative to it.
+ *
+ * @param folder Folder of the host.
+ */
+void shim_setSdcardRoot(const char *folder);
+
+/**
+ * @brief Limits the free space reported by the SD card.
+ *
+ * @param bytes Free bytes. Zero for the free space of the host.
+ */
+void shim_setFreeBytes(uint64_t bytes);
+
+/**
+ * @brief Sets the value of a setting of the app, e.g. the ROM folder.
+ *
+ * @param key Key of the setting.
+ * @param value Value of the setting.
+ */
+void shim_setSetting(const char *key, const char *value);
+
+/**
+ * @brief Provides the flash memory, written by flash_range_program().
+ *
+ * @return A pointer to PICO_FLASH_SIZE_BYTES bytes, at the XIP_BASE address
+ * of the firmware.
+ */
+const uint8_t *shim_getFlash(void);
+
+const shim_fs_stats_t *shim_getFsStats(void);
+const shim_net_stats_t *shim_getNetStats(void);
+const shim_alloc_stats_t *shim_getAllocStats(void);
+
+// Reset the counters
+void shim_resetFsStats(void);
+void shim_resetNetStats(void);
+void shim_resetAllocStats(void);
+
+/**
+ * @brief Stops counting the memory allocations, for the code of the shim
+ * itself and of the benchmark. Calls can be nested.
+ */
+void shim_allocPause(void);
+
+/**
+ * @brief Counts the memory allocations again.
+ */
+void shim_allocResume(void);
+
+#endif  // SHIM_H
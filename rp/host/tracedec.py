@@ -0,0 +1,119 @@
+"""Decoder of the trace saved by the 'trace' command of the firmware.
+
+The firmware must be built with TRACE_MODE=1. The 'trace' command writes the
+last records of each core to /trace.bin in the microSD card:
+
+    python3 tracedec.py /path/to/trace.bin
+
+The names of the events and of their arguments are read from trace.h, so
+the decoder follows the firmware it was built with. The records of both
+cores are merged by time, and shown relative to the first one.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+TRACE_FILE_MAGIC = 0x31435254  # "TRC1"
+TRACE_FILE_VERSION = 1
+NUM_CORES = 2
+
+HEADER = struct.Struct("<IHH%dI%dI" % (NUM_CORES, NUM_CORES))
+RECORD = struct.Struct("<IHBBII")
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                              "..", "src", "include", "trace.h")
+EVENT_LINE = re.compile(r'^\s*X\((\w+),\s*"([^"]*)",\s*"([^"]*)"\)')
+
+
+def read_events(path):
+    """Names and arguments of the events, in the order of trace_event_t.
+    TRACE_NONE is 0, so the first event of TRACE_EVENTS is 1."""
+    events = [("TRACE_NONE", "", "")]
+    with open(path, encoding="utf-8") as header:
+        for line in header:
+            match = EVENT_LINE.match(line)
+            if match:
+                events.append(match.groups())
+    return events
+
+
+def read_records(path):
+    with open(path, "rb") as trace:
+        data = trace.read()
+    if len(data) < HEADER.size:
+        raise ValueError("too short for a trace")
+    fields = HEADER.unpack_from(data)
+    magic, version, record_size = fields[:3]
+    counts = fields[3:3 + NUM_CORES]
+    lost = fields[3 + NUM_CORES:]
+    if magic != TRACE_FILE_MAGIC:
+        raise ValueError("not a trace, magic 0x%08X" % magic)
+    if version != TRACE_FILE_VERSION or record_size != RECORD.size:
+        raise ValueError("version %d with records of %d bytes not supported"
+                         % (version, record_size))
+    records = []
+    offset = HEADER.size
+    for core in range(NUM_CORES):
+        for _ in range(counts[core]):
+            if offset + RECORD.size > len(data):
+                raise ValueError("truncated in the records of core %d" % core)
+            records.append(RECORD.unpack_from(data, offset))
+            offset += RECORD.size
+    return records, counts, lost
+
+
+def format_arg(name, value):
+    if name == "":
+        return ""
+    if name in ("function", "offset", "checksum"):
+        return "%s=0x%08X" % (name, value)
+    return "%s=%d" % (name, value)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace", help="file saved by the 'trace' command")
+    parser.add_argument("--header", default=DEFAULT_HEADER,
+                        help="trace.h with the events (default: %(default)s)")
+    args = parser.parse_args()
+
+    events = read_events(args.header)
+    try:
+        records, counts, lost = read_records(args.trace)
+    except (OSError, ValueError) as error:
+        sys.exit("%s: %s" % (args.trace, error))
+
+    for core in range(NUM_CORES):
+        print("# core %d: %d records, %d lost before them"
+              % (core, counts[core], lost[core]))
+    if not records:
+        return
+
+    # time_us_32() wraps every 71 minutes. The rings cover much less, so
+    # the times are taken modulo 2^32 from the oldest record of the cores.
+    oldest = [records[sum(counts[:core])][0]
+              for core in range(NUM_CORES) if counts[core] > 0]
+    first = oldest[0]
+    for time_us in oldest[1:]:
+        if (first - time_us) & 0xFFFFFFFF < 0x80000000:
+            first = time_us
+    records.sort(key=lambda r: (r[0] - first) & 0xFFFFFFFF)
+    previous = first
+    for time_us, event, core, _, arg0, arg1 in records:
+        if event < len(events):
+            name, name0, name1 = events[event]
+        else:
+            name, name0, name1 = "EVENT_%d" % event, "arg0", "arg1"
+        relative = (time_us - first) & 0xFFFFFFFF
+        delta = (time_us - previous) & 0xFFFFFFFF
+        previous = time_us
+        fields = [format_arg(name0, arg0), format_arg(name1, arg1)]
+        print("%12d %+10d c%d %-24s %s" % (relative, delta, core, name,
+                                          " ".join(f for f in fields if f)))
+
+
+if __name__ == "__main__":
+    main()
@@ -10,6 +10,20 @@ static SettingsConfigEntry defaultEntries[] = {
      "https://roms.sidecartridge.com/roms.csv"},
     {ACONFIG_PARAM_ROM_MODE, SETTINGS_TYPE_INT,
      "255"},  // 0: ROM, 1: DELAY-ROM, 255: MENU
+    {ACONFIG_PARAM_WIFI_CACHE, SETTINGS_TYPE_STRING,
+     ""},  // Last connection, see network_getStaCache()
+    {ACONFIG_PARAM_ROM_PUSH, SETTINGS_TYPE_BOOL,
+     "false"},  // Load ROM images pushed over the network while emulating
+    {ACONFIG_PARAM_SD_CALIBRATION, SETTINGS_TYPE_STRING,
+     ""},  // SD card and its fastest SPI clock, see sdcal_calibrate()
+    {ACONFIG_PARAM_PROFILE, SETTINGS_TYPE_STRING,
+     "auto"},  // Clock and voltage profile, or auto. See profile.h.
+    {ACONFIG_PARAM_MACHINE, SETTINGS_TYPE_INT,
+     "-1"},  // Computer reported by the setup, the _MCH cookie
+    {ACONFIG_PARAM_ROM_TIMING, SETTINGS_TYPE_STRING,
+     "auto"},  // Timing variant of the ROM reads, or auto. See romemul.h.
+    {ACONFIG_PARAM_BUS_TRACE, SETTINGS_TYPE_BOOL,
+     "false"},  // Record the accesses to the ROM in Ripper mode
 };
 
 // Create a global context for our settings
@@ -0,0 +1,85 @@
+/**
+ * File: arena.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Static arenas of the working buffers, instead of the heap
+ */
+
+#include "arena.h"
+
+#include "bustrace.h"
+#include "extsort.h"
+#include "hardware/flash.h"
+#include "profile.h"
+#include "romindex.h"
+#include "sdcal.h"
+#include "term.h"
+
+// The users of each arena must fit in its budget
+#if SDCAL_BENCH_CHUNK > ARENA_SCRATCH_SIZE
+#error "ARENA_SCRATCH_SIZE too small for SDCAL_BENCH_CHUNK"
+#endif
+#if FLASH_SECTOR_SIZE > ARENA_SCRATCH_SIZE
+#error "ARENA_SCRATCH_SIZE too small for FLASH_SECTOR_SIZE"
+#endif
+#if TERM_PRINT_SETTINGS_BUFFER_SIZE > ARENA_SCRATCH_SIZE
+#error "ARENA_SCRATCH_SIZE too small for TERM_PRINT_SETTINGS_BUFFER_SIZE"
+#endif
+#if (ROMINDEX_MERGE_CHUNK * ROMINDEX_NAME_LENGTH) > ARENA_SCRATCH_SIZE
+#error "ARENA_SCRATCH_SIZE too small for ROMINDEX_MERGE_CHUNK"
+#endif
+#if BUSTRACE_ARENA_BYTES > ARENA_TRACE_SIZE
+#error "ARENA_TRACE_SIZE too small for BUSTRACE_ARENA_BYTES"
+#endif
+#if BUSTRACE_RING_BYTES > ARENA_TRACE_ALIGNMENT
+#error "ARENA_TRACE_ALIGNMENT too small for BUSTRACE_RING_BYTES"
+#endif
+#if PROFILE_BENCH_BYTES > ARENA_SCRATCH_SIZE
+#error "ARENA_SCRATCH_SIZE too small for PROFILE_BENCH_BYTES"
+#endif
+#if EXTSORT_CHUNK_SIZE > ARENA_SORT_SIZE
+#error "ARENA_SORT_SIZE too small for EXTSORT_CHUNK_SIZE"
+#endif
+
+#define ARENA_STORAGE(id, name, size, alignment) \
+  static uint8_t id##_storage[size] __attribute__((aligned(alignment)));
+ARENA_BUDGET(ARENA_STORAGE)
+#undef ARENA_STORAGE
+
+#define ARENA_INIT(id, name, size, alignment) \
+  {name, id##_storage, size, 0, 0, 0},
+static arena_t arenas[ARENA_COUNT] = {ARENA_BUDGET(ARENA_INIT)};
+#undef ARENA_INIT
+
+void *arena_alloc(arena_id_t id, size_t size) {
+  arena_t *arena = &arenas[id];
+  size_t aligned = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+  if (aligned > arena->size - arena->used) {
+    arena->failures++;
+    DPRINTF("Arena %s full: %u bytes asked, %u free\n", arena->name,
+            (unsigned int)size, (unsigned int)(arena->size - arena->used));
+    return NULL;
+  }
+  void *buffer = &arena->base[arena->used];
+  arena->used += aligned;
+  if (arena->used > arena->highWater) {
+    arena->highWater = arena->used;
+  }
+  return buffer;
+}
+
+void arena_free(arena_id_t id, void *buffer) {
+  arena_t *arena = &arenas[id];
+  if (buffer == NULL) {
+    return;
+  }
+  size_t offset = (size_t)((uint8_t *)buffer - arena->base);
+  if (offset >= arena->used) {
+    DPRINTF("Arena %s: buffer %p not in use\n", arena->name, buffer);
+    return;
+  }
+  arena->used = offset;
+}
+
+const arena_t *arena_get(arena_id_t id) { return &arenas[id]; }
@@ -0,0 +1,328 @@
+/**
+ * File: bustrace.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Recorder of the accesses of the computer to the ROM. The DMA
+ * copies each access to the rings, an alarm of core0 compresses them, and
+ * core1 writes them to the microSD card.
+ */
+
+#include "bustrace.h"
+
+static FATFS filesystem;
+static FIL file;
+static uint8_t *buffer = NULL;
+static uint32_t *addresses = NULL;
+static uint32_t *times = NULL;
+
+// Queue of compressed bytes. core0 fills the buffer at queueHead and hands
+// it over, core1 writes the buffers from queueTail up to queueHead.
+static uint8_t *queue = NULL;
+static uint32_t queueUsed[BUSTRACE_OUT_BUFFERS];
+static volatile uint32_t queueHead = 0;
+static volatile uint32_t queueTail = 0;
+
+static bustrace_file_header_t header;
+static bustrace_stats_t stats;
+
+// Set by core0 to end the job of the writer in core1
+static volatile bool stopRequested = false;
+static alarm_id_t drainAlarmId = 0;
+
+// State of the compression, only used by the alarm of core0
+static uint32_t outUsed = 0;      // Of the buffer at queueHead
+static uint32_t lastHandOff = 0;  // ms
+static bool dropping = false;     // The queue was full. A gap goes next.
+static uint32_t tail = 0;         // Next slot of the rings to compress
+static uint32_t lastSeen = 0;  // Time of the last access read from the rings
+static uint32_t prevAddress = 0;
+static uint32_t prevTime = 0;
+static uint32_t prevZigzag = 0;
+static uint32_t prevTimeDelta = 0;
+static bool repeatable = false;
+static uint32_t run = 0;
+
+// Gives the buffer filled to core1. false if all the others wait for it.
+static bool handOff(void) {
+  uint32_t next = (queueHead + 1) % BUSTRACE_OUT_BUFFERS;
+  if (next == queueTail) {
+    return false;
+  }
+  queueUsed[queueHead] = outUsed;
+  __dmb();
+  queueHead = next;
+  outUsed = 0;
+  lastHandOff = to_ms_since_boot(get_absolute_time());
+  return true;
+}
+
+// Room for one more access in the buffer filled
+static bool makeRoom(void) {
+  return (outUsed + BUSTRACE_ENTRY_MAX_BYTES <= BUSTRACE_OUT_BYTES) ||
+         handOff();
+}
+
+static inline void putVarint(uint32_t value) {
+  uint8_t *out = &queue[queueHead * BUSTRACE_OUT_BYTES];
+  while (value >= 0x80) {
+    out[outUsed++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[outUsed++] = (uint8_t)value;
+}
+
+static void flushRun(void) {
+  if (run > 0) {
+    putVarint((run << 1) | 1);
+    run = 0;
+  }
+}
+
+// The next access is relative to address 0 and to the start again
+static void putGap(void) {
+  flushRun();
+  putVarint(1);
+  prevAddress = 0;
+  prevTime = header.startUs;
+  repeatable = false;
+  dropping = false;
+  stats.gaps++;
+}
+
+static void putAccess(uint32_t address, uint32_t time) {
+  address &= BUSTRACE_ADDRESS_MASK;
+  int32_t addressDelta = (int32_t)address - (int32_t)prevAddress;
+  uint32_t zigzag =
+      ((uint32_t)addressDelta << 1) ^ (uint32_t)(addressDelta >> 31);
+  uint32_t timeDelta = time - prevTime;
+  prevAddress = address;
+  prevTime = time;
+  stats.accesses++;
+  // Code and copies read the ROM in sequence at a steady pace
+  if (repeatable && (zigzag == prevZigzag) && (timeDelta == prevTimeDelta) &&
+      (run < (UINT32_MAX >> 1))) {
+    run++;
+    return;
+  }
+  flushRun();
+  putVarint(zigzag << 1);
+  putVarint(timeDelta);
+  prevZigzag = zigzag;
+  prevTimeDelta = timeDelta;
+  repeatable = true;
+}
+
+// Compresses the accesses in the rings. The slot the DMA writes next holds
+// the access of a lap before: if it is newer than the last one read, the DMA
+// lapped the recorder and the accesses in between are lost. The accesses
+// that do not fit in the queue are lost too.
+static void drain(void) {
+  uint32_t head = romemul_getCaptureIndex() & (BUSTRACE_RING_RECORDS - 1);
+  if ((int32_t)(times[head] - lastSeen) > 0) {
+    if ((romemul_getCaptureIndex() & (BUSTRACE_RING_RECORDS - 1)) != head) {
+      return;  // Written meanwhile. Check it again.
+    }
+    if (makeRoom()) {
+      putGap();
+    } else {
+      dropping = true;
+    }
+    tail = head;
+    lastSeen = times[(head - 1) & (BUSTRACE_RING_RECORDS - 1)];
+    return;
+  }
+  while (tail != head) {
+    lastSeen = times[tail];
+    if (makeRoom()) {
+      if (dropping) {
+        putGap();
+      }
+      putAccess(addresses[tail], lastSeen);
+    } else {
+      dropping = true;
+      stats.dropped++;
+    }
+    tail = (tail + 1) & (BUSTRACE_RING_RECORDS - 1);
+  }
+}
+
+// Alarm of core0, until bustrace_stop()
+static int64_t drainAlarm(alarm_id_t id, void *userData) {
+  drain();
+  // Keeps what was recorded if the power goes off
+  if ((outUsed > 0) && (to_ms_since_boot(get_absolute_time()) - lastHandOff >=
+                        BUSTRACE_FLUSH_MS)) {
+    handOff();
+  }
+  return BUSTRACE_DRAIN_US;
+}
+
+// Writes the buffers handed over by core0
+static bool writeQueue(void) {
+  bool written = false;
+  while (queueTail != queueHead) {
+    uint32_t slot = queueTail;
+    __dmb();
+    if (stats.error == FR_OK) {
+      UINT bytes;
+      FRESULT res = f_write(&file, &queue[slot * BUSTRACE_OUT_BYTES],
+                            queueUsed[slot], &bytes);
+      if ((res == FR_OK) && (bytes != queueUsed[slot])) {
+        res = FR_DENIED;  // Card full
+      }
+      if (res != FR_OK) {
+        stats.error = res;
+      } else {
+        stats.bytes += queueUsed[slot];
+      }
+    }
+    queueTail = (slot + 1) % BUSTRACE_OUT_BUFFERS;
+    written = true;
+  }
+  return written;
+}
+
+// Job of core1, until bustrace_stop()
+static void record(void *context) {
+  (void)context;
+  uint32_t lastSync = to_ms_since_boot(get_absolute_time());
+  bool pending = false;
+  while (!stopRequested) {
+    worker_yield();
+    pending |= writeQueue();
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    if (pending && (now - lastSync >= BUSTRACE_FLUSH_MS)) {
+      f_sync(&file);
+      lastSync = now;
+      pending = false;
+    }
+  }
+  writeQueue();
+}
+
+static bool mountCard(void) {
+  if (sdcard_initFilesystem(&filesystem, "") != SDCARD_INIT_OK) {
+    return false;
+  }
+  SettingsConfigEntry *calibration =
+      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_SD_CALIBRATION);
+  sdcal_applyCalibration((calibration != NULL) ? calibration->value : NULL);
+  return true;
+}
+
+bool bustrace_init(void) {
+  if (!mountCard()) {
+    DPRINTF("No microSD card. The bus is not recorded.\n");
+    return false;
+  }
+  buffer = arena_alloc(ARENA_TRACE, BUSTRACE_ARENA_BYTES);
+  if (buffer == NULL) {
+    DPRINTF("No memory to record the bus\n");
+    return false;
+  }
+  // The DMA wraps the rings on the low bits of the address. The arena is
+  // aligned to their size.
+  addresses = (uint32_t *)buffer;
+  times = addresses + BUSTRACE_RING_RECORDS;
+  queue = (uint8_t *)(times + BUSTRACE_RING_RECORDS);
+
+  FRESULT res = f_open(&file, BUSTRACE_FILENAME, FA_WRITE | FA_CREATE_ALWAYS);
+  if (res != FR_OK) {
+    DPRINTF("Error creating %s: %d\n", BUSTRACE_FILENAME, res);
+    arena_free(ARENA_TRACE, buffer);
+    return false;
+  }
+  memset(&header, 0, sizeof(header));
+  header.magic = BUSTRACE_FILE_MAGIC;
+  header.version = BUSTRACE_FILE_VERSION;
+  header.startUs = time_us_32();
+  UINT bytes;
+  f_write(&file, &header, sizeof(header), &bytes);
+
+  // No slot is newer than the start
+  memset(addresses, 0, BUSTRACE_RING_BYTES);
+  for (uint32_t i = 0; i < BUSTRACE_RING_RECORDS; i++) {
+    times[i] = header.startUs;
+  }
+  memset(&stats, 0, sizeof(stats));
+  tail = 0;
+  lastSeen = header.startUs;
+  prevAddress = 0;
+  prevTime = header.startUs;
+  repeatable = false;
+  run = 0;
+  outUsed = 0;
+  dropping = false;
+  queueHead = 0;
+  queueTail = 0;
+  stopRequested = false;
+
+  romemul_capture_t capture = {addresses, times, BUSTRACE_RING_BITS};
+  romemul_setCapture(&capture);
+  DPRINTF("Recording the bus to %s\n", BUSTRACE_FILENAME);
+  return true;
+}
+
+void bustrace_start(void) {
+  worker_start();
+  if (worker_submit(record, NULL, NULL) != WORKER_OK) {
+    DPRINTF("Error starting the writer of the bus\n");
+  }
+  lastHandOff = to_ms_since_boot(get_absolute_time());
+  drainAlarmId = add_alarm_in_us(BUSTRACE_DRAIN_US, drainAlarm, NULL, true);
+  if (drainAlarmId <= 0) {
+    DPRINTF("Error starting the recorder of the bus\n");
+  }
+}
+
+const bustrace_stats_t *bustrace_stop(void) {
+  if (drainAlarmId > 0) {
+    cancel_alarm(drainAlarmId);
+    drainAlarmId = 0;
+  }
+  // The accesses left and the last buffer, once core1 makes room for them
+  drain();
+  while (!makeRoom()) {
+    tight_loop_contents();
+  }
+  flushRun();
+  while ((outUsed > 0) && !handOff()) {
+    tight_loop_contents();
+  }
+  stopRequested = true;
+  worker_stop();
+
+  header.accesses = stats.accesses;
+  header.gaps = stats.gaps;
+  header.bytes = stats.bytes;
+  UINT bytes;
+  FRESULT res = f_lseek(&file, 0);
+  if (res == FR_OK) {
+    res = f_write(&file, &header, sizeof(header), &bytes);
+  }
+  FRESULT closeRes = f_close(&file);
+  if (stats.error == FR_OK) {
+    stats.error = (res != FR_OK) ? res : closeRes;
+  }
+  arena_free(ARENA_TRACE, buffer);
+  DPRINTF("Bus recorded: %u accesses, %u gaps, %u dropped, %u bytes. "
+          "Error: %d\n",
+          (unsigned int)stats.accesses, (unsigned int)stats.gaps,
+          (unsigned int)stats.dropped, (unsigned int)stats.bytes,
+          stats.error);
+  return &stats;
+}
+
+bool bustrace_readLast(bustrace_file_header_t *last) {
+  FIL trace;
+  if (f_open(&trace, BUSTRACE_FILENAME, FA_READ) != FR_OK) {
+    return false;
+  }
+  UINT bytes;
+  FRESULT res = f_read(&trace, last, sizeof(bustrace_file_header_t), &bytes);
+  f_close(&trace);
+  return (res == FR_OK) && (bytes == sizeof(bustrace_file_header_t)) &&
+         (last->magic == BUSTRACE_FILE_MAGIC) &&
+         (last->version == BUSTRACE_FILE_VERSION) && (last->bytes > 0);
+}
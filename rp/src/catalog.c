@@ -0,0 +1,1077 @@
+/**
+ * File: catalog.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Paged ROM catalog backed by a per-page string arena
+ */
+
+#include "catalog.h"
+
+// Sorting key of a CSV line: the decoded filename, and the offset of the line
+// in the file to break ties between duplicated filenames.
+typedef struct {
+  char filename[CATALOG_NAME_LENGTH];
+  uint32_t offset;
+} csv_key_t;
+
+typedef struct {
+  char url[CATALOG_TEXT_LENGTH];
+  char name[CATALOG_TEXT_LENGTH];
+  char description[CATALOG_TEXT_LENGTH];
+  char tags[CATALOG_TEXT_LENGTH];
+  char size[CATALOG_CSV_SIZE_LENGTH];
+  char hash[CATALOG_HASH_LENGTH];
+} csv_fields_t;
+
+// State of the producer of the keys of the CSV file to sort
+typedef struct {
+  FIL file;
+  int count;
+} csv_sort_t;
+
+static catalog_source_t source = CATALOG_SOURCE_NONE;
+static char sourcePath[CATALOG_PATH_SIZE];
+static int entriesCount = 0;
+
+// Page loaded. The strings of the entries live in the arena.
+static int loadedPage = -1;
+static catalog_entry_t pageEntries[CATALOG_PAGE_SIZE];
+static int pageEntriesCount = 0;
+static char arena[CATALOG_ARENA_SIZE];
+static size_t arenaUsed = 0;
+
+// Scratch area to read a page, shared by all the sources
+static union {
+  csv_key_t keys[CATALOG_PAGE_SIZE];
+  romindex_entry_t entries[CATALOG_PAGE_SIZE];
+  uint32_t offsets[CATALOG_PAGE_SIZE + 1];
+} scratch;
+
+// Header of the binary catalog opened
+static catalog_header_t binaryHeader;
+
+// Working buffers to parse the CSV file. Kept out of the stack.
+static char csvLine[CATALOG_CSV_LINE_SIZE];
+static csv_fields_t csvFields;
+
+// Offset of the line of the last entry of each CSV page already selected.
+// It is the lower bound to select the entries of the next page.
+static uint32_t csvPageLast[CATALOG_MAX_PAGES];
+static int csvPagesKnown = 0;
+
+// Results of the last search, as positions in the catalog
+static bool searchActive = false;
+static uint16_t searchResults[CATALOG_SEARCH_MAX_RESULTS];
+static int searchCount = 0;
+
+// State of the producer of records to build the search index. Kept out of the
+// stack.
+static struct {
+  FIL table;
+  FIL records;
+  uint32_t index;
+  uint32_t end;  // File offset of the end of the previous record
+  char record[CATALOG_RECORD_MIN + CATALOG_TEXT_LENGTH];
+} searchBuild;
+
+static void arenaReset(void) { arenaUsed = 0; }
+
+// Copy a string into the arena. If the arena is full the string is truncated,
+// so put the least important fields last.
+static const char *arenaStrdup(const char *src, size_t maxLength) {
+  size_t available = CATALOG_ARENA_SIZE - arenaUsed;
+  if (available == 0) {
+    return "";
+  }
+  size_t len = strnlen(src, maxLength - 1);
+  if (len >= available) {
+    len = available - 1;
+  }
+  char *dest = &arena[arenaUsed];
+  memcpy(dest, src, len);
+  dest[len] = '\0';
+  arenaUsed += len + 1;
+  return dest;
+}
+
+//-----------------------------------------------------------------
+// Helper: URL-decode a string.
+// Converts %xx sequences into their character values.
+// dest_size includes room for the null terminator.
+static void urlDecode(const char *src, char *dest, size_t destSize) {
+  size_t idx = 0;
+  while (*src && idx < destSize - 1) {
+    if (*src == '%') {
+      // Check if next two characters are valid hex digits.
+      if (isxdigit((unsigned char)*(src + 1)) &&
+          isxdigit((unsigned char)*(src + 2))) {
+        char hex[3] = {*(src + 1), *(src + 2), '\0'};
+        dest[idx++] = (char)strtol(hex, NULL, HEX_BASE);
+        src += 3;
+        continue;
+      }
+    }
+    dest[idx++] = *src++;
+  }
+  dest[idx] = '\0';
+}
+
+static bool parseCsvLine(const char *line, csv_fields_t *fields) {
+  const char *ptr = line;
+  size_t jdx;
+
+  if (line[0] == '\0' || line[0] == '\n') {
+    return false;
+  }
+
+// Tiny helper: extracts quoted CSV field (no inner quotes support)
+#define EXTRACT_FIELD(dest)                                \
+  do {                                                     \
+    while (*ptr && isspace((unsigned char)*ptr)) ptr++;    \
+    if (*ptr != '\"') return false;                        \
+    ptr++;                                                 \
+    jdx = 0;                                               \
+    while (*ptr && *ptr != '\"' && jdx < sizeof(dest) - 1) \
+      dest[jdx++] = *ptr++;                                \
+    dest[jdx] = 0;                                         \
+    if (*ptr == '\"') ptr++;                               \
+    while (*ptr && (*ptr == ',' || isspace(*ptr))) ptr++;  \
+  } while (0)
+
+  EXTRACT_FIELD(fields->url);
+  EXTRACT_FIELD(fields->name);
+  EXTRACT_FIELD(fields->description);
+  EXTRACT_FIELD(fields->tags);
+  EXTRACT_FIELD(fields->size);
+  // The hash is optional. Older catalogs do not have it.
+  fields->hash[0] = '\0';
+  if (*ptr == '\"') {
+    EXTRACT_FIELD(fields->hash);
+  }
+#undef EXTRACT_FIELD
+  return true;
+}
+
+static int compareKeys(const csv_key_t *keyA, const csv_key_t *keyB) {
+  int cmp = strcasecmp(keyA->filename, keyB->filename);
+  if (cmp != 0) {
+    return cmp;
+  }
+  return (keyA->offset > keyB->offset) - (keyA->offset < keyB->offset);
+}
+
+// Read the next valid line of the CSV file and return its key. Returns false
+// at the end of the file.
+static bool readCsvKey(FIL *file, csv_key_t *key) {
+  for (;;) {
+    uint32_t offset = (uint32_t)f_tell(file);
+    if (f_gets(csvLine, sizeof(csvLine), file) == NULL) {
+      return false;
+    }
+    if (parseCsvLine(csvLine, &csvFields)) {
+      urlDecode(csvFields.url, key->filename, sizeof(key->filename));
+      key->offset = offset;
+      return true;
+    }
+  }
+}
+
+static bool readCsvLineAt(FIL *file, uint32_t offset) {
+  if (f_lseek(file, offset) != FR_OK) {
+    return false;
+  }
+  if (f_gets(csvLine, sizeof(csvLine), file) == NULL) {
+    return false;
+  }
+  return parseCsvLine(csvLine, &csvFields);
+}
+
+// Select the sorted entries of a page with one pass over the file: keep the
+// CATALOG_PAGE_SIZE smallest keys above the last key of the previous page.
+static catalog_status_t selectCsvPage(FIL *file, int page, int *selected) {
+  csv_key_t key;
+  csv_key_t boundary;
+  bool hasBoundary = (page > 0);
+
+  if (hasBoundary) {
+    if (!readCsvLineAt(file, csvPageLast[page - 1])) {
+      return CATALOG_READ_ERROR;
+    }
+    urlDecode(csvFields.url, boundary.filename, sizeof(boundary.filename));
+    boundary.offset = csvPageLast[page - 1];
+  }
+
+  // Skip header
+  if ((f_lseek(file, 0) != FR_OK) ||
+      (f_gets(csvLine, sizeof(csvLine), file) == NULL)) {
+    return CATALOG_READ_ERROR;
+  }
+
+  int count = 0;
+  while (readCsvKey(file, &key)) {
+    if (hasBoundary && (compareKeys(&key, &boundary) <= 0)) {
+      continue;
+    }
+    if ((count == CATALOG_PAGE_SIZE) &&
+        (compareKeys(&key, &scratch.keys[count - 1]) >= 0)) {
+      continue;
+    }
+    if (count < CATALOG_PAGE_SIZE) {
+      count++;
+    }
+    int pos = count - 1;
+    while ((pos > 0) && (compareKeys(&key, &scratch.keys[pos - 1]) < 0)) {
+      scratch.keys[pos] = scratch.keys[pos - 1];
+      pos--;
+    }
+    scratch.keys[pos] = key;
+  }
+
+  if (count > 0) {
+    csvPageLast[page] = scratch.keys[count - 1].offset;
+    if (csvPagesKnown < page + 1) {
+      csvPagesKnown = page + 1;
+    }
+  }
+  *selected = count;
+  return CATALOG_OK;
+}
+
+static catalog_status_t loadCsvPage(int page) {
+  FIL file;
+  FRESULT res = f_open(&file, sourcePath, FA_READ);
+  if (res != FR_OK) {
+    DPRINTF("Error opening CSV file %s: %d\n", sourcePath, res);
+    return CATALOG_OPEN_ERROR;
+  }
+
+  // Pages are selected in order, as each one starts after the previous one
+  catalog_status_t status = CATALOG_OK;
+  int selected = 0;
+  while ((status == CATALOG_OK) && (csvPagesKnown < page)) {
+    status = selectCsvPage(&file, csvPagesKnown, &selected);
+    if (selected == 0) {
+      status = CATALOG_READ_ERROR;
+    }
+  }
+  if (status == CATALOG_OK) {
+    status = selectCsvPage(&file, page, &selected);
+  }
+
+  // Now decode the fields of the lines selected into the arena
+  char decoded[CATALOG_TEXT_LENGTH];
+  for (int i = 0; (status == CATALOG_OK) && (i < selected); i++) {
+    if (!readCsvLineAt(&file, scratch.keys[i].offset)) {
+      status = CATALOG_READ_ERROR;
+      break;
+    }
+    catalog_entry_t *entry = &pageEntries[pageEntriesCount++];
+    entry->filename = arenaStrdup(scratch.keys[i].filename, CATALOG_NAME_LENGTH);
+    urlDecode(csvFields.name, decoded, sizeof(decoded));
+    entry->name = arenaStrdup(decoded, CATALOG_NAME_LENGTH);
+    urlDecode(csvFields.tags, decoded, sizeof(decoded));
+    entry->tags = arenaStrdup(decoded, CATALOG_NAME_LENGTH);
+    entry->hash = arenaStrdup(csvFields.hash, CATALOG_HASH_LENGTH);
+    urlDecode(csvFields.description, decoded, sizeof(decoded));
+    entry->description = arenaStrdup(decoded, CATALOG_TEXT_LENGTH);
+    entry->size = atoi(csvFields.size);
+  }
+  f_close(&file);
+  return status;
+}
+
+// Point the fields of an entry to the strings of a record in place
+static bool parseBinaryRecord(const char *ptr, const char *end,
+                              catalog_entry_t *entry) {
+  if ((end - ptr < (int)sizeof(int32_t) + 5) || (end[-1] != '\0')) {
+    return false;  // Corrupted record
+  }
+  int32_t romSize;
+  memcpy(&romSize, ptr, sizeof(romSize));
+  entry->size = romSize;
+  ptr += sizeof(romSize);
+  entry->filename = ptr;
+  ptr += strlen(ptr) + 1;
+  entry->name = (ptr < end) ? ptr : "";
+  ptr += strlen(entry->name) + 1;
+  entry->tags = (ptr < end) ? ptr : "";
+  ptr += strlen(entry->tags) + 1;
+  entry->hash = (ptr < end) ? ptr : "";
+  ptr += strlen(entry->hash) + 1;
+  entry->description = (ptr < end) ? ptr : "";
+  return true;
+}
+
+// Path of the binary catalog: the CSV path with the extension replaced
+static void getBinaryPath(const char *csvPath, const char *extension,
+                          char *path, size_t size) {
+  const char *dot = strrchr(csvPath, '.');
+  const char *slash = strrchr(csvPath, '/');
+  int baseLength = (dot != NULL && (slash == NULL || dot > slash))
+                       ? (int)(dot - csvPath)
+                       : (int)strlen(csvPath);
+  snprintf(path, size, "%.*s%s", baseLength, csvPath, extension);
+}
+
+static int compareKeysQsort(const void *first, const void *second) {
+  return compareKeys((const csv_key_t *)first, (const csv_key_t *)second);
+}
+
+static bool readKey(FIL *file, csv_key_t *key) {
+  UINT bytes;
+  FRESULT res = f_read(file, key, sizeof(csv_key_t), &bytes);
+  return (res == FR_OK) && (bytes == sizeof(csv_key_t));
+}
+
+static bool writeBytes(FIL *file, const void *data, UINT size) {
+  UINT bytes;
+  FRESULT res = f_write(file, data, size, &bytes);
+  return (res == FR_OK) && (bytes == size);
+}
+
+// Producer of the keys of the CSV file for the external sort
+static bool nextCsvKey(void *record, void *context) {
+  csv_sort_t *sort = (csv_sort_t *)context;
+  worker_yield();  // Converted in core1
+  if (sort->count >= CATALOG_MAX_PAGES * CATALOG_PAGE_SIZE) {
+    DPRINTF("Maximum ROM count reached (%d)\n", sort->count);
+    return false;
+  }
+  if (!readCsvKey(&sort->file, (csv_key_t *)record)) {
+    return false;
+  }
+  sort->count++;
+  return true;
+}
+
+// First step: sort the keys of the CSV lines by filename on the SD card
+static catalog_status_t sortCsvKeys(const char *csvPath, const char *pathA,
+                                    const char *pathB, int *count,
+                                    const char **sortedPath) {
+  csv_sort_t sort = {.count = 0};
+  FRESULT res = f_open(&sort.file, csvPath, FA_READ);
+  if (res != FR_OK) {
+    DPRINTF("Error opening CSV file %s: %d\n", csvPath, res);
+    return CATALOG_OPEN_ERROR;
+  }
+  // Skip header
+  if (f_gets(csvLine, sizeof(csvLine), &sort.file) == NULL) {
+    DPRINTF("Error reading header from CSV file\n");
+    f_close(&sort.file);
+    return CATALOG_READ_ERROR;
+  }
+  extsort_status_t status =
+      extsort_sort(pathA, pathB, sizeof(csv_key_t), nextCsvKey, &sort,
+                   compareKeysQsort, count, sortedPath);
+  f_close(&sort.file);
+  switch (status) {
+    case EXTSORT_OK:
+      return CATALOG_OK;
+    case EXTSORT_MEMORY_ERROR:
+      return CATALOG_MEMORY_ERROR;
+    case EXTSORT_WRITE_ERROR:
+      return CATALOG_WRITE_ERROR;
+    default:
+      return CATALOG_READ_ERROR;
+  }
+}
+
+// Append a string to a record, truncated to maxLength including the null
+// terminator. Returns the bytes used.
+static size_t appendString(char *dest, const char *src, size_t maxLength) {
+  size_t len = strnlen(src, maxLength - 1);
+  memcpy(dest, src, len);
+  dest[len] = '\0';
+  return len + 1;
+}
+
+// Last step: read the CSV lines in the order of the sorted keys, decode them
+// and write the records and their offset table.
+static catalog_status_t writeBinary(const char *csvPath, const char *keysPath,
+                                    const char *binPath, int count,
+                                    const FILINFO *csvInfo) {
+  FIL csvFile;
+  FIL keysFile;
+  FIL binFile;
+  if (f_open(&csvFile, csvPath, FA_READ) != FR_OK) {
+    return CATALOG_OPEN_ERROR;
+  }
+  if ((count > 0) && (f_open(&keysFile, keysPath, FA_READ) != FR_OK)) {
+    f_close(&csvFile);
+    return CATALOG_OPEN_ERROR;
+  }
+  if (f_open(&binFile, binPath, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+    f_close(&csvFile);
+    if (count > 0) {
+      f_close(&keysFile);
+    }
+    return CATALOG_WRITE_ERROR;
+  }
+
+  catalog_header_t header = {
+      .magic = CATALOG_MAGIC,
+      .version = CATALOG_VERSION,
+      .pageSize = CATALOG_PAGE_SIZE,
+      .arenaSize = CATALOG_ARENA_SIZE,
+      .reserved = 0,
+      .count = (uint32_t)count,
+      .recordsEnd = 0,
+      .csvSize = (uint32_t)csvInfo->fsize,
+      .csvDate = csvInfo->fdate,
+      .csvTime = csvInfo->ftime,
+  };
+  FSIZE_t tablePos = sizeof(catalog_header_t);
+  FSIZE_t recordPos = tablePos + (FSIZE_t)count * sizeof(uint32_t);
+
+  // Records go after the table. The offsets are buffered and flushed to the
+  // table every CATALOG_TABLE_CHUNK records to avoid seeking for each one.
+  catalog_status_t status = CATALOG_OK;
+  if (f_lseek(&binFile, recordPos) != FR_OK) {
+    status = CATALOG_WRITE_ERROR;
+  }
+  uint32_t tableChunk[CATALOG_TABLE_CHUNK];
+  int tableCount = 0;
+  char record[CATALOG_RECORD_MIN + CATALOG_TEXT_LENGTH];
+  char decoded[CATALOG_TEXT_LENGTH];
+  size_t pageBytes = 0;
+  csv_key_t key;
+  for (int i = 0; (status == CATALOG_OK) && (i < count); i++) {
+    worker_yield();  // Converted in core1
+    if (!readKey(&keysFile, &key) || !readCsvLineAt(&csvFile, key.offset)) {
+      status = CATALOG_READ_ERROR;
+      break;
+    }
+    int posInPage = i % CATALOG_PAGE_SIZE;
+    if (posInPage == 0) {
+      pageBytes = 0;
+    }
+    int32_t size = atoi(csvFields.size);
+    size_t len = sizeof(size);
+    memcpy(record, &size, sizeof(size));
+    len += appendString(&record[len], key.filename, CATALOG_NAME_LENGTH);
+    urlDecode(csvFields.name, decoded, sizeof(decoded));
+    len += appendString(&record[len], decoded, CATALOG_NAME_LENGTH);
+    urlDecode(csvFields.tags, decoded, sizeof(decoded));
+    len += appendString(&record[len], decoded, CATALOG_NAME_LENGTH);
+    len += appendString(&record[len], csvFields.hash, CATALOG_HASH_LENGTH);
+
+    // Keep room for the worst case of the records left in the page, so a
+    // whole page always fits in the arena.
+    size_t reserve =
+        (size_t)(CATALOG_PAGE_SIZE - 1 - posInPage) * (CATALOG_RECORD_MIN + 1);
+    size_t budget = CATALOG_ARENA_SIZE - pageBytes - len - reserve;
+    if (budget > CATALOG_TEXT_LENGTH) {
+      budget = CATALOG_TEXT_LENGTH;
+    }
+    urlDecode(csvFields.description, decoded, sizeof(decoded));
+    len += appendString(&record[len], decoded, budget);
+
+    tableChunk[tableCount++] = (uint32_t)f_tell(&binFile);
+    if (!writeBytes(&binFile, record, len)) {
+      status = CATALOG_WRITE_ERROR;
+      break;
+    }
+    pageBytes += len;
+
+    if ((tableCount == CATALOG_TABLE_CHUNK) || (i == count - 1)) {
+      FSIZE_t pos = f_tell(&binFile);
+      if ((f_lseek(&binFile, tablePos) != FR_OK) ||
+          !writeBytes(&binFile, tableChunk, tableCount * sizeof(uint32_t)) ||
+          (f_lseek(&binFile, pos) != FR_OK)) {
+        status = CATALOG_WRITE_ERROR;
+        break;
+      }
+      tablePos += tableCount * sizeof(uint32_t);
+      tableCount = 0;
+    }
+  }
+
+  // The header goes last. A conversion interrupted leaves no valid magic.
+  if (status == CATALOG_OK) {
+    header.recordsEnd = (uint32_t)f_tell(&binFile);
+    if ((f_lseek(&binFile, 0) != FR_OK) ||
+        !writeBytes(&binFile, &header, sizeof(header))) {
+      status = CATALOG_WRITE_ERROR;
+    }
+  }
+  f_close(&csvFile);
+  if (count > 0) {
+    f_close(&keysFile);
+  }
+  if ((f_close(&binFile) != FR_OK) && (status == CATALOG_OK)) {
+    status = CATALOG_WRITE_ERROR;
+  }
+  return status;
+}
+
+// Producer of the name and tags of the records of the binary catalog, in
+// order, to build the search index
+static bool nextSearchRecord(const char **name, const char **tags,
+                             void *context) {
+  const catalog_header_t *header = (const catalog_header_t *)context;
+  if (searchBuild.index >= header->count) {
+    return false;
+  }
+  // The table is read one offset ahead: the end of the current record
+  uint32_t end = header->recordsEnd;
+  UINT bytes;
+  if ((searchBuild.index + 1 < header->count) &&
+      ((f_read(&searchBuild.table, &end, sizeof(end), &bytes) != FR_OK) ||
+       (bytes != sizeof(end)))) {
+    return false;
+  }
+  if (end <= searchBuild.end) {
+    return false;
+  }
+  UINT size = end - searchBuild.end;
+  if (size > sizeof(searchBuild.record)) {
+    size = sizeof(searchBuild.record);
+  }
+  if ((f_lseek(&searchBuild.records, searchBuild.end) != FR_OK) ||
+      (f_read(&searchBuild.records, searchBuild.record, size, &bytes) !=
+       FR_OK) ||
+      (bytes != size)) {
+    return false;
+  }
+  searchBuild.record[size - 1] = '\0';
+  catalog_entry_t entry;
+  if (!parseBinaryRecord(searchBuild.record, &searchBuild.record[size],
+                         &entry)) {
+    return false;
+  }
+  *name = entry.name;
+  *tags = entry.tags;
+  searchBuild.end = end;
+  searchBuild.index++;
+  return true;
+}
+
+// Build the search index of the binary catalog, next to it
+static catalog_status_t buildSearchIndex(const char *binPath) {
+  char idxPath[CATALOG_PATH_SIZE];
+  char sortPathA[CATALOG_PATH_SIZE];
+  char sortPathB[CATALOG_PATH_SIZE];
+  getBinaryPath(binPath, CATALOG_SEARCH_EXTENSION, idxPath, sizeof(idxPath));
+  getBinaryPath(binPath, CATALOG_SORT_EXTENSION_A, sortPathA,
+                sizeof(sortPathA));
+  getBinaryPath(binPath, CATALOG_SORT_EXTENSION_B, sortPathB,
+                sizeof(sortPathB));
+
+  catalog_header_t header = {0};
+  UINT bytes;
+  if (f_open(&searchBuild.table, binPath, FA_READ) != FR_OK) {
+    return CATALOG_OPEN_ERROR;
+  }
+  if (f_open(&searchBuild.records, binPath, FA_READ) != FR_OK) {
+    f_close(&searchBuild.table);
+    return CATALOG_OPEN_ERROR;
+  }
+  FRESULT res = f_read(&searchBuild.table, &header, sizeof(header), &bytes);
+  catalog_status_t status = CATALOG_OK;
+  if ((res != FR_OK) || (bytes != sizeof(header)) ||
+      (header.magic != CATALOG_MAGIC) || (header.version != CATALOG_VERSION)) {
+    status = CATALOG_READ_ERROR;
+  }
+
+  // Skip the offset of the first record, it is where the records start
+  searchBuild.index = 0;
+  searchBuild.end = sizeof(catalog_header_t) + header.count * sizeof(uint32_t);
+  if ((status == CATALOG_OK) &&
+      (f_lseek(&searchBuild.table, sizeof(catalog_header_t) +
+                                       sizeof(uint32_t)) != FR_OK)) {
+    status = CATALOG_READ_ERROR;
+  }
+  if (status == CATALOG_OK) {
+    romsearch_stamp_t stamp = {
+        .count = header.count,
+        .size = header.recordsEnd,
+        .date = header.csvDate,
+        .time = header.csvTime,
+    };
+    romsearch_status_t searchStatus =
+        romsearch_build(idxPath, sortPathA, sortPathB, &stamp,
+                        nextSearchRecord, &header);
+    if (searchStatus == ROMSEARCH_MEMORY_ERROR) {
+      status = CATALOG_MEMORY_ERROR;
+    } else if (searchStatus != ROMSEARCH_OK) {
+      status = CATALOG_WRITE_ERROR;
+    } else if (searchBuild.index != header.count) {
+      // The producer stopped early on a read error or corrupted record
+      f_unlink(idxPath);
+      status = CATALOG_READ_ERROR;
+    }
+  }
+  f_close(&searchBuild.table);
+  f_close(&searchBuild.records);
+  return status;
+}
+
+catalog_status_t catalog_convertCsv(const char *csvPath) {
+  char binPath[CATALOG_PATH_SIZE];
+  char sortPathA[CATALOG_PATH_SIZE];
+  char sortPathB[CATALOG_PATH_SIZE];
+  getBinaryPath(csvPath, CATALOG_BINARY_EXTENSION, binPath, sizeof(binPath));
+  getBinaryPath(csvPath, CATALOG_SORT_EXTENSION_A, sortPathA,
+                sizeof(sortPathA));
+  getBinaryPath(csvPath, CATALOG_SORT_EXTENSION_B, sortPathB,
+                sizeof(sortPathB));
+
+  // Never leave a binary catalog of a previous CSV file behind
+  if (source == CATALOG_SOURCE_BINARY) {
+    catalog_close();
+  }
+  f_unlink(binPath);
+
+  FILINFO csvInfo;
+  FRESULT res = f_stat(csvPath, &csvInfo);
+  if (res != FR_OK) {
+    DPRINTF("Error reading CSV file %s: %d\n", csvPath, res);
+    return CATALOG_OPEN_ERROR;
+  }
+
+  absolute_time_t startTime = get_absolute_time();
+  int count = 0;
+  const char *sortedPath = sortPathA;
+  catalog_status_t status =
+      sortCsvKeys(csvPath, sortPathA, sortPathB, &count, &sortedPath);
+  if (status == CATALOG_OK) {
+    status = writeBinary(csvPath, sortedPath, binPath, count, &csvInfo);
+  }
+  f_unlink(sortPathA);
+  f_unlink(sortPathB);
+  if (status != CATALOG_OK) {
+    DPRINTF("Error converting CSV file %s: %d\n", csvPath, status);
+    f_unlink(binPath);
+    return status;
+  }
+  DPRINTF("CSV file %s converted. %d entries in %u ms.\n", csvPath, count,
+          (unsigned int)(absolute_time_diff_us(startTime, get_absolute_time()) /
+                         1000));
+
+  // The catalog is usable without the search index, so it is not an error
+  // here. Searching will try to build it again.
+  status = buildSearchIndex(binPath);
+  if (status != CATALOG_OK) {
+    DPRINTF("Error building the search index of %s: %d\n", binPath, status);
+  }
+  return CATALOG_OK;
+}
+
+// Open the binary catalog and check it was converted from the CSV file as it
+// is now, and budgeted for the current page and arena sizes.
+catalog_status_t catalog_buildSearchIndex(const char *csvPath) {
+  char binPath[CATALOG_PATH_SIZE];
+  getBinaryPath(csvPath, CATALOG_BINARY_EXTENSION, binPath, sizeof(binPath));
+  catalog_status_t status = buildSearchIndex(binPath);
+  if (status != CATALOG_OK) {
+    DPRINTF("Error building the search index of %s: %d\n", binPath, status);
+  }
+  return status;
+}
+
+static bool openBinary(const char *csvPath, const char *binPath) {
+  FILINFO csvInfo;
+  if (f_stat(csvPath, &csvInfo) != FR_OK) {
+    return false;
+  }
+  FIL file;
+  UINT bytes;
+  if (f_open(&file, binPath, FA_READ) != FR_OK) {
+    return false;
+  }
+  FRESULT res = f_read(&file, &binaryHeader, sizeof(binaryHeader), &bytes);
+  bool valid =
+      (res == FR_OK) && (bytes == sizeof(binaryHeader)) &&
+      (binaryHeader.magic == CATALOG_MAGIC) &&
+      (binaryHeader.version == CATALOG_VERSION) &&
+      (binaryHeader.pageSize == CATALOG_PAGE_SIZE) &&
+      (binaryHeader.arenaSize == CATALOG_ARENA_SIZE) &&
+      (binaryHeader.recordsEnd == f_size(&file)) &&
+      (binaryHeader.csvSize == (uint32_t)csvInfo.fsize) &&
+      (binaryHeader.csvDate == csvInfo.fdate) &&
+      (binaryHeader.csvTime == csvInfo.ftime);
+  f_close(&file);
+  return valid;
+}
+
+static catalog_status_t loadBinaryPage(int page) {
+  FIL file;
+  UINT bytes;
+  FRESULT res = f_open(&file, sourcePath, FA_READ);
+  if (res != FR_OK) {
+    DPRINTF("Error opening catalog file %s: %d\n", sourcePath, res);
+    return CATALOG_OPEN_ERROR;
+  }
+
+  // Read the offsets of the records of the page, plus the next one to know
+  // where the last record ends.
+  int first = page * CATALOG_PAGE_SIZE;
+  int count = (int)binaryHeader.count - first;
+  if (count > CATALOG_PAGE_SIZE) {
+    count = CATALOG_PAGE_SIZE;
+  }
+  int offsetsCount = (first + count < (int)binaryHeader.count) ? count + 1
+                                                               : count;
+  UINT size = offsetsCount * sizeof(uint32_t);
+  res = f_lseek(&file, sizeof(catalog_header_t) +
+                           (FSIZE_t)first * sizeof(uint32_t));
+  if (res == FR_OK) {
+    res = f_read(&file, scratch.offsets, size, &bytes);
+  }
+  if ((res != FR_OK) || (bytes != size)) {
+    f_close(&file);
+    return CATALOG_READ_ERROR;
+  }
+  if (offsetsCount == count) {
+    scratch.offsets[count] = binaryHeader.recordsEnd;
+  }
+
+  // The records of a page are contiguous: read them in the arena at once and
+  // point the entries to the strings in place.
+  size = scratch.offsets[count] - scratch.offsets[0];
+  if (size > CATALOG_ARENA_SIZE) {
+    f_close(&file);
+    return CATALOG_READ_ERROR;
+  }
+  res = f_lseek(&file, scratch.offsets[0]);
+  if (res == FR_OK) {
+    res = f_read(&file, arena, size, &bytes);
+  }
+  f_close(&file);
+  if ((res != FR_OK) || (bytes != size)) {
+    return CATALOG_READ_ERROR;
+  }
+  arenaUsed = size;
+
+  for (int i = 0; i < count; i++) {
+    if (!parseBinaryRecord(&arena[scratch.offsets[i] - scratch.offsets[0]],
+                           &arena[scratch.offsets[i + 1] - scratch.offsets[0]],
+                           &pageEntries[pageEntriesCount++])) {
+      return CATALOG_READ_ERROR;
+    }
+  }
+  return CATALOG_OK;
+}
+
+static void addSdcardEntry(const char *filename) {
+  catalog_entry_t *entry = &pageEntries[pageEntriesCount++];
+  entry->filename = arenaStrdup(filename, CATALOG_NAME_LENGTH);
+  entry->name = entry->filename;
+  entry->description = "";
+  entry->tags = "";
+  entry->hash = "";
+  entry->size = 0;
+}
+
+static catalog_status_t loadSdcardPage(int page) {
+  int count = romindex_readEntries(sourcePath, page * CATALOG_PAGE_SIZE,
+                                   scratch.entries, CATALOG_PAGE_SIZE);
+  if (count < 0) {
+    return CATALOG_INDEX_ERROR;
+  }
+  for (int i = 0; i < count; i++) {
+    addSdcardEntry(scratch.entries[i].filename);
+  }
+  return CATALOG_OK;
+}
+
+// Load the results of a search in the page. They are not contiguous in the
+// catalog, so each one is read on its own.
+static catalog_status_t loadFilteredPage(int page) {
+  int first = page * CATALOG_PAGE_SIZE;
+  int count = searchCount - first;
+  if (count > CATALOG_PAGE_SIZE) {
+    count = CATALOG_PAGE_SIZE;
+  }
+  if (source == CATALOG_SOURCE_SDCARD) {
+    for (int i = 0; i < count; i++) {
+      if (romindex_readEntries(sourcePath, searchResults[first + i],
+                               scratch.entries, 1) != 1) {
+        return CATALOG_INDEX_ERROR;
+      }
+      addSdcardEntry(scratch.entries[0].filename);
+    }
+    return CATALOG_OK;
+  }
+
+  FIL file;
+  UINT bytes;
+  FRESULT res = f_open(&file, sourcePath, FA_READ);
+  if (res != FR_OK) {
+    DPRINTF("Error opening catalog file %s: %d\n", sourcePath, res);
+    return CATALOG_OPEN_ERROR;
+  }
+  catalog_status_t status = CATALOG_OK;
+  for (int i = 0; (status == CATALOG_OK) && (i < count); i++) {
+    uint32_t record = searchResults[first + i];
+    UINT size = (record + 1 < binaryHeader.count) ? 2 * sizeof(uint32_t)
+                                                  : sizeof(uint32_t);
+    res = f_lseek(&file, sizeof(catalog_header_t) +
+                             (FSIZE_t)record * sizeof(uint32_t));
+    if (res == FR_OK) {
+      res = f_read(&file, scratch.offsets, size, &bytes);
+    }
+    if ((res != FR_OK) || (bytes != size)) {
+      status = CATALOG_READ_ERROR;
+      break;
+    }
+    if (size == sizeof(uint32_t)) {
+      scratch.offsets[1] = binaryHeader.recordsEnd;
+    }
+
+    // The records were budgeted for their own page, not this one. Keep room
+    // for the rest of the page and truncate the description if needed.
+    size_t reserve = (size_t)(count - 1 - i) * (CATALOG_RECORD_MIN + 1);
+    size_t available = CATALOG_ARENA_SIZE - arenaUsed - reserve;
+    size = scratch.offsets[1] - scratch.offsets[0];
+    if (size > available) {
+      size = available;
+    }
+    res = f_lseek(&file, scratch.offsets[0]);
+    if (res == FR_OK) {
+      res = f_read(&file, &arena[arenaUsed], size, &bytes);
+    }
+    if ((res != FR_OK) || (bytes != size) || (size == 0)) {
+      status = CATALOG_READ_ERROR;
+      break;
+    }
+    arena[arenaUsed + size - 1] = '\0';
+    if (!parseBinaryRecord(&arena[arenaUsed], &arena[arenaUsed + size],
+                           &pageEntries[pageEntriesCount++])) {
+      status = CATALOG_READ_ERROR;
+      break;
+    }
+    arenaUsed += size;
+  }
+  f_close(&file);
+  return status;
+}
+
+catalog_status_t catalog_openSdcard(const char *folder,
+                                    romindex_filter_t filter) {
+  catalog_close();
+  int count = 0;
+  romindex_status_t status = romindex_sync(folder, filter, &count);
+  if (status < 0) {
+    DPRINTF("Error loading the ROM index of %s: %d\n", folder, status);
+    return CATALOG_INDEX_ERROR;
+  }
+  snprintf(sourcePath, sizeof(sourcePath), "%s", folder);
+  source = CATALOG_SOURCE_SDCARD;
+  entriesCount = count;
+  DPRINTF("Found %d ROMs on the SD card.\n", entriesCount);
+  return CATALOG_OK;
+}
+
+catalog_status_t catalog_openCsv(const char *csvPath) {
+  catalog_close();
+
+  // Use the binary catalog. Converting the CSV file takes seconds, so it is
+  // left to the caller, in core1.
+  char binPath[CATALOG_PATH_SIZE];
+  getBinaryPath(csvPath, CATALOG_BINARY_EXTENSION, binPath, sizeof(binPath));
+  if (openBinary(csvPath, binPath)) {
+    snprintf(sourcePath, sizeof(sourcePath), "%s", binPath);
+    source = CATALOG_SOURCE_BINARY;
+    entriesCount = (int)binaryHeader.count;
+    DPRINTF("Found %d ROMs in catalog file.\n", entriesCount);
+    return CATALOG_OK;
+  }
+  DPRINTF("Catalog %s missing or out of date\n", binPath);
+
+  // Fall back to selecting the pages straight from the CSV file
+  FIL file;
+  FRESULT res = f_open(&file, csvPath, FA_READ);
+  if (res != FR_OK) {
+    DPRINTF("Error opening CSV file %s: %d\n", csvPath, res);
+    return CATALOG_OPEN_ERROR;
+  }
+
+  // Skip header
+  if (f_gets(csvLine, sizeof(csvLine), &file) == NULL) {
+    DPRINTF("Error reading header from CSV file\n");
+    f_close(&file);
+    return CATALOG_READ_ERROR;
+  }
+
+  // Only count the entries. Pages are decoded on demand.
+  int count = 0;
+  while (f_gets(csvLine, sizeof(csvLine), &file) != NULL) {
+    if (!parseCsvLine(csvLine, &csvFields)) {
+      continue;
+    }
+    if (count >= CATALOG_MAX_PAGES * CATALOG_PAGE_SIZE) {
+      DPRINTF("Maximum ROM count reached (%d)\n", count);
+      break;
+    }
+    count++;
+  }
+  f_close(&file);
+
+  snprintf(sourcePath, sizeof(sourcePath), "%s", csvPath);
+  source = CATALOG_SOURCE_CSV;
+  entriesCount = count;
+  DPRINTF("Found %d ROMs in CSV file.\n", entriesCount);
+  return CATALOG_OK;
+}
+
+void catalog_close(void) {
+  source = CATALOG_SOURCE_NONE;
+  entriesCount = 0;
+  loadedPage = -1;
+  pageEntriesCount = 0;
+  csvPagesKnown = 0;
+  searchActive = false;
+  searchCount = 0;
+  arenaReset();
+}
+
+static catalog_status_t searchBinary(const char *query, bool *truncated) {
+  char idxPath[CATALOG_PATH_SIZE];
+  getBinaryPath(sourcePath, CATALOG_SEARCH_EXTENSION, idxPath,
+                sizeof(idxPath));
+  romsearch_stamp_t stamp = {
+      .count = binaryHeader.count,
+      .size = binaryHeader.recordsEnd,
+      .date = binaryHeader.csvDate,
+      .time = binaryHeader.csvTime,
+  };
+  if (!romsearch_isValid(idxPath, &stamp)) {
+    DPRINTF("Search index %s missing or out of date\n", idxPath);
+    return CATALOG_STALE_ERROR;
+  }
+  romsearch_status_t status =
+      romsearch_query(idxPath, query, searchResults,
+                      CATALOG_SEARCH_MAX_RESULTS, &searchCount, truncated);
+  if (status == ROMSEARCH_QUERY_ERROR) {
+    return CATALOG_QUERY_ERROR;
+  }
+  return (status == ROMSEARCH_OK) ? CATALOG_OK : CATALOG_INDEX_ERROR;
+}
+
+// The SD card catalog only has the filenames, and they are already in the
+// index of the folder. Scanning it is as fast as a search index would be.
+static catalog_status_t searchSdcard(const char *query, bool *truncated) {
+  for (int first = 0; first < entriesCount; first += CATALOG_PAGE_SIZE) {
+    int count = romindex_readEntries(sourcePath, first, scratch.entries,
+                                     CATALOG_PAGE_SIZE);
+    if (count <= 0) {
+      return CATALOG_INDEX_ERROR;
+    }
+    for (int i = 0; i < count; i++) {
+      if (!romsearch_matches(query, scratch.entries[i].filename, "")) {
+        continue;
+      }
+      if (searchCount == CATALOG_SEARCH_MAX_RESULTS) {
+        *truncated = true;
+        return CATALOG_OK;
+      }
+      searchResults[searchCount++] = (uint16_t)(first + i);
+    }
+  }
+  return CATALOG_OK;
+}
+
+catalog_status_t catalog_search(const char *query) {
+  catalog_clearSearch();
+  absolute_time_t startTime = get_absolute_time();
+  bool truncated = false;
+  catalog_status_t status;
+  switch (source) {
+    case CATALOG_SOURCE_BINARY:
+      status = searchBinary(query, &truncated);
+      break;
+    case CATALOG_SOURCE_SDCARD:
+      status = searchSdcard(query, &truncated);
+      break;
+    case CATALOG_SOURCE_CSV:
+      status = CATALOG_STALE_ERROR;  // Not converted yet
+      break;
+    default:
+      status = CATALOG_OPEN_ERROR;
+      break;
+  }
+  if (status != CATALOG_OK) {
+    DPRINTF("Error searching '%s' in the catalog: %d\n", query, status);
+    searchCount = 0;
+    return status;
+  }
+  searchActive = true;
+  loadedPage = -1;
+  DPRINTF("Search '%s': %d results%s in %u ms.\n", query, searchCount,
+          truncated ? " (truncated)" : "",
+          (unsigned int)(absolute_time_diff_us(startTime, get_absolute_time()) /
+                         1000));
+  return CATALOG_OK;
+}
+
+void catalog_clearSearch(void) {
+  loadedPage = -1;
+  searchActive = false;
+  searchCount = 0;
+}
+
+bool catalog_isFiltered(void) { return searchActive; }
+
+bool catalog_isStale(void) { return source == CATALOG_SOURCE_CSV; }
+
+int catalog_getCount(void) {
+  return searchActive ? searchCount : entriesCount;
+}
+
+int catalog_getPages(void) {
+  return (catalog_getCount() + CATALOG_PAGE_SIZE - 1) / CATALOG_PAGE_SIZE;
+}
+
+catalog_status_t catalog_loadPage(int page) {
+  if (source == CATALOG_SOURCE_NONE) {
+    return CATALOG_OPEN_ERROR;
+  }
+  if (page < 0 || page >= catalog_getPages()) {
+    return CATALOG_RANGE_ERROR;
+  }
+  if (page == loadedPage) {
+    return CATALOG_OK;
+  }
+
+  loadedPage = -1;
+  pageEntriesCount = 0;
+  arenaReset();
+  catalog_status_t status;
+  if (searchActive) {
+    status = loadFilteredPage(page);
+  } else {
+    switch (source) {
+      case CATALOG_SOURCE_SDCARD:
+        status = loadSdcardPage(page);
+        break;
+      case CATALOG_SOURCE_BINARY:
+        status = loadBinaryPage(page);
+        break;
+      default:
+        status = loadCsvPage(page);
+        break;
+    }
+  }
+  if (status != CATALOG_OK) {
+    DPRINTF("Error loading catalog page %d: %d\n", page, status);
+    pageEntriesCount = 0;
+    return status;
+  }
+  loadedPage = page;
+  DPRINTF("Catalog page %d loaded. %d entries, %u bytes of arena.\n", page,
+          pageEntriesCount, (unsigned int)arenaUsed);
+  return CATALOG_OK;
+}
+
+const catalog_entry_t *catalog_getEntry(int index) {
+  if (index < 0 || index >= catalog_getCount()) {
+    return NULL;
+  }
+  if (catalog_loadPage(index / CATALOG_PAGE_SIZE) != CATALOG_OK) {
+    return NULL;
+  }
+  int pos = index % CATALOG_PAGE_SIZE;
+  return (pos < pageEntriesCount) ? &pageEntries[pos] : NULL;
+}
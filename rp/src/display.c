@@ -26,6 +26,10 @@ static unsigned char *u8g2Buffer = NULL;
 // Global u8g2 structure
 static u8g2_t u8g2 = {0};
 
+// Copy of the framebuffer to the computer still running, if any. Drawing
+// waits for it, so the copy overlaps with whatever comes after the refresh.
+static dmacopy_fence_t refreshFence = DMACOPY_NO_FENCE;
+
 // Dummy byte communication function
 static unsigned char u8x8DummyByte(void *u8x8, unsigned char msg,
                                    unsigned char argInt, void *argPtr) {
@@ -70,7 +74,10 @@ static const u8x8_display_info_t u8x8Ataristlow320x200DisplayInfo = {
     /* pixel_height = */ 200};
 
 // Getter function for u8g2 structure
-u8g2_t *display_getU8g2Ref() { return &u8g2; }
+u8g2_t *display_getU8g2Ref() {
+  dmacopy_wait(refreshFence);
+  return &u8g2;
+}
 
 // Getter function for display address
 uint32_t display_getAddress() { return displayAddress; }
@@ -152,11 +159,27 @@ void display_setupU8g2() {
   u8g2_InitDisplay(&u8g2);  // Initialize display (will use dummy callbacks)
 }
 
+#if DISPLAY_BYPASS_FRAMEBUFFER == 0
+static uint32_t refreshStart = 0;
+
+// Called from the DMA interrupt when the framebuffer is in the computer
+static void refreshDone(void *context) {
+  (void)context;
+  perf_stop(PERF_TIMER_DISPLAY, refreshStart, DISPLAY_BUFFER_SIZE);
+  TRACE(TRACE_DISPLAY_REFRESH, DISPLAY_BUFFER_SIZE,
+        time_us_32() - refreshStart);
+}
+#endif
+
 void display_refresh() {
 #if DISPLAY_BYPASS_FRAMEBUFFER == 0
   uint32_t *displayBuffer = (void *)display_getAddress();
-  COPY_AND_SWAP_16BIT_DMA(displayBuffer, (uint16_t *)u8g2Buffer,
-                          DISPLAY_BUFFER_SIZE);
+  // Two refreshes in a row write the same memory
+  dmacopy_wait(refreshFence);
+  refreshStart = perf_start();
+  refreshFence = dmacopy_memcpyBswap16(displayBuffer, u8g2Buffer,
+                                       DISPLAY_BUFFER_SIZE, DMACOPY_NO_FENCE,
+                                       refreshDone, NULL);
 #endif
 }
 
@@ -184,6 +207,7 @@ void display_generateMaskTable(uint32_t memoryAddress) {
 // blank_bytes is the number of bytes to blank out at the bottom of the screen
 // They should be the same as the number of bytes in a row of chars
 void display_scrollup(uint16_t blankBytes) {
+  dmacopy_wait(refreshFence);
   // blank bytes is the number of bytes to blank out at the bottom of the screen
   memmove(u8g2Buffer, u8g2Buffer + blankBytes,
           DISPLAY_BUFFER_SIZE - blankBytes);
@@ -0,0 +1,133 @@
+/**
+ * File: dlqueue.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Queue of download jobs, run one after the other
+ */
+
+#include "dlqueue.h"
+
+static dlqueue_job_t jobs[DLQUEUE_MAX_JOBS];
+static int jobCount = 0;
+static int current = -1;  // Job downloading, if any
+
+// Make room dropping the jobs already finished
+static void dropFinished(void) {
+  int kept = 0;
+  for (int i = 0; i < jobCount; i++) {
+    if ((jobs[i].status == DLQUEUE_JOB_DONE) ||
+        (jobs[i].status == DLQUEUE_JOB_FAILED)) {
+      continue;
+    }
+    if (i == current) {
+      current = kept;
+    }
+    if (kept != i) {
+      jobs[kept] = jobs[i];
+    }
+    kept++;
+  }
+  jobCount = kept;
+}
+
+static void finishJob(download_err_t err) {
+  dlqueue_job_t *job = &jobs[current];
+  job->status = (err == DOWNLOAD_OK) ? DLQUEUE_JOB_DONE : DLQUEUE_JOB_FAILED;
+  job->error = err;
+  job->bytes = download_getStats()->bytes;
+  current = -1;
+  download_setStatus(DOWNLOAD_STATUS_IDLE);
+  DPRINTF("Job %s finished: %d. %u bytes\n", job->filename, err,
+          (unsigned int)job->bytes);
+
+  // The done function may add jobs and move this one
+  if (job->done != NULL) {
+    dlqueue_job_t finished = *job;
+    finished.done(&finished);
+  }
+}
+
+static void startJob(int index) {
+  dlqueue_job_t *job = &jobs[index];
+  current = index;
+  job->status = DLQUEUE_JOB_DOWNLOADING;
+  download_setFilepath(job->url);
+  download_setTarget(job->target, job->flashAddress);
+  download_setHash(job->hash);
+  download_err_t err = download_start();
+  if (err != DOWNLOAD_OK) {
+    DPRINTF("Error starting download of %s: %d\n", job->url, err);
+    finishJob(err);
+  }
+}
+
+dlqueue_status_t dlqueue_add(const char *url, download_target_t target,
+                             uint32_t flashAddress, const char *hash,
+                             dlqueue_done_t done) {
+  const char *name = strrchr(url, '/');
+  if ((strstr(url, "://") == NULL) || (name == NULL) || (name[1] == '\0') ||
+      (strlen(url) >= DOWNLOAD_BUFFLINE_SIZE)) {
+    DPRINTF("Invalid URL to download: %s\n", url);
+    return DLQUEUE_URL_ERROR;
+  }
+  if (jobCount == DLQUEUE_MAX_JOBS) {
+    dropFinished();
+  }
+  if (jobCount == DLQUEUE_MAX_JOBS) {
+    DPRINTF("Download queue full\n");
+    return DLQUEUE_FULL_ERROR;
+  }
+  dlqueue_job_t *job = &jobs[jobCount++];
+  memset(job, 0, sizeof(dlqueue_job_t));
+  snprintf(job->url, sizeof(job->url), "%s", url);
+  snprintf(job->filename, sizeof(job->filename), "%s", name + 1);
+  job->target = target;
+  job->flashAddress = flashAddress;
+  snprintf(job->hash, sizeof(job->hash), "%s", (hash != NULL) ? hash : "");
+  job->done = done;
+  job->status = DLQUEUE_JOB_QUEUED;
+  DPRINTF("Queued download of %s\n", job->url);
+  return DLQUEUE_OK;
+}
+
+void dlqueue_poll() {
+  if (current >= 0) {
+    if (download_poll() == DOWNLOAD_POLL_CONTINUE) {
+      jobs[current].bytes = download_getStats()->bytes;
+      return;
+    }
+    // Write the file only if the download completed
+    download_err_t err = download_finish();
+    if (err == DOWNLOAD_OK) {
+      err = download_confirm();
+    }
+    finishJob(err);
+    return;
+  }
+
+  for (int i = 0; i < jobCount; i++) {
+    if (jobs[i].status == DLQUEUE_JOB_QUEUED) {
+      startJob(i);
+      return;
+    }
+  }
+}
+
+bool dlqueue_isBusy() {
+  if (current >= 0) {
+    return true;
+  }
+  for (int i = 0; i < jobCount; i++) {
+    if (jobs[i].status == DLQUEUE_JOB_QUEUED) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int dlqueue_getCount() { return jobCount; }
+
+const dlqueue_job_t *dlqueue_getJob(int index) {
+  return ((index >= 0) && (index < jobCount)) ? &jobs[index] : NULL;
+}
@@ -0,0 +1,259 @@
+/**
+ * File: dmacopy.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Asynchronous copies with DMA over a few channels claimed once
+ */
+
+#include "dmacopy.h"
+
+static bool initialized = false;
+static uint channels[DMACOPY_CHANNELS];
+static uint32_t channelsMask = 0;
+static dmacopy_op_t *running[DMACOPY_CHANNELS];
+
+// Ring of the copies. The copy of a fence is in ops[fence %
+// DMACOPY_QUEUE_SIZE] until it is freed.
+static dmacopy_op_t ops[DMACOPY_QUEUE_SIZE];
+static dmacopy_fence_t nextFence = 1;  // Of the next copy submitted
+static dmacopy_fence_t nextStart = 1;  // Of the next copy to start
+static dmacopy_fence_t oldest = 1;     // Of the oldest copy not freed
+
+static inline dmacopy_op_t *opOf(dmacopy_fence_t fence) {
+  return &ops[fence % DMACOPY_QUEUE_SIZE];
+}
+
+// Fences wrap after 2^32 copies, far more than a session makes
+static inline bool isBefore(dmacopy_fence_t first, dmacopy_fence_t second) {
+  return (int32_t)(first - second) < 0;
+}
+
+static bool __not_in_flash_func(isDoneLocked)(dmacopy_fence_t fence) {
+  if ((fence == DMACOPY_NO_FENCE) || isBefore(fence, oldest)) {
+    return true;
+  }
+  return !isBefore(fence, nextFence) ||
+         (opOf(fence)->state == DMACOPY_OP_DONE);
+}
+
+static void __not_in_flash_func(complete)(dmacopy_op_t *op) {
+  op->state = DMACOPY_OP_DONE;
+  if (op->done != NULL) {
+    op->done(op->context);
+  }
+}
+
+static bool __not_in_flash_func(isFlashRunning)(void) {
+  for (int i = 0; i < DMACOPY_CHANNELS; i++) {
+    if ((running[i] != NULL) && (running[i]->type == DMACOPY_OP_FROM_FLASH)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void __not_in_flash_func(startOp)(int index, dmacopy_op_t *op) {
+  uint channel = channels[index];
+  dma_channel_config cfg = dma_channel_get_default_config(channel);
+  const volatile void *src = op->src;
+  uint32_t count = op->bytes;
+  bool aligned = ((((uintptr_t)op->dest | (uintptr_t)op->src | op->bytes) &
+                   3) == 0);
+  switch (op->type) {
+    case DMACOPY_OP_MEMCPY:
+      if (aligned) {
+        count = op->bytes / 4;
+      } else {
+        channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+      }
+      break;
+    case DMACOPY_OP_MEMCPY_BSWAP16:
+      count = (op->bytes + 1) / 2;
+      channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+      channel_config_set_bswap(&cfg, true);
+      break;
+    case DMACOPY_OP_MEMSET:
+      src = &op->value;
+      channel_config_set_read_increment(&cfg, false);
+      if ((((uintptr_t)op->dest | op->bytes) & 3) == 0) {
+        count = op->bytes / 4;
+      } else {
+        channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+      }
+      break;
+    case DMACOPY_OP_FROM_FLASH:
+      // Drain what a previous stream left, and stream the new range
+      while (!(xip_ctrl_hw->stat & XIP_STAT_FIFO_EMPTY)) {
+        (void)xip_ctrl_hw->stream_fifo;
+      }
+      xip_ctrl_hw->stream_addr = (uint32_t)op->src;
+      xip_ctrl_hw->stream_ctr = op->bytes / 4;
+      src = (const void *)XIP_AUX_BASE;
+      count = op->bytes / 4;
+      channel_config_set_read_increment(&cfg, false);
+      channel_config_set_dreq(&cfg, DREQ_XIP_STREAM);
+      break;
+  }
+  running[index] = op;
+  op->state = DMACOPY_OP_RUNNING;
+  dma_channel_configure(channel, &cfg, op->dest, src, count, true);
+}
+
+// Starts the copies that can start, in order. With the interrupts masked.
+static void __not_in_flash_func(pump)(void) {
+  while (isBefore(nextStart, nextFence)) {
+    dmacopy_op_t *op = opOf(nextStart);
+    if (!isDoneLocked(op->after)) {
+      return;
+    }
+    if (op->bytes == 0) {
+      complete(op);
+      nextStart++;
+      continue;
+    }
+    if ((op->type == DMACOPY_OP_FROM_FLASH) && isFlashRunning()) {
+      return;
+    }
+    int index = 0;
+    while ((index < DMACOPY_CHANNELS) && (running[index] != NULL)) {
+      index++;
+    }
+    if (index == DMACOPY_CHANNELS) {
+      return;
+    }
+    startOp(index, op);
+    nextStart++;
+  }
+}
+
+// Ends the copies finished, frees them in order and starts the next ones.
+// With the interrupts masked.
+static void __not_in_flash_func(service)(void) {
+  for (int i = 0; i < DMACOPY_CHANNELS; i++) {
+    if ((running[i] != NULL) && !dma_channel_is_busy(channels[i])) {
+      dmacopy_op_t *op = running[i];
+      running[i] = NULL;
+      complete(op);
+    }
+  }
+  while (isBefore(oldest, nextStart) &&
+         (opOf(oldest)->state == DMACOPY_OP_DONE)) {
+    opOf(oldest)->state = DMACOPY_OP_FREE;
+    oldest++;
+  }
+  pump();
+}
+
+static void __not_in_flash_func(dmaIrqHandler)(void) {
+  uint32_t pending = dma_hw->ints0 & channelsMask;
+  if (pending == 0) {
+    return;  // Shared with other channels
+  }
+  // Also the copies that dmacopy_wait() already ended
+  dma_hw->ints0 = pending;
+  service();
+}
+
+void dmacopy_init(void) {
+  if (initialized) {
+    return;
+  }
+  for (int i = 0; i < DMACOPY_CHANNELS; i++) {
+    channels[i] = (uint)dma_claim_unused_channel(true);
+    channelsMask |= 1u << channels[i];
+    running[i] = NULL;
+    dma_channel_set_irq0_enabled(channels[i], true);
+  }
+  irq_add_shared_handler(DMACOPY_DMA_IRQ, dmaIrqHandler,
+                         PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+  irq_set_enabled(DMACOPY_DMA_IRQ, true);
+  initialized = true;
+  DPRINTF("DMA copy channels: %u, %u\n", channels[0], channels[1]);
+}
+
+static dmacopy_fence_t submit(dmacopy_op_type_t type, void *dest,
+                              const void *src, size_t bytes, uint32_t value,
+                              dmacopy_fence_t after, dmacopy_done_t done,
+                              void *context) {
+  dmacopy_init();
+  uint32_t ints = save_and_disable_interrupts();
+  // Full: wait for the oldest copy
+  while ((nextFence - oldest) >= DMACOPY_QUEUE_SIZE) {
+    service();
+    if ((nextFence - oldest) >= DMACOPY_QUEUE_SIZE) {
+      restore_interrupts(ints);
+      tight_loop_contents();
+      ints = save_and_disable_interrupts();
+    }
+  }
+  dmacopy_fence_t fence = nextFence;
+  dmacopy_op_t *op = opOf(fence);
+  op->type = type;
+  op->dest = dest;
+  op->src = src;
+  op->bytes = (uint32_t)bytes;
+  op->value = value;
+  op->fence = fence;
+  op->after = after;
+  op->done = done;
+  op->context = context;
+  op->state = DMACOPY_OP_PENDING;
+  nextFence++;
+  pump();
+  restore_interrupts(ints);
+  return fence;
+}
+
+dmacopy_fence_t dmacopy_memcpy(void *dest, const void *src, size_t bytes,
+                               dmacopy_fence_t after, dmacopy_done_t done,
+                               void *context) {
+  return submit(DMACOPY_OP_MEMCPY, dest, src, bytes, 0, after, done, context);
+}
+
+dmacopy_fence_t dmacopy_memcpyBswap16(void *dest, const void *src,
+                                      size_t bytes, dmacopy_fence_t after,
+                                      dmacopy_done_t done, void *context) {
+  return submit(DMACOPY_OP_MEMCPY_BSWAP16, dest, src, bytes, 0, after, done,
+                context);
+}
+
+dmacopy_fence_t dmacopy_memset(void *dest, uint8_t value, size_t bytes,
+                               dmacopy_fence_t after, dmacopy_done_t done,
+                               void *context) {
+  return submit(DMACOPY_OP_MEMSET, dest, NULL, bytes, value * 0x01010101u,
+                after, done, context);
+}
+
+dmacopy_fence_t dmacopy_fromFlash(void *dest, const void *src, size_t bytes,
+                                  dmacopy_fence_t after, dmacopy_done_t done,
+                                  void *context) {
+  return submit(DMACOPY_OP_FROM_FLASH, dest, src, bytes, 0, after, done,
+                context);
+}
+
+bool dmacopy_isDone(dmacopy_fence_t fence) {
+  uint32_t ints = save_and_disable_interrupts();
+  bool done = isDoneLocked(fence);
+  restore_interrupts(ints);
+  return done;
+}
+
+void __not_in_flash_func(dmacopy_wait)(dmacopy_fence_t fence) {
+  if (fence == DMACOPY_NO_FENCE) {
+    return;
+  }
+  // Serviced here too, so it does not need the interrupt. The interrupts
+  // are only masked to service, so the protocol interrupt keeps running
+  // during long copies.
+  while (true) {
+    uint32_t ints = save_and_disable_interrupts();
+    service();
+    bool done = isBefore(fence, oldest) || !isBefore(fence, nextFence);
+    restore_interrupts(ints);
+    if (done) {
+      return;
+    }
+    tight_loop_contents();
+  }
+}
@@ -11,11 +11,54 @@
 // Download
 static FIL file;
 static download_status_t downloadStatus = DOWNLOAD_STATUS_IDLE;
-static HTTPC_REQUEST_T request = {0};
+static volatile bool requestComplete = true;
 static char filepath[DOWNLOAD_BUFFLINE_SIZE] = {0};
 static download_url_components_t components;
 static download_file_t fileUrl;
 
+// Write-behind buffer. The body received is gathered here and written to
+// the file in whole buffers, without allocating memory per packet.
+static uint8_t writeBuffer[DOWNLOAD_WRITE_BUFFER_SIZE]
+    __attribute__((aligned(4)));
+static size_t writeBufferUsed = 0;
+static download_stats_t stats;
+static absolute_time_t startTime;
+
+// Target of the download. Reset to the SD card after each download starts.
+static download_target_t target = DOWNLOAD_TARGET_SDCARD;
+static download_target_t activeTarget = DOWNLOAD_TARGET_SDCARD;
+static uint32_t targetFlashAddress = 0;
+static uint32_t romFlashAddress = 0;
+
+// Sector of the ROM being gathered before programming it into the flash
+static uint8_t romBuffer[FLASH_SECTOR_SIZE] __attribute__((aligned(4)));
+static size_t romBufferUsed = 0;
+static uint32_t romOffset = 0;  // Bytes of the ROM already programmed
+static uint8_t romHeader[DOWNLOAD_ROM_HEADER_SIZE];
+static int romHeaderPending = 0;  // Bytes of a possible header still to check
+
+// Digest of the body. The expected one is set before each download starts.
+static download_hash_t hashType = DOWNLOAD_HASH_NONE;
+static download_hash_t activeHashType = DOWNLOAD_HASH_NONE;
+static uint8_t nextHash[DOWNLOAD_SHA256_SIZE];
+static uint8_t expectedHash[DOWNLOAD_SHA256_SIZE];
+static union {
+  mbedtls_md5_context md5;
+  mbedtls_sha256_context sha256;
+} hashContext;
+
+// Conditional and resumed requests
+static download_validators_t validators;  // Of the file being downloaded
+static uint32_t resumeOffset = 0;
+static bool notModified = false;
+
+// Headers of the response
+static char etagHeader[DOWNLOAD_ETAG_SIZE];
+static char lastModifiedHeader[DOWNLOAD_DATE_SIZE];
+static char contentRangeHeader[DOWNLOAD_DATE_SIZE];
+static uint32_t contentLength = 0;
+static download_err_t responseError = DOWNLOAD_OK;  // Why it was rejected
+
 static void url_encode(const char *src, char *dst, size_t dst_len) {
   static const char hex[] = "0123456789ABCDEF";
   size_t i = 0;
@@ -41,6 +84,65 @@ static void getTmpFilenamePath(char filename[DOWNLOAD_BUFFLINE_SIZE]) {
                ->value);
 }
 
+// Generates the final file path of the download.
+static void getFinalFilenamePath(char filename[DOWNLOAD_BUFFLINE_SIZE]) {
+  snprintf(filename, DOWNLOAD_BUFFLINE_SIZE, "%s/%s",
+           settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_ROMS_FOLDER)
+               ->value,
+           fileUrl.filename);
+}
+
+// Generates the path of the validators stored next to a file.
+static void getValidatorsPath(const char *filename,
+                              char path[DOWNLOAD_BUFFLINE_SIZE]) {
+  snprintf(path, DOWNLOAD_BUFFLINE_SIZE, "%s%s", filename,
+           DOWNLOAD_VALIDATORS_EXTENSION);
+}
+
+// Reads the validators stored next to a file. False if missing, or if they
+// are not from the URL given or have nothing to validate.
+static bool readValidators(const char *filename, const char *url,
+                           download_validators_t *dest) {
+  char path[DOWNLOAD_BUFFLINE_SIZE];
+  getValidatorsPath(filename, path);
+  FIL vfile;
+  UINT bytesRead;
+  if (f_open(&vfile, path, FA_READ) != FR_OK) {
+    return false;
+  }
+  FRESULT res = f_read(&vfile, dest, sizeof(download_validators_t), &bytesRead);
+  f_close(&vfile);
+  return (res == FR_OK) && (bytesRead == sizeof(download_validators_t)) &&
+         (dest->magic == DOWNLOAD_VALIDATORS_MAGIC) &&
+         (dest->version == DOWNLOAD_VALIDATORS_VERSION) &&
+         (strncmp(dest->url, url, sizeof(dest->url)) == 0) &&
+         ((dest->etag[0] != '\0') || (dest->lastModified[0] != '\0'));
+}
+
+static FRESULT writeValidators(const char *filename,
+                               const download_validators_t *src) {
+  char path[DOWNLOAD_BUFFLINE_SIZE];
+  getValidatorsPath(filename, path);
+  FIL vfile;
+  UINT bytesWritten;
+  FRESULT res = f_open(&vfile, path, FA_WRITE | FA_CREATE_ALWAYS);
+  if (res != FR_OK) {
+    return res;
+  }
+  res = f_write(&vfile, src, sizeof(download_validators_t), &bytesWritten);
+  FRESULT closeRes = f_close(&vfile);
+  if ((res == FR_OK) && (bytesWritten != sizeof(download_validators_t))) {
+    res = FR_DENIED;
+  }
+  return (res != FR_OK) ? res : closeRes;
+}
+
+static void deleteValidators(const char *filename) {
+  char path[DOWNLOAD_BUFFLINE_SIZE];
+  getValidatorsPath(filename, path);
+  f_unlink(path);
+}
+
 // Parses a URL into its components and extracts the file name.
 static int parseUrl(const char *url, download_url_components_t *components,
                     download_file_t *file) {
@@ -110,137 +212,414 @@ static int parseUrl(const char *url, download_url_components_t *components,
   return 0;  // Success.
 }
 
-// Save body to file
-static err_t httpClientReceiveFileFn(__unused void *arg,
-                                     __unused struct altcp_pcb *conn,
-                                     struct pbuf *ptr, err_t err) {
-  // Check for null input or errors
-  if (ptr == NULL) {
-    DPRINTF("End of data or connection closed by the server.\n");
-    downloadStatus = DOWNLOAD_STATUS_COMPLETED;
-    return ERR_OK;  // Signal the connection closure
+// Splits the port from the host of the URL, e.g. of a local server. Zero if
+// none, for the default port of the protocol.
+static uint16_t splitHostPort(const char *host,
+                              char name[DOWNLOAD_HOSTNAME_SIZE]) {
+  snprintf(name, DOWNLOAD_HOSTNAME_SIZE, "%s", host);
+  char *colon = strrchr(name, ':');
+  if (colon == NULL) {
+    return 0;
   }
+  *colon = '\0';
+  return (uint16_t)atoi(colon + 1);
+}
 
-  if (err != ERR_OK) {
-    DPRINTF("Error receiving file: %i\n", err);
-    downloadStatus = DOWNLOAD_STATUS_FAILED;
-    return ERR_VAL;  // Invalid input or error occurred
+// Write the data gathered in the write-behind buffer to the file
+static FRESULT flushWriteBuffer(void) {
+  if (writeBufferUsed == 0) {
+    return FR_OK;
+  }
+  UINT bytesWritten;
+  absolute_time_t writeStart = get_absolute_time();
+  FRESULT res = f_write(&file, writeBuffer, writeBufferUsed, &bytesWritten);
+  absolute_time_t writeEnd = get_absolute_time();
+  stats.writeUs += (uint32_t)absolute_time_diff_us(writeStart, writeEnd);
+  stats.elapsedUs = (uint32_t)absolute_time_diff_us(startTime, writeEnd);
+  stats.writes++;
+  if (res != FR_OK || bytesWritten != writeBufferUsed) {
+    DPRINTF("Error writing to file: %i\n", res);
+    return (res != FR_OK) ? res : FR_DENIED;
   }
+  writeBufferUsed = 0;
 
-  // Allocate buffer to hold pbuf content
-  char *buffc = malloc(ptr->tot_len);
-  if (buffc == NULL) {
-    DPRINTF("Error allocating memory\n");
-    downloadStatus = DOWNLOAD_STATUS_FAILED;
-    return ERR_MEM;  // Memory allocation failed
+  // Keep the size in the directory entry up to date, so an interrupted
+  // download can resume from here even after a power cycle
+  if ((stats.writes % DOWNLOAD_SYNC_WRITES) == 0) {
+    res = f_sync(&file);
   }
+  return res;
+}
 
-  // Use pbuf_copy_partial to copy the pbuf content to the buffer
-  pbuf_copy_partial(ptr, buffc, ptr->tot_len, 0);
+// Parse a digest in hex. The length is already checked.
+static bool parseHash(const char *hex, uint8_t *digest, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    char byte[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+    if (!isxdigit((unsigned char)byte[0]) ||
+        !isxdigit((unsigned char)byte[1])) {
+      return false;
+    }
+    digest[i] = (uint8_t)strtoul(byte, NULL, HEX_BASE);
+  }
+  return true;
+}
 
-  // Write the buffer to the file. File descriptor is 'file'
-  FRESULT res;
-  UINT bytesWritten;
-  res = f_write(&file, buffc, ptr->tot_len, &bytesWritten);
+static void hashStart(void) {
+  if (activeHashType == DOWNLOAD_HASH_MD5) {
+    mbedtls_md5_init(&hashContext.md5);
+    mbedtls_md5_starts(&hashContext.md5);
+  } else if (activeHashType == DOWNLOAD_HASH_SHA256) {
+    mbedtls_sha256_init(&hashContext.sha256);
+    mbedtls_sha256_starts(&hashContext.sha256, 0);
+  }
+}
 
-  // Free the allocated memory
-  free(buffc);
+static void hashUpdate(const uint8_t *data, size_t len) {
+  if (activeHashType == DOWNLOAD_HASH_NONE) {
+    return;
+  }
+  absolute_time_t hashStartTime = get_absolute_time();
+  if (activeHashType == DOWNLOAD_HASH_MD5) {
+    mbedtls_md5_update(&hashContext.md5, data, len);
+  } else {
+    mbedtls_sha256_update(&hashContext.sha256, data, len);
+  }
+  stats.hashUs +=
+      (uint32_t)absolute_time_diff_us(hashStartTime, get_absolute_time());
+}
 
-  // Check for file write errors
-  if (res != FR_OK || bytesWritten != ptr->tot_len) {
-    DPRINTF("Error writing to file: %i\n", res);
-    downloadStatus = DOWNLOAD_STATUS_FAILED;
-    return ERR_ABRT;  // Abort on failure
+static bool hashMatches(void) {
+  uint8_t digest[DOWNLOAD_SHA256_SIZE];
+  size_t size;
+  if (activeHashType == DOWNLOAD_HASH_MD5) {
+    mbedtls_md5_finish(&hashContext.md5, digest);
+    mbedtls_md5_free(&hashContext.md5);
+    size = DOWNLOAD_MD5_SIZE;
+  } else {
+    mbedtls_sha256_finish(&hashContext.sha256, digest);
+    mbedtls_sha256_free(&hashContext.sha256);
+    size = DOWNLOAD_SHA256_SIZE;
   }
+  return memcmp(digest, expectedHash, size) == 0;
+}
 
-  // Acknowledge that we received the data
-#if BOOSTER_DOWNLOAD_HTTPS == 1
-  altcp_recved(conn, ptr->tot_len);
-#else
-  tcp_recved(conn, ptr->tot_len);
-#endif
+// Hash the bytes kept from an interrupted download. The file is left at the
+// end of them, to append the rest.
+static bool hashResumed(void) {
+  if (f_lseek(&file, 0) != FR_OK) {
+    return false;
+  }
+  uint32_t left = resumeOffset;
+  while (left > 0) {
+    UINT chunk = (left > DOWNLOAD_WRITE_BUFFER_SIZE)
+                     ? DOWNLOAD_WRITE_BUFFER_SIZE
+                     : (UINT)left;
+    UINT bytesRead;
+    if ((f_read(&file, writeBuffer, chunk, &bytesRead) != FR_OK) ||
+        (bytesRead != chunk)) {
+      return false;
+    }
+    hashUpdate(writeBuffer, chunk);
+    left -= chunk;
+  }
+  return true;
+}
 
-  // Free the pbuf
-  pbuf_free(ptr);
+// Byte-swap the sector gathered and program it into the flash of the ROM
+static bool programRomBuffer(void) {
+  if (romBufferUsed == 0) {
+    return true;
+  }
+  if (romOffset + FLASH_SECTOR_SIZE > DOWNLOAD_ROM_MAX_SIZE) {
+    DPRINTF("ROM too big. More than %u bytes.\n",
+            (unsigned int)DOWNLOAD_ROM_MAX_SIZE);
+    return false;
+  }
+  memset(&romBuffer[romBufferUsed], 0, FLASH_SECTOR_SIZE - romBufferUsed);
+  CHANGE_ENDIANESS_BLOCK16(romBuffer, FLASH_SECTOR_SIZE);
+
+  // Same as storing a ROM file from the SD card: interrupts disabled while
+  // the flash is not available
+  uint32_t offset = romFlashAddress - XIP_BASE + romOffset;
+  worker_lockoutStart();
+  uint32_t ints = save_and_disable_interrupts();
+  flash_range_erase(offset, FLASH_SECTOR_SIZE);
+  flash_range_program(offset, romBuffer, FLASH_SECTOR_SIZE);
+  restore_interrupts(ints);
+  worker_lockoutEnd();
+  romOffset += FLASH_SECTOR_SIZE;
+  romBufferUsed = 0;
+  return true;
+}
 
-  downloadStatus = DOWNLOAD_STATUS_IN_PROGRESS;
-  return ERR_OK;
+// Erase the sectors already programmed, so a download that failed or did
+// not match its digest does not leave part of an image to boot. One sector at
+// a time, to keep the interrupts masked as briefly as when programming.
+static void eraseRom(void) {
+  for (uint32_t erased = 0; erased < romOffset; erased += FLASH_SECTOR_SIZE) {
+    uint32_t offset = romFlashAddress - XIP_BASE + erased;
+    worker_lockoutStart();
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_erase(offset, FLASH_SECTOR_SIZE);
+    restore_interrupts(ints);
+    worker_lockoutEnd();
+  }
+  DPRINTF("ROM area erased. %u bytes.\n", (unsigned int)romOffset);
+  romOffset = 0;
+  romBufferUsed = 0;
 }
 
-// Function to parse headers and check Content-Length
-static err_t httpClientHeaderCheckSizeFn(__unused httpc_state_t *connection,
-                                         __unused void *arg, struct pbuf *hdr,
-                                         u16_t hdrLen,
-                                         __unused u32_t contentLen) {
-  downloadStatus = DOWNLOAD_STATUS_FAILED;
-  const char *contentLengthLabel = "Content-Length:";
-  u16_t offset = 0;
-  char *headerData = malloc(hdrLen + 1);
+// Gather the body into the sectors of the ROM
+static bool appendRom(const uint8_t *data, size_t len) {
+  // Hold the first bytes until we know if they are a header to drop
+  while ((romHeaderPending > 0) && (len > 0)) {
+    romHeader[DOWNLOAD_ROM_HEADER_SIZE - romHeaderPending] = *data++;
+    romHeaderPending--;
+    len--;
+    if (romHeaderPending == 0) {
+      bool zeroed = true;
+      for (int i = 0; i < DOWNLOAD_ROM_HEADER_SIZE; i++) {
+        zeroed = zeroed && (romHeader[i] == 0);
+      }
+      if (zeroed) {
+        DPRINTF("Skipping first 4 bytes. Looks like a STEEM cartridge.\n");
+      } else if (!appendRom(romHeader, DOWNLOAD_ROM_HEADER_SIZE)) {
+        return false;
+      }
+    }
+  }
+  while (len > 0) {
+    size_t chunk = FLASH_SECTOR_SIZE - romBufferUsed;
+    if (chunk > len) {
+      chunk = len;
+    }
+    memcpy(&romBuffer[romBufferUsed], data, chunk);
+    romBufferUsed += chunk;
+    data += chunk;
+    len -= chunk;
+    if ((romBufferUsed == FLASH_SECTOR_SIZE) && !programRomBuffer()) {
+      return false;
+    }
+  }
+  return true;
+}
 
-  if (headerData == NULL) {
-    return ERR_MEM;  // Memory allocation failed
+// Fail fast if the rest of the file does not fit in the SD card. If the file
+// is still empty, reserve a contiguous area for it: the clusters are then
+// allocated one after the other as the data is written, without searching
+// the FAT, and the file can be read back later with multi-block reads. The
+// size of the file stays the bytes written, so it can still be resumed.
+static bool reserveSpace(uint32_t size) {
+  if (size == 0) {
+    return true;  // Length unknown
+  }
+  uint64_t freeBytes;
+  if ((sdcard_getFreeBytes(&freeBytes) == FR_OK) && (freeBytes < size)) {
+    DPRINTF("Not enough space for %u bytes. Only %u KB free.\n",
+            (unsigned int)size, (unsigned int)(freeBytes / 1024));
+    responseError = DOWNLOAD_NOSPACE_ERROR;
+    return false;
+  }
+#if FF_USE_EXPAND
+  if (f_size(&file) == 0) {
+    FRESULT res = f_expand(&file, size, 0);
+    if (res != FR_OK) {
+      // Fragmented free space. Allocate the clusters as they come.
+      DPRINTF("No contiguous area for %u bytes: %i\n", (unsigned int)size,
+              res);
+    }
   }
+#endif
+  return true;
+}
 
-  // Copy header data into a buffer for parsing
-  pbuf_copy_partial(hdr, headerData, hdrLen, 0);
-  headerData[hdrLen] = '\0';  // Null-terminate the string
+// Save body to file
+static bool onBody(const uint8_t *data, size_t len,
+                   __unused void *context) {
+  // Gather the body in the write-behind buffer, writing it to the file each
+  // time it is full. And in the ROM, if streaming into it.
+  stats.bytes += len;
+  hashUpdate(data, len);
+  if ((activeTarget != DOWNLOAD_TARGET_SDCARD) && !appendRom(data, len)) {
+    downloadStatus = DOWNLOAD_STATUS_FAILED;
+    return false;  // Abort on failure
+  }
+  if (activeTarget == DOWNLOAD_TARGET_ROM) {
+    return true;
+  }
+  while (len > 0) {
+    size_t chunk = DOWNLOAD_WRITE_BUFFER_SIZE - writeBufferUsed;
+    if (chunk > len) {
+      chunk = len;
+    }
+    memcpy(&writeBuffer[writeBufferUsed], data, chunk);
+    writeBufferUsed += chunk;
+    data += chunk;
+    len -= chunk;
+    if ((writeBufferUsed == DOWNLOAD_WRITE_BUFFER_SIZE) &&
+        (flushWriteBuffer() != FR_OK)) {
+      downloadStatus = DOWNLOAD_STATUS_FAILED;
+      return false;  // Abort on failure
+    }
+  }
+  return true;
+}
 
-  // Find the Content-Length header
-  char *contentLengthStart = strstr(headerData, contentLengthLabel);
-  if (contentLengthStart != NULL) {
-    contentLengthStart +=
-        strlen(contentLengthLabel);  // Move past "Content-Length:"
+// Keep the headers needed to decide what to do with the temporary file
+static void onHeader(const char *name, const char *value,
+                     __unused void *context) {
+  if (strcasecmp(name, "ETag") == 0) {
+    snprintf(etagHeader, sizeof(etagHeader), "%s", value);
+  } else if (strcasecmp(name, "Last-Modified") == 0) {
+    snprintf(lastModifiedHeader, sizeof(lastModifiedHeader), "%s", value);
+  } else if (strcasecmp(name, "Content-Range") == 0) {
+    snprintf(contentRangeHeader, sizeof(contentRangeHeader), "%s", value);
+  } else if (strcasecmp(name, "Content-Length") == 0) {
+    contentLength = (uint32_t)strtoul(value, NULL, DEC_BASE);
+  }
+}
 
-    // Skip leading spaces
-    while (*contentLengthStart == ' ') {
-      contentLengthStart++;
-    }
+// Function to check the status and headers of the response, and decide what
+// to do with the temporary file
+static bool onHeadersDone(int statusCode, __unused void *context) {
+  downloadStatus = DOWNLOAD_STATUS_FAILED;
+  DPRINTF("HTTP status: %d. Content-Length: %u. ETag: %s. Last-Modified: %s\n",
+          statusCode, (unsigned int)contentLength, etagHeader,
+          lastModifiedHeader);
 
-    // Convert the Content-Length value to an integer
-    size_t contentLength = strtoul(contentLengthStart, NULL, DEC_BASE);
+  char filename[DOWNLOAD_BUFFLINE_SIZE];
+  getTmpFilenamePath(filename);
+  switch (statusCode) {
+    case DOWNLOAD_HTTP_NOT_MODIFIED:
+      DPRINTF("File not modified. Keeping the one downloaded.\n");
+      notModified = true;
+      break;
+    case DOWNLOAD_HTTP_PARTIAL_CONTENT: {
+      // "bytes 1024-2047/4096". Must start where the file ends.
+      bool rangeValid =
+          (resumeOffset > 0) &&
+          (strncasecmp(contentRangeHeader, "bytes ", strlen("bytes ")) ==
+           0) &&
+          (strtoul(&contentRangeHeader[strlen("bytes ")], NULL, DEC_BASE) ==
+           resumeOffset);
+      if (!rangeValid) {
+        DPRINTF("Unexpected range: %s\n", contentRangeHeader);
+        deleteValidators(filename);
+        return false;
+      }
+      DPRINTF("Resuming download at %u bytes\n", (unsigned int)resumeOffset);
+      stats.offset = resumeOffset;
+      if (!reserveSpace(contentLength)) {
+        return false;
+      }
+    } break;
+    case DOWNLOAD_HTTP_OK:
+      if (activeTarget != DOWNLOAD_TARGET_SDCARD) {
+        // A size of a header plus whole sectors may be a STEEM image
+        uint32_t size = contentLength;
+        if (size > DOWNLOAD_ROM_MAX_SIZE + DOWNLOAD_ROM_HEADER_SIZE) {
+          DPRINTF("ROM too big: %u bytes\n", (unsigned int)size);
+          return false;
+        }
+        romHeaderPending =
+            ((size > DOWNLOAD_ROM_HEADER_SIZE) &&
+             ((size - DOWNLOAD_ROM_HEADER_SIZE) % FLASH_SECTOR_SIZE == 0))
+                ? DOWNLOAD_ROM_HEADER_SIZE
+                : 0;
+        if (activeTarget == DOWNLOAD_TARGET_ROM) {
+          break;
+        }
+      }
+      // The whole file. Discard any partial download.
+      if (resumeOffset > 0) {
+        DPRINTF("Server sent the whole file. Restarting the download.\n");
+        if ((f_lseek(&file, 0) != FR_OK) || (f_truncate(&file) != FR_OK)) {
+          return false;
+        }
+        resumeOffset = 0;
+        hashStart();
+      }
+      // Keep the validators to resume or revalidate the file later
+      snprintf(validators.etag, sizeof(validators.etag), "%s", etagHeader);
+      snprintf(validators.lastModified, sizeof(validators.lastModified), "%s",
+               lastModifiedHeader);
+      if ((etagHeader[0] != '\0') || (lastModifiedHeader[0] != '\0')) {
+        writeValidators(filename, &validators);
+      } else {
+        deleteValidators(filename);
+      }
+      // Last, so no other file takes the clusters reserved
+      if (!reserveSpace(contentLength)) {
+        return false;
+      }
+      break;
+    default:
+      DPRINTF("Unexpected HTTP status: %d\n", statusCode);
+      return false;
   }
 
-  free(headerData);  // Free allocated memory
   downloadStatus = DOWNLOAD_STATUS_IN_PROGRESS;
-  return ERR_OK;  // Header check passed
+  return true;  // Header check passed
 }
 
-static void httpClientResultCompleteFn(void *arg, httpc_result_t httpcResult,
-                                       u32_t rxContentLen, u32_t srvRes,
-                                       err_t err) {
-  HTTPC_REQUEST_T *req = (HTTPC_REQUEST_T *)arg;
-  DPRINTF("Requet complete: result %d len %u server_response %u err %d\n",
-          httpcResult, rxContentLen, srvRes, err);
-  req->complete = true;
-  if (err == ERR_OK) {
+static void onDone(httpconn_result_t result, __unused void *context) {
+  if ((result == HTTPCONN_OK) &&
+      (downloadStatus == DOWNLOAD_STATUS_IN_PROGRESS)) {
     downloadStatus = DOWNLOAD_STATUS_COMPLETED;
   } else {
     downloadStatus = DOWNLOAD_STATUS_FAILED;
   }
+  requestComplete = true;
 }
 
-download_err_t download_start() {
-  // Download the app binary from the URL in the app_info struct
-  // The binary is saved to the SD card in the folder
-  // The binary is downloaded using the HTTP client
-  // The binary is saved to the SD card
-
-  // Get the components of a url
-  if (parseUrl(filepath, &components, &fileUrl) != 0) {
-    DPRINTF("Error parsing URL\n");
-    return DOWNLOAD_CANNOTPARSEURL_ERROR;
+static const httpresp_callbacks_t responseCallbacks = {
+    onHeader, onHeadersDone, onBody, NULL};
+
+// Headers of a conditional or resumed request, if any
+static void buildRequestHeaders(char *headers, size_t size) {
+  const char *validator = (validators.etag[0] != '\0')
+                              ? validators.etag
+                              : validators.lastModified;
+  headers[0] = '\0';
+  if ((resumeOffset > 0) && (validator[0] != '\0')) {
+    snprintf(headers, size, "Range: bytes=%u-\r\nIf-Range: %s\r\n",
+             (unsigned int)resumeOffset, validator);
+  } else if (validator[0] != '\0') {
+    snprintf(headers, size, "%s: %s\r\n",
+             (validators.etag[0] != '\0') ? "If-None-Match"
+                                           : "If-Modified-Since",
+             validator);
   }
+}
 
-  // Open the file for writing to the folder of the apps to the tmp.download
-  // file
-  char filename[DOWNLOAD_BUFFLINE_SIZE] = {0};
-  getTmpFilenamePath(filename);
-  DPRINTF("Downloading to file: %s\n", filename);
+// Open the tmp file. If conditional, resume an interrupted download of the
+// same URL or revalidate the file already downloaded.
+static download_err_t openTmpFile(const char *filename, bool conditional) {
   FRESULT res;
 
-  // Close any previously open handle
-  DPRINTF("Closing any previously open file\n");
-  f_close(&file);
+  // Resume an interrupted download of the same URL. Only from the last whole
+  // write-behind buffer, so the writes stay aligned.
+  FILINFO info;
+  memset(&validators, 0, sizeof(validators));
+  if (conditional && readValidators(filename, fileUrl.url, &validators) &&
+      (f_stat(filename, &info) == FR_OK)) {
+    resumeOffset = (uint32_t)(info.fsize -
+                              info.fsize % DOWNLOAD_WRITE_BUFFER_SIZE);
+  }
+  if (resumeOffset > 0) {
+    DPRINTF("Resuming file at %u bytes\n", (unsigned int)resumeOffset);
+    res = f_open(&file, filename, FA_READ | FA_WRITE | FA_OPEN_EXISTING);
+    if ((res == FR_OK) && ((f_lseek(&file, resumeOffset) != FR_OK) ||
+                           (f_truncate(&file) != FR_OK))) {
+      f_close(&file);
+      res = FR_DENIED;
+    }
+    if (res == FR_OK) {
+      return DOWNLOAD_OK;
+    }
+    DPRINTF("Error resuming file %s: %i\n", filename, res);
+    resumeOffset = 0;
+  }
 
   // Clear read-only attribute if necessary
   DPRINTF("Clearing read-only attribute, if any\n");
@@ -250,6 +629,7 @@ download_err_t download_start() {
   DPRINTF("Removing file if it exists\n");
   res = f_unlink(filename);
   DPRINTF("Status of unlink: %i. And move on.\n", res);
+  deleteValidators(filename);
 
   // Open file for writing or create if it doesn't exist
   DPRINTF("Opening file for writing\n");
@@ -271,29 +651,131 @@ download_err_t download_start() {
     return DOWNLOAD_CANNOTOPENFILE_ERROR;
   }
 
+  // Revalidate the file already downloaded, if any
+  char finalFilename[DOWNLOAD_BUFFLINE_SIZE];
+  getFinalFilenamePath(finalFilename);
+  if (!conditional || (f_stat(finalFilename, &info) != FR_OK) ||
+      !readValidators(finalFilename, fileUrl.url, &validators)) {
+    memset(&validators, 0, sizeof(validators));
+  }
+  return DOWNLOAD_OK;
+}
+
+void download_setTarget(download_target_t newTarget, uint32_t flashAddress) {
+  target = newTarget;
+  targetFlashAddress = flashAddress;
+}
+
+download_hash_t download_setHash(const char *hash) {
+  size_t len = (hash != NULL) ? strlen(hash) : 0;
+  hashType = DOWNLOAD_HASH_NONE;
+  if ((len == 2 * DOWNLOAD_MD5_SIZE) &&
+      parseHash(hash, nextHash, DOWNLOAD_MD5_SIZE)) {
+    hashType = DOWNLOAD_HASH_MD5;
+  } else if ((len == 2 * DOWNLOAD_SHA256_SIZE) &&
+             parseHash(hash, nextHash, DOWNLOAD_SHA256_SIZE)) {
+    hashType = DOWNLOAD_HASH_SHA256;
+  } else if (len > 0) {
+    DPRINTF("Invalid hash: %s\n", hash);
+  }
+  return hashType;
+}
+
+download_err_t download_start() {
+  // Download the app binary from the URL in the app_info struct
+  // The binary is saved to the SD card in the folder
+  // The binary is downloaded using the HTTP client
+  // The binary is saved to the SD card
+
+  // The target only applies to this download
+  activeTarget = target;
+  romFlashAddress = targetFlashAddress;
+  target = DOWNLOAD_TARGET_SDCARD;
+  activeHashType = hashType;
+  memcpy(expectedHash, nextHash, sizeof(expectedHash));
+  hashType = DOWNLOAD_HASH_NONE;
+
+  // Get the components of a url
+  if (parseUrl(filepath, &components, &fileUrl) != 0) {
+    DPRINTF("Error parsing URL\n");
+    return DOWNLOAD_CANNOTPARSEURL_ERROR;
+  }
+
+  // Open the file for writing to the folder of the apps to the tmp.download
+  // file
+  char filename[DOWNLOAD_BUFFLINE_SIZE] = {0};
+  getTmpFilenamePath(filename);
+  DPRINTF("Downloading to file: %s\n", filename);
+  FRESULT res;
+
+  // Close any previously open handle
+  DPRINTF("Closing any previously open file\n");
+  f_close(&file);
+
+  resumeOffset = 0;
+  notModified = false;
+  romBufferUsed = 0;
+  romOffset = 0;
+  romHeaderPending = 0;
+  // The ROM needs the whole body: no conditional nor resumed requests
+  if (activeTarget == DOWNLOAD_TARGET_ROM) {
+    memset(&validators, 0, sizeof(validators));
+  } else {
+    download_err_t err =
+        openTmpFile(filename, activeTarget == DOWNLOAD_TARGET_SDCARD);
+    if (err != DOWNLOAD_OK) {
+      return err;
+    }
+  }
+  if (activeTarget != DOWNLOAD_TARGET_SDCARD) {
+    DPRINTF("Streaming into the ROM at 0x%08X\n",
+            (unsigned int)romFlashAddress);
+  }
+  validators.magic = DOWNLOAD_VALIDATORS_MAGIC;
+  validators.version = DOWNLOAD_VALIDATORS_VERSION;
+  snprintf(validators.url, sizeof(validators.url), "%s", fileUrl.url);
+
   downloadStatus = DOWNLOAD_STATUS_STARTED;
+  writeBufferUsed = 0;
+  memset(&stats, 0, sizeof(stats));
+  startTime = get_absolute_time();
+
+  // The digest covers the whole file, so hash what was kept first
+  hashStart();
+  if ((resumeOffset > 0) && !hashResumed()) {
+    DPRINTF("Error reading the download to resume\n");
+    f_close(&file);
+    deleteValidators(filename);
+    return DOWNLOAD_CANNOTREADFILE_ERROR;
+  }
 
   // Encode the URI for HTTP request
   // The URI must be URL-encoded to handle special characters
   char encodedUri[DOWNLOAD_BUFFLINE_SIZE] = {0};
   url_encode(components.uri, encodedUri, sizeof(encodedUri));
   DPRINTF("Encoded URI: %s\n", encodedUri);
-  // Initialize the request structure
-  request.url = encodedUri;
-  request.hostname = components.host;
+  char requestHeaders[DOWNLOAD_BUFFLINE_SIZE] = {0};
+  buildRequestHeaders(requestHeaders, sizeof(requestHeaders));
+  etagHeader[0] = '\0';
+  lastModifiedHeader[0] = '\0';
+  contentRangeHeader[0] = '\0';
+  contentLength = 0;
+  responseError = DOWNLOAD_OK;
   DPRINTF("HOST: %s. URI: %s\n", components.host, encodedUri);
-  request.headers_fn = httpClientHeaderCheckSizeFn;
-  request.recv_fn = httpClientReceiveFileFn;
-  request.result_fn = httpClientResultCompleteFn;
-  DPRINTF("Downloading: %s\n", request.url);
 #if APP_DOWNLOAD_HTTPS == 1
-  request.tls_config = altcp_tls_create_config_client(NULL, 0);  // https
   DPRINTF("Download with HTTPS\n");
 #else
   DPRINTF("Download with HTTP\n");
 #endif
-  int result = http_client_request_async(cyw43_arch_async_context(), &request);
-  if (result != 0) {
+  // Over the connection of the previous download, if still open to the host
+  char hostName[DOWNLOAD_HOSTNAME_SIZE];
+  uint16_t port = splitHostPort(components.host, hostName);
+  requestComplete = false;
+  httpconn_result_t result =
+      httpconn_get(hostName, port, encodedUri, requestHeaders,
+                   &responseCallbacks, onDone, NULL);
+  if (result != HTTPCONN_OK) {
+    requestComplete = true;
     DPRINTF("Error initializing the download: %i\n", result);
     res = f_close(&file);
     if (res != FR_OK) {
@@ -305,33 +787,77 @@ download_err_t download_start() {
 }
 
 download_poll_t download_poll() {
-  if (!request.complete) {
+  if (!requestComplete) {
     async_context_poll(cyw43_arch_async_context());
-    async_context_wait_for_work_ms(cyw43_arch_async_context(),
-                                   DOWNLOAD_POLLING_INTERVAL_MS);
+    // Do not wait for more work if that poll ended the request
+    if (!requestComplete) {
+      async_context_wait_for_work_ms(cyw43_arch_async_context(),
+                                     DOWNLOAD_POLLING_INTERVAL_MS);
+    }
     return DOWNLOAD_POLL_CONTINUE;
   }
   return DOWNLOAD_POLL_COMPLETED;
 }
 
 download_err_t download_finish() {
-  // Close the file
-  int res = f_close(&file);
-  if (res != FR_OK) {
-    DPRINTF("Error closing tmp file %s: %i\n", res);
-    return DOWNLOAD_CANNOTCLOSEFILE_ERROR;
+  // Write the last partial buffer, then close the file
+  FRESULT flushRes = FR_OK;
+  if (activeTarget != DOWNLOAD_TARGET_ROM) {
+    flushRes = flushWriteBuffer();
+    writeBufferUsed = 0;
+    int res = f_close(&file);
+    if (res != FR_OK) {
+      DPRINTF("Error closing tmp file: %i\n", res);
+      return DOWNLOAD_CANNOTCLOSEFILE_ERROR;
+    }
   }
   DPRINTF("Downloaded.\n");
 
-#if APP_DOWNLOAD_HTTPS == 1
-  altcp_tls_free_config(request.tls_config);
-#endif
-
-  if (downloadStatus != DOWNLOAD_STATUS_COMPLETED) {
+  if (downloadStatus != DOWNLOAD_STATUS_COMPLETED || flushRes != FR_OK) {
     DPRINTF("Error downloading: %i\n", downloadStatus);
-    return DOWNLOAD_FORCEDABORT_ERROR;
+    if (activeTarget != DOWNLOAD_TARGET_SDCARD) {
+      eraseRom();
+    }
+    return (responseError != DOWNLOAD_OK) ? responseError
+                                          : DOWNLOAD_FORCEDABORT_ERROR;
+  }
+  // A file not modified has no body to hash, and was checked before
+  if ((activeHashType != DOWNLOAD_HASH_NONE) && !notModified &&
+      !hashMatches()) {
+    DPRINTF("Hash mismatch. Discarding the download.\n");
+    if (activeTarget != DOWNLOAD_TARGET_ROM) {
+      char tmpFname[DOWNLOAD_BUFFLINE_SIZE];
+      getTmpFilenamePath(tmpFname);
+      f_unlink(tmpFname);
+      deleteValidators(tmpFname);
+    }
+    if (activeTarget != DOWNLOAD_TARGET_SDCARD) {
+      eraseRom();
+    }
+    return DOWNLOAD_HASHMISMATCH_ERROR;
+  }
+  // Program the last partial sector of the ROM
+  if ((activeTarget != DOWNLOAD_TARGET_SDCARD) && !programRomBuffer()) {
+    eraseRom();
+    return DOWNLOAD_CANNOTPROGRAMROM_ERROR;
+  }
+  perf_add(PERF_TIMER_DOWNLOAD, stats.elapsedUs, stats.bytes);
+  // Bytes per microsecond are MB/s. Shown with two decimals.
+  uint32_t rate = (stats.elapsedUs > 0)
+                      ? (uint32_t)((uint64_t)stats.bytes * 100 / stats.elapsedUs)
+                      : 0;
+  DPRINTF("File downloaded. %u bytes in %u ms, %u.%02u MB/s. %u writes, %u ms "
+          "writing to SD card.\n",
+          (unsigned int)stats.bytes, (unsigned int)(stats.elapsedUs / 1000),
+          (unsigned int)(rate / 100), (unsigned int)(rate % 100),
+          (unsigned int)stats.writes, (unsigned int)(stats.writeUs / 1000));
+  if (activeHashType != DOWNLOAD_HASH_NONE) {
+    uint32_t hashed = stats.bytes + stats.offset;
+    uint32_t usPerKb =
+        (hashed > 0) ? (uint32_t)((uint64_t)stats.hashUs * 1024 / hashed) : 0;
+    DPRINTF("Hash verified. %u ms hashing, %u us per KB.\n",
+            (unsigned int)(stats.hashUs / 1000), (unsigned int)usPerKb);
   }
-  DPRINTF("File downloaded\n");
 
   return DOWNLOAD_OK;
 }
@@ -339,21 +865,28 @@ download_err_t download_finish() {
 download_err_t download_confirm() {
   // Get the filename of the app binary in uf2 format
   char fname[DOWNLOAD_BUFFLINE_SIZE] = {0};
-  snprintf(fname, sizeof(fname), "%s/%s",
-           settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_ROMS_FOLDER)
-               ->value,
-           fileUrl.filename);
+  getFinalFilenamePath(fname);
+  char tmpFname[DOWNLOAD_BUFFLINE_SIZE] = {0};
+  getTmpFilenamePath(tmpFname);
+
+  if (activeTarget == DOWNLOAD_TARGET_ROM) {
+    // Nothing written to the SD card
+    return DOWNLOAD_OK;
+  }
+
+  if (notModified) {
+    // The server had nothing new. Keep the file already downloaded.
+    DPRINTF("File %s not modified\n", fname);
+    f_unlink(tmpFname);
+    deleteValidators(tmpFname);
+    return DOWNLOAD_OK;
+  }
 
   DPRINTF("Writing file %s\n", fname);
 
   // Try to delete the file if they exist
   f_unlink(fname);
-
-  // Now rename the tmp file to the final filename
-  char tmpFname[DOWNLOAD_BUFFLINE_SIZE] = {0};
-  snprintf(tmpFname, sizeof(tmpFname), "%s/tmp.download",
-           settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_ROMS_FOLDER)
-               ->value);
+  deleteValidators(fname);
 
   // Rename the file to the final filename
   FRESULT res = f_rename(tmpFname, fname);
@@ -361,6 +894,13 @@ download_err_t download_confirm() {
     DPRINTF("Error renaming file: %i\n", res);
     return DOWNLOAD_CANNOTRENAMEFILE_ERROR;
   }
+
+  // The validators follow the file, to revalidate it next time
+  char tmpValidators[DOWNLOAD_BUFFLINE_SIZE];
+  char fnameValidators[DOWNLOAD_BUFFLINE_SIZE];
+  getValidatorsPath(tmpFname, tmpValidators);
+  getValidatorsPath(fname, fnameValidators);
+  f_rename(tmpValidators, fnameValidators);
   DPRINTF("Written file %s\n", fname);
   return DOWNLOAD_OK;
 }
@@ -377,3 +917,7 @@ void download_setFilepath(const char *path) {
 const download_url_components_t *download_getUrlComponents() {
   return &components;
 }
+
+bool download_isNotModified() { return notModified; }
+
+const download_stats_t *download_getStats() { return &stats; }
@@ -23,6 +23,15 @@ static void cmdNetwork(const char *arg);
 static void cmdLaunch(const char *arg);
 static void cmdBooster(const char *arg);
 static void cmdDelay(const char *arg);
+static void cmdSearch(const char *arg);
+static void cmdQueue(const char *arg);
+static void cmdSdBench(const char *arg);
+static void cmdSdCalibrate(const char *arg);
+static void cmdStats(const char *arg);
+static void cmdProfile(const char *arg);
+static void cmdTiming(const char *arg);
+static void cmdBusTrace(const char *arg);
+static void cmdTrace(const char *arg);
 static void cmdUnknown(const char *arg);
 
 // Command table
@@ -35,6 +44,17 @@ static const Command commands[] = {
     {"d", cmdNetwork},
     {"l", cmdLaunch},
     {"r", cmdDelay},
+    {"f", cmdSearch},
+    {"find", cmdSearch},
+    {"q", cmdQueue},
+    {"queue", cmdQueue},
+    {"sdbench", cmdSdBench},
+    {"sdcal", cmdSdCalibrate},
+    {"stats", cmdStats},
+    {"profile", cmdProfile},
+    {"timing", cmdTiming},
+    {"bus", cmdBusTrace},
+    {"trace", cmdTrace},
     {"e", cmdExit},
     {"x", cmdBooster},
     {"?", cmdHelp},
@@ -53,9 +73,8 @@ static const Command commands[] = {
 // Number of commands in the table
 static const size_t numCommands = sizeof(commands) / sizeof(commands[0]);
 
-// Global array to store ROM info.
-static ROM *roms = NULL;
-static int romsCount = 0;
+// File system of the SD card, to mount it again after a calibration
+static FATFS *filesystem = NULL;
 
 // ROMs folder. Initialize with the default value.
 static char romsFolder[MAX_PATH_SIZE] = "/roms";
@@ -63,7 +82,11 @@ static char romsFolder[MAX_PATH_SIZE] = "/roms";
 // Pagination info
 static int currentRomPage = 0;
 static int maxRomPages = 0;
-static int downloadRomSelected = -1;
+
+// Filename and hash of the ROM being downloaded. The catalog page may change
+// while the download is in progress.
+static char downloadRomFilename[MAX_FILENAME_LENGTH] = "";
+static char downloadRomHash[CATALOG_HASH_LENGTH] = "";
 
 // Menu status
 static MenuState menuState = {0, 0};
@@ -78,16 +101,74 @@ static bool resetDeviceAtBoot = true;
 // Do we have network or not?
 static bool hasNetwork = false;
 
+// Connection to the WiFi network, made in the background
+static network_sta_state_t networkState = NETWORK_STA_IDLE;
+static char networkStatus[NETWORK_MAX_STRING_LENGTH] = {0};
+
 // Delay/ripper mode?
 static bool delayMode = false;
 
+// Core1 must not run from the flash while it is written
+static void saveSettings() {
+  worker_lockoutStart();
+  settings_save(aconfig_getContext(), true);
+  worker_lockoutEnd();
+}
+
+// FatFs and the catalog are used from one core at a time. The commands that
+// need them wait while core1 converts the catalog.
+static bool sdcardBusy() {
+  if (!worker_isBusy()) {
+    return false;
+  }
+  term_printString("Updating the catalog. Try again in a moment.\n");
+  return true;
+}
+
+static char catalogCsvPath[MAX_PATH_SIZE] = {0};
+static catalog_status_t catalogStatus = CATALOG_OK;
+// Only the search index is out of date, not the catalog
+static bool catalogIndexOnly = false;
+// Submitted by the main loop: the worker was full, or a command found the
+// catalog out of date and the first page is still read here
+static bool catalogPending = false;
+
+// Runs in core1
+static void convertCatalog(void *context) {
+  catalogStatus = catalogIndexOnly
+                      ? catalog_buildSearchIndex((const char *)context)
+                      : catalog_convertCsv((const char *)context);
+}
+
+static void catalogConverted(void *context) {
+  if (catalogStatus != CATALOG_OK) {
+    DPRINTF("Error converting the catalog: %d\n", catalogStatus);
+  } else {
+    DPRINTF("Catalog %s converted\n", (const char *)context);
+  }
+}
+
+// Never converted here: it takes seconds, and this core must keep handling
+// the computer and the SELECT button
+static void submitCatalog() {
+  catalogPending = (worker_submit(convertCatalog, catalogConverted,
+                                  catalogCsvPath) != WORKER_OK);
+}
+
+// Converts the catalog, or only builds its search index, from the main loop
+static void updateCatalog(const char *csvPath, bool indexOnly) {
+  snprintf(catalogCsvPath, sizeof(catalogCsvPath), "%s", csvPath);
+  catalogIndexOnly = indexOnly;
+  catalogPending = true;
+}
+
 static FRESULT storeFileToFlash(const char *filename, uint32_t flashAddress) {
   FIL file;
   FRESULT res;
   UINT bytesRead;
   FSIZE_t size;
 
-  uint8_t *buffer = (uint8_t *)malloc(FLASH_SECTOR_SIZE);
+  uint8_t *buffer = (uint8_t *)arena_alloc(ARENA_SCRATCH, FLASH_SECTOR_SIZE);
   if (buffer == NULL) {
     DPRINTF("Error allocating memory for buffer\n");
     return FR_NOT_ENOUGH_CORE;
@@ -97,7 +178,7 @@ static FRESULT storeFileToFlash(const char *filename, uint32_t flashAddress) {
   res = f_open(&file, filename, FA_READ);
   if (res != FR_OK) {
     DPRINTF("Error opening file %s: %d\n", filename, res);
-    free(buffer);
+    arena_free(ARENA_SCRATCH, buffer);
     return res;
   }
 
@@ -114,7 +195,7 @@ static FRESULT storeFileToFlash(const char *filename, uint32_t flashAddress) {
       DPRINTF("Error reading header of file: %d (bytes read: %u)\n", res,
               bytesRead);
       f_close(&file);
-      free(buffer);
+      arena_free(ARENA_SCRATCH, buffer);
       return res;
     }
 
@@ -128,7 +209,7 @@ static FRESULT storeFileToFlash(const char *filename, uint32_t flashAddress) {
       if (res != FR_OK) {
         DPRINTF("Error seeking back in file: %d\n", res);
         f_close(&file);
-        free(buffer);
+        arena_free(ARENA_SCRATCH, buffer);
         return res;
       }
     }
@@ -146,7 +227,7 @@ static FRESULT storeFileToFlash(const char *filename, uint32_t flashAddress) {
     if (res != FR_OK) {
       DPRINTF("Error reading file: %d\n", res);
       f_close(&file);
-      free(buffer);
+      arena_free(ARENA_SCRATCH, buffer);
       return res;
     }
     if (bytesRead == 0) {
@@ -169,17 +250,19 @@ static FRESULT storeFileToFlash(const char *filename, uint32_t flashAddress) {
 
     DPRINTF("Programming %u bytes at offset 0x%X\n", programSize, offset);
     // Disable interrupts during flash programming.
+    worker_lockoutStart();
     uint32_t ints = save_and_disable_interrupts();
     flash_range_erase(offset, programSize);
     flash_range_program(offset, buffer, programSize);
     restore_interrupts(ints);
+    worker_lockoutEnd();
 
     // Increment the flash offset by the actual bytes read.
     offset += bytesRead;
   }
 
   f_close(&file);
-  free(buffer);
+  arena_free(ARENA_SCRATCH, buffer);
   DPRINTF("File %s stored to flash at address 0x%X\n", filename, flashAddress);
   return FR_OK;
 }
@@ -251,7 +334,7 @@ static AutorunResult autorunIfRequested(void) {
                       filenameStart);
   settings_put_integer(aconfig_getContext(), ACONFIG_PARAM_ROM_MODE,
                        ROM_MODE_DIRECT);
-  settings_save(aconfig_getContext(), true);
+  saveSettings();
 
   // Blink green LED (if available) forever instead of resetting
 #ifdef BLINK_H
@@ -265,12 +348,15 @@ static AutorunResult autorunIfRequested(void) {
       blink_off();
     }
     sleep_ms(AUTORUN_BLINK_MS);
+    // SELECT resets out of autorun
+    select_poll();
   }
 #else
   DPRINTF(
       "Autorun successful. Entering infinite loop to indicate autorun mode.\n");
   while (1) {
     sleep_ms(AUTORUN_BLINK_MS);
+    select_poll();
   }
 #endif
   return AUTORUN_OK;  // Not reached on success, keeps signature consistent
@@ -299,202 +385,34 @@ static int hasValidExtension(const char *filename) {
   return 0;
 }
 
-/**
- * @brief Comparison function for qsort to sort ROMs lexicographically
- * (case-insensitive).
- */
-static int compareRoms(const void *first, const void *second) {
-  const ROM *romA = (const ROM *)first;
-  const ROM *romB = (const ROM *)second;
-  return strcasecmp(romA->filename, romB->filename);
-}
-
-//-----------------------------------------------------------------
-// Helper: URL-decode a string.
-// Converts %xx sequences into their character values.
-// dest_size includes room for the null terminator.
-static void urlDecode(const char *src, char *dest, size_t destSize) {
-  size_t idx = 0;
-  while (*src && idx < destSize - 1) {
-    if (*src == '%') {
-      // Check if next two characters are valid hex digits.
-      if (isxdigit((unsigned char)*(src + 1)) &&
-          isxdigit((unsigned char)*(src + 2))) {
-        char hex[3] = {*(src + 1), *(src + 2), '\0'};
-        dest[idx++] = (char)strtol(hex, NULL, HEX_BASE);
-        src += 3;
-        continue;
-      }
-    }
-    dest[idx++] = *src++;
-  }
-  dest[idx] = '\0';
-}
-
 static void readRomsSdcard(const char *folder) {
-  FRESULT res;
-  DIR dir;
-  FILINFO fno;
-
-  // Open the directory.
-  res = f_opendir(&dir, folder);
-  if (res != FR_OK) {
-    DPRINTF("Error opening directory %s: %d\n", folder, res);
-    return;
-  }
-
-  // Reset the ROM count.
-  romsCount = 0;
-
-  // Read each directory entry.
-  for (;;) {
-    res = f_readdir(&dir, &fno);
-    if (res != FR_OK || fno.fname[0] == 0) {
-      break;  // Break on error or end of directory
-    }
-
-    // Skip directories if you only want files.
-    if (fno.fattrib & AM_DIR) {
-      continue;
-    }
-
-    // Skip files starting with '.'
-    if (fno.fname[0] == '.') {
-      continue;
-    }
-
-    // Only add files with valid extensions.
-    if (!hasValidExtension(fno.fname)) {
-      continue;
-    }
-
-    // Store the filename into the roms[] array if there is space.
-    if (romsCount < MAX_ROMS) {
-      // Copy the filename from FatFS entry. fno.fname is a char array.
-      strncpy(roms[romsCount].filename, fno.fname, MAX_FILENAME_LENGTH - 1);
-      roms[romsCount].filename[MAX_FILENAME_LENGTH - 1] = '\0';
-      strncpy(roms[romsCount].name, fno.fname, MAX_FILENAME_LENGTH - 1);
-      roms[romsCount].name[MAX_FILENAME_LENGTH - 1] = '\0';
-      roms[romsCount].path[0] = '\0';
-      strncat(roms[romsCount].path, folder, MAX_PATH_SIZE - 1);
-      strncat(roms[romsCount].path, "/", MAX_PATH_SIZE - 1);
-      strncat(roms[romsCount].path, fno.fname, MAX_PATH_SIZE - 1);
-      romsCount++;
-    } else {
-      DPRINTF("Maximum ROM count reached (%d)\n", MAX_ROMS);
-      break;
-    }
+  // The catalog only keeps one page in RAM. The entries come sorted from the
+  // index of the folder.
+  if (catalog_openSdcard(folder, hasValidExtension) != CATALOG_OK) {
+    DPRINTF("Error reading the ROMs in %s\n", folder);
   }
-
-  f_closedir(&dir);
-
-  // Sort the roms array alphabetically (lexicographically) by filename.
-  qsort(roms, romsCount, sizeof(ROM), compareRoms);
-
-  DPRINTF("Found %d ROMs on the SD card.\n", romsCount);
-  maxRomPages = (romsCount + MAX_ROMS_PER_PAGE - 1) / MAX_ROMS_PER_PAGE;
+  maxRomPages = catalog_getPages();
 }
 
 static void readRomsCsv(const char *csvFilepath) {
-  FRESULT res;
-  FIL csvFile;
-  char line[256];  // If you really have huge CSV lines, make this larger, but
-                   // 256 is often enough.
-  int lineNum = 0;
-
-  romsCount = 0;
-
-  res = f_open(&csvFile, csvFilepath, FA_READ);
-  if (res != FR_OK) {
-    DPRINTF("Error opening CSV file %s: %d\n", csvFilepath, res);
-    return;
+  if (catalog_openCsv(csvFilepath) != CATALOG_OK) {
+    DPRINTF("Error reading the ROMs in %s\n", csvFilepath);
+  } else if (catalog_isStale()) {
+    // Browsed from the CSV file meanwhile
+    term_printString("Updating the catalog in the background.\n");
+    updateCatalog(csvFilepath, false);
   }
-
-  // Skip header
-  if (f_gets(line, sizeof(line), &csvFile) == NULL) {
-    DPRINTF("Error reading header from CSV file\n");
-    f_close(&csvFile);
-    return;
-  }
-
-  while (f_gets(line, sizeof(line), &csvFile) != NULL) {
-    lineNum++;
-    DPRINTF("Line %d: %s", lineNum, line);
-
-    if (line[0] == '\0' || line[0] == '\n') continue;
-
-    // These should be as small as possible!
-    char field1[MAX_PATH_SIZE] = {0};  // URL
-    char field2[MAX_PATH_SIZE] = {0};  // Name
-    char field3[MAX_PATH_SIZE] = {0};  // Description (tune this)
-    char field4[MAX_PATH_SIZE] = {0};  // Tags (tune this)
-    char field5[12] = {0};             // Size (KB) (should never be big)
-
-    char *ptr = line;
-    int jdx;
-
-// Tiny helper: extracts quoted CSV field (no inner quotes support)
-#define EXTRACT_FIELD(dest)                                \
-  do {                                                     \
-    while (*ptr && isspace((unsigned char)*ptr)) ptr++;    \
-    if (*ptr != '\"') goto next_line;                      \
-    ptr++;                                                 \
-    jdx = 0;                                               \
-    while (*ptr && *ptr != '\"' && jdx < sizeof(dest) - 1) \
-      dest[jdx++] = *ptr++;                                \
-    dest[jdx] = 0;                                         \
-    if (*ptr == '\"') ptr++;                               \
-    while (*ptr && (*ptr == ',' || isspace(*ptr))) ptr++;  \
-  } while (0)
-
-    EXTRACT_FIELD(field1);  // URL
-    EXTRACT_FIELD(field2);  // Name
-    EXTRACT_FIELD(field3);  // Description
-    EXTRACT_FIELD(field4);  // Tags
-    EXTRACT_FIELD(field5);  // Size
-
-    // --- Decode fields directly into their struct fields ---
-    if (romsCount < MAX_ROMS) {
-      ROM *r = &roms[romsCount];
-
-      urlDecode(field1, r->filename, sizeof(r->filename));
-      // Compose path
-      const char *romsFolder =
-          settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_ROMS_FOLDER)
-              ->value;
-      snprintf(r->path, sizeof(r->path), "%s/%s", romsFolder, r->filename);
-
-      urlDecode(field2, r->name, sizeof(r->name));
-      urlDecode(field3, r->description, sizeof(r->description));
-      urlDecode(field4, r->tags, sizeof(r->tags));
-      r->size = atoi(field5);
-
-      romsCount++;
-    } else {
-      DPRINTF("Maximum ROM count reached (%d)\n", MAX_ROMS);
-      break;
-    }
-  next_line:;
-  }
-  f_close(&csvFile);
-
-  qsort(roms, romsCount, sizeof(ROM), compareRoms);
-
-  DPRINTF("Found %d ROMs in CSV file.\n", romsCount);
-  maxRomPages = (romsCount + MAX_ROMS_PER_PAGE - 1) / MAX_ROMS_PER_PAGE;
-#undef EXTRACT_FIELD
+  maxRomPages = catalog_getPages();
 }
 
 /**
- * @brief Displays a single page of ROM entries.
+ * @brief Displays a single page of ROM entries of the catalog.
  *
- * @param roms        The array of ROM structures.
- * @param roms_count  The total number of ROM entries.
- * @param page_size   The number of lines (or rows) per page.
- * @param page_number The page number to display (starting with 0).
+ * @param pageSize    The number of lines (or rows) per page.
+ * @param pageNumber  The page number to display (starting with 0).
  */
-static void displayRomsPage(const ROM roms[], int romsCount, int pageSize,
-                            int pageNumber) {
+static void displayRomsPage(int pageSize, int pageNumber) {
+  int romsCount = catalog_getCount();
   if (pageSize <= 0) {
     pageSize = 0;
   }
@@ -511,13 +429,18 @@ static void displayRomsPage(const ROM roms[], int romsCount, int pageSize,
 
   char buff[TERM_SCREEN_SIZE_X];
   // Page starts at 1 for user display.
-  snprintf(buff, sizeof(buff), "Page %d, ROMs %d to %d of %d:\n\n",
-           pageNumber + 1, startIndex + 1, endIndex, romsCount);
+  snprintf(buff, sizeof(buff), "Page %d, %s %d to %d of %d:\n\n",
+           pageNumber + 1, catalog_isFiltered() ? "found" : "ROMs",
+           startIndex + 1, endIndex, romsCount);
   term_printString(buff);
 
   for (int i = startIndex; i < endIndex; i++) {
+    const catalog_entry_t *rom = catalog_getEntry(i);
+    if (rom == NULL) {
+      break;
+    }
     // ROMs starts at 1 for user display.
-    snprintf(buff, sizeof(buff), "%d. %s\n", i + 1, roms[i].name);
+    snprintf(buff, sizeof(buff), "%d. %s\n", i + 1, rom->name);
     if (strlen(buff) >= (TERM_SCREEN_SIZE_X - 2)) {
       if (buff[strlen(buff) - 2] != '\n') {
         buff[strlen(buff) - 2] = '\n';
@@ -534,7 +457,7 @@ static void navigatePages(int pageNumber) {
   term_printString(
       "\x1B"
       "E");
-  displayRomsPage(roms, romsCount, MAX_ROMS_PER_PAGE, pageNumber);
+  displayRomsPage(MAX_ROMS_PER_PAGE, pageNumber);
   term_printString("\n");
   if (pageNumber < maxRomPages - 1) {
     term_printString("[N]ext ");
@@ -542,7 +465,11 @@ static void navigatePages(int pageNumber) {
   if (pageNumber > 0) {
     term_printString("[P]rev ");
   }
-  term_printString("[M]enu or ROM number");
+  if (menuState.menuLevel == TERM_ROMS_MENU_BROWSE_NETWORK) {
+    term_printString("[F]ind [Q]ueue [M]enu or ROM #");
+  } else {
+    term_printString("[F]ind [M]enu or ROM #");
+  }
 }
 
 static void showTitle() {
@@ -558,6 +485,7 @@ static void menu(void) {
   term_printString("\n\n");
   term_printString("[B] Browse ROMs in microSD card\n");
   term_printString("[D] Download ROMs from internet server\n");
+  term_printString("[F] Find ROMs by name or #tag\n");
   term_printString("[S] Settings\n\n");
   term_printString("[E] Exit to desktop\n");
   term_printString("[X] Return to booster menu\n\n");
@@ -590,9 +518,16 @@ static void menu(void) {
   hasNetwork = currentIp.addr != 0;
   if (hasNetwork) {
     term_printString("Connected\n");
+  } else if (networkState == NETWORK_STA_JOINING) {
+    term_printString("Connecting... ");
+    term_printString(network_wifiConnStatusStr());
+    term_printString("\n");
   } else {
     term_printString("Not connected\n");
   }
+  if (dlqueue_isBusy()) {
+    term_printString("Downloading. [Q] to list the downloads.\n");
+  }
 
   term_printString("\n");
   term_printString("Select an option: ");
@@ -602,6 +537,9 @@ static void menu(void) {
 void cmdMenu(const char *arg) { menu(); }
 
 void cmdNext(const char *arg) {
+  if (sdcardBusy()) {
+    return;
+  }
   if (currentRomPage < maxRomPages - 1) {
     currentRomPage++;
   }
@@ -609,6 +547,9 @@ void cmdNext(const char *arg) {
 }
 
 void cmdPrev(const char *arg) {
+  if (sdcardBusy()) {
+    return;
+  }
   currentRomPage--;
   if (currentRomPage < 0) {
     currentRomPage = 0;
@@ -623,6 +564,19 @@ void cmdHelp(const char *arg) {
   term_printString("  clear   - Clear the terminal screen\n");
   term_printString("  exit    - Exit the terminal\n");
   term_printString("  help    - Show available commands\n");
+  term_printString(" SD card:\n");
+  term_printString("  sdbench - Measure the SD card speed\n");
+  term_printString("  sdcal   - Find the fastest SD clock\n");
+  term_printString(" Tuning:\n");
+  term_printString("  stats   - Counters, stacks and heap\n");
+  term_printString("            'stats reset' clears them\n");
+  term_printString("  trace   - Save the trace to the SD card\n");
+  term_printString("  profile - Clock profile of the computer\n");
+  term_printString("            'profile bench' validates it\n");
+  term_printString("  timing  - Timing of the ROM reads\n");
+  term_printString("            'timing test' finds the margin\n");
+  term_printString("  bus     - Record the bus in Ripper\n");
+  term_printString("            mode: 'bus on|off'\n");
 }
 
 void cmdClear(const char *arg) { term_clearScreen(); }
@@ -634,10 +588,13 @@ void cmdExit(const char *arg) {
 }
 
 void cmdCard(const char *arg) {
+  if (sdcardBusy()) {
+    return;
+  }
   readRomsSdcard(romsFolder);
   menuState.menuLevel = TERM_ROMS_MENU_BROWSE_SD;
 
-  if (romsCount == 0) {
+  if (catalog_getCount() == 0) {
     term_printString("No ROMs found in the SD card.\n");
     term_printString("Download ROMs from internet,\n");
     term_printString("or copy them to folder '");
@@ -650,15 +607,80 @@ void cmdCard(const char *arg) {
 }
 
 void cmdNetwork(const char *arg) {
+  if (sdcardBusy()) {
+    return;
+  }
   char csvPath[MAX_PATH_SIZE];
-  snprintf(csvPath, sizeof(csvPath), "%s/roms.csv", romsFolder);
+  snprintf(csvPath, sizeof(csvPath), "%s/%s", romsFolder, ROMS_CSV_FILENAME);
   readRomsCsv(csvPath);
   menuState.menuLevel = TERM_ROMS_MENU_BROWSE_NETWORK;
   currentRomPage = 0;
   navigatePages(currentRomPage);
 }
 
-void cmdLaunch(const char *arg) {
+void cmdSearch(const char *arg) {
+  if (sdcardBusy()) {
+    return;
+  }
+  switch (menuState.menuLevel) {
+    case TERM_ROMS_MENU_BROWSE_SD:
+    case TERM_ROMS_MENU_BROWSE_NETWORK:
+      break;
+    case TERM_ROMS_MENU_BROWSE_NETWORK + TERM_ROMS_MENU_SUBMENU:
+      downloadRomFilename[0] = '\0';
+      menuState.menuLevel = TERM_ROMS_MENU_BROWSE_NETWORK;
+      break;
+    case TERM_ROMS_MENU_MAIN: {
+      // From the main menu, search the ROMs of the internet server
+      char csvPath[MAX_PATH_SIZE];
+      snprintf(csvPath, sizeof(csvPath), "%s/%s", romsFolder,
+               ROMS_CSV_FILENAME);
+      readRomsCsv(csvPath);
+      menuState.menuLevel = TERM_ROMS_MENU_BROWSE_NETWORK;
+    } break;
+    default:
+      return;
+  }
+  if (catalog_getCount() == 0 && !catalog_isFiltered()) {
+    term_printString("No ROMs to search.\n");
+    menuState.menuLevel = TERM_ROMS_MENU_MAIN;
+    return;
+  }
+
+  // Without words to search, show all the ROMs again
+  catalog_status_t status = CATALOG_QUERY_ERROR;
+  if (arg[0] != '\0') {
+    term_printString("Searching...\n");
+    status = catalog_search(arg);
+  }
+  if (status == CATALOG_OK && catalog_getCount() == 0) {
+    catalog_clearSearch();
+    maxRomPages = catalog_getPages();
+    term_printString("No ROMs found. Try other words.\n");
+    return;
+  }
+  if (status == CATALOG_STALE_ERROR) {
+    // Only the catalog of the server is converted
+    if (!catalogPending) {
+      char csvPath[MAX_PATH_SIZE];
+      snprintf(csvPath, sizeof(csvPath), "%s/%s", romsFolder,
+               ROMS_CSV_FILENAME);
+      updateCatalog(csvPath, !catalog_isStale());
+    }
+    term_printString("Search not available yet. Try again in a moment.\n");
+  }
+  if (status != CATALOG_OK) {
+    catalog_clearSearch();
+    if ((status != CATALOG_QUERY_ERROR) && (status != CATALOG_STALE_ERROR)) {
+      term_printString("Search not available.\n");
+    }
+  }
+  maxRomPages = catalog_getPages();
+  currentRomPage = 0;
+  navigatePages(currentRomPage);
+}
+
+static void showLaunch() {
   menuState.menuLevel = TERM_ROMS_MENU_LAUNCH;
   term_printString("The ROM will boot shortly...\n\n");
   if (delayMode) {
@@ -668,6 +690,24 @@ void cmdLaunch(const char *arg) {
   }
   term_printString("To return to this menu, press SELECT\n");
   term_printString("If ROM doesn't boot, reset the computer\n");
+}
+
+// The ROM is already in the flash. Boot it after the reset.
+static void bootRom() {
+  // Now we can set the ROM emulation mode here
+  // Set the ROM emulation mode to 0 (ROM no delay)
+  settings_put_integer(aconfig_getContext(), ACONFIG_PARAM_ROM_MODE,
+                       delayMode ? ROM_MODE_DELAY : ROM_MODE_DIRECT);
+  saveSettings();
+
+  keepActive = false;  // Exit the active loop
+}
+
+void cmdLaunch(const char *arg) {
+  if (sdcardBusy()) {
+    return;
+  }
+  showLaunch();
   SettingsConfigEntry *romFile =
       settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_ROM_SELECTED);
   if (romFile != NULL) {
@@ -681,20 +721,563 @@ void cmdLaunch(const char *arg) {
     if (fresult != FR_OK) {
       DPRINTF("Error loading ROM file into FLASH: %d\n", fresult);
     } else {
-      // Now we can set the ROM emulation mode here
-      // Set the ROM emulation mode to 0 (ROM no delay)
-      settings_put_integer(aconfig_getContext(), ACONFIG_PARAM_ROM_MODE,
-                           delayMode ? ROM_MODE_DELAY : ROM_MODE_DIRECT);
-      settings_save(aconfig_getContext(), true);
-
-      keepActive = false;  // Exit the active loop
+      bootRom();
     }
   } else {
     DPRINTF("No ROM file selected.\n");
   }
 }
 
+// URL of a ROM, on the same server as the catalog
+static void getRomUrl(const char *filename, char *url, size_t size) {
+  snprintf(url, size, "%s://%s/%s", download_getUrlComponents()->protocol,
+           download_getUrlComponents()->host, filename);
+}
+
+// Short reason of a failed download, to fit in a line of the queue
+static const char *getJobError(const dlqueue_job_t *job) {
+  switch (job->error) {
+    case DOWNLOAD_HASHMISMATCH_ERROR:
+      return "corrupt";
+    case DOWNLOAD_NOSPACE_ERROR:
+      return "no space";
+    default:
+      return "failed";
+  }
+}
+
+static void romQueuedDone(const dlqueue_job_t *job) {
+  romindex_invalidate(romsFolder);
+}
+
+static bool selectDownloadedRom(const dlqueue_job_t *job) {
+  romindex_invalidate(romsFolder);
+  if (job->status != DLQUEUE_JOB_DONE) {
+    DPRINTF("Error downloading ROM %s: %d\n", job->filename, job->error);
+    return false;
+  }
+  // Save the selected ROM to the settings
+  settings_put_string(aconfig_getContext(), ACONFIG_PARAM_ROM_SELECTED,
+                      job->filename);
+  saveSettings();
+  return true;
+}
+
+static void romSelectedDone(const dlqueue_job_t *job) {
+  // Refresh the ROM to launch, unless browsing meanwhile
+  if (selectDownloadedRom(job) &&
+      (menuState.menuLevel == TERM_ROMS_MENU_MAIN)) {
+    menu();
+  }
+}
+
+static void romLaunchDone(const dlqueue_job_t *job) {
+  if (!selectDownloadedRom(job)) {
+    menu();
+    term_printString("\nThe ROM could not be downloaded: ");
+    term_printString(getJobError(job));
+    term_printString("\n");
+    return;
+  }
+  showLaunch();
+  bootRom();
+}
+
+// Download the ROM selected in the network catalog. When launching, the ROM
+// is also programmed into the flash while it downloads, so it boots as soon
+// as the download finishes.
+static void startRomDownload(bool launch) {
+  // Clean the ROM_SELECTED setting
+  settings_put_string(aconfig_getContext(), ACONFIG_PARAM_ROM_SELECTED, "");
+  saveSettings();
+
+  char url[MAX_PATH_SIZE * 2];
+  getRomUrl(downloadRomFilename, url, sizeof(url));
+  DPRINTF("Downloading ROM: %s\n", url);
+  dlqueue_status_t status =
+      launch ? dlqueue_add(url, DOWNLOAD_TARGET_ROM_SDCARD,
+                           (uint32_t)&_rom_temp_start, downloadRomHash,
+                           romLaunchDone)
+             : dlqueue_add(url, DOWNLOAD_TARGET_SDCARD, 0, downloadRomHash,
+                           romSelectedDone);
+  downloadRomFilename[0] = '\0';
+  downloadRomHash[0] = '\0';
+  menuState.menuLevel = TERM_ROMS_MENU_MAIN;
+  menu();
+  if (status != DLQUEUE_OK) {
+    term_printString("\nThe download queue is full.\n");
+  } else if (launch) {
+    term_printString("\nDownloading. The ROM will boot when finished...\n");
+  }
+}
+
+static void showQueue() {
+  char buff[TERM_SCREEN_SIZE_X];
+  int count = dlqueue_getCount();
+  if (count == 0) {
+    term_printString("No downloads.\n");
+    return;
+  }
+  term_printString("Downloads:\n");
+  for (int i = 0; i < count; i++) {
+    const dlqueue_job_t *job = dlqueue_getJob(i);
+    switch (job->status) {
+      case DLQUEUE_JOB_QUEUED:
+        snprintf(buff, sizeof(buff), "%-26.26s queued\n", job->filename);
+        break;
+      case DLQUEUE_JOB_DOWNLOADING:
+        snprintf(buff, sizeof(buff), "%-26.26s %u KB\n", job->filename,
+                 (unsigned int)(job->bytes / 1024));
+        break;
+      case DLQUEUE_JOB_DONE:
+        snprintf(buff, sizeof(buff), "%-26.26s done\n", job->filename);
+        break;
+      default:
+        snprintf(buff, sizeof(buff), "%-26.26s %s\n", job->filename,
+                 getJobError(job));
+    }
+    term_printString(buff);
+  }
+  const httpconn_stats_t *stats = httpconn_getStats();
+  snprintf(buff, sizeof(buff), "%u requests, %u connections.\n",
+           (unsigned int)stats->requests, (unsigned int)stats->connections);
+  term_printString(buff);
+}
+
+// "q 3 7 12-15" queues the download of the ROMs of the catalog given. "q"
+// alone lists the downloads.
+void cmdQueue(const char *arg) {
+  if (arg[0] == '\0') {
+    showQueue();
+    return;
+  }
+  if (sdcardBusy()) {
+    return;
+  }
+  if ((menuState.menuLevel != TERM_ROMS_MENU_BROWSE_NETWORK) &&
+      (menuState.menuLevel !=
+       TERM_ROMS_MENU_BROWSE_NETWORK + TERM_ROMS_MENU_SUBMENU)) {
+    term_printString("Browse the ROMs to download first.\n");
+    return;
+  }
+  int queued = 0;
+  int rejected = 0;
+  const char *next = arg;
+  while (*next != '\0') {
+    char *end;
+    long first = strtol(next, &end, DEC_BASE);
+    if (end == next) {
+      next++;  // Separator
+      continue;
+    }
+    long last = first;
+    if (*end == '-') {
+      next = end + 1;
+      last = strtol(next, &end, DEC_BASE);
+      if (end == next) {
+        last = first;
+      }
+    }
+    next = end;
+    for (long romNumber = first; romNumber <= last; romNumber++) {
+      const catalog_entry_t *rom = catalog_getEntry((int)romNumber - 1);
+      char url[MAX_PATH_SIZE * 2];
+      if (rom != NULL) {
+        getRomUrl(rom->filename, url, sizeof(url));
+      }
+      if ((rom != NULL) && (dlqueue_add(url, DOWNLOAD_TARGET_SDCARD, 0,
+                                        rom->hash,
+                                        romQueuedDone) == DLQUEUE_OK)) {
+        queued++;
+      } else {
+        rejected++;
+      }
+      if (rejected > DLQUEUE_MAX_JOBS) {
+        break;  // A range far too long
+      }
+    }
+  }
+  char buff[TERM_SCREEN_SIZE_X];
+  snprintf(buff, sizeof(buff), "%d ROMs queued for download.\n", queued);
+  term_printString(buff);
+  if (rejected > 0) {
+    snprintf(buff, sizeof(buff), "%d invalid or the queue is full.\n",
+             rejected);
+    term_printString(buff);
+  }
+}
+
+// Throughput in MB/s with two decimals
+static void printThroughput(const char *label, uint32_t kbPerSec) {
+  char buff[TERM_SCREEN_SIZE_X];
+  snprintf(buff, sizeof(buff), "%s%u.%02u MB/s\n", label,
+           (unsigned int)(kbPerSec / 1024),
+           (unsigned int)((kbPerSec % 1024) * 100 / 1024));
+  term_printString(buff);
+}
+
+void cmdSdBench(const char *arg) {
+  if (sdcardBusy()) {
+    return;
+  }
+  char buff[TERM_SCREEN_SIZE_X];
+  term_printString("Measuring the SD card speed...\n");
+  sdcal_bench_t bench;
+  sdcal_status_t status = sdcal_bench(SDCAL_SCRATCH_FILE, &bench);
+  snprintf(buff, sizeof(buff), "SPI clock:        %u Kbit/s\n",
+           (unsigned int)bench.baudRateKb);
+  term_printString(buff);
+  if (status != SDCAL_OK) {
+    snprintf(buff, sizeof(buff), "Benchmark failed: %d\n", status);
+    term_printString(buff);
+    return;
+  }
+  printThroughput("Sequential write: ", bench.seqWriteKbs);
+  printThroughput("Sequential read:  ", bench.seqReadKbs);
+  printThroughput("Random 4KB write: ", bench.randWriteKbs);
+  printThroughput("Random 4KB read:  ", bench.randReadKbs);
+}
+
+void cmdSdCalibrate(const char *arg) {
+  if (sdcardBusy()) {
+    return;
+  }
+  char buff[TERM_SCREEN_SIZE_X];
+  uint32_t previousKb = sdcal_getSpiSpeed();
+  term_printString("Calibrating the SD card clock...\n");
+  char record[SETTINGS_MAX_VALUE_LENGTH] = {0};
+  sdcal_status_t status = sdcal_calibrate(
+      filesystem, SDCAL_SCRATCH_FILE, record, sizeof(record));
+  if (status != SDCAL_OK) {
+    snprintf(buff, sizeof(buff), "Calibration failed: %d\n", status);
+    term_printString(buff);
+    return;
+  }
+  snprintf(buff, sizeof(buff), "SPI clock: %u Kbit/s (was %u)\n",
+           (unsigned int)sdcal_getSpiSpeed(), (unsigned int)previousKb);
+  term_printString(buff);
+  // Only for this card. Another card uses the clock of the settings.
+  settings_put_string(aconfig_getContext(), ACONFIG_PARAM_SD_CALIBRATION,
+                      record);
+  saveSettings();
+  term_printString("Saved. Run 'sdbench' to measure it.\n");
+}
+
+// Count, average and maximum of a timer
+static void printTimer(const char *label, perf_timer_id_t id,
+                       const char *unit) {
+  char buff[TERM_SCREEN_SIZE_X];
+  const perf_timer_t *timer = perf_getTimer(id);
+  uint32_t average =
+      (timer->count > 0) ? (uint32_t)(timer->total / timer->count) : 0;
+  snprintf(buff, sizeof(buff), "%s%u avg %u max %u %s\n", label,
+           (unsigned int)timer->count, (unsigned int)average,
+           (unsigned int)timer->max, unit);
+  term_printString(buff);
+}
+
+// Bytes transferred and throughput of a timer
+static void printTransfer(const char *label, perf_timer_id_t id) {
+  char buff[TERM_SCREEN_SIZE_X];
+  const perf_timer_t *timer = perf_getTimer(id);
+  uint32_t kbPerSec =
+      (timer->total > 0)
+          ? (uint32_t)(timer->bytes * 1000000 / 1024 / timer->total)
+          : 0;
+  snprintf(buff, sizeof(buff), "%s%u KB, ", label,
+           (unsigned int)(timer->bytes / 1024));
+  printThroughput(buff, kbPerSec);
+}
+
+void cmdStats(const char *arg) {
+  if (strcasecmp(arg, "reset") == 0) {
+    perf_reset();
+    term_printString("Counters cleared.\n");
+    return;
+  }
+  char buff[TERM_SCREEN_SIZE_X];
+  printTimer("IRQ:      ", PERF_TIMER_IRQ, "cyc");
+  snprintf(buff, sizeof(buff), "Commands: %u, %u dropped, %u bad\n",
+           (unsigned int)perf_getCount(PERF_EVENT_COMMANDS),
+           (unsigned int)perf_getCount(PERF_EVENT_DROPPED),
+           (unsigned int)perf_getCount(PERF_EVENT_CHECKSUM));
+  term_printString(buff);
+  printTimer("Display:  ", PERF_TIMER_DISPLAY, "us");
+  printTimer("Erase:    ", PERF_TIMER_FLASH_ERASE, "us");
+  printTimer("Program:  ", PERF_TIMER_FLASH_PROGRAM, "us");
+  printTransfer("SD read:  ", PERF_TIMER_SD_READ);
+  printTransfer("SD write: ", PERF_TIMER_SD_WRITE);
+  snprintf(buff, sizeof(buff), "Download: %u files\n",
+           (unsigned int)perf_getTimer(PERF_TIMER_DOWNLOAD)->count);
+  term_printString(buff);
+  printTransfer("Received: ", PERF_TIMER_DOWNLOAD);
+  // Peak use of the memory since the boot. Not cleared by 'stats reset'.
+  for (int i = 0; i < ARENA_COUNT; i++) {
+    const arena_t *arena = arena_get((arena_id_t)i);
+    snprintf(buff, sizeof(buff), "Mem %-7s %5u/%5u peak %u fail\n",
+             arena->name, (unsigned int)arena->highWater,
+             (unsigned int)arena->size, (unsigned int)arena->failures);
+    term_printString(buff);
+  }
+  // Deepest use of the stacks since painted, of what they can reach
+  for (uint core = 0; core < NUM_CORES; core++) {
+    memwatch_stack_t stack;
+    memwatch_getStack(core, &stack);
+    if (!stack.painted) {
+      continue;
+    }
+    snprintf(buff, sizeof(buff), "Stack c%u %5u/%5u, %u reserved\n", core,
+             (unsigned int)(stack.top - stack.deepest),
+             (unsigned int)(stack.top - stack.low),
+             (unsigned int)(stack.top - stack.reserved));
+    term_printString(buff);
+  }
+  memwatch_heap_t heap;
+  memwatch_getHeap(&heap);
+  snprintf(buff, sizeof(buff), "Heap %u used, %u peak of %u\n",
+           (unsigned int)heap.inUse, (unsigned int)heap.peak,
+           (unsigned int)heap.size);
+  term_printString(buff);
+}
+
+// Result of the validation of a profile
+static void printBench(const char *label, const profile_bench_t *bench) {
+  char buff[TERM_SCREEN_SIZE_X];
+  snprintf(buff, sizeof(buff), "%s%s, clock %u kHz\n", label,
+           bench->passed ? "ok" : "FAILED",
+           (unsigned int)bench->measuredKhz);
+  term_printString(buff);
+  snprintf(buff, sizeof(buff), "  Bus %u ns to sample, %u ns to release\n",
+           (unsigned int)bench->addressNs, (unsigned int)bench->releaseNs);
+  term_printString(buff);
+  snprintf(buff, sizeof(buff), "  RAM %u KB/s, flash %u KB/s\n",
+           (unsigned int)bench->ramKbs, (unsigned int)bench->flashKbs);
+  term_printString(buff);
+  if (bench->errors > 0) {
+    snprintf(buff, sizeof(buff), "  %u words wrong\n",
+             (unsigned int)bench->errors);
+    term_printString(buff);
+  }
+}
+
+void cmdProfile(const char *arg) {
+  char buff[TERM_SCREEN_SIZE_X];
+  if (strcasecmp(arg, "bench") == 0) {
+    profile_bench_t bench;
+    profile_bench(&bench);
+    printBench("Bench:    ", &bench);
+    return;
+  }
+  if (arg[0] != '\0') {
+    if ((strcasecmp(arg, PROFILE_AUTO) != 0) && (profile_find(arg) == NULL)) {
+      term_printString("Unknown profile.\n");
+      return;
+    }
+    settings_put_string(aconfig_getContext(), ACONFIG_PARAM_PROFILE, arg);
+    saveSettings();
+    term_printString("Saved. Restart to apply it.\n");
+    return;
+  }
+  const profile_t *profile = profile_get();
+  snprintf(buff, sizeof(buff), "Computer: %s\n",
+           profile_getMachineName(profile_getMachine()));
+  term_printString(buff);
+  snprintf(buff, sizeof(buff), "Profile:  %s%s\n", profile->name,
+           profile_isAuto() ? " (auto)" : "");
+  term_printString(buff);
+  snprintf(buff, sizeof(buff), "Clock:    %u MHz, %s\n",
+           (unsigned int)(profile->clockKhz / 1000),
+           VOLTAGE_VALUES[profile->voltage]);
+  term_printString(buff);
+  snprintf(buff, sizeof(buff), "PIO wait: %u cycles\n",
+           (unsigned int)profile->waitCycles);
+  term_printString(buff);
+  const profile_bench_t *boot = profile_getBootBench();
+  if (boot->run) {
+    printBench("Boot:     ", boot);
+  }
+  term_printString("Use: profile auto|compat|fast\n");
+}
+
+// Line of a timing variant: PIO cycles to sample the address and to release
+// the bus, and the time to sample the address with the profile running
+static void printTiming(const romemul_timing_t *timing, const char *suffix) {
+  char buff[TERM_SCREEN_SIZE_X];
+  const profile_t *profile = profile_get();
+  uint32_t cycles = romemul_getAddressCycles(timing);
+  unsigned int ns = (unsigned int)(cycles * SAMPLE_DIV_FREQ * 1000000.f /
+                                   profile->clockKhz);
+  snprintf(buff, sizeof(buff), "%-7s %2u/%-2u cycles, %3u ns%s\n",
+           timing->name, (unsigned int)cycles,
+           (unsigned int)romemul_getReleaseCycles(timing), ns, suffix);
+  term_printString(buff);
+}
+
+// Bus margin test. Runs each variant, from the safest, while the computer
+// sends commands, and counts the checksum errors of the protocol. Stops at
+// the first variant with errors or without commands. The main loop drives
+// it, so the commands keep being served meanwhile.
+static int marginVariant = -1;  // Running, or -1
+static absolute_time_t marginEnd;
+static uint32_t marginCommands = 0;
+static uint32_t marginErrors = 0;
+static const romemul_timing_t *marginRunning = NULL;
+static const romemul_timing_t *marginTightest = NULL;
+
+static void endMarginTest(void) {
+  marginVariant = -1;
+  if (marginTightest == NULL) {
+    term_printString("No variant passed.\n");
+    return;
+  }
+  char buff[TERM_SCREEN_SIZE_X];
+  snprintf(buff, sizeof(buff), "Tightest without errors: %s\n",
+           marginTightest->name);
+  term_printString(buff);
+  term_printString("Leave some margin to keep one.\n");
+}
+
+static void runMarginVariant(int variant) {
+  marginVariant = variant;
+  marginCommands = perf_getCount(PERF_EVENT_COMMANDS);
+  marginErrors = perf_getCount(PERF_EVENT_CHECKSUM);
+  if (!romemul_setTiming(romemul_getTimingVariant(variant))) {
+    endMarginTest();
+    return;
+  }
+  marginEnd = make_timeout_time_ms(ROMEMUL_MARGIN_TEST_MS);
+}
+
+static void startMarginTest(void) {
+  if (marginVariant >= 0) {
+    term_printString("The test is running.\n");
+    return;
+  }
+  // Backspace repeats without filling the command line
+  term_printString("Hold BACKSPACE down until the end.\n");
+  term_printString("If it hangs, press SELECT.\n");
+  marginRunning = romemul_getTiming();
+  marginTightest = NULL;
+  runMarginVariant(0);
+}
+
+static void pollMarginTest(void) {
+  if ((marginVariant < 0) || !time_reached(marginEnd)) {
+    return;
+  }
+  // Print with the timing running before
+  romemul_setTiming(marginRunning);
+  const romemul_timing_t *timing = romemul_getTimingVariant(marginVariant);
+  uint32_t commands = perf_getCount(PERF_EVENT_COMMANDS) - marginCommands;
+  uint32_t errors = perf_getCount(PERF_EVENT_CHECKSUM) - marginErrors;
+  char buff[TERM_SCREEN_SIZE_X];
+  snprintf(buff, sizeof(buff), "%-7s %3u commands, %u errors\n", timing->name,
+           (unsigned int)commands, (unsigned int)errors);
+  term_printString(buff);
+  if ((commands == 0) || (errors > 0)) {
+    endMarginTest();
+    return;
+  }
+  marginTightest = timing;
+  if (marginVariant + 1 >= ROMEMUL_TIMING_COUNT) {
+    endMarginTest();
+    return;
+  }
+  runMarginVariant(marginVariant + 1);
+}
+
+void cmdTiming(const char *arg) {
+  if (strcasecmp(arg, "test") == 0) {
+    startMarginTest();
+    return;
+  }
+  if (arg[0] != '\0') {
+    if (romemul_findTiming(arg) == NULL) {
+      term_printString("Unknown timing.\n");
+      return;
+    }
+    settings_put_string(aconfig_getContext(), ACONFIG_PARAM_ROM_TIMING, arg);
+    saveSettings();
+    term_printString("Saved. Restart to apply it.\n");
+    return;
+  }
+  const romemul_timing_t *running = romemul_getTiming();
+  term_printString("Address/release of the ROM reads:\n");
+  for (int i = 0; i < ROMEMUL_TIMING_COUNT; i++) {
+    const romemul_timing_t *timing = romemul_getTimingVariant(i);
+    bool same = (running != NULL) && (timing->nops == running->nops) &&
+                (timing->waitCycles == running->waitCycles);
+    printTiming(timing, same ? " <" : "");
+  }
+  if (running != NULL) {
+    char buff[TERM_SCREEN_SIZE_X];
+    snprintf(buff, sizeof(buff), "Running: %s\n", running->name);
+    term_printString(buff);
+  }
+  term_printString("Use: timing auto|<name>|test\n");
+}
+
+void cmdBusTrace(const char *arg) {
+  if ((strcasecmp(arg, "on") == 0) || (strcasecmp(arg, "off") == 0)) {
+    settings_put_bool(aconfig_getContext(), ACONFIG_PARAM_BUS_TRACE,
+                      strcasecmp(arg, "on") == 0);
+    saveSettings();
+  } else if (arg[0] != '\0') {
+    term_printString("Use: bus on|off\n");
+    return;
+  }
+  SettingsConfigEntry *busTrace =
+      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_BUS_TRACE);
+  bool enabled = (busTrace != NULL) &&
+                 ((busTrace->value[0] == 't') || (busTrace->value[0] == 'T'));
+  if (!enabled) {
+    term_printString("Bus recording is off.\n");
+  } else {
+    term_printString("Bus recording is on. In Ripper\n");
+    term_printString("mode, the accesses to the ROM are\n");
+    term_printString("saved to " BUSTRACE_FILENAME "\n");
+    term_printString("until SELECT is pressed.\n");
+  }
+  // The accesses lost while recording, once back from Ripper mode
+  bustrace_file_header_t last;
+  if (worker_isBusy() || !bustrace_readLast(&last)) {
+    return;
+  }
+  char buff[TERM_SCREEN_SIZE_X];
+  snprintf(buff, sizeof(buff), "Last recording: %u accesses\n",
+           (unsigned int)last.accesses);
+  term_printString(buff);
+  snprintf(buff, sizeof(buff), "%u KB, %u gaps with accesses lost\n",
+           (unsigned int)((last.bytes + 1023) / 1024),
+           (unsigned int)last.gaps);
+  term_printString(buff);
+}
+
+void cmdTrace(const char *arg) {
+  if (sdcardBusy()) {
+    return;
+  }
+  char buff[TERM_SCREEN_SIZE_X];
+  uint32_t saved = 0;
+  FRESULT res = trace_save(TRACE_FILENAME, &saved);
+  if (res == FR_DENIED) {
+    term_printString("Build with TRACE_MODE=1 to trace.\n");
+    return;
+  }
+  if (res != FR_OK) {
+    snprintf(buff, sizeof(buff), "Error saving the trace: %d\n", res);
+    term_printString(buff);
+    return;
+  }
+  snprintf(buff, sizeof(buff), "%u records saved to %s\n",
+           (unsigned int)saved, TRACE_FILENAME);
+  term_printString(buff);
+}
+
 void cmdUnknown(const char *arg) {
+  if ((menuState.menuLevel != TERM_ROMS_MENU_MAIN) && sdcardBusy()) {
+    return;
+  }
   switch (menuState.menuLevel) {
     case TERM_ROMS_MENU_MAIN:
       menu();
@@ -702,14 +1285,15 @@ void cmdUnknown(const char *arg) {
     case TERM_ROMS_MENU_BROWSE_SD: {
       // Convert to integer the argument
       int romNumber = atoi(arg);
-      if (romNumber > 0 && romNumber <= romsCount) {
+      const catalog_entry_t *rom = catalog_getEntry(romNumber - 1);
+      if (rom != NULL) {
         term_printString("Selected ROM: ");
-        term_printString(roms[romNumber - 1].filename);
+        term_printString(rom->filename);
         term_printString("\n");
         // Save the selected ROM to the settings
         settings_put_string(aconfig_getContext(), ACONFIG_PARAM_ROM_SELECTED,
-                            roms[romNumber - 1].filename);
-        settings_save(aconfig_getContext(), true);
+                            rom->filename);
+        saveSettings();
         menu();
       } else {
         term_printString(
@@ -720,36 +1304,40 @@ void cmdUnknown(const char *arg) {
     case TERM_ROMS_MENU_BROWSE_NETWORK: {
       // Convert to integer the argument
       int romNumber = atoi(arg);
-      if (romNumber > 0 && romNumber <= romsCount) {
+      const catalog_entry_t *rom = catalog_getEntry(romNumber - 1);
+      if (rom != NULL) {
         term_printString("\nROM number: ");
         term_printString(arg);
         term_printString("\n");
 
         // The
         term_printString("Name: ");
-        term_printString(roms[romNumber - 1].name);
+        term_printString(rom->name);
         term_printString("\n");
 
         term_printString("Filename: ");
-        term_printString(roms[romNumber - 1].filename);
+        term_printString(rom->filename);
         term_printString("\n");
 
         term_printString("Description: ");
-        term_printString(roms[romNumber - 1].description);
+        term_printString(rom->description);
         term_printString("\n");
 
         term_printString("Tags: ");
-        term_printString(roms[romNumber - 1].tags);
+        term_printString(rom->tags);
         term_printString("\n");
 
         term_printString("Size: ");
         char sizeStr[MAX_PATH_SIZE / 4];
-        snprintf(sizeStr, sizeof(sizeStr), "%d KB\n", roms[romNumber - 1].size);
+        snprintf(sizeStr, sizeof(sizeStr), "%d KB\n", rom->size);
         term_printString(sizeStr);
 
         term_printString("\nPress RETURN to load the ROM.\n");
+        term_printString("Press G to download and launch it.\n");
         term_printString("Press any other key to return to the menu.\n");
-        downloadRomSelected = romNumber - 1;
+        snprintf(downloadRomFilename, sizeof(downloadRomFilename), "%s",
+                 rom->filename);
+        snprintf(downloadRomHash, sizeof(downloadRomHash), "%s", rom->hash);
         menuState.menuLevel =
             TERM_ROMS_MENU_BROWSE_NETWORK + TERM_ROMS_MENU_SUBMENU;
 
@@ -761,31 +1349,11 @@ void cmdUnknown(const char *arg) {
     } break;
     case TERM_ROMS_MENU_BROWSE_NETWORK + TERM_ROMS_MENU_SUBMENU:
       if (arg[0] == '\0' || arg[0] == '\n') {
-        // Clean the ROM_SELECTED setting
-        settings_put_string(aconfig_getContext(), ACONFIG_PARAM_ROM_SELECTED,
-                            "");
-        settings_save(aconfig_getContext(), true);
-
-        // Create full path to download the file
-        char fullPath[MAX_PATH_SIZE];
-        snprintf(fullPath, MAX_PATH_SIZE, "%s/%s", romsFolder,
-                 roms[downloadRomSelected].filename);
-        DPRINTF("Downloading ROM: %s\n", fullPath);
-        download_url_components_t components = {};
-        char url[MAX_PATH_SIZE * 2];
-        snprintf(url, sizeof(url), "%s://%s/%s",
-                 download_getUrlComponents()->protocol,
-                 download_getUrlComponents()->host,
-                 roms[downloadRomSelected].filename);
-        DPRINTF("URL: %s\n", url);
-        download_setFilepath(url);
-        download_err_t err = download_start();
-        if (err != DOWNLOAD_OK) {
-          DPRINTF("Error starting download: %d\n", err);
-        }
-        menuState.menuLevel = TERM_ROMS_MENU_MAIN;
-        menu();
+        startRomDownload(false);
+      } else if ((arg[0] == 'g' || arg[0] == 'G') && arg[1] == '\0') {
+        startRomDownload(true);
       } else {
+        downloadRomFilename[0] = '\0';
         menuState.menuLevel = TERM_ROMS_MENU_BROWSE_NETWORK;
         navigatePages(currentRomPage);
       }
@@ -830,7 +1398,7 @@ static void preinit() {
   // Show the title
   showTitle();
   term_printString("\n\n");
-  term_printString("Configuring network... please wait...\n");
+  term_printString("Starting... please wait...\n");
   term_printString("or press SHIFT to boot to desktop.\n");
 
   display_refresh();
@@ -851,16 +1419,152 @@ void failure(const char *message) {
   display_refresh();
 }
 
-static void romDownloadUpdate() {
-  // Save the selected ROM to the settings
-  if (downloadRomSelected > 0) {
-    settings_put_string(aconfig_getContext(), ACONFIG_PARAM_ROM_SELECTED,
-                        roms[downloadRomSelected].filename);
-    settings_save(aconfig_getContext(), true);
+static void catalogDone(const dlqueue_job_t *job) {
+  if (job->status != DLQUEUE_JOB_DONE) {
+    DPRINTF("Error downloading the catalog: %d\n", job->error);
+  } else if (download_isNotModified()) {
+    DPRINTF("The catalog did not change. Nothing to convert.\n");
+  } else {
+    // The catalog was downloaded. Convert it now, so browsing it only has to
+    // seek to the page requested. Core1 converts it while the menu and the
+    // network keep running here.
+    snprintf(catalogCsvPath, sizeof(catalogCsvPath), "%s/%s", romsFolder,
+             ROMS_CSV_FILENAME);
+    catalogIndexOnly = false;
+    submitCatalog();
+  }
+}
+
+// The catalog of the server is refreshed as soon as there is network
+static void queueCatalog() {
+#if APP_DOWNLOAD_HTTPS == 1
+  SettingsConfigEntry *catalog = settings_find_entry(
+      aconfig_get_context(), ACONFIG_PARAM_ROM_HTTPS_CATALOG);
+#else
+  SettingsConfigEntry *catalog =
+      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_ROM_HTTP_CATALOG);
+#endif
+  if (catalog == NULL) {
+    DPRINTF("No catalog URL found in the settings. No initializing.\n");
+    return;
+  }
+  DPRINTF("Catalog URL: %s\n", catalog->value);
+  dlqueue_add(catalog->value, DOWNLOAD_TARGET_SDCARD, 0, NULL, catalogDone);
+}
+
+// Remember the access point and the lease for a faster connection on the
+// next boot. The flash is only written when they changed.
+static void saveNetworkCache() {
+  char cache[SETTINGS_MAX_VALUE_LENGTH] = {0};
+  if (!network_getStaCache(cache, sizeof(cache))) {
+    return;
+  }
+  SettingsConfigEntry *stored =
+      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_WIFI_CACHE);
+  if ((stored != NULL) && (strcmp(stored->value, cache) == 0)) {
+    return;
+  }
+  DPRINTF("Saving the WiFi cache: %s\n", cache);
+  settings_put_string(aconfig_getContext(), ACONFIG_PARAM_WIFI_CACHE, cache);
+  saveSettings();
+}
+
+// The setup program reports the computer when it starts. The profile of the
+// next boot is chosen for it.
+static void pollMachine() {
+  int32_t machine;
+  if (!profile_takeReportedMachine(&machine)) {
+    return;
+  }
+  SettingsConfigEntry *entry =
+      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_MACHINE);
+  if ((entry != NULL) && (strtol(entry->value, NULL, 0) == machine)) {
+    return;
+  }
+  DPRINTF("Computer reported: %s (0x%08X)\n",
+          profile_getMachineName(machine), (unsigned int)machine);
+  settings_put_integer(aconfig_getContext(), ACONFIG_PARAM_MACHINE, machine);
+  saveSettings();
+}
+
+// Drive the connection to the WiFi network and show its progress in the main
+// menu
+static void pollNetwork() {
+  network_sta_state_t state = network_wifiStaPoll();
+  bool changed = (state != networkState) ||
+                 ((state == NETWORK_STA_JOINING) &&
+                  (strcmp(networkStatus, network_wifiConnStatusStr()) != 0));
+  if (!changed) {
+    return;
+  }
+  if ((state == NETWORK_STA_CONNECTED) &&
+      (networkState != NETWORK_STA_CONNECTED)) {
+    queueCatalog();
+    saveNetworkCache();
+  }
+  networkState = state;
+  snprintf(networkStatus, sizeof(networkStatus), "%s",
+           network_wifiConnStatusStr());
+  if (menuState.menuLevel == TERM_ROMS_MENU_MAIN) {
     menu();
   }
 }
 
+// The ROM emulation runs in the PIO and the DMA. This core sleeps until an
+// interrupt: a SELECT edge, or the network when the ROM push is enabled.
+static void waitSelectPress(bool romPush) {
+  select_event_t event;
+  while (!select_getEvent(&event) || (event.type != SELECT_EVENT_PRESS)) {
+    select_sleep();
+    if (romPush) {
+      network_wifiStaPoll();
+      if (rompush_poll()) {
+        DPRINTF("New ROM image loaded: %u bytes in %u us\n",
+                (unsigned int)rompush_getStats()->bytes,
+                (unsigned int)rompush_getStats()->receiveUs);
+      }
+    }
+  }
+}
+
+// In Ripper mode, record the accesses of the computer to the ROM if enabled
+// in the settings. Before init_romemul(), that chains the capture.
+static bool startBusTrace() {
+  SettingsConfigEntry *busTrace =
+      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_BUS_TRACE);
+  if ((busTrace == NULL) ||
+      ((busTrace->value[0] != 't') && (busTrace->value[0] != 'T'))) {
+    return false;
+  }
+  return bustrace_init();
+}
+
+// While emulating a ROM, connect to the WiFi network and accept new builds
+// of the ROM pushed from a computer. Only if enabled in the settings.
+static bool startRomPush() {
+  SettingsConfigEntry *romPush =
+      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_ROM_PUSH);
+  if ((romPush == NULL) ||
+      ((romPush->value[0] != 't') && (romPush->value[0] != 'T'))) {
+    return false;
+  }
+  int err = network_wifiInit(WIFI_MODE_STA);
+  if (err != 0) {
+    DPRINTF("Error initializing the network: %i. No ROM push.\n", err);
+    return false;
+  }
+  SettingsConfigEntry *cache =
+      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_WIFI_CACHE);
+  network_setStaCache((cache != NULL) ? cache->value : NULL);
+  err = network_wifiStaConnectAsync(NETWORK_CONNECT_ATTEMPTS);
+  if (err != NETWORK_WIFI_STA_CONN_OK) {
+    DPRINTF("Error connecting to the WiFi network: %i\n", err);
+    return false;
+  }
+  return rompush_start(ROMPUSH_PORT, (uint32_t)&_rom_temp_start) ==
+         ROMPUSH_OK;
+}
+
 static void init(const char *folder) {
   // Store the ROMs folder, if not NULL or empty
   if (folder != NULL && strlen(folder) > 0) {
@@ -950,10 +1654,7 @@ void __not_in_flash_func(emul_start)() {
     select_setLongResetCallback(reset_deviceAndEraseFlash);
     if (appModeValue == ROM_MODE_DELAY) {
       // Wait until SELECT is pressed
-      while (!select_detectPush()) {
-        // Run the ROM emulation state machine
-        sleep_ms(SLEEP_LOOP_MS);
-      }
+      waitSelectPress(false);
       // Select button pressed. Wait until it is released
       select_waitPush();
     }
@@ -963,17 +1664,26 @@ void __not_in_flash_func(emul_start)() {
     DPRINTF("Copy the ROM firmware to RAM: 0x%X, length: %u bytes\n",
             flashAddress, ROM_SIZE_BYTES * ROM_BANKS);
     COPY_FIRMWARE_TO_RAM((uint16_t *)flashAddress, ROM_SIZE_BYTES * ROM_BANKS);
+    bool busTrace = (appModeValue == ROM_MODE_DELAY) && startBusTrace();
     init_romemul(NULL, NULL, false);
+    if (busTrace) {
+      bustrace_start();
+    }
 
 #ifdef BLINK_H
     blink_on();
 #endif
 
+    bool romPush = startRomPush();
+
     DPRINTF("ROM emulation mode started. Waiting for SELECT button\n");
     // Wait until SELECT is pressed
-    while (!select_detectPush()) {
-      // Run the ROM emulation state machine
-      sleep_ms(SLEEP_LOOP_MS);
+    waitSelectPress(romPush);
+    if (romPush) {
+      rompush_stop();
+    }
+    if (busTrace) {
+      bustrace_stop();
     }
     DPRINTF("SELECT button pressed. Waiting for release\n");
     // Select button pressed. Wait until it is released
@@ -986,7 +1696,7 @@ void __not_in_flash_func(emul_start)() {
     // Set the ROM emulation mode to 255 (setup menu)
     settings_put_integer(aconfig_getContext(), ACONFIG_PARAM_ROM_MODE,
                          ROM_MODE_SETUP);
-    settings_save(aconfig_getContext(), true);
+    saveSettings();
 
 #ifdef BLINK_H
     blink_off();
@@ -1004,6 +1714,9 @@ void __not_in_flash_func(emul_start)() {
   // place.
   // The code is stored as an array in the target_firmware.h file
   //
+  // Count the interrupts, the commands and the I/O from here. See 'stats'.
+  perf_init();
+
   // Copy the terminal firmware to RAM
   COPY_FIRMWARE_TO_RAM((uint16_t *)target_firmware, target_firmware_length * 2);
   init_romemul(NULL, term_dma_irq_handler_lookup, false);
@@ -1024,6 +1737,10 @@ void __not_in_flash_func(emul_start)() {
   select_coreWaitPush(reset_device,
                       reset_deviceAndEraseFlash);  // Wait for the SELECT
                                                    // button to be pushed
+
+  // Core1 runs the long jobs, like converting the catalog, so this core
+  // keeps serving the computer and the network
+  worker_start();
   // 6. Init the sd card
   // Most of the apps or microfirmwares will need to read and write files
   // to the SD card. The SD card is used to store the ROM files, configuration
@@ -1054,12 +1771,17 @@ void __not_in_flash_func(emul_start)() {
     while (1) {
       // Wait forever
       term_loop();
+      select_poll();
 #ifdef BLINK_H
       blink_toogle();
 #endif
     }
   } else {
     DPRINTF("SD card found & initialized\n");
+    filesystem = &fsys;
+    SettingsConfigEntry *calibration = settings_find_entry(
+        aconfig_getContext(), ACONFIG_PARAM_SD_CALIBRATION);
+    sdcal_applyCalibration((calibration != NULL) ? calibration->value : NULL);
     AutorunResult autorunResult = autorunIfRequested();
     if (autorunResult != AUTORUN_OK) {
       DPRINTF("Autorun error: %i. Continue.\n", autorunResult);
@@ -1073,7 +1795,8 @@ void __not_in_flash_func(emul_start)() {
   preinit();
 
   // 7. Init the network, if needed
-  // It's always a good idea to wait for the network to be ready
+  // The connection is made in the background, polled from the main loop, so
+  // the menu and the microSD card are available from the first frame.
   // Get the WiFi mode from the settings
   SettingsConfigEntry *wifiMode =
       settings_find_entry(gconfig_getContext(), PARAM_WIFI_MODE);
@@ -1089,60 +1812,24 @@ void __not_in_flash_func(emul_start)() {
       if (err != 0) {
         DPRINTF("Error initializing the network: %i. No initializing.\n", err);
       } else {
-        // Set the term_loop as a callback during the polling period
-        network_setPollingCallback(term_loop);
-        // Connect to the WiFi network
-        int maxAttempts = 3;  // or any other number defined elsewhere
-        int attempt = 0;
-        err = NETWORK_WIFI_STA_CONN_ERR_TIMEOUT;
-
-        while ((attempt < maxAttempts) &&
-               (err == NETWORK_WIFI_STA_CONN_ERR_TIMEOUT)) {
-          err = network_wifiStaConnect();
-          attempt++;
-
-          if ((err > 0) && (err < NETWORK_WIFI_STA_CONN_ERR_TIMEOUT)) {
-            DPRINTF("Error connecting to the WiFi network: %i\n", err);
-          }
-        }
-
-        if (err == NETWORK_WIFI_STA_CONN_ERR_TIMEOUT) {
-          DPRINTF("Timeout connecting to the WiFi network after %d attempts\n",
-                  maxAttempts);
-          // Optionally, return an error code here.
+        SettingsConfigEntry *cache =
+            settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_WIFI_CACHE);
+        network_setStaCache((cache != NULL) ? cache->value : NULL);
+        err = network_wifiStaConnectAsync(NETWORK_CONNECT_ATTEMPTS);
+        if (err != NETWORK_WIFI_STA_CONN_OK) {
+          DPRINTF("Error connecting to the WiFi network: %i\n", err);
         }
-        network_setPollingCallback(NULL);
       }
     } else {
       DPRINTF("WiFi mode is AP. No initializing.\n");
     }
   }
+  networkState = network_wifiStaGetState();
 
   // 8. Download the list of available ROMs from the network
-  // Since the list of availanble ROMs is stored in a remote server and does
-  // not change frequently, it is a good idea to download the list of ROMs at
-  // the beginning of the app. This way, the user can browse the list of ROMs
-  // available in the server and download the ROMs to the SD card.
-  // The list of ROMs is stored in a CSV file in the server. The CSV file
-  // contains the URL of the ROM file, the name of the ROM, the description,
-  // the tags, and the size of the ROM file.
-
-  char *catalogUrl = NULL;
-#if APP_DOWNLOAD_HTTPS == 1
-  SettingsConfigEntry *catalog = settings_find_entry(
-      aconfig_get_context(), ACONFIG_PARAM_ROM_HTTPS_CATALOG);
-#else
-  SettingsConfigEntry *catalog =
-      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_ROM_HTTP_CATALOG);
-#endif
-  if (catalog == NULL) {
-    DPRINTF("No catalog URL found in the settings. No initializing.\n");
-  } else {
-    catalogUrl = catalog->value;
-    DPRINTF("Catalog URL: %s\n", catalogUrl);
-    download_setFilepath(catalogUrl);
-    download_start();
-  }
+  // The list of ROMs is stored in a CSV file in the server, and does not
+  // change frequently. It is queued for download as soon as the network is
+  // connected (see pollNetwork()), and only transferred again if it changed.
 
   // 9. Now complete the terminal emulator initialization
   // The terminal emulator is used to interact with the user to configure the
@@ -1155,15 +1842,10 @@ void __not_in_flash_func(emul_start)() {
   // The main loop runs until the user decides to launch a ROM or exit the
   // app.
   DPRINTF("Start the app loop here\n");
-  roms = malloc(MAX_ROMS * sizeof(ROM));
-  if (roms == NULL) {
-    DPRINTF("Error allocating memory for ROMs\n");
-  }
   absolute_time_t wifiScanTime = make_timeout_time_ms(
       WIFI_SCAN_TIME_MS);  // 3 seconds minimum for network scanning
+  absolute_time_t perfMirrorTime = make_timeout_time_ms(PERF_MIRROR_MS);
 
-  absolute_time_t startDownloadTime =
-      make_timeout_time_ms(DOWNLOAD_DAY_MS);  // Future time
   while (getKeepActive()) {
 #if PICO_CYW43_ARCH_POLL
     network_safe_poll();
@@ -1174,42 +1856,47 @@ void __not_in_flash_func(emul_start)() {
     // Check remote commands
     term_loop();
 
-    // Check the download status
-    switch (download_getStatus()) {
-      case DOWNLOAD_STATUS_REQUESTED: {
-        startDownloadTime = make_timeout_time_ms(
-            DOWNLOAD_START_MS);  // 3 seconds to start the download
-        download_setStatus(DOWNLOAD_STATUS_NOT_STARTED);
-        break;
-      }
-      case DOWNLOAD_STATUS_NOT_STARTED: {
-        if ((absolute_time_diff_us(get_absolute_time(), startDownloadTime) <
-             0)) {
-          download_err_t err = download_start();
-          if (err != DOWNLOAD_OK) {
-            DPRINTF("Error downloading app. Drive to error page.\n");
-          }
-        }
-        break;
-      }
-      case DOWNLOAD_STATUS_IN_PROGRESS: {
-        download_poll();
-        break;
-      }
-      case DOWNLOAD_STATUS_COMPLETED: {
-        // Save the app info to the SD card
-        download_finish();
-        download_confirm();
-        download_setStatus(DOWNLOAD_STATUS_IDLE);
-        romDownloadUpdate();
-        break;
-      }
+    // Connect to the WiFi network, and get the catalog when connected
+    pollNetwork();
+
+    // The computer of the profile of the next boot
+    pollMachine();
+
+    // The next variant of the bus margin test, if running
+    pollMarginTest();
+
+    // Run the downloads queued. They wait for the catalog conversion to
+    // end, as it uses the microSD card.
+    worker_poll();
+    if (catalogPending) {
+      submitCatalog();
+    }
+    if (!worker_isBusy()) {
+      dlqueue_poll();
+    }
+
+    // Short press: reset the device. Long press: erase the flash.
+    select_poll();
+
+    // The trace, to the debug output
+    trace_drain();
+
+    // The performance counters, for the computer
+    if (time_reached(perfMirrorTime)) {
+      perf_mirror((unsigned int)&__rom_in_ram_start__ +
+                  TERM_SHARED_VARIABLES_OFFSET + TERM_PERF_COUNTERS * 4);
+      perfMirrorTime = make_timeout_time_ms(PERF_MIRROR_MS);
+      // And warn of a stack close to overflow
+      memwatch_poll();
     }
   }
-  if (roms != NULL) {
-    free(roms);
-    roms = NULL;
+  if (marginVariant >= 0) {
+    romemul_setTiming(marginRunning);  // Left in the middle of the test
+    marginVariant = -1;
   }
+  worker_stop();
+  httpconn_close();
+  catalog_close();
   // 11. Send RESET computer command
   // Exiting the loop means we are done with the setup/configuration mode and
   // we are ready to start the ROM emulation or the booster app.
@@ -1229,7 +1916,7 @@ void __not_in_flash_func(emul_start)() {
     // Set the ROM emulation mode to 255 (setup menu)
     settings_put_integer(aconfig_getContext(), ACONFIG_PARAM_ROM_MODE,
                          ROM_MODE_SETUP);
-    settings_save(aconfig_getContext(), true);
+    saveSettings();
 
     sleep_ms(SLEEP_LOOP_MS);
 
@@ -0,0 +1,156 @@
+/**
+ * File: extsort.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: External merge sort of records on the SD card
+ */
+
+#include "extsort.h"
+
+static bool readRecord(FIL *file, void *record, size_t recordSize) {
+  UINT bytes;
+  FRESULT res = f_read(file, record, recordSize, &bytes);
+  return (res == FR_OK) && (bytes == recordSize);
+}
+
+static bool writeRecords(FIL *file, const void *records, size_t size) {
+  UINT bytes;
+  FRESULT res = f_write(file, records, size, &bytes);
+  return (res == FR_OK) && (bytes == size);
+}
+
+// First step: pull the records from the producer and write them in sorted
+// runs of the size of the chunk.
+static extsort_status_t writeSortedRuns(const char *runsPath,
+                                        size_t recordSize,
+                                        extsort_next_t next, void *context,
+                                        extsort_compare_t compare,
+                                        int runLength, int *count) {
+  uint8_t *chunk = (uint8_t *)arena_alloc(ARENA_SORT, runLength * recordSize);
+  if (chunk == NULL) {
+    DPRINTF("Error allocating memory for the sort\n");
+    return EXTSORT_MEMORY_ERROR;
+  }
+  FIL runsFile;
+  FRESULT res = f_open(&runsFile, runsPath, FA_CREATE_ALWAYS | FA_WRITE);
+  if (res != FR_OK) {
+    DPRINTF("Error creating sort file %s: %d\n", runsPath, res);
+    arena_free(ARENA_SORT, chunk);
+    return EXTSORT_WRITE_ERROR;
+  }
+
+  extsort_status_t status = EXTSORT_OK;
+  *count = 0;
+  int chunkCount = 0;
+  bool more = true;
+  while (more) {
+    more = next(&chunk[chunkCount * recordSize], context);
+    if (more) {
+      chunkCount++;
+      (*count)++;
+    }
+    if ((chunkCount == runLength) || (!more && chunkCount > 0)) {
+      qsort(chunk, chunkCount, recordSize, compare);
+      if (!writeRecords(&runsFile, chunk, chunkCount * recordSize)) {
+        status = EXTSORT_WRITE_ERROR;
+        break;
+      }
+      chunkCount = 0;
+    }
+  }
+  if ((f_close(&runsFile) != FR_OK) && (status == EXTSORT_OK)) {
+    status = EXTSORT_WRITE_ERROR;
+  }
+  arena_free(ARENA_SORT, chunk);
+  return status;
+}
+
+// One pass: merge each pair of consecutive sorted runs of the source file
+// into a sorted run twice as long in the destination file.
+static extsort_status_t mergeRuns(const char *srcPath, const char *dstPath,
+                                  size_t recordSize, extsort_compare_t compare,
+                                  int count, int runLength) {
+  FIL first;
+  FIL second;
+  FIL dst;
+  if (f_open(&first, srcPath, FA_READ) != FR_OK) {
+    return EXTSORT_OPEN_ERROR;
+  }
+  if (f_open(&second, srcPath, FA_READ) != FR_OK) {
+    f_close(&first);
+    return EXTSORT_OPEN_ERROR;
+  }
+  if (f_open(&dst, dstPath, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+    f_close(&first);
+    f_close(&second);
+    return EXTSORT_WRITE_ERROR;
+  }
+
+  extsort_status_t status = EXTSORT_OK;
+  uint8_t recordA[EXTSORT_MAX_RECORD_SIZE];
+  uint8_t recordB[EXTSORT_MAX_RECORD_SIZE];
+  for (int start = 0; (status == EXTSORT_OK) && (start < count);
+       start += 2 * runLength) {
+    int idxA = start;
+    int endA = (start + runLength < count) ? start + runLength : count;
+    int idxB = endA;
+    int endB = (endA + runLength < count) ? endA + runLength : count;
+    if ((f_lseek(&first, (FSIZE_t)idxA * recordSize) != FR_OK) ||
+        (f_lseek(&second, (FSIZE_t)idxB * recordSize) != FR_OK)) {
+      status = EXTSORT_READ_ERROR;
+      break;
+    }
+    bool hasA = (idxA < endA) && readRecord(&first, recordA, recordSize);
+    bool hasB = (idxB < endB) && readRecord(&second, recordB, recordSize);
+    while (hasA || hasB) {
+      worker_yield();  // Sorted in core1
+      bool takeA = hasA && (!hasB || (compare(recordA, recordB) <= 0));
+      if (!writeRecords(&dst, takeA ? recordA : recordB, recordSize)) {
+        status = EXTSORT_WRITE_ERROR;
+        break;
+      }
+      if (takeA) {
+        hasA = (++idxA < endA) && readRecord(&first, recordA, recordSize);
+      } else {
+        hasB = (++idxB < endB) && readRecord(&second, recordB, recordSize);
+      }
+    }
+    if ((status == EXTSORT_OK) && ((idxA < endA) || (idxB < endB))) {
+      status = EXTSORT_READ_ERROR;
+    }
+  }
+  f_close(&first);
+  f_close(&second);
+  if ((f_close(&dst) != FR_OK) && (status == EXTSORT_OK)) {
+    status = EXTSORT_WRITE_ERROR;
+  }
+  return status;
+}
+
+extsort_status_t extsort_sort(const char *pathA, const char *pathB,
+                              size_t recordSize, extsort_next_t next,
+                              void *context, extsort_compare_t compare,
+                              int *count, const char **sortedPath) {
+  *count = 0;
+  *sortedPath = pathA;
+  if ((recordSize == 0) || (recordSize > EXTSORT_MAX_RECORD_SIZE)) {
+    return EXTSORT_MEMORY_ERROR;
+  }
+  int runLength = EXTSORT_CHUNK_SIZE / recordSize;
+  extsort_status_t status = writeSortedRuns(pathA, recordSize, next, context,
+                                            compare, runLength, count);
+
+  // Bottom-up merge of the runs, alternating between both files
+  const char *srcPath = pathA;
+  const char *dstPath = pathB;
+  for (; (status == EXTSORT_OK) && (runLength < *count); runLength *= 2) {
+    status = mergeRuns(srcPath, dstPath, recordSize, compare, *count,
+                       runLength);
+    const char *swapPath = srcPath;
+    srcPath = dstPath;
+    dstPath = swapPath;
+  }
+  *sortedPath = srcPath;
+  return status;
+}
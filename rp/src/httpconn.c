@@ -0,0 +1,334 @@
+/**
+ * File: httpconn.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Persistent HTTP/1.1 connection to a server. The lwIP HTTP
+ * client closes the connection after each response, so this one talks to the
+ * TCP (or TLS) layer directly to keep it alive between requests.
+ */
+
+#include "httpconn.h"
+
+static struct altcp_pcb *pcb = NULL;
+static volatile httpconn_state_t state = HTTPCONN_STATE_CLOSED;
+static char connHost[HTTPCONN_HOSTNAME_SIZE] = {0};
+static uint16_t connPort = 0;
+static ip_addr_t serverAddr;
+static int polls = 0;  // Polls without any data received
+
+// Request in progress
+static char requestText[HTTPCONN_REQUEST_SIZE];
+static size_t requestLength = 0;
+static httpresp_t resp;
+static httpconn_done_t doneFn = NULL;
+static void *doneContext = NULL;
+static bool reusedConnection = false;
+
+static httpconn_stats_t stats;
+
+#if APP_DOWNLOAD_HTTPS == 1
+static struct altcp_tls_config *tlsConfig = NULL;
+#endif
+
+static err_t recvFn(void *arg, struct altcp_pcb *conn, struct pbuf *p,
+                    err_t err);
+static void errFn(void *arg, err_t err);
+static err_t pollFn(void *arg, struct altcp_pcb *conn);
+
+// Close the connection. Returns ERR_ABRT if it had to be aborted, which must
+// be returned to lwIP when called from one of its callbacks.
+static err_t closePcb(void) {
+  err_t err = ERR_OK;
+  if (pcb != NULL) {
+    altcp_arg(pcb, NULL);
+    altcp_recv(pcb, NULL);
+    altcp_err(pcb, NULL);
+    altcp_poll(pcb, NULL, 0);
+    if (altcp_close(pcb) != ERR_OK) {
+      altcp_abort(pcb);
+      err = ERR_ABRT;
+    }
+    pcb = NULL;
+  }
+  state = HTTPCONN_STATE_CLOSED;
+  return err;
+}
+
+// Report the end of the request. The state must be final before, so the done
+// function can make the next request.
+static void complete(httpconn_result_t result) {
+  httpconn_done_t fn = doneFn;
+  doneFn = NULL;
+  DPRINTF("Request complete: %d. HTTP status %d, %u bytes\n", result,
+          resp.status, (unsigned int)resp.received);
+  if (fn != NULL) {
+    fn(result, doneContext);
+  }
+}
+
+static err_t fail(httpconn_result_t result) {
+  err_t err = closePcb();
+  complete(result);
+  return err;
+}
+
+static httpconn_result_t sendRequest(void) {
+  state = HTTPCONN_STATE_WAITING;
+  polls = 0;
+  err_t err = altcp_write(pcb, requestText, (u16_t)requestLength,
+                          TCP_WRITE_FLAG_COPY);
+  if (err == ERR_OK) {
+    err = altcp_output(pcb);
+  }
+  if (err != ERR_OK) {
+    DPRINTF("Error sending the request: %d\n", err);
+    return HTTPCONN_SEND_ERROR;
+  }
+  return HTTPCONN_OK;
+}
+
+static err_t connectedFn(__unused void *arg, __unused struct altcp_pcb *conn,
+                         err_t err) {
+  if (err != ERR_OK) {
+    return fail(HTTPCONN_CONNECT_ERROR);
+  }
+  DPRINTF("Connected to %s:%u\n", connHost, (unsigned int)connPort);
+  if (sendRequest() != HTTPCONN_OK) {
+    return fail(HTTPCONN_SEND_ERROR);
+  }
+  return ERR_OK;
+}
+
+static httpconn_result_t openConnection(void) {
+#if APP_DOWNLOAD_HTTPS == 1
+  if (tlsConfig == NULL) {
+    tlsConfig = altcp_tls_create_config_client(NULL, 0);
+  }
+  pcb = altcp_tls_new(tlsConfig, IP_GET_TYPE(&serverAddr));
+  if (pcb != NULL) {
+    mbedtls_ssl_set_hostname(altcp_tls_context(pcb), connHost);
+  }
+#else
+  pcb = altcp_new_ip_type(NULL, IP_GET_TYPE(&serverAddr));
+#endif
+  if (pcb == NULL) {
+    DPRINTF("Error allocating the connection\n");
+    state = HTTPCONN_STATE_CLOSED;
+    return HTTPCONN_CONNECT_ERROR;
+  }
+  altcp_arg(pcb, NULL);
+  altcp_recv(pcb, recvFn);
+  altcp_err(pcb, errFn);
+  altcp_poll(pcb, pollFn, HTTPCONN_POLL_INTERVAL);
+  state = HTTPCONN_STATE_CONNECTING;
+  polls = 0;
+  stats.connections++;
+  err_t err = altcp_connect(pcb, &serverAddr, connPort, connectedFn);
+  if (err != ERR_OK) {
+    DPRINTF("Error connecting: %d\n", err);
+    closePcb();
+    return HTTPCONN_CONNECT_ERROR;
+  }
+  return HTTPCONN_OK;
+}
+
+// The server closed a connection kept alive before answering. It is not an
+// error: send the request again on a new connection.
+static bool retryRequest(void) {
+  if (!reusedConnection || (resp.received > 0)) {
+    return false;
+  }
+  DPRINTF("Kept connection closed by the server. Reconnecting.\n");
+  reusedConnection = false;
+  httpconn_result_t result = openConnection();
+  if (result != HTTPCONN_OK) {
+    complete(result);
+  }
+  return true;
+}
+
+static void dnsFoundFn(__unused const char *name, const ip_addr_t *ipaddr,
+                       __unused void *arg) {
+  if (state != HTTPCONN_STATE_RESOLVING) {
+    return;  // Closed meanwhile
+  }
+  if (ipaddr == NULL) {
+    DPRINTF("Error resolving %s\n", connHost);
+    state = HTTPCONN_STATE_CLOSED;
+    complete(HTTPCONN_DNS_ERROR);
+    return;
+  }
+  serverAddr = *ipaddr;
+  httpconn_result_t result = openConnection();
+  if (result != HTTPCONN_OK) {
+    complete(result);
+  }
+}
+
+// The server closed the connection
+static err_t remoteClosed(void) {
+  bool waiting = (state == HTTPCONN_STATE_WAITING);
+  err_t err = closePcb();
+  if (waiting && !retryRequest()) {
+    complete((httpresp_close(&resp) == HTTPRESP_DONE)
+                 ? HTTPCONN_OK
+                 : HTTPCONN_CLOSED_ERROR);
+  }
+  return err;
+}
+
+static err_t recvFn(__unused void *arg, struct altcp_pcb *conn,
+                    struct pbuf *p, err_t err) {
+  if (p == NULL) {
+    return remoteClosed();
+  }
+  if ((err != ERR_OK) || (state != HTTPCONN_STATE_WAITING)) {
+    // Nothing is expected on an idle connection
+    pbuf_free(p);
+    return fail(HTTPCONN_PROTOCOL_ERROR);
+  }
+
+  polls = 0;
+  httpresp_status_t status = HTTPRESP_OK;
+  bool leftover = false;
+  for (struct pbuf *q = p; (q != NULL) && (status == HTTPRESP_OK);
+       q = q->next) {
+    size_t consumed;
+    status = httpresp_feed(&resp, (const uint8_t *)q->payload, q->len,
+                           &consumed);
+    leftover = (consumed < q->len) ||
+               ((status == HTTPRESP_DONE) && (q->next != NULL));
+  }
+  altcp_recved(conn, p->tot_len);
+  pbuf_free(p);
+
+  switch (status) {
+    case HTTPRESP_OK:
+      return ERR_OK;
+    case HTTPRESP_DONE:
+      if (resp.keepAlive && !leftover) {
+        state = HTTPCONN_STATE_IDLE;
+        polls = 0;
+        complete(HTTPCONN_OK);
+        return ERR_OK;
+      }
+      err = closePcb();
+      complete(HTTPCONN_OK);
+      return err;
+    case HTTPRESP_ABORTED:
+      return fail(HTTPCONN_ABORTED);
+    default:
+      return fail(HTTPCONN_PROTOCOL_ERROR);
+  }
+}
+
+// The connection is already freed by lwIP
+static void errFn(__unused void *arg, err_t err) {
+  httpconn_state_t previous = state;
+  DPRINTF("Connection error: %d\n", err);
+  pcb = NULL;
+  state = HTTPCONN_STATE_CLOSED;
+  if (previous == HTTPCONN_STATE_CONNECTING) {
+    complete(HTTPCONN_CONNECT_ERROR);
+  } else if ((previous == HTTPCONN_STATE_WAITING) && !retryRequest()) {
+    complete(HTTPCONN_CLOSED_ERROR);
+  }
+}
+
+static err_t pollFn(__unused void *arg, __unused struct altcp_pcb *conn) {
+  uint32_t elapsedMs = (uint32_t)(++polls) * HTTPCONN_POLL_MS;
+  if ((state == HTTPCONN_STATE_IDLE) &&
+      (elapsedMs >= HTTPCONN_IDLE_TIMEOUT_MS)) {
+    DPRINTF("Closing idle connection to %s\n", connHost);
+    return closePcb();
+  }
+  if (((state == HTTPCONN_STATE_CONNECTING) ||
+       (state == HTTPCONN_STATE_WAITING)) &&
+      (elapsedMs >= HTTPCONN_RESPONSE_TIMEOUT_MS)) {
+    DPRINTF("Timeout waiting for %s\n", connHost);
+    return fail(HTTPCONN_TIMEOUT_ERROR);
+  }
+  return ERR_OK;
+}
+
+httpconn_result_t httpconn_get(const char *host, uint16_t port,
+                               const char *uri, const char *headers,
+                               const httpresp_callbacks_t *callbacks,
+                               httpconn_done_t done, void *context) {
+  if (httpconn_isBusy()) {
+    return HTTPCONN_BUSY_ERROR;
+  }
+  uint16_t defaultPort =
+      (APP_DOWNLOAD_HTTPS == 1) ? HTTPCONN_HTTPS_PORT : HTTPCONN_HTTP_PORT;
+  if (port == 0) {
+    port = defaultPort;
+  }
+
+  // The Host header only has the port if it is not the default one
+  char hostHeader[HTTPCONN_HOSTNAME_SIZE + 8];
+  if (port == defaultPort) {
+    snprintf(hostHeader, sizeof(hostHeader), "%s", host);
+  } else {
+    snprintf(hostHeader, sizeof(hostHeader), "%s:%u", host,
+             (unsigned int)port);
+  }
+  int len = snprintf(requestText, sizeof(requestText),
+                     "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: "
+                     "keep-alive\r\n%s\r\n",
+                     uri, hostHeader, (headers != NULL) ? headers : "");
+  if ((len < 0) || ((size_t)len >= sizeof(requestText))) {
+    DPRINTF("Request too long: %s\n", uri);
+    return HTTPCONN_REQUEST_ERROR;
+  }
+  requestLength = (size_t)len;
+
+  // The lwIP callbacks must not see a half prepared request
+  httpconn_result_t result = HTTPCONN_OK;
+  cyw43_arch_lwip_begin();
+  httpresp_init(&resp, callbacks);
+  doneFn = done;
+  doneContext = context;
+  stats.requests++;
+  if ((state == HTTPCONN_STATE_IDLE) && (pcb != NULL) && (connPort == port) &&
+      (strcmp(connHost, host) == 0)) {
+    DPRINTF("Reusing connection to %s\n", connHost);
+    reusedConnection = true;
+    stats.reused++;
+    result = sendRequest();
+  } else {
+    closePcb();
+    reusedConnection = false;
+    snprintf(connHost, sizeof(connHost), "%s", host);
+    connPort = port;
+    state = HTTPCONN_STATE_RESOLVING;
+    err_t err = dns_gethostbyname(connHost, &serverAddr, dnsFoundFn, NULL);
+    if (err == ERR_OK) {
+      result = openConnection();  // Address in the DNS cache
+    } else if (err != ERR_INPROGRESS) {
+      DPRINTF("Error resolving %s: %d\n", connHost, err);
+      result = HTTPCONN_DNS_ERROR;
+    }
+  }
+  if (result != HTTPCONN_OK) {
+    closePcb();
+    doneFn = NULL;
+  }
+  cyw43_arch_lwip_end();
+  return result;
+}
+
+bool httpconn_isBusy() {
+  return (state == HTTPCONN_STATE_RESOLVING) ||
+         (state == HTTPCONN_STATE_CONNECTING) ||
+         (state == HTTPCONN_STATE_WAITING);
+}
+
+void httpconn_close() {
+  cyw43_arch_lwip_begin();
+  doneFn = NULL;
+  closePcb();
+  cyw43_arch_lwip_end();
+}
+
+const httpconn_stats_t *httpconn_getStats() { return &stats; }
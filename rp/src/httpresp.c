@@ -0,0 +1,256 @@
+/**
+ * File: httpresp.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Incremental parser of HTTP/1.1 responses
+ */
+
+#include "httpresp.h"
+
+#define HTTP_STATUS_FIRST_FINAL 200  // Below are interim responses
+#define HTTP_STATUS_NO_CONTENT 204
+#define HTTP_STATUS_NOT_MODIFIED 304
+#define HTTP_STATUS_MAX 599
+#define HTTP_CHUNK_SIZE_DIGITS 8  // Chunks up to 4GB
+
+// Removes the spaces at the end of the line
+static void trimRight(char *str) {
+  size_t len = strlen(str);
+  while ((len > 0) && ((str[len - 1] == ' ') || (str[len - 1] == '\t'))) {
+    str[--len] = '\0';
+  }
+}
+
+// True if the value ends with the token given. Transfer codings are a list
+// and chunked must be the last one.
+static bool endsWithToken(const char *value, const char *token) {
+  size_t valueLen = strlen(value);
+  size_t tokenLen = strlen(token);
+  return (valueLen >= tokenLen) &&
+         (strcasecmp(&value[valueLen - tokenLen], token) == 0);
+}
+
+// "HTTP/1.1 200 OK". HTTP/1.0 connections are closed unless told otherwise.
+static bool parseStatusLine(httpresp_t *resp) {
+  if (strncmp(resp->line, "HTTP/1.", strlen("HTTP/1.")) != 0) {
+    return false;
+  }
+  resp->keepAlive = (resp->line[strlen("HTTP/1.")] != '0');
+  const char *status = strchr(resp->line, ' ');
+  resp->status = (status != NULL) ? atoi(status + 1) : 0;
+  return (resp->status >= 100) && (resp->status <= HTTP_STATUS_MAX);
+}
+
+static void parseHeader(httpresp_t *resp) {
+  char *colon = strchr(resp->line, ':');
+  if (colon == NULL) {
+    return;  // Not a header. Ignore it.
+  }
+  *colon = '\0';
+  char *name = resp->line;
+  char *value = colon + 1;
+  while ((*value == ' ') || (*value == '\t')) {
+    value++;
+  }
+  trimRight(name);
+  trimRight(value);
+
+  if (strcasecmp(name, "Content-Length") == 0) {
+    resp->hasLength = true;
+    resp->remaining = (uint32_t)strtoul(value, NULL, DEC_BASE);
+  } else if (strcasecmp(name, "Transfer-Encoding") == 0) {
+    resp->chunked = endsWithToken(value, "chunked");
+  } else if (strcasecmp(name, "Connection") == 0) {
+    if (strcasecmp(value, "close") == 0) {
+      resp->keepAlive = false;
+    } else if (strcasecmp(value, "keep-alive") == 0) {
+      resp->keepAlive = true;
+    }
+  }
+  if (resp->callbacks->header != NULL) {
+    resp->callbacks->header(name, value, resp->callbacks->context);
+  }
+}
+
+// Decide how the body is delimited once all the headers are known
+static httpresp_status_t endHeaders(httpresp_t *resp) {
+  if (resp->status < HTTP_STATUS_FIRST_FINAL) {
+    // Interim response, e.g. 100 Continue. The real one follows.
+    resp->state = HTTPRESP_STATE_STATUS;
+    resp->hasLength = false;
+    resp->chunked = false;
+    return HTTPRESP_OK;
+  }
+  if ((resp->callbacks->headersDone != NULL) &&
+      !resp->callbacks->headersDone(resp->status, resp->callbacks->context)) {
+    return HTTPRESP_ABORTED;
+  }
+  if ((resp->status == HTTP_STATUS_NO_CONTENT) ||
+      (resp->status == HTTP_STATUS_NOT_MODIFIED)) {
+    resp->state = HTTPRESP_STATE_DONE;
+  } else if (resp->chunked) {
+    resp->state = HTTPRESP_STATE_CHUNK_SIZE;
+  } else if (resp->hasLength) {
+    resp->state =
+        (resp->remaining > 0) ? HTTPRESP_STATE_BODY : HTTPRESP_STATE_DONE;
+  } else {
+    // No length: the body ends when the server closes the connection
+    resp->state = HTTPRESP_STATE_BODY_UNTIL_CLOSE;
+    resp->keepAlive = false;
+  }
+  return (resp->state == HTTPRESP_STATE_DONE) ? HTTPRESP_DONE : HTTPRESP_OK;
+}
+
+// "1f40;name=value". The extensions are ignored.
+static bool parseChunkSize(httpresp_t *resp) {
+  uint32_t size = 0;
+  int digits = 0;
+  for (const char *c = resp->line; *c != '\0'; c++) {
+    int value;
+    if ((*c >= '0') && (*c <= '9')) {
+      value = *c - '0';
+    } else if ((*c >= 'a') && (*c <= 'f')) {
+      value = *c - 'a' + 10;
+    } else if ((*c >= 'A') && (*c <= 'F')) {
+      value = *c - 'A' + 10;
+    } else {
+      break;
+    }
+    if (++digits > HTTP_CHUNK_SIZE_DIGITS) {
+      return false;
+    }
+    size = (size << 4) | (uint32_t)value;
+  }
+  if (digits == 0) {
+    return false;
+  }
+  resp->remaining = size;
+  resp->state =
+      (size > 0) ? HTTPRESP_STATE_CHUNK_DATA : HTTPRESP_STATE_TRAILER;
+  return true;
+}
+
+// A whole line was read in the current state
+static httpresp_status_t parseLine(httpresp_t *resp) {
+  switch (resp->state) {
+    case HTTPRESP_STATE_STATUS:
+      if (resp->lineLength == 0) {
+        return HTTPRESP_OK;  // Tolerate empty lines before the status
+      }
+      if (!parseStatusLine(resp)) {
+        DPRINTF("Invalid status line: %s\n", resp->line);
+        return HTTPRESP_PROTOCOL_ERROR;
+      }
+      resp->state = HTTPRESP_STATE_HEADER;
+      return HTTPRESP_OK;
+    case HTTPRESP_STATE_HEADER:
+      if (resp->lineLength == 0) {
+        return endHeaders(resp);
+      }
+      parseHeader(resp);
+      return HTTPRESP_OK;
+    case HTTPRESP_STATE_CHUNK_SIZE:
+      if (!parseChunkSize(resp)) {
+        DPRINTF("Invalid chunk size: %s\n", resp->line);
+        return HTTPRESP_PROTOCOL_ERROR;
+      }
+      return HTTPRESP_OK;
+    case HTTPRESP_STATE_CHUNK_END:
+      if (resp->lineLength != 0) {
+        return HTTPRESP_PROTOCOL_ERROR;
+      }
+      resp->state = HTTPRESP_STATE_CHUNK_SIZE;
+      return HTTPRESP_OK;
+    case HTTPRESP_STATE_TRAILER:
+      // The trailer headers are ignored
+      if (resp->lineLength == 0) {
+        resp->state = HTTPRESP_STATE_DONE;
+        return HTTPRESP_DONE;
+      }
+      return HTTPRESP_OK;
+    default:
+      return HTTPRESP_PROTOCOL_ERROR;
+  }
+}
+
+void httpresp_init(httpresp_t *resp, const httpresp_callbacks_t *callbacks) {
+  memset(resp, 0, sizeof(httpresp_t));
+  resp->callbacks = callbacks;
+  resp->state = HTTPRESP_STATE_STATUS;
+}
+
+httpresp_status_t httpresp_feed(httpresp_t *resp, const uint8_t *data,
+                                size_t len, size_t *consumed) {
+  size_t pos = 0;
+  httpresp_status_t result = HTTPRESP_OK;
+  if (resp->state == HTTPRESP_STATE_DONE) {
+    result = HTTPRESP_DONE;
+  } else if (resp->state == HTTPRESP_STATE_ERROR) {
+    result = HTTPRESP_PROTOCOL_ERROR;
+  }
+
+  while ((pos < len) && (result == HTTPRESP_OK)) {
+    switch (resp->state) {
+      case HTTPRESP_STATE_BODY:
+      case HTTPRESP_STATE_CHUNK_DATA:
+      case HTTPRESP_STATE_BODY_UNTIL_CLOSE: {
+        size_t chunk = len - pos;
+        if ((resp->state != HTTPRESP_STATE_BODY_UNTIL_CLOSE) &&
+            (chunk > resp->remaining)) {
+          chunk = resp->remaining;
+        }
+        if ((resp->callbacks->body != NULL) &&
+            !resp->callbacks->body(&data[pos], chunk,
+                                   resp->callbacks->context)) {
+          result = HTTPRESP_ABORTED;
+        }
+        pos += chunk;
+        if (resp->state == HTTPRESP_STATE_BODY_UNTIL_CLOSE) {
+          break;
+        }
+        resp->remaining -= (uint32_t)chunk;
+        if (resp->remaining > 0) {
+          break;
+        }
+        if (resp->state == HTTPRESP_STATE_CHUNK_DATA) {
+          resp->state = HTTPRESP_STATE_CHUNK_END;
+        } else {
+          resp->state = HTTPRESP_STATE_DONE;
+          if (result == HTTPRESP_OK) {
+            result = HTTPRESP_DONE;
+          }
+        }
+      } break;
+      default: {
+        // Line by line: status, headers and chunk framing
+        char c = (char)data[pos++];
+        if (c == '\n') {
+          resp->line[resp->lineLength] = '\0';
+          result = parseLine(resp);
+          resp->lineLength = 0;
+        } else if ((c != '\r') &&
+                   (resp->lineLength < HTTPRESP_LINE_SIZE - 1)) {
+          resp->line[resp->lineLength++] = c;
+        }
+      } break;
+    }
+  }
+
+  if (result < 0) {
+    resp->state = HTTPRESP_STATE_ERROR;
+  }
+  resp->received += (uint32_t)pos;
+  *consumed = pos;
+  return result;
+}
+
+httpresp_status_t httpresp_close(httpresp_t *resp) {
+  if ((resp->state == HTTPRESP_STATE_BODY_UNTIL_CLOSE) ||
+      (resp->state == HTTPRESP_STATE_DONE)) {
+    resp->state = HTTPRESP_STATE_DONE;
+    return HTTPRESP_DONE;
+  }
+  resp->state = HTTPRESP_STATE_ERROR;
+  return HTTPRESP_CLOSED_ERROR;
+}
@@ -18,6 +18,13 @@
 #define ACONFIG_PARAM_ROM_MODE "MODE"
 #define ACONFIG_PARAM_ROM_HTTP_CATALOG "HTTP_CATALOG"
 #define ACONFIG_PARAM_ROM_HTTPS_CATALOG "HTTPS_CATALOG"
+#define ACONFIG_PARAM_WIFI_CACHE "WIFI_CACHE"
+#define ACONFIG_PARAM_ROM_PUSH "ROM_PUSH"
+#define ACONFIG_PARAM_SD_CALIBRATION "SD_CALIBRATION"
+#define ACONFIG_PARAM_PROFILE "PROFILE"
+#define ACONFIG_PARAM_MACHINE "MACHINE"
+#define ACONFIG_PARAM_ROM_TIMING "ROM_TIMING"
+#define ACONFIG_PARAM_BUS_TRACE "BUS_TRACE"
 
 #define ACONFIG_SUCCESS 0
 #define ACONFIG_INIT_ERROR -1
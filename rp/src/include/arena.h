@@ -0,0 +1,96 @@
+/**
+ * File: arena.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the static arenas of the working buffers
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "constants.h"
+#include "debug.h"
+
+// Every buffer starts on a double word
+#define ARENA_ALIGNMENT 8
+
+// Memory budget. Each arena is a static block sized for the largest set of
+// buffers its users take at the same time, checked in arena.c against their
+// sizes. The buffers are taken and given back as a stack, so an arena never
+// fragments and an allocation is a few instructions.
+//
+// Scratch: buffers of the main loop of core0 that live for one operation.
+// The largest is the transfer of sdbench and sdcal. Also the sector of
+// storeFileToFlash, the text of the print command, the rescan of the ROM
+// index and the validation of the clock profile.
+#define ARENA_SCRATCH_SIZE 16384
+// Sort: the runs of the external sort of the catalog and of the search
+// index. The sort only runs in core1, while converting the catalog or
+// building its search index.
+#define ARENA_SORT_SIZE 2560
+// Trace: in Ripper mode, the rings of the capture of the bus and the queue
+// of compressed bytes for the microSD card. The rings are taken first, at
+// the start of the arena, aligned to their size for the DMA.
+#define ARENA_TRACE_SIZE 24576
+#define ARENA_TRACE_ALIGNMENT 4096
+
+// Name, size and alignment of each arena
+#define ARENA_BUDGET(X)                                                  \
+  X(ARENA_SCRATCH, "scratch", ARENA_SCRATCH_SIZE, ARENA_ALIGNMENT)       \
+  X(ARENA_SORT, "sort", ARENA_SORT_SIZE, ARENA_ALIGNMENT)                \
+  X(ARENA_TRACE, "trace", ARENA_TRACE_SIZE, ARENA_TRACE_ALIGNMENT)
+
+// All the arenas. The settings have their own pool, see settings.c.
+#define ARENA_TOTAL_SIZE \
+  (ARENA_SCRATCH_SIZE + ARENA_SORT_SIZE + ARENA_TRACE_SIZE)
+#define ARENA_TOTAL_BUDGET 45056
+
+#if ARENA_TOTAL_SIZE > ARENA_TOTAL_BUDGET
+#error "The arenas exceed ARENA_TOTAL_BUDGET"
+#endif
+
+#define ARENA_ENUM(id, name, size, alignment) id,
+typedef enum { ARENA_BUDGET(ARENA_ENUM) ARENA_COUNT } arena_id_t;
+#undef ARENA_ENUM
+
+typedef struct {
+  const char *name;
+  uint8_t *base;
+  size_t size;
+  size_t used;
+  size_t highWater;   // Most bytes used at the same time since the boot
+  uint32_t failures;  // Allocations that did not fit
+} arena_t;
+
+/**
+ * @brief Takes a buffer from the top of an arena. Only one core uses an
+ * arena at a time, and never from an interrupt.
+ *
+ * @param id Arena.
+ * @param size Bytes. Rounded up to ARENA_ALIGNMENT.
+ * @return The buffer, or NULL if it does not fit.
+ */
+void *arena_alloc(arena_id_t id, size_t size);
+
+/**
+ * @brief Gives back a buffer and every buffer taken after it. Does nothing
+ * if buffer is NULL, so it can replace free().
+ *
+ * @param id Arena.
+ * @param buffer Returned by arena_alloc().
+ */
+void arena_free(arena_id_t id, void *buffer);
+
+/**
+ * @brief Returns the state of an arena, for the stats command.
+ */
+const arena_t *arena_get(arena_id_t id);
+
+#endif  // ARENA_H
@@ -0,0 +1,124 @@
+/**
+ * File: bustrace.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the recorder of the accesses of the computer to the
+ * ROM in Ripper mode
+ */
+
+#ifndef BUSTRACE_H
+#define BUSTRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "aconfig.h"
+#include "arena.h"
+#include "constants.h"
+#include "debug.h"
+#include "ff.h"
+#include "pico/stdlib.h"
+#include "romemul.h"
+#include "sdcal.h"
+#include "worker.h"
+
+#define BUSTRACE_FILENAME "/bustrace.bin"
+#define BUSTRACE_FILE_MAGIC 0x31535542  // "BUS1"
+#define BUSTRACE_FILE_VERSION 1
+
+// Rings of the capture, filled by the DMA: 1024 accesses, half a
+// millisecond of the computer reading the ROM as fast as it can
+#define BUSTRACE_RING_BITS 12
+#define BUSTRACE_RING_BYTES (1u << BUSTRACE_RING_BITS)
+#define BUSTRACE_RING_RECORDS (BUSTRACE_RING_BYTES / sizeof(uint32_t))
+
+// An alarm of core0 compresses the rings this often, five times in the time
+// the DMA takes to fill them. The microSD card never holds it up.
+#define BUSTRACE_DRAIN_US 100
+
+// Queue of compressed bytes for core1, that writes them to the microSD card.
+// A write to the card can take a few hundred milliseconds: the code and the
+// copies the computer reads in sequence compress to a few bytes, and the
+// buffers left fill meanwhile. If all are full, the accesses are lost until
+// one is written, and a gap is marked.
+#define BUSTRACE_OUT_BYTES 2048
+#define BUSTRACE_OUT_BUFFERS 8
+
+// Most bytes an access takes: the gap before it, the run before it, and the
+// two differences
+#define BUSTRACE_ENTRY_MAX_BYTES 21
+
+// Both rings first, aligned to their size, then the queue, from the trace
+// arena
+#define BUSTRACE_ARENA_BYTES \
+  (2 * BUSTRACE_RING_BYTES + BUSTRACE_OUT_BUFFERS * BUSTRACE_OUT_BYTES)
+
+// Without a buffer full, the bytes compressed are written after this long
+#define BUSTRACE_FLUSH_MS 1000
+
+// Bits of the address in the capture: !ROM4 inverted (bit 16) and the 16
+// bits of the bus
+#define BUSTRACE_ADDRESS_MASK 0x1FFFF
+
+// The file is the header and a stream of unsigned LEB128 varints. Each
+// entry starts with a head:
+// - Even: an access. head >> 1 is the zigzag of the difference with the
+//   previous address, followed by the microseconds since the previous
+//   access.
+// - Odd, head >> 1 > 0: the previous differences repeat that many times.
+// - Odd, head >> 1 == 0: accesses lost before the next one, the DMA lapped
+//   the recorder.
+// The first access is relative to address 0 and to startUs.
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t startUs;   // time_us_32() at the start
+  uint32_t accesses;  // Written when the recording stops
+  uint32_t gaps;
+  uint32_t bytes;  // Of the stream after the header
+} bustrace_file_header_t;
+
+typedef struct {
+  uint32_t accesses;
+  uint32_t gaps;
+  uint32_t dropped;  // Accesses that did not fit in the queue
+  uint32_t bytes;
+  FRESULT error;  // First error writing the file
+} bustrace_stats_t;
+
+/**
+ * @brief Mounts the microSD card, creates the file and sets the capture of
+ * the bus. Call it before init_romemul().
+ *
+ * @return false if there is no card or no memory. The ROM is emulated
+ * without recording.
+ */
+bool bustrace_init(void);
+
+/**
+ * @brief Starts the alarm that compresses the accesses in core0, and the
+ * writer of the microSD card in core1, after init_romemul().
+ */
+void bustrace_start(void);
+
+/**
+ * @brief Stops the recorder. Compresses the accesses left, writes them and
+ * closes the file.
+ *
+ * @return The counts of the recording.
+ */
+const bustrace_stats_t *bustrace_stop(void);
+
+/**
+ * @brief Reads the counts of the last recording from the header of the file.
+ *
+ * @param header Filled with the header.
+ * @return false if there is no recording, or it was not closed.
+ */
+bool bustrace_readLast(bustrace_file_header_t *header);
+
+#endif  // BUSTRACE_H
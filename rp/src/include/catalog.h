@@ -0,0 +1,237 @@
+/**
+ * File: catalog.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the paged ROM catalog (SD card and network)
+ */
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constants.h"
+#include "debug.h"
+#include "extsort.h"
+#include "ff.h"
+#include "romindex.h"
+#include "romsearch.h"
+#include "worker.h"
+
+#define CATALOG_PAGE_SIZE 20    // Entries per page shown in the terminal
+#define CATALOG_ARENA_SIZE 5120  // String pool for the entries of one page
+#define CATALOG_MAX_PAGES 200    // Up to 4000 entries in a CSV catalog
+#define CATALOG_NAME_LENGTH ROMINDEX_NAME_LENGTH
+#define CATALOG_TEXT_LENGTH 128
+#define CATALOG_PATH_SIZE 128
+#define CATALOG_CSV_LINE_SIZE 384
+#define CATALOG_CSV_SIZE_LENGTH 12
+#define CATALOG_HASH_LENGTH 65  // SHA-256 in hex, or MD5, null-terminated
+
+// Binary catalog converted from the CSV file
+#define CATALOG_BINARY_EXTENSION ".cat"
+#define CATALOG_SORT_EXTENSION_A ".s1"  // Temporary files of the merge sort
+#define CATALOG_SORT_EXTENSION_B ".s2"
+#define CATALOG_MAGIC 0x54414352  // "RCAT" in little endian
+#define CATALOG_VERSION 2
+#define CATALOG_TABLE_CHUNK 64  // Offsets buffered before writing the table
+
+// Search index of the binary catalog
+#define CATALOG_SEARCH_EXTENSION ".idx"
+#define CATALOG_SEARCH_MAX_RESULTS 200  // Ten pages of results
+#if (CATALOG_MAX_PAGES * CATALOG_PAGE_SIZE) > ROMSEARCH_MAX_RECORDS
+#error "ROMSEARCH_MAX_RECORDS too small for the CSV catalog"
+#endif
+
+// Size of a binary record without description: size, and filename, name,
+// tags and hash with their terminators. A page of them must always fit in the
+// arena, descriptions are truncated to the space left.
+#define CATALOG_RECORD_MIN (4 + 3 * CATALOG_NAME_LENGTH + CATALOG_HASH_LENGTH)
+#if (CATALOG_PAGE_SIZE * (CATALOG_RECORD_MIN + 1)) > CATALOG_ARENA_SIZE
+#error "CATALOG_ARENA_SIZE too small for a page of binary catalog records"
+#endif
+
+typedef enum {
+  CATALOG_OK = 0,
+  CATALOG_OPEN_ERROR = -1,
+  CATALOG_READ_ERROR = -2,
+  CATALOG_INDEX_ERROR = -3,
+  CATALOG_RANGE_ERROR = -4,
+  CATALOG_WRITE_ERROR = -5,
+  CATALOG_MEMORY_ERROR = -6,
+  CATALOG_QUERY_ERROR = -7,
+  CATALOG_STALE_ERROR = -8  // Not converted, or converted from another CSV
+} catalog_status_t;
+
+typedef enum {
+  CATALOG_SOURCE_NONE = 0,
+  CATALOG_SOURCE_SDCARD,
+  CATALOG_SOURCE_CSV,
+  CATALOG_SOURCE_BINARY
+} catalog_source_t;
+
+// On-disk header of the binary catalog. It is followed by a table with the
+// file offset of each record, and then the records sorted by filename. Each
+// record is the size in KB (int32) followed by the filename, name, tags, hash
+// and description as null-terminated strings, already URL-decoded.
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t pageSize;   // CATALOG_PAGE_SIZE used to budget the records
+  uint16_t arenaSize;  // CATALOG_ARENA_SIZE used to budget the records
+  uint16_t reserved;
+  uint32_t count;       // Number of records
+  uint32_t recordsEnd;  // File offset of the end of the last record
+  uint32_t csvSize;     // Size of the CSV file converted
+  uint16_t csvDate;     // FAT date of the CSV file converted
+  uint16_t csvTime;     // FAT time of the CSV file converted
+} catalog_header_t;
+
+// An entry of the page loaded. Strings point to the page arena and are only
+// valid until another page is loaded.
+typedef struct {
+  const char *filename;
+  const char *name;
+  const char *description;
+  const char *tags;
+  const char *hash;  // Digest of the file in hex. Empty if unknown.
+  int size;          // KB. Zero if unknown.
+} catalog_entry_t;
+
+/**
+ * @brief Opens the catalog of ROM files stored in a folder of the SD card.
+ *
+ * Brings the persistent index of the folder up to date. Entries are read one
+ * page at a time from the index, so the number of ROM files is not limited by
+ * the RAM available.
+ *
+ * @param folder Folder with the ROM files.
+ * @param filter Callback deciding which filenames are ROM files.
+ * @return catalog_status_t CATALOG_OK on success, or an error code.
+ */
+catalog_status_t catalog_openSdcard(const char *folder,
+                                    romindex_filter_t filter);
+
+/**
+ * @brief Converts the CSV catalog into the binary catalog.
+ *
+ * The CSV file has a header line and then one line per ROM with five quoted
+ * and URL-encoded fields: url, name, description, tags and size in KB. An
+ * optional sixth field has the SHA-256 or MD5 digest of the file in hex. The
+ * lines are sorted by filename with an external merge sort on the SD card,
+ * decoded, and written next to the CSV file with the .cat extension. The
+ * search index is built next to it with the .idx extension. Call it after
+ * downloading a new CSV file, or when the catalog opened is stale. It takes
+ * seconds: call it from core1.
+ *
+ * @param csvPath Path of the CSV file on the SD card.
+ * @return catalog_status_t CATALOG_OK on success, or an error code.
+ */
+catalog_status_t catalog_convertCsv(const char *csvPath);
+
+/**
+ * @brief Builds the search index of the binary catalog converted from a CSV
+ * file again, when catalog_search() finds it missing or out of date. It takes
+ * seconds: call it from core1.
+ *
+ * @param csvPath Path of the CSV file on the SD card.
+ * @return catalog_status_t CATALOG_OK on success, or an error code.
+ */
+catalog_status_t catalog_buildSearchIndex(const char *csvPath);
+
+/**
+ * @brief Opens the catalog of ROM files available for download.
+ *
+ * Uses the binary catalog converted from the CSV file. Any page is then
+ * loaded with two seeks. If it is missing or out of date, it is not converted
+ * here: each page is selected with one sequential pass over the CSV file
+ * instead, and catalog_isStale() is true. Either way only one page is kept in
+ * RAM.
+ *
+ * @param csvPath Path of the CSV file on the SD card.
+ * @return catalog_status_t CATALOG_OK on success, or an error code.
+ */
+catalog_status_t catalog_openCsv(const char *csvPath);
+
+/**
+ * @brief Closes the catalog and forgets the page loaded.
+ */
+void catalog_close(void);
+
+/**
+ * @brief Filters the catalog opened with the entries matching a query.
+ *
+ * Each word of the query must match the start of a word of the name or the
+ * tags of the entry. A word starting with '#' only matches the tags. The
+ * binary catalog uses its search index. If the index is missing or out of
+ * date, or the catalog is read from the CSV file, it returns
+ * CATALOG_STALE_ERROR: see catalog_buildSearchIndex() and
+ * catalog_convertCsv(). The SD card catalog only has names, and is scanned
+ * instead. Until the filter is cleared, the entries and pages are those of
+ * the results, up to CATALOG_SEARCH_MAX_RESULTS.
+ *
+ * @param query Words to search, separated by spaces.
+ * @return catalog_status_t CATALOG_OK on success, or an error code. The
+ * catalog is left unfiltered on error.
+ */
+catalog_status_t catalog_search(const char *query);
+
+/**
+ * @brief Removes the filter of the last search.
+ */
+void catalog_clearSearch(void);
+
+/**
+ * @brief Checks if the catalog shows the results of a search.
+ *
+ * @return true if filtered by catalog_search.
+ */
+bool catalog_isFiltered(void);
+
+/**
+ * @brief Checks if the catalog opened needs catalog_convertCsv().
+ *
+ * @return true if it is read from the CSV file, as the binary catalog is
+ * missing or out of date.
+ */
+bool catalog_isStale(void);
+
+/**
+ * @brief Returns the number of entries of the catalog opened.
+ *
+ * @return int Number of entries, or of results if filtered. Zero if no
+ * catalog is open.
+ */
+int catalog_getCount(void);
+
+/**
+ * @brief Returns the number of pages of the catalog opened.
+ *
+ * @return int Number of pages of CATALOG_PAGE_SIZE entries.
+ */
+int catalog_getPages(void);
+
+/**
+ * @brief Loads a page of entries into the page arena.
+ *
+ * Does nothing if the page is already loaded.
+ *
+ * @param page Page number, starting with 0.
+ * @return catalog_status_t CATALOG_OK on success, or an error code.
+ */
+catalog_status_t catalog_loadPage(int page);
+
+/**
+ * @brief Returns an entry of the catalog, loading its page if needed.
+ *
+ * @param index Position of the entry in the sorted catalog, starting with 0.
+ * @return const catalog_entry_t* The entry, or NULL if out of range or the
+ * page cannot be loaded.
+ */
+const catalog_entry_t *catalog_getEntry(int index);
+
+#endif  // CATALOG_H
@@ -16,8 +16,11 @@
 
 #include "constants.h"
 #include "debug.h"
+#include "dmacopy.h"
 #include "hardware/dma.h"
 #include "memfunc.h"
+#include "perf.h"
+#include "trace.h"
 #include "u8g2.h"
 
 // Define custom display dimensions
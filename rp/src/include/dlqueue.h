@@ -0,0 +1,103 @@
+/**
+ * File: dlqueue.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the queue of download jobs
+ */
+
+#ifndef DLQUEUE_H
+#define DLQUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "constants.h"
+#include "debug.h"
+#include "download.h"
+
+#define DLQUEUE_MAX_JOBS 16
+
+typedef enum {
+  DLQUEUE_OK = 0,
+  DLQUEUE_FULL_ERROR = -1,
+  DLQUEUE_URL_ERROR = -2
+} dlqueue_status_t;
+
+typedef enum {
+  DLQUEUE_JOB_QUEUED,
+  DLQUEUE_JOB_DOWNLOADING,
+  DLQUEUE_JOB_DONE,
+  DLQUEUE_JOB_FAILED
+} dlqueue_job_status_t;
+
+typedef struct dlqueue_job dlqueue_job_t;
+
+// Called in the main loop when a job ends, successfully or not
+typedef void (*dlqueue_done_t)(const dlqueue_job_t *job);
+
+struct dlqueue_job {
+  char url[DOWNLOAD_BUFFLINE_SIZE];
+  char filename[DOWNLOAD_FILENAME_SIZE];  // Last part of the URL
+  download_target_t target;
+  uint32_t flashAddress;  // Of the ROM, for the ROM targets
+  char hash[DOWNLOAD_HASH_LENGTH];  // Digest expected. Empty if none.
+  dlqueue_done_t done;
+  dlqueue_job_status_t status;
+  download_err_t error;  // Of a failed job
+  uint32_t bytes;        // Bytes received
+};
+
+/**
+ * @brief Adds a download to the end of the queue.
+ *
+ * The jobs run one after the other, over the same connection while they are
+ * on the same host. When the queue is full, the jobs already finished are
+ * dropped to make room.
+ *
+ * @param url URL of the file to download.
+ * @param target Where to write the file.
+ * @param flashAddress Address of the flash area of the ROM. Ignored for the
+ * SD card target.
+ * @param hash Digest the file must have, in hex. See download_setHash(). Can
+ * be NULL.
+ * @param done Function called when the job ends. Can be NULL.
+ * @return DLQUEUE_OK if queued, or an error code.
+ */
+dlqueue_status_t dlqueue_add(const char *url, download_target_t target,
+                             uint32_t flashAddress, const char *hash,
+                             dlqueue_done_t done);
+
+/**
+ * @brief Drives the queue. Call it from the main loop.
+ *
+ * Polls the download in progress and, when it ends, writes the file and
+ * calls the done function of the job. Then starts the next job queued.
+ */
+void dlqueue_poll(void);
+
+/**
+ * @brief Checks if there are jobs queued or downloading.
+ *
+ * @return true if the queue is not finished.
+ */
+bool dlqueue_isBusy(void);
+
+/**
+ * @brief Number of jobs in the queue, finished ones included.
+ *
+ * @return The number of jobs.
+ */
+int dlqueue_getCount(void);
+
+/**
+ * @brief Provides a job of the queue, in the order they were added.
+ *
+ * @param index Position of the job.
+ * @return A pointer to the job, or NULL if out of range.
+ */
+const dlqueue_job_t *dlqueue_getJob(int index);
+
+#endif  // DLQUEUE_H
@@ -0,0 +1,136 @@
+/**
+ * File: dmacopy.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the asynchronous copies with DMA
+ */
+
+#ifndef DMACOPY_H
+#define DMACOPY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "constants.h"
+#include "debug.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+// Channels claimed once by dmacopy_init() and never released. Two copies can
+// run at the same time.
+#define DMACOPY_CHANNELS 2
+
+// Copies submitted and not finished yet. Submitting more waits.
+#define DMACOPY_QUEUE_SIZE 8
+
+// The ROM emulator has DMA_IRQ_1
+#define DMACOPY_DMA_IRQ (DMA_IRQ_0)
+
+// Identifies a copy submitted, to wait for it or to start another one after
+// it. Fences grow in the order of submission.
+typedef uint32_t dmacopy_fence_t;
+
+// No copy. Already done, and a copy started after it starts right away.
+#define DMACOPY_NO_FENCE 0
+
+// Called from the DMA interrupt, or from dmacopy_wait(), when a copy ends.
+// Keep it short.
+typedef void (*dmacopy_done_t)(void *context);
+
+typedef enum {
+  DMACOPY_OP_MEMCPY,
+  DMACOPY_OP_MEMCPY_BSWAP16,
+  DMACOPY_OP_MEMSET,
+  DMACOPY_OP_FROM_FLASH
+} dmacopy_op_type_t;
+
+typedef enum {
+  DMACOPY_OP_FREE,
+  DMACOPY_OP_PENDING,
+  DMACOPY_OP_RUNNING,
+  DMACOPY_OP_DONE
+} dmacopy_op_state_t;
+
+typedef struct {
+  dmacopy_op_type_t type;
+  volatile dmacopy_op_state_t state;
+  void *dest;
+  const void *src;
+  uint32_t bytes;
+  uint32_t value;  // Pattern of DMACOPY_OP_MEMSET, read by the DMA
+  dmacopy_fence_t fence;
+  dmacopy_fence_t after;  // Does not start before this one ends
+  dmacopy_done_t done;
+  void *context;
+} dmacopy_op_t;
+
+/**
+ * @brief Claims the channels and installs the interrupt handler in the
+ * current core. Called again, does nothing. The copies are submitted from
+ * this core, and never from an interrupt.
+ */
+void dmacopy_init(void);
+
+/**
+ * @brief Copies memory. Transfers words if both addresses and the size are
+ * aligned to 4 bytes, otherwise bytes.
+ *
+ * The copies start in the order submitted, as soon as a channel is free and
+ * the copy in after has ended. Chain copies through after when one needs the
+ * result of another.
+ *
+ * @param dest Destination.
+ * @param src Source. Must not change until the copy ends.
+ * @param bytes Size.
+ * @param after Fence of the copy to wait for, or DMACOPY_NO_FENCE.
+ * @param done Called when the copy ends. Can be NULL.
+ * @param context Passed to done.
+ * @return Fence of the copy.
+ */
+dmacopy_fence_t dmacopy_memcpy(void *dest, const void *src, size_t bytes,
+                               dmacopy_fence_t after, dmacopy_done_t done,
+                               void *context);
+
+/**
+ * @brief Copies memory swapping the bytes of each 16-bit word, for the
+ * computer. Odd sizes are rounded up. Same rules as dmacopy_memcpy().
+ */
+dmacopy_fence_t dmacopy_memcpyBswap16(void *dest, const void *src,
+                                      size_t bytes, dmacopy_fence_t after,
+                                      dmacopy_done_t done, void *context);
+
+/**
+ * @brief Fills memory with a byte. Same rules as dmacopy_memcpy().
+ */
+dmacopy_fence_t dmacopy_memset(void *dest, uint8_t value, size_t bytes,
+                               dmacopy_fence_t after, dmacopy_done_t done,
+                               void *context);
+
+/**
+ * @brief Copies from the flash with the XIP stream, without going through
+ * the cache. src and bytes must be aligned to 4 bytes. Only one runs at a
+ * time. Same rules as dmacopy_memcpy().
+ */
+dmacopy_fence_t dmacopy_fromFlash(void *dest, const void *src, size_t bytes,
+                                  dmacopy_fence_t after, dmacopy_done_t done,
+                                  void *context);
+
+/**
+ * @brief Returns true if the copy has ended.
+ */
+bool dmacopy_isDone(dmacopy_fence_t fence);
+
+/**
+ * @brief Waits for a copy to end, and for the copies submitted before it.
+ * Works with the interrupts disabled.
+ */
+void dmacopy_wait(dmacopy_fence_t fence);
+
+#endif  // DMACOPY_H
@@ -9,6 +9,7 @@
 #ifndef DOWNLOAD_H
 #define DOWNLOAD_H
 
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,9 +18,16 @@
 #include "constants.h"
 #include "debug.h"
 #include "ff.h"
-#include "httpc/httpc.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "httpconn.h"
+#include "mbedtls/md5.h"
+#include "mbedtls/sha256.h"
 #include "memfunc.h"
 #include "network.h"
+#include "perf.h"
+#include "sdcard.h"
+#include "worker.h"
 
 #define DOWNLOAD_BUFFLINE_SIZE 256
 #define DOWNLOAD_FILENAME_SIZE 64
@@ -27,6 +35,15 @@
 #define DOWNLOAD_PROTOCOL_SIZE 16
 #define DOWNLOAD_POLLING_INTERVAL_MS 100
 
+// Write-behind buffer of the body received. A power of two multiple of the
+// sector size, so every write but the last one is made of whole sectors and
+// never straddles a cluster boundary.
+#define DOWNLOAD_WRITE_BUFFER_SIZE 8192
+#define DOWNLOAD_SYNC_WRITES 16  // Writes between syncs of the file size
+#if (DOWNLOAD_WRITE_BUFFER_SIZE % FF_MAX_SS) != 0
+#error "DOWNLOAD_WRITE_BUFFER_SIZE must be a multiple of the sector size"
+#endif
+
 typedef enum {
   DOWNLOAD_STATUS_IDLE,
   DOWNLOAD_STATUS_REQUESTED,
@@ -37,6 +54,12 @@ typedef enum {
   DOWNLOAD_STATUS_FAILED
 } download_status_t;
 
+typedef enum {
+  DOWNLOAD_TARGET_SDCARD,     // Into the file on the SD card
+  DOWNLOAD_TARGET_ROM,        // Into the flash area of the ROM
+  DOWNLOAD_TARGET_ROM_SDCARD  // Both at the same time
+} download_target_t;
+
 typedef enum {
   DOWNLOAD_POLL_CONTINUE,
   DOWNLOAD_POLL_ERROR,
@@ -57,7 +80,10 @@ typedef enum {
   DOWNLOAD_MD5MISMATCH_ERROR,
   DOWNLOAD_CANNOTRENAMEFILE_ERROR,
   DOWNLOAD_CANNOTCREATE_CONFIG,
-  DOWNLOAD_CANNOTDELETECONFIGSECTOR_ERROR
+  DOWNLOAD_CANNOTDELETECONFIGSECTOR_ERROR,
+  DOWNLOAD_CANNOTPROGRAMROM_ERROR,
+  DOWNLOAD_HASHMISMATCH_ERROR,
+  DOWNLOAD_NOSPACE_ERROR
 } download_err_t;
 
 typedef struct {
@@ -71,17 +97,108 @@ typedef struct {
   char filename[DOWNLOAD_FILENAME_SIZE];
 } download_file_t;
 
+// Streaming of a ROM straight into its flash area while downloading
+#define DOWNLOAD_ROM_MAX_SIZE (ROM_SIZE_BYTES * ROM_BANKS)
+#define DOWNLOAD_ROM_HEADER_SIZE 4  // Zeroed header of STEEM cartridge images
+
+// Digest of the file expected, checked while it downloads
+#define DOWNLOAD_HASH_LENGTH 65  // SHA-256 in hex, null-terminated
+#define DOWNLOAD_MD5_SIZE 16
+#define DOWNLOAD_SHA256_SIZE 32
+
+typedef enum {
+  DOWNLOAD_HASH_NONE,
+  DOWNLOAD_HASH_MD5,    // 32 hex digits
+  DOWNLOAD_HASH_SHA256  // 64 hex digits
+} download_hash_t;
+
+// Validators of a downloaded file, stored next to it with this extension.
+// Also stored next to the temporary file while downloading, to resume it.
+#define DOWNLOAD_VALIDATORS_EXTENSION ".hdr"
+#define DOWNLOAD_VALIDATORS_MAGIC 0x52444856  // "VHDR" in little endian
+#define DOWNLOAD_VALIDATORS_VERSION 1
+#define DOWNLOAD_ETAG_SIZE 80
+#define DOWNLOAD_DATE_SIZE 40
+
+#define DOWNLOAD_HTTP_OK 200
+#define DOWNLOAD_HTTP_PARTIAL_CONTENT 206
+#define DOWNLOAD_HTTP_NOT_MODIFIED 304
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  char url[DOWNLOAD_BUFFLINE_SIZE];       // URL of the file
+  char etag[DOWNLOAD_ETAG_SIZE];          // ETag header. Empty if none.
+  char lastModified[DOWNLOAD_DATE_SIZE];  // Last-Modified header
+} download_validators_t;
+
+// Throughput of the last download
+typedef struct {
+  uint32_t bytes;      // Bytes of the body received
+  uint32_t elapsedUs;  // From the request to the last byte written
+  uint32_t writeUs;    // Time spent writing to the SD card
+  uint32_t writes;     // Number of writes to the SD card
+  uint32_t offset;     // Bytes kept from an interrupted download
+  uint32_t hashUs;     // Time spent hashing, resumed bytes included
+} download_stats_t;
+
 /**
  * @brief Initiates the download by parsing the current URL, opening a temporary
  * file, and starting the HTTP client request for the file. Checks and prepares
  * the file system environment (e.g., clearing read-only attributes, handling
  * locked files) before initiating the asynchronous download.
  *
+ * If the temporary file holds an interrupted download of the same URL, only
+ * the rest of the file is requested with a Range header. Otherwise, if the
+ * file was already downloaded, the request is conditional on the validators
+ * stored next to it, and the server answers without body if unchanged.
+ *
+ * When the server sends the Content-Length, the download fails before
+ * writing anything if the SD card has no room for it. A file written from
+ * the start gets a contiguous area of clusters reserved for it.
+ *
  * @return A download_err_t code indicating a successful start or a specific
  * error.
  */
 download_err_t download_start(void);
 
+/**
+ * @brief Sets where the next download is written. Only applies to the next
+ * call to download_start(); downloads go to the SD card by default.
+ *
+ * With a ROM target the body is byte-swapped and programmed into the flash
+ * area the ROM emulation boots from, sector by sector as it arrives, so the
+ * ROM can be launched as soon as the download finishes. A STEEM cartridge
+ * image header is dropped. ROM downloads are never conditional nor resumed,
+ * as the whole body is needed. The area keeps no copy of the previous image:
+ * the digest is only known at the end, so if the download fails or does not
+ * match, download_finish() erases the sectors already programmed.
+ *
+ * @param newTarget Where to write the body of the file.
+ * @param flashAddress Address of the flash area of the ROM. Ignored for the
+ * SD card target.
+ */
+void download_setTarget(download_target_t newTarget, uint32_t flashAddress);
+
+/**
+ * @brief Sets the digest the next download must have. Only applies to the
+ * next call to download_start().
+ *
+ * The body is hashed as it arrives, so the file is verified without reading
+ * it again from the SD card. Only the bytes kept from an interrupted download
+ * are read back, to hash them before resuming. A file not modified since it
+ * was downloaded is not hashed again. If the digest does not match,
+ * download_finish() fails, the temporary file is deleted and the ROM area
+ * programmed is erased.
+ *
+ * @param hash Digest in hex: 32 digits for MD5 or 64 for SHA-256. NULL or
+ * empty to not verify the download.
+ * @return The algorithm of the digest. DOWNLOAD_HASH_NONE if empty or not a
+ * valid digest.
+ */
+download_hash_t download_setHash(const char *hash);
+
 /**
  * @brief Polls the download process by invoking the asynchronous context
  * routines. Processes incoming data packets and HTTP events. Periodically waits
@@ -94,9 +211,10 @@ download_err_t download_start(void);
 download_poll_t download_poll(void);
 
 /**
- * @brief Finalizes the download process by closing the temporary file and
- * releasing resources. Performs error handling during file closure and cleans
- * up HTTPS configurations if used.
+ * @brief Finalizes the download process by closing the temporary file.
+ * Performs error handling during file closure, and checks the digest set with
+ * download_setHash(). The connection stays open for the next download from
+ * the same server.
  *
  * @return A download_err_t code indicating success or the specific error
  * encountered.
@@ -108,7 +226,8 @@ download_err_t download_finish(void);
  *
  * Generates the final file path based on application configuration and deletes
  * any pre-existing file. Ensures integrity by checking the result of the rename
- * operation.
+ * operation. The validators of the file are kept next to it. If the file was
+ * not modified, the file already downloaded is kept instead.
  *
  * @return A download_err_t code indicating a successful rename or an error code
  * if renaming fails.
@@ -149,4 +268,22 @@ void download_setFilepath(const char *path);
  */
 const download_url_components_t *download_getUrlComponents(void);
 
+/**
+ * @brief Checks if the server answered that the file already downloaded is
+ * unchanged.
+ *
+ * @return true if the last download was not modified, false otherwise.
+ */
+bool download_isNotModified(void);
+
+/**
+ * @brief Provides the throughput figures of the last download.
+ *
+ * Updated while the download is in progress and final after
+ * download_finish().
+ *
+ * @return A pointer to a download_stats_t structure.
+ */
+const download_stats_t *download_getStats(void);
+
 #endif  // DOWNLOAD_H
@@ -14,43 +14,40 @@
 #include <string.h>
 
 #include "aconfig.h"
+#include "arena.h"
 #include "blink.h"
+#include "bustrace.h"
+#include "catalog.h"
 #include "constants.h"
 #include "debug.h"
+#include "dlqueue.h"
 #include "download.h"
 #include "ff.h"
 #include "httpc/httpc.h"
 #include "memfunc.h"
+#include "memwatch.h"
 #include "network.h"
 #include "pico/stdlib.h"
+#include "profile.h"
 #include "romemul.h"
+#include "romindex.h"
+#include "rompush.h"
+#include "sdcal.h"
 #include "sdcard.h"
 #include "select.h"
 #include "term.h"
+#include "worker.h"
 
 #define WIFI_SCAN_TIME_MS (5 * 1000)
-#define DOWNLOAD_START_MS (3 * 1000)
-#define DOWNLOAD_DAY_MS (86400 * 1000)
 #define SLEEP_LOOP_MS 100
 
-#define MAX_ROMS 100
-#define MAX_ROMS_PER_PAGE 20
+#define MAX_ROMS_PER_PAGE CATALOG_PAGE_SIZE
 #define MAX_FILENAME_LENGTH 36
 #define MAX_PATH_SIZE 128
+#define ROMS_CSV_FILENAME "roms.csv"
 
 #define AUTORUN_BLINK_MS 200
 
-typedef struct {
-  char filename[MAX_FILENAME_LENGTH];
-  // You can add other fields (e.g. file size, type, etc.)
-  char path[MAX_PATH_SIZE];
-  char name[MAX_FILENAME_LENGTH];
-  char description[MAX_PATH_SIZE];
-  char tags[MAX_FILENAME_LENGTH];
-  int size;
-
-} ROM;
-
 enum {
   ROM_MODE_DIRECT = 0,  // ROM direct (no delay)
   ROM_MODE_DELAY = 1,   // ROM delay
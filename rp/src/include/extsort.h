@@ -0,0 +1,66 @@
+/**
+ * File: extsort.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the external merge sort of records on the SD card
+ */
+
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "constants.h"
+#include "debug.h"
+#include "ff.h"
+#include "worker.h"
+
+#define EXTSORT_CHUNK_SIZE 2560     // Bytes of records sorted in RAM per run
+#define EXTSORT_MAX_RECORD_SIZE 64  // Largest record supported
+
+typedef enum {
+  EXTSORT_OK = 0,
+  EXTSORT_OPEN_ERROR = -1,
+  EXTSORT_READ_ERROR = -2,
+  EXTSORT_WRITE_ERROR = -3,
+  EXTSORT_MEMORY_ERROR = -4
+} extsort_status_t;
+
+// Compares two records, like the qsort comparison function
+typedef int (*extsort_compare_t)(const void *first, const void *second);
+
+// Fills the record with the next one to sort. Returns false when there are no
+// more records.
+typedef bool (*extsort_next_t)(void *record, void *context);
+
+/**
+ * @brief Sorts fixed-size records using two temporary files on the SD card.
+ *
+ * The records are pulled from the producer callback in chunks of
+ * EXTSORT_CHUNK_SIZE bytes, sorted in RAM and written as runs to the first
+ * file. Then the runs are merged pairwise, alternating between both files,
+ * until there is only one. The RAM used does not depend on the number of
+ * records, and each merge pass is a sequential read and write. Each record
+ * merged calls worker_yield(), so core0 can write the flash meanwhile.
+ *
+ * @param pathA Path of the first temporary file.
+ * @param pathB Path of the second temporary file.
+ * @param recordSize Size of each record in bytes.
+ * @param next Producer of the records to sort.
+ * @param context Context passed to the producer.
+ * @param compare Comparison function of the records.
+ * @param count Pointer where the number of records sorted is stored.
+ * @param sortedPath Pointer where the path of the file with the sorted
+ * records is stored. It is either pathA or pathB.
+ * @return extsort_status_t EXTSORT_OK on success, or an error code.
+ */
+extsort_status_t extsort_sort(const char *pathA, const char *pathB,
+                              size_t recordSize, extsort_next_t next,
+                              void *context, extsort_compare_t compare,
+                              int *count, const char **sortedPath);
+
+#endif  // EXTSORT_H
@@ -0,0 +1,123 @@
+/**
+ * File: httpconn.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the persistent HTTP/1.1 connection to a server
+ */
+
+#ifndef HTTPCONN_H
+#define HTTPCONN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "constants.h"
+#include "debug.h"
+#include "httpresp.h"
+#include "lwip/altcp.h"
+#include "lwip/dns.h"
+#include "pico/cyw43_arch.h"
+
+#ifndef APP_DOWNLOAD_HTTPS
+#define APP_DOWNLOAD_HTTPS 0
+#endif
+
+#if APP_DOWNLOAD_HTTPS == 1
+#include "lwip/altcp_tls.h"
+#include "mbedtls/ssl.h"  // Server Name Indication TLS extension
+#endif
+
+#define HTTPCONN_HOSTNAME_SIZE 128
+#define HTTPCONN_REQUEST_SIZE 1024  // Request line and headers
+#define HTTPCONN_HTTP_PORT 80
+#define HTTPCONN_HTTPS_PORT 443
+
+// The TCP poll callback runs every HTTPCONN_POLL_INTERVAL coarse TCP timer
+// ticks of 500 ms
+#define HTTPCONN_POLL_INTERVAL 2
+#define HTTPCONN_POLL_MS 1000
+#define HTTPCONN_IDLE_TIMEOUT_MS (10 * SEC_TO_MS)  // Keep-alive before closing
+#define HTTPCONN_RESPONSE_TIMEOUT_MS (30 * SEC_TO_MS)  // Without any data
+
+typedef enum {
+  HTTPCONN_OK = 0,
+  HTTPCONN_BUSY_ERROR = -1,     // A request is already in progress
+  HTTPCONN_REQUEST_ERROR = -2,  // The request does not fit
+  HTTPCONN_DNS_ERROR = -3,
+  HTTPCONN_CONNECT_ERROR = -4,
+  HTTPCONN_SEND_ERROR = -5,
+  HTTPCONN_PROTOCOL_ERROR = -6,  // Not a valid HTTP response
+  HTTPCONN_ABORTED = -7,         // A callback of the response stopped it
+  HTTPCONN_CLOSED_ERROR = -8,    // Closed before the end of the response
+  HTTPCONN_TIMEOUT_ERROR = -9
+} httpconn_result_t;
+
+typedef enum {
+  HTTPCONN_STATE_CLOSED,
+  HTTPCONN_STATE_RESOLVING,
+  HTTPCONN_STATE_CONNECTING,
+  HTTPCONN_STATE_WAITING,  // Request sent, receiving the response
+  HTTPCONN_STATE_IDLE      // Kept open for the next request
+} httpconn_state_t;
+
+// Called once per request, with the result of the whole response
+typedef void (*httpconn_done_t)(httpconn_result_t result, void *context);
+
+typedef struct {
+  uint32_t connections;  // Connections opened
+  uint32_t requests;     // Requests made
+  uint32_t reused;       // Requests sent over a connection kept open
+} httpconn_stats_t;
+
+/**
+ * @brief Sends a GET request, reusing the open connection if it is to the
+ * same host and port.
+ *
+ * The response is parsed as it arrives and passed to the callbacks, and the
+ * done function is called at the end. If the server keeps the connection
+ * alive, it stays open for HTTPCONN_IDLE_TIMEOUT_MS for the next request, so
+ * there is no new DNS lookup nor TCP (or TLS) handshake. A request on a kept
+ * connection that the server closed meanwhile is sent again on a new one.
+ *
+ * The callbacks run in the lwIP context.
+ *
+ * @param host Name of the server.
+ * @param port Port of the server. Zero for the default of the protocol.
+ * @param uri Path of the resource, already encoded.
+ * @param headers Extra request headers, each one ending with "\r\n". Can be
+ * NULL.
+ * @param callbacks Callbacks of the response. Must outlive the request.
+ * @param done Function called when the request ends.
+ * @param context Context passed to the done function.
+ * @return HTTPCONN_OK if the request is on its way, or an error code. The
+ * done function is only called if the request started.
+ */
+httpconn_result_t httpconn_get(const char *host, uint16_t port,
+                               const char *uri, const char *headers,
+                               const httpresp_callbacks_t *callbacks,
+                               httpconn_done_t done, void *context);
+
+/**
+ * @brief Checks if a request is in progress.
+ *
+ * @return true from httpconn_get() until the done function is called.
+ */
+bool httpconn_isBusy(void);
+
+/**
+ * @brief Closes the connection, even if a request is in progress. Its done
+ * function is not called.
+ */
+void httpconn_close(void);
+
+/**
+ * @brief Provides the counters of connections and requests.
+ *
+ * @return A pointer to a httpconn_stats_t structure.
+ */
+const httpconn_stats_t *httpconn_getStats(void);
+
+#endif  // HTTPCONN_H
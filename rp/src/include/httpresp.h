@@ -0,0 +1,112 @@
+/**
+ * File: httpresp.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the incremental parser of HTTP/1.1 responses
+ */
+
+#ifndef HTTPRESP_H
+#define HTTPRESP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "constants.h"
+#include "debug.h"
+
+#define HTTPRESP_LINE_SIZE 256  // Longer header lines are truncated
+
+typedef enum {
+  HTTPRESP_OK = 0,               // More data needed
+  HTTPRESP_DONE = 1,             // The whole response was parsed
+  HTTPRESP_PROTOCOL_ERROR = -1,  // Not a valid response
+  HTTPRESP_ABORTED = -2,         // A callback asked to stop
+  HTTPRESP_CLOSED_ERROR = -3     // Connection closed before the end
+} httpresp_status_t;
+
+// Called for each header of the response
+typedef void (*httpresp_header_t)(const char *name, const char *value,
+                                  void *context);
+
+// Called after the last header, before the body. Returns false to abort.
+typedef bool (*httpresp_headers_done_t)(int status, void *context);
+
+// Called with each piece of the body, already without chunk framing. Returns
+// false to abort.
+typedef bool (*httpresp_body_t)(const uint8_t *data, size_t len,
+                                void *context);
+
+typedef struct {
+  httpresp_header_t header;
+  httpresp_headers_done_t headersDone;
+  httpresp_body_t body;
+  void *context;
+} httpresp_callbacks_t;
+
+typedef enum {
+  HTTPRESP_STATE_STATUS,
+  HTTPRESP_STATE_HEADER,
+  HTTPRESP_STATE_BODY,
+  HTTPRESP_STATE_BODY_UNTIL_CLOSE,
+  HTTPRESP_STATE_CHUNK_SIZE,
+  HTTPRESP_STATE_CHUNK_DATA,
+  HTTPRESP_STATE_CHUNK_END,
+  HTTPRESP_STATE_TRAILER,
+  HTTPRESP_STATE_DONE,
+  HTTPRESP_STATE_ERROR
+} httpresp_state_t;
+
+typedef struct {
+  const httpresp_callbacks_t *callbacks;
+  httpresp_state_t state;
+  int status;          // Status code of the response
+  bool keepAlive;      // The connection can be reused after the response
+  bool chunked;        // Transfer-Encoding: chunked
+  bool hasLength;      // Content-Length received
+  uint32_t remaining;  // Bytes left of the body or the current chunk
+  uint32_t received;   // Bytes of the response parsed, framing included
+  size_t lineLength;
+  char line[HTTPRESP_LINE_SIZE];
+} httpresp_t;
+
+/**
+ * @brief Prepares the parser for a new response.
+ *
+ * @param resp Parser to initialize.
+ * @param callbacks Callbacks of the response. Must outlive the parser.
+ */
+void httpresp_init(httpresp_t *resp, const httpresp_callbacks_t *callbacks);
+
+/**
+ * @brief Parses the next bytes of the response, in any size of pieces.
+ *
+ * Interim 1xx responses are skipped. The body is delimited by Content-Length,
+ * by chunks, or by the end of the connection, and is passed to the body
+ * callback as it arrives. Nothing is buffered but the current header line.
+ *
+ * @param resp Parser of the response.
+ * @param data Bytes received.
+ * @param len Number of bytes received.
+ * @param consumed Pointer where the number of bytes parsed is stored. Less
+ * than len if the response ended before them.
+ * @return HTTPRESP_OK if more data is needed, HTTPRESP_DONE at the end of the
+ * response, or an error code.
+ */
+httpresp_status_t httpresp_feed(httpresp_t *resp, const uint8_t *data,
+                                size_t len, size_t *consumed);
+
+/**
+ * @brief Tells the parser that the server closed the connection.
+ *
+ * @param resp Parser of the response.
+ * @return HTTPRESP_DONE if the body ends with the connection, or
+ * HTTPRESP_CLOSED_ERROR if the response was incomplete.
+ */
+httpresp_status_t httpresp_close(httpresp_t *resp);
+
+#endif  // HTTPRESP_H
@@ -13,6 +13,7 @@
 
 #include "constants.h"
 #include "debug.h"
+#include "dmacopy.h"
 #include "hardware/dma.h"
 #include "hardware/structs/xip_ctrl.h"
 
@@ -21,11 +22,13 @@
     COPY_FIRMWARE_TO_RAM_DMA(emulROM, emulROM_length); \
   } while (0)
 
-#define ERASE_FIRMWARE_IN_RAM()                               \
-  do {                                                        \
-    memset((void *)&__rom_in_ram_start__, 0,                  \
-           ROM_SIZE_LONGWORDS *ROM_BANKS * sizeof(uint32_t)); \
-    DPRINTF("RAM for the firmware zeroed.\n");                \
+#define ERASE_FIRMWARE_IN_RAM()                                       \
+  do {                                                                \
+    dmacopy_wait(dmacopy_memset(                                      \
+        (void *)&__rom_in_ram_start__, 0,                             \
+        ROM_SIZE_LONGWORDS *ROM_BANKS * sizeof(uint32_t),             \
+        DMACOPY_NO_FENCE, NULL, NULL));                               \
+    DPRINTF("RAM for the firmware zeroed.\n");                        \
   } while (0)
 
 #define COPY_FIRMWARE_TO_RAM_MEMCPY(emulROM, emulROM_length) \
@@ -34,27 +37,12 @@
     DPRINTF("Emulation firmware copied to RAM.\n");          \
   } while (0)
 
-#define COPY_FIRMWARE_TO_RAM_DMA(emulROM, emulROM_length)                     \
-  do {                                                                        \
-    while (!(xip_ctrl_hw->stat & XIP_STAT_FIFO_EMPTY))                        \
-      (void)xip_ctrl_hw->stream_fifo;                                         \
-    xip_ctrl_hw->stream_addr = (uint32_t)&(emulROM)[0];                       \
-    xip_ctrl_hw->stream_ctr = (emulROM_length) / 4;                           \
-    const uint dma_chan = dma_claim_unused_channel(true);                     \
-    dma_channel_config cfg = dma_channel_get_default_config(dma_chan);        \
-    channel_config_set_read_increment(&cfg, false);                           \
-    channel_config_set_write_increment(&cfg, true);                           \
-    channel_config_set_dreq(&cfg, DREQ_XIP_STREAM);                           \
-    dma_channel_configure(dma_chan, &cfg,                                     \
-                          (void *)&__rom_in_ram_start__, /* Write addr */     \
-                          (const void *)XIP_AUX_BASE,    /* Read addr */      \
-                          (emulROM_length) / 4,          /* Transfer count */ \
-                          true /* Start immediately! */                       \
-    );                                                                        \
-    while (dma_channel_is_busy(dma_chan)) {                                   \
-      tight_loop_contents();                                                  \
-    }                                                                         \
-  } while (0)
+// Streamed from the flash, without going through the XIP cache
+#define COPY_FIRMWARE_TO_RAM_DMA(emulROM, emulROM_length)               \
+  dmacopy_wait(dmacopy_fromFlash((void *)&__rom_in_ram_start__,         \
+                                 (const void *)&(emulROM)[0],           \
+                                 (emulROM_length), DMACOPY_NO_FENCE,    \
+                                 NULL, NULL))
 
 #define CHANGE_ENDIANESS_BLOCK16(dest_ptr_word, size_in_bytes) \
   do {                                                         \
@@ -111,29 +99,10 @@
     (((uint32_t)(*((volatile uint32_t *)((address) + (offset))) >> 16) & \
       0xFFFF))))
 
+// Blocking. Use dmacopy_memcpyBswap16() to do something else meanwhile.
 #define COPY_AND_SWAP_16BIT_DMA(dest, source, num_bytes)           \
-  do {                                                             \
-    size_t _rounded_bytes = ((num_bytes) + 1) & ~1;                \
-    size_t _num_words = _rounded_bytes / 2;                        \
-    int _dma_channel = dma_claim_unused_channel(true);             \
-    dma_channel_config _dma_cfg =                                  \
-        dma_channel_get_default_config(_dma_channel);              \
-    channel_config_set_transfer_data_size(&_dma_cfg, DMA_SIZE_16); \
-    channel_config_set_read_increment(&_dma_cfg, true);            \
-    channel_config_set_write_increment(&_dma_cfg, true);           \
-    channel_config_set_bswap(&_dma_cfg, true);                     \
-    dma_channel_configure(                                         \
-        _dma_channel, /* Channel */                                \
-        &_dma_cfg,    /* Channel config */                         \
-        (dest),       /* Destination address */                    \
-        (source),     /* Source address */                         \
-        (_num_words), /* Number of 16-bit words to transfer */     \
-        false         /* Don't start yet */                        \
-    );                                                             \
-    dma_channel_start(_dma_channel);                               \
-    dma_channel_wait_for_finish_blocking(_dma_channel);            \
-    dma_channel_unclaim(_dma_channel);                             \
-  } while (0)
+  dmacopy_wait(dmacopy_memcpyBswap16((dest), (source), (num_bytes), \
+                                     DMACOPY_NO_FENCE, NULL, NULL))
 
 /**
  * @brief Macro to set a shared variable.
@@ -0,0 +1,81 @@
+/**
+ * File: memwatch.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the high-water marks of the stacks and the heap
+ */
+
+#ifndef MEMWATCH_H
+#define MEMWATCH_H
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "debug.h"
+#include "pico/stdlib.h"
+
+// Written on the free part of the stacks. A word still with it was never
+// used.
+#define MEMWATCH_PAINT 0x5AC4C0DEu
+
+// Left unpainted below the stack pointer of memwatch_paintStack()
+#define MEMWATCH_PAINT_MARGIN 64
+
+// memwatch_poll() warns when a stack has less than this left
+#define MEMWATCH_STACK_LOW 256
+
+// The stacks live in the 4KB scratch banks, after the data placed there:
+// core0 grows down from the top of SCRATCH_Y, core1 in the array of
+// pico_multicore at the start of SCRATCH_X. Going below low corrupts that
+// data, or the ROM in RAM for core1.
+typedef struct {
+  uintptr_t low;       // Lowest address the stack can use
+  uintptr_t reserved;  // Bottom of the stack reserved by the linker
+  uintptr_t top;
+  uintptr_t deepest;  // Lowest address written since painted
+  bool painted;
+} memwatch_stack_t;
+
+typedef struct {
+  uint32_t inUse;  // Bytes allocated now
+  uint32_t peak;   // Top of the heap. newlib never gives it back.
+  uint32_t size;   // From the end of the static data to the ROM in RAM
+} memwatch_heap_t;
+
+/**
+ * @brief Paints the free part of the stack of a core. core0 paints its own
+ * stack, below the stack pointer; call it first thing in main(). core1 must
+ * be in reset, and its stack is painted whole.
+ *
+ * @param core Core of the stack.
+ */
+void memwatch_paintStack(uint core);
+
+/**
+ * @brief Measures the stack of a core. Scans the painted words, so call it
+ * from the terminal, not from the hot paths.
+ *
+ * @param core Core of the stack.
+ * @param stack Filled with the limits and the deepest address used.
+ */
+void memwatch_getStack(uint core, memwatch_stack_t *stack);
+
+/**
+ * @brief Returns the use of the heap.
+ */
+void memwatch_getHeap(memwatch_heap_t *heap);
+
+/**
+ * @brief Prints a warning to the debug output, once, when a stack gets
+ * close to its limit or the heap grows into the ROM in RAM. A couple of
+ * reads, for the main loop.
+ */
+void memwatch_poll(void);
+
+#endif  // MEMWATCH_H
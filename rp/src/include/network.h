@@ -19,9 +19,11 @@
 #endif
 
 #ifdef CYW43_WL_GPIO_LED_PIN
+#include "lwip/dhcp.h"
 #include "lwip/dns.h"
 #include "lwip/ip4_addr.h"
 #include "lwip/netif.h"
+#include "lwip/prot/dhcp.h"
 #include "pico/cyw43_arch.h"
 #include "pico/unique_id.h"
 #endif
@@ -44,6 +46,9 @@
 
 #define NETWORK_POLLING_INTERVAL 100  // 100 ms
 #define NETWORK_CONNECT_TIMEOUT 30    // 30 seconds
+#define NETWORK_CONNECT_ATTEMPTS 3
+#define NETWORK_CACHED_JOIN_TIMEOUT 5  // 5 seconds, then join with a scan
+#define NETWORK_STA_CACHE_FIELDS 9     // SSID hash, BSSID, channel and IP
 
 #define NETWORK_POWER_MGMT_DISABLED 0xa11140
 #define NETWORK_POWER_MGMT_MAX_OPTIONS 5
@@ -98,6 +103,14 @@ typedef enum {
   NOT_SUPPORTED
 } wifi_sta_conn_status_t;
 
+// State of the connection made in the background
+typedef enum {
+  NETWORK_STA_IDLE,       // Not started
+  NETWORK_STA_JOINING,    // Joining the network or waiting for an IP address
+  NETWORK_STA_CONNECTED,  // Link up with an IP address
+  NETWORK_STA_FAILED      // Gave up. See network_wifiConnStatusStr()
+} network_sta_state_t;
+
 typedef enum {
   WIFI_MODE_AP = 0,  // Access Point mode
   WIFI_MODE_STA = 1  // Station mode
@@ -205,6 +218,60 @@ wifi_scan_data_t* network_getFoundNetworks();
  */
 wifi_sta_conn_process_status_t network_wifiStaConnect();
 
+/**
+ * @brief Starts connecting to the WiFi network in station mode, without
+ * waiting for it.
+ *
+ * Configures the interface and starts joining the network. The connection
+ * then progresses with network_wifiStaPoll(), so the app can run meanwhile.
+ *
+ * @param maxAttempts Times to try joining before giving up, each one for up
+ * to NETWORK_CONNECT_TIMEOUT seconds.
+ * @return NETWORK_WIFI_STA_CONN_OK if the connection started, or an error
+ * code.
+ */
+wifi_sta_conn_process_status_t network_wifiStaConnectAsync(int maxAttempts);
+
+/**
+ * @brief Drives the connection started with network_wifiStaConnectAsync().
+ *
+ * Checks the link once per second and joins again when an attempt times out.
+ * Returns at once. Call it from the main loop.
+ *
+ * @return The state of the connection.
+ */
+network_sta_state_t network_wifiStaPoll();
+
+/**
+ * @brief Provides the state of the connection made in the background.
+ *
+ * @return The state of the connection.
+ */
+network_sta_state_t network_wifiStaGetState();
+
+/**
+ * @brief Sets the record of the last connection, to join the same access
+ * point on the same channel without scanning, and to ask the DHCP server for
+ * the same address. Call it before network_wifiStaConnectAsync().
+ *
+ * If the directed join fails, the connection falls back to a normal join.
+ * If the DHCP server refuses the address, lwIP asks for a new one.
+ *
+ * @param value Record from network_getStaCache(). Ignored if empty, invalid
+ * or of another SSID.
+ */
+void network_setStaCache(const char* value);
+
+/**
+ * @brief Provides the record of the current connection, to store it in the
+ * settings for network_setStaCache() on the next boot.
+ *
+ * @param value Buffer for the record, as text.
+ * @param size Size of the buffer.
+ * @return true if connected and the record was written.
+ */
+bool network_getStaCache(char* value, size_t size);
+
 /**
  * @brief Obtains the current WiFi connection status.
  *
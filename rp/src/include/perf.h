@@ -0,0 +1,138 @@
+/**
+ * File: perf.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the runtime performance counters
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "constants.h"
+#include "debug.h"
+#include "hardware/regs/m0plus.h"
+#include "hardware/structs/systick.h"
+#include "pico/stdlib.h"
+#include "trace.h"
+
+// SysTick is a 24-bit down counter at the system clock
+#define PERF_SYSTICK_MASK 0x00FFFFFF
+
+#define PERF_MIRROR_MS 1000  // Refresh of the counters for the computer
+
+typedef enum {
+  PERF_TIMER_IRQ = 0,     // Protocol DMA interrupt. Time in CPU cycles.
+  PERF_TIMER_DISPLAY,     // display_refresh()
+  PERF_TIMER_FLASH_ERASE,
+  PERF_TIMER_FLASH_PROGRAM,
+  PERF_TIMER_SD_READ,
+  PERF_TIMER_SD_WRITE,
+  PERF_TIMER_DOWNLOAD,    // Whole downloads, from the request to the end
+  PERF_TIMERS_COUNT
+} perf_timer_id_t;
+
+typedef enum {
+  PERF_EVENT_COMMANDS = 0,  // Protocol commands parsed
+  PERF_EVENT_DROPPED,       // Overwritten before the main loop read them
+  PERF_EVENT_CHECKSUM,      // Checksum errors
+  PERF_EVENTS_COUNT
+} perf_event_id_t;
+
+typedef struct {
+  uint32_t count;
+  uint64_t total;  // Microseconds, or cycles for PERF_TIMER_IRQ
+  uint32_t max;
+  uint64_t bytes;  // Transferred, for the flash, the SD card and downloads
+} perf_timer_t;
+
+// Order of the 32-bit shared variables written by perf_mirror()
+typedef enum {
+  PERF_SHARED_IRQ_COUNT = 0,
+  PERF_SHARED_IRQ_MAX_CYCLES,
+  PERF_SHARED_COMMANDS,
+  PERF_SHARED_DROPPED,
+  PERF_SHARED_CHECKSUM,
+  PERF_SHARED_DISPLAY_COUNT,
+  PERF_SHARED_DISPLAY_MAX_US,
+  PERF_SHARED_SD_READ_KB,
+  PERF_SHARED_SD_WRITE_KB,
+  PERF_SHARED_DOWNLOAD_KBS,  // Average of the downloads, in KB/s
+  PERF_SHARED_COUNT
+} perf_shared_t;
+
+/**
+ * @brief Clears the counters and starts SysTick to count the cycles of the
+ * interrupts of this core.
+ */
+void perf_init(void);
+
+/**
+ * @brief Adds a measure to a timer.
+ *
+ * @param id Timer.
+ * @param elapsed Microseconds, or cycles for PERF_TIMER_IRQ.
+ * @param bytes Bytes transferred meanwhile, or 0.
+ */
+void perf_add(perf_timer_id_t id, uint32_t elapsed, uint32_t bytes);
+
+/**
+ * @brief Returns a start time for perf_stop().
+ */
+static inline uint32_t perf_start(void) { return time_us_32(); }
+
+/**
+ * @brief Adds the time elapsed since start to a timer.
+ *
+ * @param id Timer.
+ * @param start Value returned by perf_start().
+ * @param bytes Bytes transferred meanwhile, or 0.
+ */
+void perf_stop(perf_timer_id_t id, uint32_t start, uint32_t bytes);
+
+/**
+ * @brief Returns a cycle count for perf_irqStop(), for code too short for
+ * microseconds. Only within the same core.
+ */
+static inline uint32_t perf_irqStart(void) { return systick_hw->cvr; }
+
+/**
+ * @brief Adds an entry of the protocol interrupt and the cycles spent since
+ * start. Runs from RAM.
+ */
+void perf_irqStop(uint32_t start);
+
+/**
+ * @brief Counts an event. Runs from RAM.
+ */
+void perf_count(perf_event_id_t id);
+
+/**
+ * @brief Returns a timer.
+ */
+const perf_timer_t *perf_getTimer(perf_timer_id_t id);
+
+/**
+ * @brief Returns the count of an event.
+ */
+uint32_t perf_getCount(perf_event_id_t id);
+
+/**
+ * @brief Clears the counters.
+ */
+void perf_reset(void);
+
+/**
+ * @brief Writes the counters as 32-bit shared variables the computer can
+ * read, in the order of perf_shared_t.
+ *
+ * @param address Address of the first shared variable.
+ */
+void perf_mirror(uint32_t address);
+
+#endif  // PERF_H
@@ -0,0 +1,159 @@
+/**
+ * File: profile.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the clock and voltage profiles of each computer
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aconfig.h"
+#include "arena.h"
+#include "constants.h"
+#include "debug.h"
+#include "dmacopy.h"
+#include "hardware/clocks.h"
+#include "hardware/uart.h"
+#include "hardware/vreg.h"
+#include "pico/stdlib.h"
+
+// Value of the PROFILE setting that chooses from the computer reported
+#define PROFILE_AUTO "auto"
+
+// Profiles. Name, system clock in kHz, core voltage and delay cycles of the
+// bus instructions of romemul_read (0 to 3, see romemul.pio). The state
+// machines run at the system clock divided by SAMPLE_DIV_FREQ in all of
+// them, as a divider below 1 does not exist: the clock and the delay cycles
+// set the time of the bus. compat are the values of the previous releases,
+// for the ST, the STE, the Mega STE and any computer not reported. The TT
+// and the Falcon need the answer sooner.
+#define PROFILE_TABLE(X)                                                \
+  X(PROFILE_COMPAT, "compat", RP2040_CLOCK_FREQ_KHZ, RP2040_VOLTAGE, 3) \
+  X(PROFILE_FAST, "fast", 250000, VREG_VOLTAGE_1_20, 2)
+
+#define PROFILE_ENUM(id, name, khz, voltage, waitCycles) id,
+typedef enum { PROFILE_TABLE(PROFILE_ENUM) PROFILE_COUNT } profile_id_t;
+#undef PROFILE_ENUM
+
+typedef struct {
+  const char *name;
+  uint32_t clockKhz;
+  enum vreg_voltage voltage;
+  uint8_t waitCycles;
+} profile_t;
+
+// Computer reported by the setup program, the _MCH cookie of TOS. The high
+// word is the family, the low word the model in the family.
+#define PROFILE_MACHINE_UNKNOWN (-1)
+#define PROFILE_MACHINE_ST 0x00000000
+#define PROFILE_MACHINE_STE 0x00010000
+#define PROFILE_MACHINE_MEGASTE 0x00010010
+#define PROFILE_MACHINE_TT 0x00020000
+#define PROFILE_MACHINE_FALCON 0x00030000
+#define PROFILE_MACHINE_FAMILY(model) ((uint32_t)(model) >> 16)
+
+// Validation of a profile. Uses a buffer of the scratch arena.
+#define PROFILE_BENCH_BYTES 8192
+#define PROFILE_BENCH_PASSES 8
+#define PROFILE_CLOCK_TOLERANCE 100  // The clock measured within 1/100
+#define PROFILE_VREG_SETTLE_US 1000  // After raising the voltage
+
+// Limits of the bus a profile is validated against. The commands of the
+// computer are answered in time from the clock of compat up, as noted in
+// main(). The read program, with the delay of the profile, must not sample
+// the address or release the data sooner than with the delays of fast.
+#define PROFILE_COMMAND_MIN_KHZ RP2040_CLOCK_FREQ_KHZ
+#define PROFILE_ADDRESS_MIN_NS 45
+#define PROFILE_RELEASE_MIN_NS 35
+
+typedef struct {
+  bool run;
+  bool passed;
+  uint32_t measuredKhz;  // Frequency counter of clk_sys
+  uint32_t ramKbs;       // Pattern written and checked in RAM
+  uint32_t flashKbs;     // Flash read without cache, checked with the DMA
+  uint32_t errors;       // Words that did not match
+  uint32_t addressNs;    // From the read signal to the address sampled
+  uint32_t releaseNs;    // From the data on the bus to its release
+} profile_bench_t;
+
+/**
+ * @brief Chooses the profile from the settings and the computer reported in
+ * the last setup, applies it and validates it. Falls back to compat if the
+ * validation fails. Call it from main(), after the settings are loaded and
+ * before any peripheral but the debug UART is set up.
+ */
+void profile_init(void);
+
+/**
+ * @brief Returns the profile running.
+ */
+const profile_t *profile_get(void);
+
+/**
+ * @brief Returns the profile of a name, or NULL if there is none.
+ */
+const profile_t *profile_find(const char *name);
+
+/**
+ * @brief Returns the profile of a computer.
+ *
+ * @param model Value of the _MCH cookie, or PROFILE_MACHINE_UNKNOWN.
+ */
+const profile_t *profile_forMachine(int32_t model);
+
+/**
+ * @brief Returns the name of a computer, for the terminal.
+ */
+const char *profile_getMachineName(int32_t model);
+
+/**
+ * @brief Returns the computer the current profile was chosen for, from the
+ * settings at boot.
+ */
+int32_t profile_getMachine(void);
+
+/**
+ * @brief Returns true if the profile was chosen from the computer.
+ */
+bool profile_isAuto(void);
+
+/**
+ * @brief Validates the profile running: the clock against the frequency
+ * counter and the limits of the bus, with the times of the read program of
+ * the profile, a RAM pattern and the flash read without cache. Takes a few
+ * milliseconds.
+ *
+ * @param bench Filled with the results.
+ * @return true if all passed.
+ */
+bool profile_bench(profile_bench_t *bench);
+
+/**
+ * @brief Returns the validation made at boot.
+ */
+const profile_bench_t *profile_getBootBench(void);
+
+/**
+ * @brief Takes note of the computer reported by the setup program. Called
+ * from the protocol command, so it only stores it.
+ */
+void profile_reportMachine(uint32_t value);
+
+/**
+ * @brief Returns true once for each computer reported, to save it in the
+ * settings for the next boot.
+ *
+ * @param value Set to the computer reported.
+ */
+bool profile_takeReportedMachine(int32_t *value);
+
+#endif  // PROFILE_H
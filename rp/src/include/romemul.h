@@ -12,21 +12,80 @@
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "../../build/romemul.pio.h"
+#include "aconfig.h"
 #include "constants.h"
 #include "debug.h"
 #include "hardware/dma.h"
 #include "hardware/pio.h"
 #include "hardware/structs/bus_ctrl.h"
+#include "hardware/structs/timer.h"
+#include "hardware/sync.h"
 #include "hardware/vreg.h"
 #include "memfunc.h"
 #include "pico/stdlib.h"
+#include "profile.h"
 
 #define ROMEMUL_BUS_BITS 17
 
 #define ROMEMUL_DMA_IRQ (DMA_IRQ_1)  // Use DMA IRQ 1 for ROM emulator
 
+// Delay field of the instructions of romemul_read. With .side_set 2 opt,
+// two bits of the five are left for the delay.
+#define ROMEMUL_READ_DELAY_SHIFT 8
+#define ROMEMUL_READ_DELAY_MASK (0x3u << ROMEMUL_READ_DELAY_SHIFT)
+#define ROMEMUL_READ_MAX_INSTRUCTIONS 32
+
+// A nop is assembled as mov y, y. The mask leaves out the side-set and the
+// delay.
+#define ROMEMUL_READ_NOP 0xA042u
+#define ROMEMUL_READ_NOP_MASK 0xE0FFu
+
+// PIO interrupt raised by the monitors of !ROM3 and !ROM4 (see romemul.pio)
+#define ROMEMUL_BUS_IRQ 2
+// Longest wait for the read program to end an access before a swap
+#define ROMEMUL_SWAP_TIMEOUT_US 1000
+
+// Value of the ROM_TIMING setting that takes the delay from the clock profile
+#define ROMEMUL_TIMING_AUTO "auto"
+
+// Timing variants of romemul_read, all built from the program in
+// romemul.pio when it is loaded. Name, padding nops kept in each of the two
+// blocks (1 to 3) and delay cycles of the bus instructions (0 to 3). From
+// the safest, the program as written, to the tightest.
+#define ROMEMUL_TIMING_TABLE(X)            \
+  X(ROMEMUL_TIMING_SAFE, "safe", 3, 3)     \
+  X(ROMEMUL_TIMING_NORMAL, "normal", 3, 2) \
+  X(ROMEMUL_TIMING_QUICK, "quick", 2, 2)   \
+  X(ROMEMUL_TIMING_FAST, "fast", 2, 1)     \
+  X(ROMEMUL_TIMING_TIGHT, "tight", 1, 1)
+
+#define ROMEMUL_TIMING_ENUM(id, name, nops, waitCycles) id,
+typedef enum {
+  ROMEMUL_TIMING_TABLE(ROMEMUL_TIMING_ENUM) ROMEMUL_TIMING_COUNT
+} romemul_timing_id_t;
+#undef ROMEMUL_TIMING_ENUM
+
+typedef struct {
+  const char *name;
+  uint8_t nops;        // Padding nops kept in each block
+  uint8_t waitCycles;  // Delay of the bus instructions
+} romemul_timing_t;
+
+// Each variant of the bus margin test runs this long
+#define ROMEMUL_MARGIN_TEST_MS 3000
+
+// Capture of the bus. Two DMA channels chained after the lookup of the data
+// copy the address read and the time of the read into two rings, before the
+// next address is read. Each ring is aligned to its size.
+typedef struct {
+  uint32_t *addresses;  // As read from the PIO: bit 16 is !ROM4 inverted
+  uint32_t *times;      // time_us_32() of each read
+  uint ringBits;        // Bytes of each ring, as a power of two
+} romemul_capture_t;
+
 typedef void (*IRQInterceptionCallback)();
 
 // extern int read_addr_rom_dma_channel;
@@ -36,6 +95,53 @@ typedef void (*IRQInterceptionCallback)();
 int init_romemul(IRQInterceptionCallback requestCallback,
                  IRQInterceptionCallback responseCallback, bool copyFlashToRAM);
 
+/**
+ * @brief Returns a timing variant of the table.
+ */
+const romemul_timing_t *romemul_getTimingVariant(romemul_timing_id_t id);
+
+/**
+ * @brief Returns the timing of a name, or NULL if there is none. auto is the
+ * delay of the clock profile with all the nops.
+ */
+const romemul_timing_t *romemul_findTiming(const char *name);
+
+/**
+ * @brief Returns the timing of the read program loaded, or NULL before
+ * init_romemul().
+ */
+const romemul_timing_t *romemul_getTiming(void);
+
+/**
+ * @brief PIO cycles from the read signal to the address sampled, and from
+ * the data on the bus to its release.
+ */
+uint32_t romemul_getAddressCycles(const romemul_timing_t *timing);
+uint32_t romemul_getReleaseCycles(const romemul_timing_t *timing);
+
+/**
+ * @brief Loads the read program again with another timing, between two
+ * accesses of the computer. For the bus margin test. The variant is built
+ * first, and the interrupts are only masked while the programs are swapped.
+ * The monitors of the bus are stopped meanwhile, so no access is cut.
+ *
+ * @return false if the emulator is not running, the read program does not
+ * end its access in ROMEMUL_SWAP_TIMEOUT_US, or the program does not fit.
+ */
+bool romemul_setTiming(const romemul_timing_t *timing);
+
+/**
+ * @brief Records the accesses of the computer in the rings of capture from
+ * the next init_romemul(). Call it before.
+ */
+void romemul_setCapture(const romemul_capture_t *capture);
+
+/**
+ * @brief Returns the slot of the rings of capture the DMA writes next. The
+ * slots before it are complete.
+ */
+uint32_t romemul_getCaptureIndex(void);
+
 void dma_irqHandlerLookup(void);
 void dma_irqHandlerAddress(void);
 
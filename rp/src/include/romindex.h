@@ -0,0 +1,105 @@
+/**
+ * File: romindex.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the persistent SD card ROM directory index
+ */
+
+#ifndef ROMINDEX_H
+#define ROMINDEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "constants.h"
+#include "debug.h"
+#include "ff.h"
+
+#define ROMINDEX_FILENAME ".romindex"
+#define ROMINDEX_TMP_FILENAME ".romindex.tmp"
+#define ROMINDEX_MAGIC 0x58444952  // "RIDX" in little endian
+#define ROMINDEX_VERSION 2
+#define ROMINDEX_NAME_LENGTH 36  // Same as MAX_FILENAME_LENGTH in emul.h
+#define ROMINDEX_PATH_SIZE 128
+#define ROMINDEX_MAX_ENTRIES 16384  // Keeps the rescan bitmap under 2KB
+#define ROMINDEX_MERGE_CHUNK 64     // New entries merged per rescan pass
+
+typedef enum {
+  ROMINDEX_OK = 0,       // Index is up to date
+  ROMINDEX_UPDATED = 1,  // Index rescanned and written back
+  ROMINDEX_DIR_ERROR = -1,
+  ROMINDEX_WRITE_ERROR = -2,
+  ROMINDEX_MEMORY_ERROR = -3,
+  ROMINDEX_READ_ERROR = -4
+} romindex_status_t;
+
+// On-disk header. The index is valid while the files of the folder match
+// the signature. A zero signature is never valid.
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t dirFiles;  // Files of the folder when the index was written
+  uint32_t dirHash;   // Sum of the hashes of their names
+  uint32_t count;     // Number of entries following the header
+} romindex_header_t;
+
+// On-disk entry. Entries are stored sorted case-insensitively.
+typedef struct {
+  char filename[ROMINDEX_NAME_LENGTH];
+} romindex_entry_t;
+
+// Returns non-zero if the file must be part of the index
+typedef int (*romindex_filter_t)(const char *filename);
+
+/**
+ * @brief Brings the index of a folder up to date.
+ *
+ * The directory is read once to sign the files accepted by the filter: their
+ * count and the sum of the hashes of their names. The timestamp of a folder
+ * is not updated when files are added or removed, so it cannot be trusted.
+ * If the index file stored in the folder has the same signature, nothing is
+ * read but the header. Otherwise the index is updated incrementally on the
+ * SD card: entries no longer present are dropped and new files are merged in
+ * sorted order. The entries never have to fit in RAM; new files are merged
+ * in chunks of ROMINDEX_MERGE_CHUNK.
+ *
+ * @param folder Folder with the ROM files.
+ * @param filter Callback deciding which filenames are indexed.
+ * @param count Pointer where the number of entries in the index is stored.
+ * @return romindex_status_t ROMINDEX_OK or ROMINDEX_UPDATED on success, or a
+ * negative error code.
+ */
+romindex_status_t romindex_sync(const char *folder, romindex_filter_t filter,
+                                int *count);
+
+/**
+ * @brief Reads a range of consecutive sorted entries from the index.
+ *
+ * Seeks straight to the first entry requested, so reading any page costs the
+ * same regardless of the size of the index.
+ *
+ * @param folder Folder with the ROM files.
+ * @param first Position of the first entry to read.
+ * @param entries Array to fill with the entries.
+ * @param maxEntries Number of entries to read.
+ * @return int Number of entries read, or a negative romindex_status_t code.
+ */
+int romindex_readEntries(const char *folder, int first,
+                         romindex_entry_t *entries, int maxEntries);
+
+/**
+ * @brief Marks the index of a folder as stale.
+ *
+ * Clears the signature, so the next sync rescans the folder even if the
+ * names of the files are the same. Called after the firmware writes to the
+ * folder, e.g. a download.
+ *
+ * @param folder Folder with the ROM files.
+ */
+void romindex_invalidate(const char *folder);
+
+#endif  // ROMINDEX_H
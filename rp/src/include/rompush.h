@@ -0,0 +1,105 @@
+/**
+ * File: rompush.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the HTTP endpoint that loads a ROM image pushed
+ * over the network straight into the RAM of the ROM emulation
+ */
+
+#ifndef ROMPUSH_H
+#define ROMPUSH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "constants.h"
+#include "debug.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "lwip/altcp.h"
+#include "pico/cyw43_arch.h"
+#include "pico/stdlib.h"
+#include "worker.h"
+
+#define ROMPUSH_PORT 80
+#define ROMPUSH_PATH "/rom"
+#define ROMPUSH_PERSIST_QUERY "persist=1"  // Also program the flash
+#define ROMPUSH_HEAD_SIZE 512              // Request line and headers
+#define ROMPUSH_ANSWER_SIZE 160
+#define ROMPUSH_MAX_SIZE (ROM_SIZE_BYTES * ROM_BANKS)
+#define ROMPUSH_HEADER_SIZE 4  // Zeroed header of STEEM cartridge images
+
+// The TCP poll callback runs every ROMPUSH_POLL_INTERVAL coarse TCP timer
+// ticks of 500 ms
+#define ROMPUSH_POLL_INTERVAL 2
+#define ROMPUSH_POLL_MS 1000
+#define ROMPUSH_TIMEOUT_MS (10 * SEC_TO_MS)  // Without any data
+
+typedef enum {
+  ROMPUSH_OK = 0,
+  ROMPUSH_LISTEN_ERROR = -1
+} rompush_result_t;
+
+typedef enum {
+  ROMPUSH_STATE_CLOSED,      // Not listening
+  ROMPUSH_STATE_LISTENING,   // Waiting for a client
+  ROMPUSH_STATE_HEAD,        // Receiving the request line and headers
+  ROMPUSH_STATE_BODY,       // Writing the image in the RAM
+  ROMPUSH_STATE_PERSISTING  // Image loaded, waiting to program the flash
+} rompush_state_t;
+
+// Last image pushed
+typedef struct {
+  uint32_t bytes;      // Bytes of the image, without the header
+  uint32_t receiveUs;  // From the end of the headers to the last byte
+  uint32_t persistUs;  // Programming the flash. 0 if not persisted.
+  uint32_t sectors;    // Sectors programmed. Unchanged ones are skipped.
+  uint32_t pushes;     // Images loaded since the endpoint started
+} rompush_stats_t;
+
+/**
+ * @brief Starts listening for ROM images, on every interface. Can be called
+ * before the network is connected.
+ *
+ * An image is sent with PUT or POST to ROMPUSH_PATH, e.g. with
+ * `curl -T cart.img http://<address>/rom`. Its body is byte-swapped and
+ * written into the RAM the ROM emulation reads from as it arrives, so the
+ * computer sees the new ROM after a reset. A STEEM cartridge image header is
+ * dropped, and the rest of the RAM is cleared. With the ROMPUSH_PERSIST_QUERY
+ * query the image is also programmed into the flash, so it survives a power
+ * cycle, reprogramming only the sectors that changed. The answer reports the
+ * time spent receiving and persisting.
+ *
+ * Only one image is received at a time. The RAM holds a partial image if the
+ * client stops sending before the end.
+ *
+ * @param port TCP port to listen on.
+ * @param flashAddress Address of the flash area of the ROM, for the images
+ * persisted.
+ * @return ROMPUSH_OK if listening.
+ */
+rompush_result_t rompush_start(uint16_t port, uint32_t flashAddress);
+
+/**
+ * @brief Completes the image received, from the main loop: programs it into
+ * the flash if asked, out of the lwIP callbacks, and answers the client.
+ *
+ * @return true if a new image was loaded since the last call.
+ */
+bool rompush_poll(void);
+
+/**
+ * @brief Stops listening and closes the client connection, if any.
+ */
+void rompush_stop(void);
+
+/**
+ * @brief Returns the timing of the last image loaded.
+ */
+const rompush_stats_t *rompush_getStats(void);
+
+#endif  // ROMPUSH_H
@@ -0,0 +1,131 @@
+/**
+ * File: romsearch.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the inverted search index of the ROM catalog
+ */
+
+#ifndef ROMSEARCH_H
+#define ROMSEARCH_H
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constants.h"
+#include "debug.h"
+#include "extsort.h"
+#include "ff.h"
+#include "worker.h"
+
+#define ROMSEARCH_MAGIC 0x48435352  // "RSCH" in little endian
+#define ROMSEARCH_VERSION 1
+#define ROMSEARCH_TOKEN_LENGTH 16  // Longer words are indexed truncated
+#define ROMSEARCH_MIN_TOKEN 2      // Shorter words are not indexed
+#define ROMSEARCH_MAX_TERMS 4      // Words of a query. The rest are ignored.
+#define ROMSEARCH_MAX_RECORDS 4096  // Records of the catalog searchable
+#define ROMSEARCH_TAG_PREFIX '#'   // Marks the words of the tags
+
+typedef enum {
+  ROMSEARCH_OK = 0,
+  ROMSEARCH_OPEN_ERROR = -1,
+  ROMSEARCH_READ_ERROR = -2,
+  ROMSEARCH_WRITE_ERROR = -3,
+  ROMSEARCH_MEMORY_ERROR = -4,
+  ROMSEARCH_QUERY_ERROR = -5
+} romsearch_status_t;
+
+// Identifies the version of the catalog indexed. The index is stale when any
+// field differs from the catalog opened.
+typedef struct {
+  uint32_t count;  // Number of records of the catalog
+  uint32_t size;   // Size of the catalog file
+  uint16_t date;   // FAT date of the source of the catalog
+  uint16_t time;   // FAT time of the source of the catalog
+} romsearch_stamp_t;
+
+// On-disk header, followed by the postings sorted by token and record
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t tokenLength;
+  uint32_t count;  // Number of postings
+  romsearch_stamp_t stamp;
+} romsearch_header_t;
+
+// On-disk posting: a lowercase word of the name, or of the tags prefixed with
+// ROMSEARCH_TAG_PREFIX, and the position of the record in the catalog.
+typedef struct {
+  char token[ROMSEARCH_TOKEN_LENGTH];
+  uint32_t record;
+} romsearch_posting_t;
+
+// Returns the name and tags of the next record of the catalog, in order.
+// Returns false when there are no more records.
+typedef bool (*romsearch_next_t)(const char **name, const char **tags,
+                                 void *context);
+
+/**
+ * @brief Builds the search index of a catalog.
+ *
+ * Splits the name and tags of each record in words, and sorts the postings
+ * with an external merge sort on the SD card, so the RAM used does not depend
+ * on the size of the catalog.
+ *
+ * @param idxPath Path of the index file.
+ * @param tmpPathA Path of the first temporary file of the sort.
+ * @param tmpPathB Path of the second temporary file of the sort.
+ * @param stamp Version of the catalog indexed.
+ * @param next Producer of the records of the catalog.
+ * @param context Context passed to the producer.
+ * @return romsearch_status_t ROMSEARCH_OK on success, or an error code.
+ */
+romsearch_status_t romsearch_build(const char *idxPath, const char *tmpPathA,
+                                   const char *tmpPathB,
+                                   const romsearch_stamp_t *stamp,
+                                   romsearch_next_t next, void *context);
+
+/**
+ * @brief Checks the index file was built for a version of the catalog.
+ *
+ * @param idxPath Path of the index file.
+ * @param stamp Version of the catalog opened.
+ * @return true if the index can be queried, false if missing or stale.
+ */
+bool romsearch_isValid(const char *idxPath, const romsearch_stamp_t *stamp);
+
+/**
+ * @brief Finds the records matching all the words of a query.
+ *
+ * Each word of the query matches the words of the name or the tags starting
+ * with it. A word starting with ROMSEARCH_TAG_PREFIX only matches the tags.
+ * Each word costs a binary search and a sequential scan of the postings
+ * matching it.
+ *
+ * @param idxPath Path of the index file.
+ * @param query Words to search, separated by spaces.
+ * @param results Array to fill with the records found, in catalog order.
+ * @param maxResults Size of the results array.
+ * @param count Pointer where the number of records found is stored.
+ * @param truncated Pointer set to true if more records than maxResults match.
+ * @return romsearch_status_t ROMSEARCH_OK on success, or an error code.
+ */
+romsearch_status_t romsearch_query(const char *idxPath, const char *query,
+                                   uint16_t *results, int maxResults,
+                                   int *count, bool *truncated);
+
+/**
+ * @brief Checks a record matches all the words of a query, without index.
+ *
+ * Same matching rules as romsearch_query, for catalogs not indexed.
+ *
+ * @param query Words to search, separated by spaces.
+ * @param name Name of the record.
+ * @param tags Tags of the record.
+ * @return true if all the words of the query match.
+ */
+bool romsearch_matches(const char *query, const char *name, const char *tags);
+
+#endif  // ROMSEARCH_H
@@ -0,0 +1,114 @@
+/**
+ * File: sdcal.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the benchmark and the calibration of the SPI clock
+ * of the SD card. Only for the firmware: it needs the SPI and the disk
+ * access of the SD card driver.
+ */
+
+#ifndef SDCAL_H
+#define SDCAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "constants.h"
+#include "debug.h"
+#include "diskio.h"
+#include "hardware/clocks.h"
+#include "hardware/spi.h"
+#include "pico/stdlib.h"
+#include "sd_card.h"
+#include "sdcard.h"
+#include "select.h"
+
+// Benchmark and calibration of the SPI clock, over a scratch file
+#define SDCAL_SCRATCH_FILE "/.sdbench"
+#define SDCAL_BENCH_CHUNK 16384  // 32 sectors per multi-block transfer
+#define SDCAL_BENCH_SIZE SDCARD_MEGABYTE  // Sequential transfers
+#define SDCAL_BENCH_RANDOM_SIZE 4096
+#define SDCAL_BENCH_RANDOM_COUNT 128
+#define SDCAL_CALIBRATION_SIZE 65536
+#define SDCAL_CALIBRATION_PASSES 3
+#define SDCAL_CALIBRATION_MAX_KB 50000  // SD high speed limit
+#define SDCAL_CALIBRATION_FIELDS 2      // Card id and clock
+
+typedef enum {
+  SDCAL_OK = 0,
+  SDCAL_NOMEM_ERROR = -1,
+  SDCAL_FILE_ERROR = -2,    // Cannot create the scratch file
+  SDCAL_IO_ERROR = -3,      // A read or write failed
+  SDCAL_VERIFY_ERROR = -4,  // Data read back is not the one written
+  SDCAL_MOUNT_ERROR = -5    // Cannot mount again after a failure
+} sdcal_status_t;
+
+// Throughput in KB per second
+typedef struct {
+  uint32_t baudRateKb;  // SPI clock
+  uint32_t seqWriteKbs;
+  uint32_t seqReadKbs;
+  uint32_t randReadKbs;  // SDCAL_BENCH_RANDOM_SIZE blocks
+  uint32_t randWriteKbs;
+} sdcal_bench_t;
+
+/**
+ * @brief Returns the SPI clock in use, in kilobits per second.
+ */
+uint32_t sdcal_getSpiSpeed(void);
+
+/**
+ * @brief Identifies the card inserted, with a hash of its CID register.
+ *
+ * @return The hash of the CID. Zero if there is no card.
+ */
+uint32_t sdcal_getCardId(void);
+
+/**
+ * @brief Measures the sequential and random throughput of the card at the
+ * current SPI clock, through the file system.
+ *
+ * Writes and reads back SDCAL_BENCH_SIZE bytes in multi-block transfers,
+ * then reads and writes SDCAL_BENCH_RANDOM_COUNT blocks at random offsets.
+ * The sequential data read back is checked with a CRC-32. Only the time spent
+ * in the file system is measured. The scratch file is deleted at the end.
+ *
+ * @param path Scratch file to use.
+ * @param bench Where to store the throughput.
+ * @return SDCAL_OK, or the error that stopped the benchmark.
+ */
+sdcal_status_t sdcal_bench(const char *path, sdcal_bench_t *bench);
+
+/**
+ * @brief Finds the fastest SPI clock the card works reliably with.
+ *
+ * Steps the clock up from the current one, through the rates the SPI can
+ * generate up to SDCAL_CALIBRATION_MAX_KB. At each step, multi-block writes
+ * and reads of a contiguous scratch file are checked with a CRC-32,
+ * SDCAL_CALIBRATION_PASSES times. The sectors of the file are accessed
+ * directly, so a failing clock cannot damage the file system. At the first
+ * failure the card is mounted again at the last good clock, which is kept.
+ *
+ * @param fsPtr File system of the card, to mount it again after a failure.
+ * @param path Scratch file to use.
+ * @param record Buffer for the result, for sdcal_applyCalibration().
+ * @param size Size of the buffer.
+ * @return SDCAL_OK if a clock was chosen, even the current one.
+ */
+sdcal_status_t sdcal_calibrate(FATFS *fsPtr, const char *path, char *record,
+                               size_t size);
+
+/**
+ * @brief Applies the clock of a calibration, if it was made with the card
+ * inserted. Call it after mounting the file system.
+ *
+ * @param record Result of sdcal_calibrate(). Ignored if empty, invalid or of
+ * another card.
+ * @return true if the clock was applied.
+ */
+bool sdcal_applyCalibration(const char *record);
+
+#endif  // SDCAL_H
@@ -95,6 +95,18 @@ void sdcard_setSpiSpeedSettings();
  */
 void sdcard_getInfo(FATFS *fsPtr, uint32_t *totalSizeMb, uint32_t *freeSpaceMb);
 
+/**
+ * @brief Retrieve the free space of the SD card in bytes.
+ *
+ * Same as sdcard_getInfo() but without rounding down to megabytes, to check if
+ * a file fits before writing it.
+ *
+ * @param freeBytes Pointer to a variable where the free space is stored. Zero
+ * on error.
+ * @return FRESULT FR_OK on success, or the error of f_getfree.
+ */
+FRESULT sdcard_getFreeBytes(uint64_t *freeBytes);
+
 // Hardware Configuration of SPI "objects"
 
 // NOLINTBEGIN(readability-identifier-naming)
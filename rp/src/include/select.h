@@ -11,29 +11,48 @@
 
 #include "constants.h"
 #include "debug.h"
-#include "pico/multicore.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "pico/stdlib.h"
+#include "trace.h"
 
-#define SELECT_LOOP_DELAY 10  // 10 ms
+#define SELECT_DEBOUNCE_US 20000  // Contacts bouncing after an edge
 
 #define SELECT_LONG_RESET 10000  // 10 seconds
 
+#define SELECT_EVENT_QUEUE_SIZE 8
+
 // Define a callback typdef for the reset function
 typedef void (*reset_callback_t)();
 
+typedef enum {
+  SELECT_EVENT_PRESS,
+  SELECT_EVENT_RELEASE,
+  SELECT_EVENT_LONG  // Held for SELECT_LONG_RESET ms. Released later.
+} select_event_type_t;
+
+typedef struct {
+  select_event_type_t type;
+  uint32_t timeUs;      // Of the first edge, from time_us_32()
+  uint32_t durationUs;  // Since the press. 0 for SELECT_EVENT_PRESS.
+} select_event_t;
+
 /**
  * @brief Initializes the SELECT detection.
  *
  * Configures the hardware and software parameters needed for detecting
- * the SELECT button press. Always call first.
+ * the SELECT button press, and enables the interrupt on both edges. The
+ * edges are debounced and queued as timestamped events. Always call first.
  */
 void select_configure();
 
 /**
  * @brief Waits for button release.
  *
- * Blocks execution until the SELECT button is released. Ensures the user’s
- * push is fully handled.
+ * Sleeps until the SELECT button is released, or held long enough for a
+ * long press, and invokes the short or long press callback. Ensures the
+ * user’s push is fully handled.
  */
 void select_waitPush();
 
@@ -47,11 +66,25 @@ void select_waitPush();
 bool select_detectPush();
 
 /**
- * @brief Waits for push in secondary core.
+ * @brief Gets the next event of the SELECT button.
  *
- * Launches an asynchronous wait for a SELECT button push on the secondary core.
- * Accepts two callbacks: one for short press reset and one for long press
- * reset.
+ * @param event Filled with the oldest event not read yet.
+ * @return true if there was an event.
+ */
+bool select_getEvent(select_event_t *event);
+
+/**
+ * @brief Sleeps in __wfi until the next interrupt, of the SELECT button or
+ * any other. Returns right away if there are events not read yet.
+ */
+void select_sleep();
+
+/**
+ * @brief Waits for push in the background.
+ *
+ * Registers the callbacks invoked by select_poll(): one for short press
+ * reset and one for long press reset. The presses are detected by the
+ * interrupt, so the secondary core is free for other work.
  *
  * @param reset Callback to be invoked on a short button press.
  * @param resetLong Callback to be invoked on a long button press.
@@ -59,14 +92,22 @@ bool select_detectPush();
 void select_coreWaitPush(reset_callback_t reset, reset_callback_t resetLong);
 
 /**
- * @brief Disables secondary core wait.
+ * @brief Disables the background wait.
  *
- * Disables waiting for the SELECT button push on the secondary core.
- *
- * Useful to cancel or adjust the handling in multicore scenarios.
+ * Disables the interrupt of the SELECT button and forgets any event not
+ * read yet.
  */
 void select_coreWaitPushDisable();
 
+/**
+ * @brief Handles the events of the SELECT button.
+ *
+ * Invokes the short press callback when the button is released, and the
+ * long press callback as soon as it has been held for SELECT_LONG_RESET ms,
+ * without waiting for the release. Never blocks. Call it from the main loop.
+ */
+void select_poll();
+
 /**
  * @brief Monitors for reset trigger.
  *
@@ -1,50 +1,50 @@
 const uint16_t target_firmware[] = {
-    0xABCD, 0xEF42, 0x0000, 0x0000, 0x08FA, 0x001E, 0x0000, 0x0000, 0x9D80, 0x5B97, 0x0000, 0x058C, 0x5445, 0x524D, 0x0000, 0x3F3C,
-    0x0002, 0x4E4E, 0x548F, 0x2440, 0x45EA, 0xF000, 0x264A, 0x2C3C, 0x0000, 0x0564, 0x43F9, 0x00FA, 0x0046, 0xE44E, 0x5346, 0x24D9,
-    0x51CE, 0xFFFC, 0x4ED3, 0x2C40, 0x0038, 0x0008, 0x0484, 0x3F3C, 0x0004, 0x4E4E, 0x548F, 0xB07C, 0x0002, 0x6700, 0x0130, 0x3F3C,
-    0x0025, 0x4E4E, 0x548F, 0x204E, 0x227C, 0x00FA, 0x8000, 0x203C, 0x0000, 0x0F9F, 0x3219, 0xE159, 0x3401, 0x4842, 0x3401, 0x20C2,
-    0x20C2, 0x51C8, 0xFFF0, 0x2C39, 0x00FA, 0x9F40, 0xBCBC, 0x0000, 0x0003, 0x6664, 0x3F3C, 0x000B, 0x4E41, 0x548F, 0x4A80, 0x6700,
-    0x0054, 0x3F3C, 0x0008, 0x4E41, 0x548F, 0xB03C, 0x001B, 0x6700, 0x0026, 0x2600, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7204, 0x303C,
-    0x0001, 0x6100, 0x02F4, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0020, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7200,
-    0x303C, 0x0000, 0x6100, 0x02D2, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0092, 0xBCBC, 0x0000, 0x0001, 0x6700,
-    0x01EA, 0xBCBC, 0x0000, 0x0002, 0x6700, 0x01FE, 0x3F3C, 0xFFFF, 0x3F3C, 0x000B, 0x4E4D, 0x588F, 0x0800, 0x0001, 0x6600, 0x01EA,
-    0x0800, 0x0000, 0x6600, 0x01E2, 0x3F3C, 0x000B, 0x4E41, 0x548F, 0x4A80, 0x6700, 0x0054, 0x3F3C, 0x0008, 0x4E41, 0x548F, 0xB03C,
-    0x001B, 0x6700, 0x0026, 0x2600, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7204, 0x303C, 0x0001, 0x6100, 0x0260, 0x4CDF, 0x00FE, 0x4A40,
-    0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0020, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7200, 0x303C, 0x0000, 0x6100, 0x023E, 0x4CDF, 0x00FE,
-    0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0xFED4, 0x3F3C, 0x0025, 0x4E4E, 0x548F, 0x224E, 0x244E, 0x45EA, 0x0050, 0x207C, 0x00FA,
-    0x8000, 0x267C, 0x00FA, 0x1000, 0x203C, 0x0000, 0x00C7, 0x223C, 0x0000, 0x0013, 0x3418, 0xE15A, 0x3602, 0xC67C, 0xFF00, 0xEE4B,
-    0x3833, 0x3000, 0x4844, 0xC47C, 0x00FF, 0xD442, 0x3833, 0x2000, 0x22C4, 0x24C4, 0x51C9, 0xFFDE, 0x43E9, 0x0050, 0x45EA, 0x0050,
-    0x51C8, 0xFFCC, 0x2C39, 0x00FA, 0x9F40, 0xBCBC, 0x0000, 0x0003, 0x6664, 0x3F3C, 0x000B, 0x4E41, 0x548F, 0x4A80, 0x6700, 0x0054,
-    0x3F3C, 0x0008, 0x4E41, 0x548F, 0xB03C, 0x001B, 0x6700, 0x0026, 0x2600, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7204, 0x303C, 0x0001,
-    0x6100, 0x0196, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0020, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7200, 0x303C,
-    0x0000, 0x6100, 0x0174, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0092, 0xBCBC, 0x0000, 0x0001, 0x6700, 0x008C,
-    0xBCBC, 0x0000, 0x0002, 0x6700, 0x00A0, 0x3F3C, 0xFFFF, 0x3F3C, 0x000B, 0x4E4D, 0x588F, 0x0800, 0x0001, 0x6600, 0x008C, 0x0800,
-    0x0000, 0x6600, 0x0084, 0x3F3C, 0x000B, 0x4E41, 0x548F, 0x4A80, 0x6700, 0x0054, 0x3F3C, 0x0008, 0x4E41, 0x548F, 0xB03C, 0x001B,
-    0x6700, 0x0026, 0x2600, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7204, 0x303C, 0x0001, 0x6100, 0x0102, 0x4CDF, 0x00FE, 0x4A40, 0x6704,
-    0x51CF, 0xFFE8, 0x6000, 0x0020, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7200, 0x303C, 0x0000, 0x6100, 0x00E0, 0x4CDF, 0x00FE, 0x4A40,
-    0x6704, 0x51CF, 0xFFE8, 0x6000, 0xFEA4, 0x2C3C, 0x000F, 0xFFFF, 0x5386, 0x66FC, 0x42B8, 0x0420, 0x42B8, 0x043A, 0x42B8, 0x051A,
-    0x2078, 0x0004, 0x4ED0, 0x4E71, 0x4E75, 0x2038, 0x05A0, 0x6700, 0x001A, 0x2040, 0x2018, 0x6700, 0x0012, 0xB0BC, 0x5F4D, 0x4348,
-    0x6704, 0x5848, 0x60EE, 0x2818, 0x6002, 0x4284, 0x2F04, 0x263C, 0x0000, 0x0000, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7208, 0x303C,
-    0x0001, 0x6100, 0x0074, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x4A40, 0x6604, 0x201F, 0x4E75, 0x281F, 0x60CE, 0x3F3C,
-    0x0030, 0x4E41, 0x548F, 0xC0BC, 0x0000, 0xFFFF, 0x0C78, 0x00FC, 0x0004, 0x6608, 0x3239, 0x00FC, 0x0002, 0x6006, 0x3239, 0x00E0,
-    0x0002, 0xC2BC, 0x0000, 0xFFFF, 0x4841, 0x8081, 0x263C, 0x0000, 0x0001, 0x2800, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7208, 0x303C,
-    0x0001, 0x6100, 0x0014, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x4A40, 0x66A8, 0x4E75, 0x2439, 0x00FA, 0xF004, 0x5841,
+    0xABCD, 0xEF42, 0x0000, 0x0000, 0x08FA, 0x001E, 0x0000, 0x0000, 0x9D00, 0x5D50, 0x0000, 0x0588, 0x5445, 0x524D, 0x0000, 0x3F3C,
+    0x0002, 0x4E4E, 0x548F, 0x2440, 0x45EA, 0xF000, 0x264A, 0x2C3C, 0x0000, 0x0560, 0x43F9, 0x00FA, 0x0046, 0xE44E, 0x5346, 0x24D9,
+    0x51CE, 0xFFFC, 0x4ED3, 0x2C40, 0x6100, 0x02C4, 0x0038, 0x0008, 0x0484, 0x3F3C, 0x0004, 0x4E4E, 0x548F, 0xB07C, 0x0002, 0x6700,
+    0x0130, 0x3F3C, 0x0025, 0x4E4E, 0x548F, 0x204E, 0x227C, 0x00FA, 0x8000, 0x203C, 0x0000, 0x0F9F, 0x3219, 0xE159, 0x3401, 0x4842,
+    0x3401, 0x20C2, 0x20C2, 0x51C8, 0xFFF0, 0x2C39, 0x00FA, 0x9F40, 0xBCBC, 0x0000, 0x0003, 0x6664, 0x3F3C, 0x000B, 0x4E41, 0x548F,
+    0x4A80, 0x6700, 0x0054, 0x3F3C, 0x0008, 0x4E41, 0x548F, 0xB03C, 0x001B, 0x6700, 0x0026, 0x2600, 0x3E3C, 0x0003, 0x48E7, 0x7F00,
+    0x7204, 0x303C, 0x0001, 0x6100, 0x02EC, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0020, 0x3E3C, 0x0003, 0x48E7,
+    0x7F00, 0x7200, 0x303C, 0x0000, 0x6100, 0x02CA, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0092, 0xBCBC, 0x0000,
+    0x0001, 0x6700, 0x01EA, 0xBCBC, 0x0000, 0x0002, 0x6700, 0x01FE, 0x3F3C, 0xFFFF, 0x3F3C, 0x000B, 0x4E4D, 0x588F, 0x0800, 0x0001,
+    0x6600, 0x01EA, 0x0800, 0x0000, 0x6600, 0x01E2, 0x3F3C, 0x000B, 0x4E41, 0x548F, 0x4A80, 0x6700, 0x0054, 0x3F3C, 0x0008, 0x4E41,
+    0x548F, 0xB03C, 0x001B, 0x6700, 0x0026, 0x2600, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7204, 0x303C, 0x0001, 0x6100, 0x0258, 0x4CDF,
+    0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0020, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7200, 0x303C, 0x0000, 0x6100, 0x0236,
+    0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0xFED4, 0x3F3C, 0x0025, 0x4E4E, 0x548F, 0x224E, 0x244E, 0x45EA, 0x0050,
+    0x207C, 0x00FA, 0x8000, 0x267C, 0x00FA, 0x1000, 0x203C, 0x0000, 0x00C7, 0x223C, 0x0000, 0x0013, 0x3418, 0xE15A, 0x3602, 0xC67C,
+    0xFF00, 0xEE4B, 0x3833, 0x3000, 0x4844, 0xC47C, 0x00FF, 0xD442, 0x3833, 0x2000, 0x22C4, 0x24C4, 0x51C9, 0xFFDE, 0x43E9, 0x0050,
+    0x45EA, 0x0050, 0x51C8, 0xFFCC, 0x2C39, 0x00FA, 0x9F40, 0xBCBC, 0x0000, 0x0003, 0x6664, 0x3F3C, 0x000B, 0x4E41, 0x548F, 0x4A80,
+    0x6700, 0x0054, 0x3F3C, 0x0008, 0x4E41, 0x548F, 0xB03C, 0x001B, 0x6700, 0x0026, 0x2600, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7204,
+    0x303C, 0x0001, 0x6100, 0x018E, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0020, 0x3E3C, 0x0003, 0x48E7, 0x7F00,
+    0x7200, 0x303C, 0x0000, 0x6100, 0x016C, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0092, 0xBCBC, 0x0000, 0x0001,
+    0x6700, 0x008C, 0xBCBC, 0x0000, 0x0002, 0x6700, 0x00A0, 0x3F3C, 0xFFFF, 0x3F3C, 0x000B, 0x4E4D, 0x588F, 0x0800, 0x0001, 0x6600,
+    0x008C, 0x0800, 0x0000, 0x6600, 0x0084, 0x3F3C, 0x000B, 0x4E41, 0x548F, 0x4A80, 0x6700, 0x0054, 0x3F3C, 0x0008, 0x4E41, 0x548F,
+    0xB03C, 0x001B, 0x6700, 0x0026, 0x2600, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7204, 0x303C, 0x0001, 0x6100, 0x00FA, 0x4CDF, 0x00FE,
+    0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0x0020, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7200, 0x303C, 0x0000, 0x6100, 0x00D8, 0x4CDF,
+    0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x6000, 0xFEA4, 0x2C3C, 0x000F, 0xFFFF, 0x5386, 0x66FC, 0x42B8, 0x0420, 0x42B8, 0x043A,
+    0x42B8, 0x051A, 0x2078, 0x0004, 0x4ED0, 0x4E71, 0x4E75, 0x2038, 0x05A0, 0x6700, 0x001A, 0x2040, 0x2018, 0x6700, 0x0012, 0xB0BC,
+    0x5F4D, 0x4348, 0x6704, 0x5848, 0x60EE, 0x2818, 0x6002, 0x4284, 0x2F04, 0x263C, 0x0000, 0x0000, 0x3E3C, 0x0003, 0x48E7, 0x7F00,
+    0x7208, 0x303C, 0x0002, 0x6100, 0x006C, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x201F, 0x4E75, 0x3F3C, 0x0030, 0x4E41,
+    0x548F, 0xC0BC, 0x0000, 0xFFFF, 0x0C78, 0x00FC, 0x0004, 0x6608, 0x3239, 0x00FC, 0x0002, 0x6006, 0x3239, 0x00E0, 0x0002, 0xC2BC,
+    0x0000, 0xFFFF, 0x4841, 0x8081, 0x263C, 0x0000, 0x0001, 0x2800, 0x3E3C, 0x0003, 0x48E7, 0x7F00, 0x7208, 0x303C, 0x0002, 0x6100,
+    0x0014, 0x4CDF, 0x00FE, 0x4A40, 0x6704, 0x51CF, 0xFFE8, 0x4A40, 0x66A8, 0x4E75, 0x2439, 0x00FA, 0xF004, 0x5841, 0x43F9, 0x00FA,
+    0xF000, 0x207C, 0x00FB, 0x0000, 0xD1FC, 0x0000, 0x8000, 0x3E3C, 0xABCD, 0x4A30, 0x7000, 0x4287, 0xDE40, 0x4A30, 0x0000, 0xDE41,
+    0x4A30, 0x1000, 0x4A41, 0x6700, 0x0088, 0xDE42, 0x4A30, 0x2000, 0xB27C, 0x0002, 0x6700, 0x007A, 0x4842, 0xDE42, 0x4A30, 0x2000,
+    0xB27C, 0x0004, 0x6700, 0x006A, 0xDE43, 0x4A30, 0x3000, 0xB27C, 0x0006, 0x6700, 0x005C, 0x4843, 0xDE43, 0x4A30, 0x3000, 0xB27C,
+    0x0008, 0x6700, 0x004C, 0xDE44, 0x4A30, 0x4000, 0xB27C, 0x000A, 0x6700, 0x003E, 0x4844, 0xDE44, 0x4A30, 0x4000, 0xB27C, 0x000C,
+    0x672E, 0xDE45, 0x4A30, 0x5000, 0xB27C, 0x000E, 0x6722, 0x4845, 0xDE45, 0x4A30, 0x5000, 0xB27C, 0x0010, 0x6714, 0xDE46, 0x4A30,
+    0x6000, 0xB27C, 0x0012, 0x6708, 0x4846, 0xDE46, 0x4A30, 0x6000, 0x4A30, 0x7000, 0x4842, 0x2E3C, 0x0000, 0xFFFF, 0x7000, 0xB491,
+    0x6706, 0x5387, 0x66F8, 0x5380, 0x4E75, 0x2439, 0x00FA, 0xF004, 0xCCBC, 0x0000, 0xFFFF, 0x7210, 0xD286, 0x5281, 0xE289, 0xE389,
     0x43F9, 0x00FA, 0xF000, 0x207C, 0x00FB, 0x0000, 0xD1FC, 0x0000, 0x8000, 0x3E3C, 0xABCD, 0x4A30, 0x7000, 0x4287, 0xDE40, 0x4A30,
-    0x0000, 0xDE41, 0x4A30, 0x1000, 0x4A41, 0x6700, 0x0088, 0xDE42, 0x4A30, 0x2000, 0xB27C, 0x0002, 0x6700, 0x007A, 0x4842, 0xDE42,
-    0x4A30, 0x2000, 0xB27C, 0x0004, 0x6700, 0x006A, 0xDE43, 0x4A30, 0x3000, 0xB27C, 0x0006, 0x6700, 0x005C, 0x4843, 0xDE43, 0x4A30,
-    0x3000, 0xB27C, 0x0008, 0x6700, 0x004C, 0xDE44, 0x4A30, 0x4000, 0xB27C, 0x000A, 0x6700, 0x003E, 0x4844, 0xDE44, 0x4A30, 0x4000,
-    0xB27C, 0x000C, 0x672E, 0xDE45, 0x4A30, 0x5000, 0xB27C, 0x000E, 0x6722, 0x4845, 0xDE45, 0x4A30, 0x5000, 0xB27C, 0x0010, 0x6714,
-    0xDE46, 0x4A30, 0x6000, 0xB27C, 0x0012, 0x6708, 0x4846, 0xDE46, 0x4A30, 0x6000, 0x4A30, 0x7000, 0x4842, 0x2E3C, 0x0000, 0xFFFF,
-    0x7000, 0xB491, 0x6706, 0x5387, 0x66F8, 0x5380, 0x4E75, 0x2439, 0x00FA, 0xF004, 0xCCBC, 0x0000, 0xFFFF, 0x7210, 0xD286, 0x5281,
-    0xE289, 0xE389, 0x43F9, 0x00FA, 0xF000, 0x207C, 0x00FB, 0x0000, 0xD1FC, 0x0000, 0x8000, 0x3E3C, 0xABCD, 0x4A30, 0x7000, 0x4287,
-    0xDE40, 0x4A30, 0x0000, 0xDE41, 0x4A30, 0x1000, 0xDE42, 0x4A30, 0x2000, 0x4842, 0xDE42, 0x4A30, 0x2000, 0xDE43, 0x4A30, 0x3000,
-    0x4843, 0xDE43, 0x4A30, 0x3000, 0xDE44, 0x4A30, 0x4000, 0x4844, 0xDE44, 0x4A30, 0x4000, 0xDE45, 0x4A30, 0x5000, 0x4845, 0xDE45,
-    0x4A30, 0x5000, 0x2A06, 0x2C07, 0x4287, 0x0805, 0x0000, 0x662E, 0x5285, 0xE24D, 0x5345, 0x200C, 0x0800, 0x0000, 0x6712, 0x161C,
-    0xE14B, 0x161C, 0x4A30, 0x3000, 0xDE43, 0x51CD, 0xFFF2, 0x605E, 0x301C, 0xDE40, 0x4A30, 0x0000, 0x51CD, 0xFFF6, 0x6050, 0x5285,
-    0xE24D, 0x200C, 0x0800, 0x0000, 0x6726, 0x5345, 0x6712, 0x5345, 0x161C, 0xE14B, 0x161C, 0x4A30, 0x3000, 0xDE43, 0x51CD, 0xFFF2,
-    0x101C, 0xE148, 0xC07C, 0xFF00, 0xDE40, 0x4A30, 0x0000, 0x601E, 0x5345, 0x670E, 0x5345, 0x301C, 0xDE40, 0x4A30, 0x0000, 0x51CD,
-    0xFFF6, 0x301C, 0xC07C, 0xFF00, 0xDE40, 0x4A30, 0x0000, 0xDC47, 0x4A30, 0x6000, 0x4842, 0x2C3C, 0x0000, 0xFFFF, 0x7000, 0xB491,
-    0x6706, 0x5386, 0x66F8, 0x5380, 0x4E75
+    0x0000, 0xDE41, 0x4A30, 0x1000, 0xDE42, 0x4A30, 0x2000, 0x4842, 0xDE42, 0x4A30, 0x2000, 0xDE43, 0x4A30, 0x3000, 0x4843, 0xDE43,
+    0x4A30, 0x3000, 0xDE44, 0x4A30, 0x4000, 0x4844, 0xDE44, 0x4A30, 0x4000, 0xDE45, 0x4A30, 0x5000, 0x4845, 0xDE45, 0x4A30, 0x5000,
+    0x2A06, 0x2C07, 0x4287, 0x0805, 0x0000, 0x662E, 0x5285, 0xE24D, 0x5345, 0x200C, 0x0800, 0x0000, 0x6712, 0x161C, 0xE14B, 0x161C,
+    0x4A30, 0x3000, 0xDE43, 0x51CD, 0xFFF2, 0x605E, 0x301C, 0xDE40, 0x4A30, 0x0000, 0x51CD, 0xFFF6, 0x6050, 0x5285, 0xE24D, 0x200C,
+    0x0800, 0x0000, 0x6726, 0x5345, 0x6712, 0x5345, 0x161C, 0xE14B, 0x161C, 0x4A30, 0x3000, 0xDE43, 0x51CD, 0xFFF2, 0x101C, 0xE148,
+    0xC07C, 0xFF00, 0xDE40, 0x4A30, 0x0000, 0x601E, 0x5345, 0x670E, 0x5345, 0x301C, 0xDE40, 0x4A30, 0x0000, 0x51CD, 0xFFF6, 0x301C,
+    0xC07C, 0xFF00, 0xDE40, 0x4A30, 0x0000, 0xDC47, 0x4A30, 0x6000, 0x4842, 0x2C3C, 0x0000, 0xFFFF, 0x7000, 0xB491, 0x6706, 0x5386,
+    0x66F8, 0x5380, 0x4E75
 };
 uint16_t target_firmware_length = sizeof(target_firmware) / sizeof(target_firmware[0]);
 
@@ -14,14 +14,19 @@
 #include <string.h>
 
 #include "aconfig.h"
+#include "arena.h"
 #include "constants.h"
 #include "debug.h"
 #include "display_term.h"
 #include "hardware/dma.h"
 #include "memfunc.h"
+#include "perf.h"
+#include "profile.h"
 #include "reset.h"
 #include "time.h"
 #include "tprotocol.h"
+#include "trace.h"
+#include "worker.h"
 
 #define ADDRESS_HIGH_BIT 0x8000  // High bit of the address
 
@@ -48,6 +53,8 @@
 // Shared variables for common use. Must be set in the init function
 #define TERM_HARDWARE_TYPE (0)     // Hardware type. 0xF200
 #define TERM_HARDWARE_VERSION (1)  // Hardware version.  0xF204
+// First of the performance counters, in the order of perf_shared_t. 0xF240
+#define TERM_PERF_COUNTERS (16)
 
 // App commands for the terminal
 #define APP_TERMINAL 0x00  // The terminal app
@@ -55,6 +62,8 @@
 // App terminal commands
 #define APP_TERMINAL_START 0x00      // Enter terminal command
 #define APP_TERMINAL_KEYSTROKE 0x01  // Keystroke command
+#define APP_TERMINAL_SET_SHARED_VAR \
+  0x02  // Shared variable (D3) set to a value (D4) by the computer
 
 #ifdef DISPLAY_ATARIST
 // Terminal size for Atari ST
@@ -0,0 +1,132 @@
+/**
+ * File: trace.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the binary trace of the time-critical paths
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "constants.h"
+#include "debug.h"
+#include "ff.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+// Records kept per core. A power of two.
+#define TRACE_RING_SIZE 128
+
+#define TRACE_FILE_MAGIC 0x31435254  // "TRC1"
+#define TRACE_FILE_VERSION 1
+#define TRACE_FILENAME "/trace.bin"
+
+// Events, with the meaning of their two arguments. rp/host/tracedec.py reads
+// this list to name the events, so keep one X() per line.
+#define TRACE_EVENTS(X)                                               \
+  X(TRACE_PROTOCOL_COMMAND, "command", "payload size")                \
+  X(TRACE_PROTOCOL_DROPPED, "command", "previous command")            \
+  X(TRACE_PROTOCOL_CHECKSUM, "command", "checksum")                   \
+  X(TRACE_TERM_COMMAND, "command", "payload size")                    \
+  X(TRACE_DISPLAY_REFRESH, "bytes", "us")                             \
+  X(TRACE_SELECT_EVENT, "type", "duration us")                        \
+  X(TRACE_WORKER_JOB_START, "slot", "function")                       \
+  X(TRACE_WORKER_JOB_END, "slot", "")                                 \
+  X(TRACE_FLASH_ERASE, "offset", "bytes")                             \
+  X(TRACE_FLASH_PROGRAM, "offset", "bytes")
+
+#define TRACE_EVENT_ENUM(id, arg0, arg1) id,
+typedef enum {
+  TRACE_NONE = 0,
+  TRACE_EVENTS(TRACE_EVENT_ENUM) TRACE_EVENTS_COUNT
+} trace_event_t;
+#undef TRACE_EVENT_ENUM
+
+typedef struct {
+  uint32_t timeUs;  // time_us_32()
+  uint16_t event;   // trace_event_t
+  uint8_t core;
+  uint8_t reserved;
+  uint32_t arg0;
+  uint32_t arg1;
+} trace_record_t;
+
+// Header of the file written by trace_save(). The records of each core
+// follow, oldest first.
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t counts[NUM_CORES];  // Records of each core in the file
+  uint32_t lost[NUM_CORES];    // Older records, already overwritten
+} trace_file_header_t;
+
+typedef struct {
+  trace_record_t records[TRACE_RING_SIZE];
+  volatile uint32_t head;  // Records written since the start
+  uint32_t tail;           // First record not drained yet
+  uint32_t lost;           // Overwritten before being drained
+} trace_ring_t;
+
+#if defined(_TRACE) && (_TRACE != 0)
+
+extern trace_ring_t traceRings[NUM_CORES];
+
+/**
+ * @brief Appends an event to the ring of the current core: a timestamp, the
+ * event and two arguments. A few stores, with the interrupts masked, so it
+ * can be called from interrupts and from RAM. The oldest records are
+ * overwritten.
+ */
+static inline void __not_in_flash_func(trace_event)(trace_event_t event,
+                                                    uint32_t arg0,
+                                                    uint32_t arg1) {
+  uint32_t core = get_core_num();
+  trace_ring_t *ring = &traceRings[core];
+  uint32_t ints = save_and_disable_interrupts();
+  trace_record_t *record = &ring->records[ring->head & (TRACE_RING_SIZE - 1)];
+  record->timeUs = time_us_32();
+  record->event = (uint16_t)event;
+  record->core = (uint8_t)core;
+  record->arg0 = arg0;
+  record->arg1 = arg1;
+  ring->head++;
+  restore_interrupts(ints);
+}
+
+#define TRACE(event, arg0, arg1) \
+  trace_event((event), (uint32_t)(arg0), (uint32_t)(arg1))
+
+#else
+#define TRACE(event, arg0, arg1)
+#endif
+
+/**
+ * @brief Prints the records not drained yet to the debug output, decoded,
+ * a few at a time. Call it from the main loop, never from an interrupt. Does
+ * nothing if the debug output or the trace are disabled.
+ */
+void trace_drain(void);
+
+/**
+ * @brief Writes the records in the rings to a file, for
+ * rp/host/tracedec.py. The records are not drained.
+ *
+ * @param path Path of the file.
+ * @param saved Filled with the number of records written.
+ * @return FR_OK if written. FR_DENIED if the trace is disabled.
+ */
+FRESULT trace_save(const char *path, uint32_t *saved);
+
+/**
+ * @brief Returns the name of an event.
+ */
+const char *trace_getName(trace_event_t event);
+
+#endif  // TRACE_H
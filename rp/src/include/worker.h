@@ -0,0 +1,114 @@
+/**
+ * File: worker.h
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Header for the jobs run in the secondary core
+ */
+
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "constants.h"
+#include "debug.h"
+#include "hardware/structs/sio.h"
+#include "hardware/sync.h"
+#include "memwatch.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include "trace.h"
+
+// Same as the depth of the FIFO from core0 to core1, so queueing a job never
+// blocks
+#define WORKER_MAX_JOBS 8
+
+typedef enum {
+  WORKER_OK = 0,
+  WORKER_NOT_STARTED_ERROR = -1,
+  WORKER_FULL_ERROR = -2
+} worker_status_t;
+
+typedef enum {
+  WORKER_JOB_FREE,
+  WORKER_JOB_QUEUED,
+  WORKER_JOB_RUNNING,
+  WORKER_JOB_DONE
+} worker_job_status_t;
+
+// Runs in core1
+typedef void (*worker_func_t)(void *context);
+
+// Called in the main loop of core0 when the job ends
+typedef void (*worker_done_t)(void *context);
+
+typedef struct {
+  worker_func_t func;
+  worker_done_t done;  // NULL if nothing to do when the job ends
+  void *context;
+  volatile worker_job_status_t status;
+} worker_job_t;
+
+/**
+ * @brief Launches core1 to run the jobs queued. Core1 waits for them in
+ * RAM, so it does not touch the flash while idle.
+ */
+void worker_start(void);
+
+/**
+ * @brief Waits for the jobs queued to end, calling their done callbacks, and
+ * resets core1.
+ */
+void worker_stop(void);
+
+/**
+ * @brief Queues a job for core1. The jobs run one after the other, in the
+ * order queued.
+ *
+ * Only core0 queues jobs, and not from an interrupt. A job must not use what
+ * core0 uses at the same time, like the microSD card, unless the caller
+ * makes sure it does not.
+ *
+ * @param func Function of the job.
+ * @param done Called from worker_poll() when the job ends. Can be NULL.
+ * @param context Passed to func and done. Must be valid until done is called.
+ * @return WORKER_OK if queued.
+ */
+worker_status_t worker_submit(worker_func_t func, worker_done_t done,
+                              void *context);
+
+/**
+ * @brief Calls the done callbacks of the jobs finished and frees their slots.
+ * Call it from the main loop of core0.
+ */
+void worker_poll(void);
+
+/**
+ * @brief Returns true while there are jobs queued or running, or finished
+ * but not polled yet.
+ */
+bool worker_isBusy(void);
+
+/**
+ * @brief Lets core0 program the flash, if asked. Long jobs call it often,
+ * e.g. once per record, from core1.
+ */
+void worker_yield(void);
+
+/**
+ * @brief Parks core1 in RAM before core0 erases or programs the flash. Waits
+ * for the running job to reach worker_yield() or to end. Does nothing if the
+ * worker was not started.
+ */
+void worker_lockoutStart(void);
+
+/**
+ * @brief Lets core1 run from the flash again.
+ */
+void worker_lockoutEnd(void);
+
+#endif  // WORKER_H
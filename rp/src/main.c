@@ -11,6 +11,8 @@
 #include "debug.h"
 #include "emul.h"
 #include "gconfig.h"
+#include "memwatch.h"
+#include "profile.h"
 #include "reset.h"
 
 // This is the main.c file for the app or microfirmware. It is the entry point
@@ -31,8 +33,12 @@
 // should be modified when adding new features to the application.
 
 int main() {
+  // Before the stack grows, to measure how deep it gets
+  memwatch_paintStack(0);
+
   // Set the clock frequency. Keep in mind that if you are managing remote
-  // commands you should overclock the CPU to >=225MHz
+  // commands you should overclock the CPU to >=225MHz. profile_init() never
+  // validates a profile below it (PROFILE_COMMAND_MIN_KHZ).
   set_sys_clock_khz(RP2040_CLOCK_FREQ_KHZ, true);
 
   // Set the voltage. Be cautios with this. I don't think it's possible to
@@ -131,6 +137,9 @@ int main() {
       break;
   }
 
+  // Clock and voltage for the computer, now that the settings are loaded
+  profile_init();
+
   // Start the application
   emul_start();
 }
@@ -30,6 +30,7 @@
 #define MBEDTLS_AES_C
 #define MBEDTLS_GCM_C
 #define MBEDTLS_MD_C
+#define MBEDTLS_MD5_C  // Digests of the downloads
 #define MBEDTLS_SHA256_C
 
 // RNG / entropy
@@ -0,0 +1,93 @@
+/**
+ * File: memwatch.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: High-water marks of the stacks, by painting them, and of the
+ * heap
+ */
+
+#include "memwatch.h"
+
+// From memmap_rp.ld
+extern uint32_t __scratch_y_end__;
+extern uint32_t __stack1_start__;
+extern uint32_t __stack1_end__;
+extern uint32_t __StackBottom;
+extern uint32_t __StackTop;
+extern uint32_t __end__;
+
+static bool painted[NUM_CORES] = {false};
+static bool warned[NUM_CORES + 1] = {false};  // And the heap
+
+static void getLimits(uint core, memwatch_stack_t *stack) {
+  if (core == 0) {
+    stack->low = (uintptr_t)&__scratch_y_end__;
+    stack->reserved = (uintptr_t)&__StackBottom;
+    stack->top = (uintptr_t)&__StackTop;
+  } else {
+    stack->low = (uintptr_t)&__stack1_start__;
+    stack->reserved = (uintptr_t)&__stack1_start__;
+    stack->top = (uintptr_t)&__stack1_end__;
+  }
+}
+
+void __attribute__((noinline)) memwatch_paintStack(uint core) {
+  memwatch_stack_t stack;
+  getLimits(core, &stack);
+  uintptr_t end = stack.top;
+  if (core == get_core_num()) {
+    uintptr_t sp;
+    __asm volatile("mov %0, sp" : "=r"(sp));
+    end = sp - MEMWATCH_PAINT_MARGIN;
+  }
+  for (volatile uint32_t *word = (volatile uint32_t *)stack.low;
+       (uintptr_t)word < end; word++) {
+    *word = MEMWATCH_PAINT;
+  }
+  painted[core] = true;
+  warned[core] = false;
+}
+
+void memwatch_getStack(uint core, memwatch_stack_t *stack) {
+  getLimits(core, stack);
+  stack->painted = painted[core];
+  stack->deepest = stack->top;
+  if (!stack->painted) {
+    return;
+  }
+  const volatile uint32_t *word = (const volatile uint32_t *)stack->low;
+  while (((uintptr_t)word < stack->top) && (*word == MEMWATCH_PAINT)) {
+    word++;
+  }
+  stack->deepest = (uintptr_t)word;
+}
+
+void memwatch_getHeap(memwatch_heap_t *heap) {
+  struct mallinfo info = mallinfo();
+  heap->inUse = (uint32_t)info.uordblks;
+  heap->peak = (uint32_t)((uintptr_t)sbrk(0) - (uintptr_t)&__end__);
+  heap->size =
+      (uint32_t)((uintptr_t)&__rom_in_ram_start__ - (uintptr_t)&__end__);
+}
+
+void memwatch_poll(void) {
+  for (uint core = 0; core < NUM_CORES; core++) {
+    if (!painted[core] || warned[core]) {
+      continue;
+    }
+    memwatch_stack_t stack;
+    getLimits(core, &stack);
+    if (*(volatile uint32_t *)(stack.low + MEMWATCH_STACK_LOW) !=
+        MEMWATCH_PAINT) {
+      DPRINTF("WARNING: stack of core %u with less than %u bytes left\n",
+              core, MEMWATCH_STACK_LOW);
+      warned[core] = true;
+    }
+  }
+  if (!warned[NUM_CORES] &&
+      ((uintptr_t)sbrk(0) > (uintptr_t)&__rom_in_ram_start__)) {
+    DPRINTF("WARNING: the heap grew into the ROM in RAM\n");
+    warned[NUM_CORES] = true;
+  }
+}
@@ -14,6 +14,21 @@ static char connectionStatusStr[NETWORK_MAX_STRING_LENGTH] = {0};
 // Static variable to store the callback function
 static NetworkPollingCallback networkPollingCallback = NULL;
 
+// Connection in the background, driven by network_wifiStaPoll()
+static network_sta_state_t staState = NETWORK_STA_IDLE;
+static int staAttempt = 0;
+static int staMaxAttempts = 0;
+static absolute_time_t staAttemptTimeout;
+static absolute_time_t staStatusTime;
+
+// Access point, channel and address of the last connection, to join again
+// without scanning and to ask the DHCP server for the same lease
+static bool staCacheValid = false;
+static uint8_t staCacheBssid[NETWORK_MAC_SIZE];
+static unsigned int staCacheChannel = 0;
+static ip_addr_t staCacheIp = {0};
+static bool staDirected = false;  // Joining with the cache
+
 static const char *picoSerialStr() {
   static char buf[PICO_UNIQUE_BOARD_ID_SIZE_BYTES * 2 + 1];
   pico_unique_board_id_t boardId;
@@ -393,7 +408,9 @@ static void networkStatusCallback(struct netif *netif) {
   }
 }
 
-wifi_sta_conn_process_status_t network_wifiStaConnect() {
+// Configures the STA interface: hostname, callbacks and the DHCP or static
+// addresses
+static wifi_sta_conn_process_status_t staSetup(void) {
   if (!cyw43Initialized) {
     DPRINTF("WiFi not initialized. Cancelling connection\n");
     return NETWORK_WIFI_STA_CONN_ERR_NOT_INITIALIZED;
@@ -434,6 +451,17 @@ wifi_sta_conn_process_status_t network_wifiStaConnect() {
        settings_find_entry(gconfig_getContext(), PARAM_WIFI_DHCP)->value[0] ==
            'T')) {
     DPRINTF("DHCP enabled\n");
+    // With the link still down, lwIP waits in the INIT state. From the
+    // REBOOTING state it asks for the address of the last lease as soon as
+    // the link is up, with a single request (RFC 2131 INIT-REBOOT). If the
+    // server refuses it or does not answer, lwIP starts a full discovery.
+    struct dhcp *dhcp = netif_dhcp_data(nif);
+    if (staCacheValid && (staCacheIp.addr != 0) && (dhcp != NULL) &&
+        (dhcp->state == DHCP_STATE_INIT)) {
+      DPRINTF("Asking for the last DHCP lease: %s\n", ipaddr_ntoa(&staCacheIp));
+      ip4_addr_set_u32(&dhcp->offered_ip_addr, staCacheIp.addr);
+      dhcp->state = DHCP_STATE_REBOOTING;
+    }
   } else {
     DPRINTF("Static IP enabled\n");
     dhcp_stop(nif);
@@ -459,36 +487,30 @@ wifi_sta_conn_process_status_t network_wifiStaConnect() {
     if (entry == NULL || entry->value == NULL) {
       DPRINTF("Error: DNS configuration is missing.\n");
     } else {
-      char *dns = entry->value;
-      char *dnsCopy = strdup(
-          dns);  // Make a copy of the string to avoid modifying the original
-      if (dnsCopy == NULL) {
-        DPRINTF("Error: Memory allocation failed.\n");
+      // Make a copy of the string to avoid modifying the original
+      char dnsCopy[SETTINGS_MAX_VALUE_LENGTH];
+      strncpy(dnsCopy, entry->value, sizeof(dnsCopy) - 1);
+      dnsCopy[sizeof(dnsCopy) - 1] = '\0';
+      char *dns1 = strtok(dnsCopy, ",");
+      char *dns2 = strtok(NULL, ",");
+
+      ip_addr_t dns1Ip;
+      ip_addr_t dns2Ip;
+      if (dns1 == NULL || (dns1Ip.addr = ipaddr_addr(dns1)) == IPADDR_NONE) {
+        DPRINTF("Error: Invalid DNS1 address.\n");
       } else {
-        char *dns1 = strtok(dnsCopy, ",");
-        char *dns2 = strtok(NULL, ",");
-
-        ip_addr_t dns1Ip;
-        ip_addr_t dns2Ip;
-        if (dns1 == NULL || (dns1Ip.addr = ipaddr_addr(dns1)) == IPADDR_NONE) {
-          DPRINTF("Error: Invalid DNS1 address.\n");
-          free(dnsCopy);  // Free the allocated memory
-        } else {
-          dns_setserver(0, &dns1Ip);
-          DPRINTF("DNS1: %s\n", ipaddr_ntoa(&dns1Ip));
-
-          if (dns2 != NULL) {
-            if ((dns2Ip.addr = ipaddr_addr(dns2)) == IPADDR_NONE) {
-              DPRINTF("Error: Invalid DNS2 address.\n");
-            } else {
-              dns_setserver(1, &dns2Ip);
-              DPRINTF("DNS2: %s\n", ipaddr_ntoa(&dns2Ip));
-            }
+        dns_setserver(0, &dns1Ip);
+        DPRINTF("DNS1: %s\n", ipaddr_ntoa(&dns1Ip));
+
+        if (dns2 != NULL) {
+          if ((dns2Ip.addr = ipaddr_addr(dns2)) == IPADDR_NONE) {
+            DPRINTF("Error: Invalid DNS2 address.\n");
+          } else {
+            dns_setserver(1, &dns2Ip);
+            DPRINTF("DNS2: %s\n", ipaddr_ntoa(&dns2Ip));
           }
         }
       }
-
-      free(dnsCopy);  // Free the copied string after use
     }
   }
   netif_set_up(nif);
@@ -500,7 +522,12 @@ wifi_sta_conn_process_status_t network_wifiStaConnect() {
     DPRINTF("Failed to get MAC address: %d\n", res);
     return NETWORK_WIFI_STA_CONN_ERR_MAC_FAILED;
   }
+  return NETWORK_WIFI_STA_CONN_OK;
+}
 
+// Starts joining the network of the settings. Does not wait for the link.
+// A directed join goes straight to the access point and channel of the cache.
+static wifi_sta_conn_process_status_t staJoin(bool directed) {
   SettingsConfigEntry *ssid =
       settings_find_entry(gconfig_getContext(), PARAM_WIFI_SSID);
   if (strlen(ssid->value) == 0) {
@@ -514,10 +541,13 @@ wifi_sta_conn_process_status_t network_wifiStaConnect() {
     return NETWORK_WIFI_STA_CONN_ERR_NO_AUTH_MODE;
   }
   char *passwordValue = NULL;
+  char passwordCopy[SETTINGS_MAX_VALUE_LENGTH];
   SettingsConfigEntry *password =
       settings_find_entry(gconfig_getContext(), PARAM_WIFI_PASSWORD);
   if (strlen(password->value) > 0) {
-    passwordValue = strdup(password->value);
+    strncpy(passwordCopy, password->value, sizeof(passwordCopy) - 1);
+    passwordCopy[sizeof(passwordCopy) - 1] = '\0';
+    passwordValue = passwordCopy;
   } else {
     DPRINTF(
         "No password found in config. Trying to connect without password\n");
@@ -528,13 +558,33 @@ wifi_sta_conn_process_status_t network_wifiStaConnect() {
   int errorCode = 0;
   DPRINTF("Connecting to SSID=%s, password=%s, auth=%08x. ASYNC\n", ssid->value,
           passwordValue, authValue);
-  errorCode =
-      cyw43_arch_wifi_connect_async(ssid->value, passwordValue, authValue);
-  free(passwordValue);
+  if (directed) {
+    DPRINTF("Directed join to channel %u\n", staCacheChannel);
+    errorCode = cyw43_wifi_join(
+        &cyw43_state, strlen(ssid->value), (const uint8_t *)ssid->value,
+        (passwordValue != NULL) ? strlen(passwordValue) : 0,
+        (const uint8_t *)passwordValue,
+        (passwordValue != NULL) ? authValue : CYW43_AUTH_OPEN, staCacheBssid,
+        staCacheChannel);
+  } else {
+    errorCode =
+        cyw43_arch_wifi_connect_async(ssid->value, passwordValue, authValue);
+  }
   if (errorCode != 0) {
     DPRINTF("Failed to connect to WiFi: %d\n", errorCode);
     return NETWORK_WIFI_STA_CONN_ERR_CONNECTION_FAILED;
   }
+  return NETWORK_WIFI_STA_CONN_OK;
+}
+
+wifi_sta_conn_process_status_t network_wifiStaConnect() {
+  wifi_sta_conn_process_status_t err = staSetup();
+  if (err == NETWORK_WIFI_STA_CONN_OK) {
+    err = staJoin(false);
+  }
+  if (err != NETWORK_WIFI_STA_CONN_OK) {
+    return err;
+  }
 
   // Enter a loop until the device has a WiFi connection with an IP address. Or
   // timesout.
@@ -580,6 +630,143 @@ wifi_sta_conn_process_status_t network_wifiStaConnect() {
   return 0;
 }
 
+wifi_sta_conn_process_status_t network_wifiStaConnectAsync(int maxAttempts) {
+  wifi_sta_conn_process_status_t err = staSetup();
+  staDirected = staCacheValid;
+  if (err == NETWORK_WIFI_STA_CONN_OK) {
+    err = staJoin(staDirected);
+  }
+  if (err != NETWORK_WIFI_STA_CONN_OK) {
+    staState = NETWORK_STA_FAILED;
+    return err;
+  }
+  staState = NETWORK_STA_JOINING;
+  staAttempt = 1;
+  staMaxAttempts = maxAttempts;
+  staAttemptTimeout = make_timeout_time_ms(
+      (staDirected ? NETWORK_CACHED_JOIN_TIMEOUT : NETWORK_CONNECT_TIMEOUT) *
+      SEC_TO_MS);
+  staStatusTime = make_timeout_time_ms(1 * SEC_TO_MS);
+  return NETWORK_WIFI_STA_CONN_OK;
+}
+
+network_sta_state_t network_wifiStaPoll() {
+  if (staState != NETWORK_STA_JOINING) {
+    return staState;
+  }
+  wifi_sta_conn_status_t status = network_wifiConnStatus(&staStatusTime, 1);
+  if (status == CONNECTED_WIFI_IP) {
+    DPRINTF("Connected after %d attempts\n", staAttempt);
+    staState = NETWORK_STA_CONNECTED;
+#ifdef BLINK_H
+    blink_on();
+#endif
+  } else if (status == BADAUTH_ERROR) {
+    // Trying again does not fix a wrong password
+    DPRINTF("WiFi bad authentication. Giving up.\n");
+    staState = NETWORK_STA_FAILED;
+  } else if (staDirected &&
+             ((status == CONNECT_FAILED_ERROR) || (status == GENERIC_ERROR) ||
+              (absolute_time_diff_us(get_absolute_time(), staAttemptTimeout) <=
+               0))) {
+    // The access point moved or changed channel. Not counted as an attempt.
+    DPRINTF("Directed join failed. Joining with a scan.\n");
+    staDirected = false;
+    staCacheValid = false;
+    if (staJoin(false) != NETWORK_WIFI_STA_CONN_OK) {
+      staState = NETWORK_STA_FAILED;
+    }
+    staAttemptTimeout =
+        make_timeout_time_ms(NETWORK_CONNECT_TIMEOUT * SEC_TO_MS);
+  } else if (absolute_time_diff_us(get_absolute_time(), staAttemptTimeout) <=
+             0) {
+    if ((staAttempt >= staMaxAttempts) ||
+        (staJoin(false) != NETWORK_WIFI_STA_CONN_OK)) {
+      DPRINTF("Timeout connecting to the WiFi network after %d attempts\n",
+              staAttempt);
+      staState = NETWORK_STA_FAILED;
+    } else {
+      staAttempt++;
+      DPRINTF("WiFi connection timeout. Attempt %d\n", staAttempt);
+      staAttemptTimeout =
+          make_timeout_time_ms(NETWORK_CONNECT_TIMEOUT * SEC_TO_MS);
+    }
+  }
+  return staState;
+}
+
+network_sta_state_t network_wifiStaGetState() { return staState; }
+
+// FNV-1a, to tell if the cache is of the network of the settings
+static uint32_t ssidHash(const char *ssid) {
+  uint32_t hash = 2166136261u;
+  while (*ssid != '\0') {
+    hash = (hash ^ (uint8_t)*ssid++) * 16777619u;
+  }
+  return hash;
+}
+
+void network_setStaCache(const char *value) {
+  unsigned int hash;
+  unsigned int bssid[NETWORK_MAC_SIZE];
+  unsigned int channel;
+  char ip[IPADDR_STRLEN_MAX];
+  staCacheValid = false;
+  SettingsConfigEntry *ssid =
+      settings_find_entry(gconfig_getContext(), PARAM_WIFI_SSID);
+  if ((value == NULL) || (ssid == NULL) ||
+      (sscanf(value, "%8x,%2x:%2x:%2x:%2x:%2x:%2x,%u,%15s", &hash, &bssid[0],
+              &bssid[1], &bssid[2], &bssid[3], &bssid[4], &bssid[5], &channel,
+              ip) != NETWORK_STA_CACHE_FIELDS)) {
+    return;
+  }
+  if (hash != ssidHash(ssid->value)) {
+    DPRINTF("The cache is of another network. Ignored.\n");
+    return;
+  }
+  for (int i = 0; i < NETWORK_MAC_SIZE; i++) {
+    staCacheBssid[i] = (uint8_t)bssid[i];
+  }
+  staCacheChannel = channel;
+  staCacheIp.addr = ipaddr_addr(ip);
+  if (staCacheIp.addr == IPADDR_NONE) {
+    staCacheIp.addr = 0;
+  }
+  staCacheValid = true;
+  DPRINTF("Cached join: %s\n", value);
+}
+
+bool network_getStaCache(char *value, size_t size) {
+  if (staState != NETWORK_STA_CONNECTED) {
+    return false;
+  }
+  uint8_t bssid[NETWORK_MAC_SIZE];
+  // channel_info_t of the chip: hardware, target and scan channels
+  uint32_t channelInfo[3] = {0};
+  if ((cyw43_wifi_get_bssid(&cyw43_state, bssid) != 0) ||
+      (cyw43_ioctl(&cyw43_state, CYW43_IOCTL_GET_CHANNEL, sizeof(channelInfo),
+                   (uint8_t *)channelInfo, CYW43_ITF_STA) != 0)) {
+    DPRINTF("Cannot read the access point of the connection\n");
+    return false;
+  }
+  // Only a lease from DHCP can be asked for again
+  SettingsConfigEntry *dhcp =
+      settings_find_entry(gconfig_getContext(), PARAM_WIFI_DHCP);
+  bool dhcpEnabled =
+      (dhcp != NULL) && ((dhcp->value[0] == 't') || (dhcp->value[0] == 'T'));
+  ip_addr_t ip = {0};
+  if (dhcpEnabled) {
+    ip = currentIp;
+  }
+  SettingsConfigEntry *ssid =
+      settings_find_entry(gconfig_getContext(), PARAM_WIFI_SSID);
+  snprintf(value, size, "%08x,%02x:%02x:%02x:%02x:%02x:%02x,%u,%s",
+           (unsigned int)ssidHash((ssid != NULL) ? ssid->value : ""),
+           bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5],
+           (unsigned int)channelInfo[0], ipaddr_ntoa(&ip));
+  return true;
+}
+
 char *network_wifiConnStatusStr() { return connectionStatusStr; }
 
 wifi_sta_conn_status_t network_wifiConnStatus(
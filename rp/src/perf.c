@@ -0,0 +1,131 @@
+/**
+ * File: perf.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Runtime performance counters. The flash and the SD card are
+ * measured by wrapping their functions at link time, so every caller counts,
+ * the libraries included.
+ */
+
+#include "perf.h"
+
+#include "diskio.h"
+#include "hardware/flash.h"
+
+static perf_timer_t timers[PERF_TIMERS_COUNT];
+static volatile uint32_t events[PERF_EVENTS_COUNT];
+
+void perf_init(void) {
+  perf_reset();
+  systick_hw->csr = 0;
+  systick_hw->rvr = PERF_SYSTICK_MASK;
+  systick_hw->cvr = 0;
+  systick_hw->csr =
+      M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+void perf_reset(void) {
+  memset(timers, 0, sizeof(timers));
+  for (int i = 0; i < PERF_EVENTS_COUNT; i++) {
+    events[i] = 0;
+  }
+}
+
+static void __not_in_flash_func(addTime)(perf_timer_t *timer,
+                                         uint32_t elapsed, uint32_t bytes) {
+  timer->count++;
+  timer->total += elapsed;
+  if (elapsed > timer->max) {
+    timer->max = elapsed;
+  }
+  timer->bytes += bytes;
+}
+
+void perf_add(perf_timer_id_t id, uint32_t elapsed, uint32_t bytes) {
+  addTime(&timers[id], elapsed, bytes);
+}
+
+void perf_stop(perf_timer_id_t id, uint32_t start, uint32_t bytes) {
+  addTime(&timers[id], time_us_32() - start, bytes);
+}
+
+void __not_in_flash_func(perf_irqStop)(uint32_t start) {
+  // Counting down
+  addTime(&timers[PERF_TIMER_IRQ],
+          (start - systick_hw->cvr) & PERF_SYSTICK_MASK, 0);
+}
+
+void __not_in_flash_func(perf_count)(perf_event_id_t id) { events[id]++; }
+
+const perf_timer_t *perf_getTimer(perf_timer_id_t id) { return &timers[id]; }
+
+uint32_t perf_getCount(perf_event_id_t id) { return events[id]; }
+
+// Same layout as SET_SHARED_VAR, without the debug output
+static void setShared(uint32_t address, perf_shared_t index, uint32_t value) {
+  volatile uint16_t *var = (volatile uint16_t *)(address + index * 4);
+  var[1] = value & 0xFFFF;
+  var[0] = value >> 16;
+}
+
+void perf_mirror(uint32_t address) {
+  const perf_timer_t *download = &timers[PERF_TIMER_DOWNLOAD];
+  uint32_t downloadKbs =
+      (download->total > 0)
+          ? (uint32_t)(download->bytes * 1000000 / 1024 / download->total)
+          : 0;
+  setShared(address, PERF_SHARED_IRQ_COUNT, timers[PERF_TIMER_IRQ].count);
+  setShared(address, PERF_SHARED_IRQ_MAX_CYCLES, timers[PERF_TIMER_IRQ].max);
+  setShared(address, PERF_SHARED_COMMANDS, events[PERF_EVENT_COMMANDS]);
+  setShared(address, PERF_SHARED_DROPPED, events[PERF_EVENT_DROPPED]);
+  setShared(address, PERF_SHARED_CHECKSUM, events[PERF_EVENT_CHECKSUM]);
+  setShared(address, PERF_SHARED_DISPLAY_COUNT,
+            timers[PERF_TIMER_DISPLAY].count);
+  setShared(address, PERF_SHARED_DISPLAY_MAX_US,
+            timers[PERF_TIMER_DISPLAY].max);
+  setShared(address, PERF_SHARED_SD_READ_KB,
+            (uint32_t)(timers[PERF_TIMER_SD_READ].bytes / 1024));
+  setShared(address, PERF_SHARED_SD_WRITE_KB,
+            (uint32_t)(timers[PERF_TIMER_SD_WRITE].bytes / 1024));
+  setShared(address, PERF_SHARED_DOWNLOAD_KBS, downloadKbs);
+}
+
+// Linked with --wrap, see CMakeLists.txt
+
+void __real_flash_range_erase(uint32_t flashOffs, size_t count);
+void __real_flash_range_program(uint32_t flashOffs, const uint8_t *data,
+                                size_t count);
+DRESULT __real_disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count);
+DRESULT __real_disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector,
+                          UINT count);
+
+void __wrap_flash_range_erase(uint32_t flashOffs, size_t count) {
+  TRACE(TRACE_FLASH_ERASE, flashOffs, count);
+  uint32_t start = perf_start();
+  __real_flash_range_erase(flashOffs, count);
+  perf_stop(PERF_TIMER_FLASH_ERASE, start, count);
+}
+
+void __wrap_flash_range_program(uint32_t flashOffs, const uint8_t *data,
+                                size_t count) {
+  TRACE(TRACE_FLASH_PROGRAM, flashOffs, count);
+  uint32_t start = perf_start();
+  __real_flash_range_program(flashOffs, data, count);
+  perf_stop(PERF_TIMER_FLASH_PROGRAM, start, count);
+}
+
+DRESULT __wrap_disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count) {
+  uint32_t start = perf_start();
+  DRESULT res = __real_disk_read(pdrv, buff, sector, count);
+  perf_stop(PERF_TIMER_SD_READ, start, count * FF_MIN_SS);
+  return res;
+}
+
+DRESULT __wrap_disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector,
+                          UINT count) {
+  uint32_t start = perf_start();
+  DRESULT res = __real_disk_write(pdrv, buff, sector, count);
+  perf_stop(PERF_TIMER_SD_WRITE, start, count * FF_MIN_SS);
+  return res;
+}
@@ -0,0 +1,237 @@
+/**
+ * File: profile.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Clock and voltage profiles, chosen for the computer reported
+ * in the setup and validated at boot
+ */
+
+#include "profile.h"
+
+#include "romemul.h"
+
+#define PROFILE_ENTRY(id, name, khz, voltage, waitCycles) \
+  {name, khz, voltage, waitCycles},
+static const profile_t profiles[PROFILE_COUNT] = {
+    PROFILE_TABLE(PROFILE_ENTRY)};
+#undef PROFILE_ENTRY
+
+// main() boots with compat
+static const profile_t *current = &profiles[PROFILE_COMPAT];
+static enum vreg_voltage currentVoltage = RP2040_VOLTAGE;
+static int32_t machine = PROFILE_MACHINE_UNKNOWN;
+static bool chosenAuto = true;
+static profile_bench_t bootBench = {0};
+
+// Written by the protocol command, read by the main loop
+static volatile uint32_t reportedMachine = 0;
+static volatile bool machineReported = false;
+
+const profile_t *profile_get(void) { return current; }
+
+const profile_t *profile_find(const char *name) {
+  for (int i = 0; i < PROFILE_COUNT; i++) {
+    if (strcasecmp(name, profiles[i].name) == 0) {
+      return &profiles[i];
+    }
+  }
+  return NULL;
+}
+
+const profile_t *profile_forMachine(int32_t model) {
+  if (model == PROFILE_MACHINE_UNKNOWN) {
+    return &profiles[PROFILE_COMPAT];
+  }
+  switch (PROFILE_MACHINE_FAMILY(model)) {
+    case PROFILE_MACHINE_FAMILY(PROFILE_MACHINE_TT):
+    case PROFILE_MACHINE_FAMILY(PROFILE_MACHINE_FALCON):
+      return &profiles[PROFILE_FAST];
+    default:
+      return &profiles[PROFILE_COMPAT];
+  }
+}
+
+const char *profile_getMachineName(int32_t model) {
+  if (model == PROFILE_MACHINE_UNKNOWN) {
+    return "unknown";
+  }
+  if (model == PROFILE_MACHINE_MEGASTE) {
+    return "Mega STE";
+  }
+  switch (PROFILE_MACHINE_FAMILY(model)) {
+    case PROFILE_MACHINE_FAMILY(PROFILE_MACHINE_ST):
+      return "ST";
+    case PROFILE_MACHINE_FAMILY(PROFILE_MACHINE_STE):
+      return "STE";
+    case PROFILE_MACHINE_FAMILY(PROFILE_MACHINE_TT):
+      return "TT";
+    case PROFILE_MACHINE_FAMILY(PROFILE_MACHINE_FALCON):
+      return "Falcon";
+    default:
+      return "other";
+  }
+}
+
+int32_t profile_getMachine(void) { return machine; }
+
+bool profile_isAuto(void) { return chosenAuto; }
+
+const profile_bench_t *profile_getBootBench(void) { return &bootBench; }
+
+// Raises the voltage before the clock, and lowers it after
+static bool apply(const profile_t *profile) {
+  bool raise = (profile->voltage > currentVoltage);
+  if (raise) {
+    vreg_set_voltage(profile->voltage);
+    busy_wait_us(PROFILE_VREG_SETTLE_US);
+  }
+  if (!set_sys_clock_khz(profile->clockKhz, false)) {
+    DPRINTF("Clock of %u kHz not possible\n",
+            (unsigned int)profile->clockKhz);
+    if (raise) {
+      vreg_set_voltage(currentVoltage);
+    }
+    return false;
+  }
+  if (!raise) {
+    vreg_set_voltage(profile->voltage);
+  }
+  currentVoltage = profile->voltage;
+  current = profile;
+#if defined(_DEBUG) && (_DEBUG != 0)
+  // clk_peri follows clk_sys
+  uart_set_baudrate(uart_default, PICO_DEFAULT_UART_BAUD_RATE);
+#endif
+  return true;
+}
+
+// Not random, but different in each word and each pass
+static inline uint32_t pattern(uint32_t index, uint32_t pass) {
+  uint32_t value = (index + 1) * 0x9E3779B9u ^ (pass * 0x85EBCA6Bu);
+  return value ^ (value >> 15);
+}
+
+bool profile_bench(profile_bench_t *bench) {
+  memset(bench, 0, sizeof(profile_bench_t));
+  bench->run = true;
+  bench->measuredKhz = frequency_count_khz(CLOCKS_FC0_SRC_VALUE_CLK_SYS);
+  uint32_t tolerance = current->clockKhz / PROFILE_CLOCK_TOLERANCE;
+  bool clockOk = (bench->measuredKhz + tolerance >= current->clockKhz) &&
+                 (bench->measuredKhz <= current->clockKhz + tolerance);
+
+  // The read program of the profile, as the auto timing loads it
+  const romemul_timing_t *timing = romemul_findTiming(ROMEMUL_TIMING_AUTO);
+  bench->addressNs =
+      romemul_getAddressCycles(timing) * 1000000 / current->clockKhz;
+  bench->releaseNs =
+      romemul_getReleaseCycles(timing) * 1000000 / current->clockKhz;
+  bool busOk = (current->clockKhz >= PROFILE_COMMAND_MIN_KHZ) &&
+               (bench->addressNs >= PROFILE_ADDRESS_MIN_NS) &&
+               (bench->releaseNs >= PROFILE_RELEASE_MIN_NS);
+
+  uint32_t *buffer = arena_alloc(ARENA_SCRATCH, PROFILE_BENCH_BYTES);
+  if (buffer == NULL) {
+    return false;
+  }
+  const uint32_t words = PROFILE_BENCH_BYTES / sizeof(uint32_t);
+
+  // RAM: a different pattern each pass, written and read back
+  volatile uint32_t *ram = buffer;
+  uint32_t start = time_us_32();
+  for (uint32_t pass = 0; pass < PROFILE_BENCH_PASSES; pass++) {
+    for (uint32_t i = 0; i < words; i++) {
+      ram[i] = pattern(i, pass);
+    }
+    for (uint32_t i = 0; i < words; i++) {
+      if (ram[i] != pattern(i, pass)) {
+        bench->errors++;
+      }
+    }
+  }
+  uint32_t elapsed = time_us_32() - start;
+  if (elapsed > 0) {
+    bench->ramKbs = (uint32_t)((uint64_t)PROFILE_BENCH_BYTES * 2 *
+                               PROFILE_BENCH_PASSES * 1000000 / 1024 /
+                               elapsed);
+  }
+
+  // Flash: the start of the firmware, without the cache, copied by the DMA
+  // and read by the CPU
+  const volatile uint32_t *flash =
+      (const volatile uint32_t *)XIP_NOCACHE_NOALLOC_BASE;
+  start = time_us_32();
+  for (uint32_t pass = 0; pass < PROFILE_BENCH_PASSES; pass++) {
+    const volatile uint32_t *block = flash + pass * words;
+    dmacopy_wait(dmacopy_memcpy(buffer, (const void *)block,
+                                PROFILE_BENCH_BYTES, DMACOPY_NO_FENCE, NULL,
+                                NULL));
+    for (uint32_t i = 0; i < words; i++) {
+      if (buffer[i] != block[i]) {
+        bench->errors++;
+      }
+    }
+  }
+  elapsed = time_us_32() - start;
+  if (elapsed > 0) {
+    bench->flashKbs = (uint32_t)((uint64_t)PROFILE_BENCH_BYTES * 2 *
+                                 PROFILE_BENCH_PASSES * 1000000 / 1024 /
+                                 elapsed);
+  }
+  arena_free(ARENA_SCRATCH, buffer);
+
+  bench->passed = clockOk && busOk && (bench->errors == 0);
+  DPRINTF("Bench of %s: %u kHz, bus %u/%u ns, RAM %u KB/s, flash %u KB/s, "
+          "%u errors. %s\n",
+          current->name, (unsigned int)bench->measuredKhz,
+          (unsigned int)bench->addressNs, (unsigned int)bench->releaseNs,
+          (unsigned int)bench->ramKbs, (unsigned int)bench->flashKbs,
+          (unsigned int)bench->errors, bench->passed ? "OK" : "FAILED");
+  return bench->passed;
+}
+
+void profile_init(void) {
+  SettingsConfigEntry *entry =
+      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_MACHINE);
+  if (entry != NULL) {
+    machine = (int32_t)strtol(entry->value, NULL, 0);
+  }
+  const profile_t *profile = NULL;
+  entry = settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_PROFILE);
+  if ((entry != NULL) && (strcasecmp(entry->value, PROFILE_AUTO) != 0)) {
+    profile = profile_find(entry->value);
+    if (profile == NULL) {
+      DPRINTF("Unknown profile %s. Choosing it from the computer\n",
+              entry->value);
+    }
+  }
+  chosenAuto = (profile == NULL);
+  if (chosenAuto) {
+    profile = profile_forMachine(machine);
+  }
+  DPRINTF("Profile %s%s for the %s: %u kHz, %s\n", profile->name,
+          chosenAuto ? " (auto)" : "", profile_getMachineName(machine),
+          (unsigned int)profile->clockKhz, VOLTAGE_VALUES[profile->voltage]);
+
+  if ((profile != current) && !apply(profile)) {
+    DPRINTF("Staying with %s\n", current->name);
+  }
+  if (!profile_bench(&bootBench) && (current != &profiles[PROFILE_COMPAT])) {
+    DPRINTF("Profile %s failed. Back to compat\n", current->name);
+    apply(&profiles[PROFILE_COMPAT]);
+  }
+}
+
+void __not_in_flash_func(profile_reportMachine)(uint32_t value) {
+  reportedMachine = value;
+  machineReported = true;
+}
+
+bool profile_takeReportedMachine(int32_t *value) {
+  if (!machineReported) {
+    return false;
+  }
+  machineReported = false;
+  *value = (int32_t)reportedMachine;
+  return true;
+}
@@ -15,6 +15,8 @@ void reset_device() {
 }
 
 void reset_deviceAndEraseFlash() {
+  // Core1 must not run from the flash while it is erased
+  multicore_reset_core1();
   // Erase the settings
   DPRINTF("Erasing the flash memory\n");
   settings_erase(gconfig_getContext());
@@ -15,6 +15,11 @@ static int lookupDataRomDmaChannel = -1;
 // Default PIO to use
 static PIO defaultPio = pio0;
 
+// Capture of the bus, if set before init_romemul()
+static romemul_capture_t capture = {NULL, NULL, 0};
+static int captureAddrDmaChannel = -1;
+static int captureTimeDmaChannel = -1;
+
 // Interrupt handler for DMA completion
 // We don't use at runtime, but they are useful for debugging
 // Keep in mind that printing in an interrupt handler is not a good idea
@@ -38,6 +43,11 @@ void __not_in_flash_func(dma_irqHandlerAddress)(void) {
   DPRINTF("DMA ADDR: $%x, VALUE: $%x\n", addr, value);
 }
 
+// Monitors of !ROM3 and !ROM4, stopped while the read program is swapped
+static uint monitorSms[2];
+static uint monitorOffsets[2];
+static uint monitorCount = 0;
+
 static int initMonitorRom4(PIO pio) {
   // Configure the monitor ROM4 state machine
   // Add the assembled program to the PIO into the memory where there are enough
@@ -53,6 +63,8 @@ static int initMonitorRom4(PIO pio) {
 
   // Enable the state machine
   pio_sm_set_enabled(pio, smMonitorROM4, true);
+  monitorSms[monitorCount] = smMonitorROM4;
+  monitorOffsets[monitorCount++] = offsetMonitorROM4;
 
   DPRINTF("ROM4 signal monitor initialized.\n");
   return smMonitorROM4;
@@ -74,11 +86,249 @@ static int initMonitorRom3(PIO pio) {
 
   // Enable the state machine
   pio_sm_set_enabled(pio, smMonitorROM3, true);
+  monitorSms[monitorCount] = smMonitorROM3;
+  monitorOffsets[monitorCount++] = offsetMonitorROM3;
 
   DPRINTF("ROM3 signal monitor initialized.\n");
   return smMonitorROM3;
 }
 
+#define ROMEMUL_TIMING_ENTRY(id, name, nops, waitCycles) \
+  {name, nops, waitCycles},
+static const romemul_timing_t timings[ROMEMUL_TIMING_COUNT] = {
+    ROMEMUL_TIMING_TABLE(ROMEMUL_TIMING_ENTRY)};
+#undef ROMEMUL_TIMING_ENTRY
+
+// auto: the delay of the clock profile, set in romemul_findTiming()
+static romemul_timing_t autoTiming = {ROMEMUL_TIMING_AUTO, 3, 3};
+
+// A variant of the read program, built before it is loaded
+typedef struct {
+  const romemul_timing_t *timing;
+  uint16_t instructions[ROMEMUL_READ_MAX_INSTRUCTIONS];
+  pio_program_t program;
+  uint wrapTarget;
+  uint wrap;
+} read_variant_t;
+
+// The variant loaded and the one built for the next swap
+static read_variant_t readVariants[2];
+static read_variant_t *readLoaded = &readVariants[0];
+
+// Read program loaded, to load it again with another timing
+static PIO readPio = NULL;
+static int readSm = -1;
+static uint readOffset = 0;
+
+const romemul_timing_t *romemul_getTimingVariant(romemul_timing_id_t id) {
+  return &timings[id];
+}
+
+const romemul_timing_t *romemul_findTiming(const char *name) {
+  if (strcasecmp(name, ROMEMUL_TIMING_AUTO) == 0) {
+    autoTiming.waitCycles = profile_get()->waitCycles;
+    return &autoTiming;
+  }
+  for (int i = 0; i < ROMEMUL_TIMING_COUNT; i++) {
+    if (strcasecmp(name, timings[i].name) == 0) {
+      return &timings[i];
+    }
+  }
+  return NULL;
+}
+
+const romemul_timing_t *romemul_getTiming(void) { return readLoaded->timing; }
+
+uint32_t romemul_getAddressCycles(const romemul_timing_t *timing) {
+  // The nops and the mov to the ISR, all with the delay
+  return (timing->nops + 1) * (timing->waitCycles + 1);
+}
+
+uint32_t romemul_getReleaseCycles(const romemul_timing_t *timing) {
+  return timing->nops * (timing->waitCycles + 1);
+}
+
+// Timing of the ROM_TIMING setting
+static const romemul_timing_t *getConfiguredTiming(void) {
+  const romemul_timing_t *timing = NULL;
+  SettingsConfigEntry *entry =
+      settings_find_entry(aconfig_getContext(), ACONFIG_PARAM_ROM_TIMING);
+  if (entry != NULL) {
+    timing = romemul_findTiming(entry->value);
+    if (timing == NULL) {
+      DPRINTF("Unknown ROM timing %s\n", entry->value);
+    }
+  }
+  return (timing != NULL) ? timing : romemul_findTiming(ROMEMUL_TIMING_AUTO);
+}
+
+// Builds the variant of romemul_read: drops the padding nops after the first
+// timing->nops of each block, and changes the delay of the instructions that
+// wait READ_ADDRESS_SAFE_WAIT_CYCLES. romemul_read has no jumps, so only
+// the wrap moves.
+static void buildReadProgram(const romemul_timing_t *timing,
+                             read_variant_t *variant) {
+  uint length = 0;
+  uint nopsInRow = 0;
+  variant->wrapTarget = romemul_read_wrap_target;
+  variant->wrap = romemul_read_wrap;
+  for (uint i = 0; i < romemul_read_program.length; i++) {
+    uint16_t instruction = romemul_read_program.instructions[i];
+    if ((instruction & ROMEMUL_READ_NOP_MASK) == ROMEMUL_READ_NOP) {
+      nopsInRow++;
+      if (nopsInRow > timing->nops) {
+        if (i < romemul_read_wrap_target) {
+          variant->wrapTarget--;
+        }
+        if (i <= romemul_read_wrap) {
+          variant->wrap--;
+        }
+        continue;
+      }
+    } else {
+      nopsInRow = 0;
+    }
+    if (((instruction & ROMEMUL_READ_DELAY_MASK) >>
+         ROMEMUL_READ_DELAY_SHIFT) == READ_ADDRESS_SAFE_WAIT_CYCLES) {
+      instruction = (instruction & ~ROMEMUL_READ_DELAY_MASK) |
+                    ((timing->waitCycles << ROMEMUL_READ_DELAY_SHIFT) &
+                     ROMEMUL_READ_DELAY_MASK);
+    }
+    variant->instructions[length++] = instruction;
+  }
+  variant->program = romemul_read_program;
+  variant->program.instructions = variant->instructions;
+  variant->program.length = length;
+  variant->timing = timing;
+  DPRINTF("ROM read timing %s: %u nops, %u delay cycles, %u instructions\n",
+          timing->name, timing->nops, timing->waitCycles, length);
+}
+
+// Adds the variant loaded and sets up its state machine, disabled
+static void loadReadProgram(void) {
+  readOffset = pio_add_program(readPio, &readLoaded->program);
+  romemul_read_program_init(readPio, readSm, readOffset, READ_ADDR_GPIO_BASE,
+                            READ_ADDR_PIN_COUNT, READ_SIGNAL_GPIO_BASE,
+                            SAMPLE_DIV_FREQ);
+  pio_sm_set_wrap(readPio, readSm, readOffset + readLoaded->wrapTarget,
+                  readOffset + readLoaded->wrap);
+
+  // Need to clear _input shift counter_, as well as FIFO, because there may be
+  // partial ISR contents left over from a previous run. sm_restart does this.
+  pio_sm_clear_fifos(readPio, readSm);
+  pio_sm_restart(readPio, readSm);
+}
+
+// From the start of their programs, so an access already going on when they
+// stopped is not taken as a new one
+static void restartMonitors(uint32_t monitorMask) {
+  for (uint i = 0; i < monitorCount; i++) {
+    pio_sm_exec(readPio, monitorSms[i], pio_encode_jmp(monitorOffsets[i]));
+  }
+  pio_set_sm_mask_enabled(readPio, monitorMask, true);
+}
+
+bool romemul_setTiming(const romemul_timing_t *timing) {
+  if (readSm < 0) {
+    return false;
+  }
+  // Built first, so the state machine is only stopped for the swap
+  read_variant_t *next =
+      (readLoaded == &readVariants[0]) ? &readVariants[1] : &readVariants[0];
+  buildReadProgram(timing, next);
+
+  // No access starts once the monitors stop. Then the read program is
+  // stopped while it waits for the next one, not with the bus driven, and the
+  // interrupts stay masked until it runs again.
+  uint32_t monitorMask = 0;
+  for (uint i = 0; i < monitorCount; i++) {
+    monitorMask |= 1u << monitorSms[i];
+  }
+  uint waitPc = readOffset + readLoaded->wrapTarget;
+  uint32_t interrupts = save_and_disable_interrupts();
+  pio_set_sm_mask_enabled(readPio, monitorMask, false);
+  uint32_t start = time_us_32();
+  bool waiting = true;
+  while (waiting) {
+    waiting = (pio_sm_get_pc(readPio, readSm) != waitPc) ||
+              pio_interrupt_get(readPio, ROMEMUL_BUS_IRQ);
+    if (waiting && (time_us_32() - start > ROMEMUL_SWAP_TIMEOUT_US)) {
+      break;  // Stuck without data from the DMA
+    }
+  }
+  if (waiting) {
+    restartMonitors(monitorMask);
+    restore_interrupts(interrupts);
+    DPRINTF("ROM read program busy. Timing %s not set\n", timing->name);
+    return false;
+  }
+  pio_sm_set_enabled(readPio, readSm, false);
+  pio_remove_program(readPio, &readLoaded->program, readOffset);
+  bool fits = pio_can_add_program(readPio, &next->program);
+  if (fits) {
+    readLoaded = next;
+  }
+  loadReadProgram();
+
+  // The MSW of the ROM in RAM for the X register, and no access left
+  // pending from the monitors meanwhile
+  pio_sm_put(readPio, readSm,
+             ((unsigned long int)&__rom_in_ram_start__ >> ROMEMUL_BUS_BITS));
+  pio_interrupt_clear(readPio, ROMEMUL_BUS_IRQ);
+  pio_sm_set_enabled(readPio, readSm, true);
+  restartMonitors(monitorMask);
+  restore_interrupts(interrupts);
+
+  if (!fits) {
+    DPRINTF("ROM read timing %s does not fit\n", timing->name);
+  }
+  return fits;
+}
+
+void romemul_setCapture(const romemul_capture_t *newCapture) {
+  capture = *newCapture;
+}
+
+uint32_t __not_in_flash_func(romemul_getCaptureIndex)(void) {
+  if (captureTimeDmaChannel < 0) {
+    return 0;
+  }
+  // The time is written last
+  uintptr_t next = (uintptr_t)dma_hw->ch[captureTimeDmaChannel].write_addr;
+  return (uint32_t)((next - (uintptr_t)capture.times) / sizeof(uint32_t));
+}
+
+// One of the copies of the capture: a word to its ring for each trigger,
+// then the next channel
+static void configureCapture(int channel, const volatile void *source,
+                             uint32_t *ring, int chainTo) {
+  dma_channel_config config = dma_channel_get_default_config(channel);
+  channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+  channel_config_set_read_increment(&config, false);
+  channel_config_set_write_increment(&config, true);
+  channel_config_set_ring(&config, true, capture.ringBits);
+  channel_config_set_chain_to(&config, chainTo);
+  dma_channel_configure(channel, &config, ring, source, 1, false);
+}
+
+// Claims and chains the channels of the capture. Returns the channel the
+// lookup must chain to.
+static int initCapture(void) {
+  if (capture.addresses == NULL) {
+    return readAddrRomDmaChannel;
+  }
+  captureAddrDmaChannel = dma_claim_unused_channel(true);
+  captureTimeDmaChannel = dma_claim_unused_channel(true);
+  configureCapture(captureTimeDmaChannel, &timer_hw->timerawl, capture.times,
+                   readAddrRomDmaChannel);
+  configureCapture(captureAddrDmaChannel,
+                   &dma_hw->ch[lookupDataRomDmaChannel].read_addr,
+                   capture.addresses, captureTimeDmaChannel);
+  DPRINTF("DMA channels of the capture: %d and %d\n", captureAddrDmaChannel,
+          captureTimeDmaChannel);
+  return captureAddrDmaChannel;
+}
+
 static int initRomEmulator(PIO pio, IRQInterceptionCallback requestCallback,
                            IRQInterceptionCallback responseCallback) {
   // Configure DMAs
@@ -112,20 +362,16 @@ static int initRomEmulator(PIO pio, IRQInterceptionCallback requestCallback,
   // Configure the read PIO state machine
   // Add the assembled program to the PIO into the memory where there are enough
   // space
-  uint offsetReadROM = pio_add_program(pio, &romemul_read_program);
+  // The timing variant comes from the settings
+  buildReadProgram(getConfiguredTiming(), readLoaded);
 
   // Claim a free state machine from the PIO read program
   uint smReadROM = pio_claim_unused_sm(pio, true);
+  readPio = pio;
+  readSm = smReadROM;
 
   // Start the state machine, executing the PIO read program
-  romemul_read_program_init(pio, smReadROM, offsetReadROM, READ_ADDR_GPIO_BASE,
-                            READ_ADDR_PIN_COUNT, READ_SIGNAL_GPIO_BASE,
-                            SAMPLE_DIV_FREQ);
-
-  // Need to clear _input shift counter_, as well as FIFO, because there may be
-  // partial ISR contents left over from a previous run. sm_restart does this.
-  pio_sm_clear_fifos(pio, smReadROM);
-  pio_sm_restart(pio, smReadROM);
+  loadReadProgram();
   pio_sm_set_enabled(pio, smReadROM, true);
 
   // DMA configuration
@@ -139,7 +385,8 @@ static int initRomEmulator(PIO pio, IRQInterceptionCallback requestCallback,
   channel_config_set_read_increment(&cdmaLookup, false);
   channel_config_set_write_increment(&cdmaLookup, false);
   channel_config_set_dreq(&cdmaLookup, pio_get_dreq(pio, smReadROM, true));
-  channel_config_set_chain_to(&cdmaLookup, readAddrRomDmaChannel);
+  // Through the capture of the bus, if any, back to read the next address
+  channel_config_set_chain_to(&cdmaLookup, initCapture());
   dma_channel_configure(lookupDataRomDmaChannel, &cdmaLookup,
                         &pio->txf[smReadROM], NULL, 1, false);
 
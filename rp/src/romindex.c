@@ -0,0 +1,460 @@
+/**
+ * File: romindex.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Persistent SD card ROM directory index
+ */
+
+#include "romindex.h"
+
+static int compareEntries(const void *first, const void *second) {
+  const romindex_entry_t *entryA = (const romindex_entry_t *)first;
+  const romindex_entry_t *entryB = (const romindex_entry_t *)second;
+  return strcasecmp(entryA->filename, entryB->filename);
+}
+
+static void getIndexPath(const char *folder, const char *filename,
+                         char *indexPath, size_t size) {
+  snprintf(indexPath, size, "%s/%s", folder, filename);
+}
+
+static bool isSeen(const uint8_t *seen, int idx) {
+  return (seen == NULL) || (seen[idx / 8] & (1 << (idx % 8)));
+}
+
+// Same files as the index: no directories, hidden files or files rejected
+// by the filter. The index file itself is hidden.
+static bool isIndexed(const FILINFO *fno, romindex_filter_t filter) {
+  return !(fno->fattrib & AM_DIR) && (fno->fname[0] != '.') &&
+         filter(fno->fname);
+}
+
+// FNV-1a of a name
+static uint32_t hashName(const char *name) {
+  uint32_t hash = 2166136261u;
+  while (*name != '\0') {
+    hash = (hash ^ (uint8_t)*name++) * 16777619u;
+  }
+  return hash;
+}
+
+// Signs the files of the folder in a pass of f_readdir, without touching the
+// index. The hashes are added, so the order of the entries does not matter.
+// Returns false if the folder cannot be read, and the index is rescanned.
+static bool signFolder(const char *folder, romindex_filter_t filter,
+                       uint32_t *dirFiles, uint32_t *dirHash) {
+  DIR dir;
+  FILINFO fno;
+  FRESULT res = f_opendir(&dir, folder);
+  if (res != FR_OK) {
+    DPRINTF("Cannot sign folder %s: %d\n", folder, res);
+    return false;
+  }
+  *dirFiles = 0;
+  *dirHash = 0;
+  for (;;) {
+    res = f_readdir(&dir, &fno);
+    if (res != FR_OK || fno.fname[0] == 0) {
+      break;
+    }
+    if (isIndexed(&fno, filter)) {
+      (*dirFiles)++;
+      *dirHash += hashName(fno.fname);
+    }
+  }
+  f_closedir(&dir);
+  if (*dirHash == 0) {
+    *dirHash = 1;  // Zero is the signature of an invalidated index
+  }
+  return (res == FR_OK);
+}
+
+// Open the index file and validate the header. Returns the number of entries,
+// or -1 if the file does not exist or is not valid. The file is left open
+// only on success.
+static int openIndex(const char *indexPath, BYTE mode, FIL *file,
+                     romindex_header_t *header) {
+  UINT bytesRead;
+  FRESULT res = f_open(file, indexPath, mode);
+  if (res != FR_OK) {
+    DPRINTF("No index file %s: %d\n", indexPath, res);
+    return -1;
+  }
+  res = f_read(file, header, sizeof(romindex_header_t), &bytesRead);
+  if ((res != FR_OK) || (bytesRead != sizeof(romindex_header_t)) ||
+      (header->magic != ROMINDEX_MAGIC) ||
+      (header->version != ROMINDEX_VERSION) ||
+      (header->recordSize != sizeof(romindex_entry_t)) ||
+      (header->count > ROMINDEX_MAX_ENTRIES) ||
+      (f_size(file) != sizeof(romindex_header_t) +
+                           header->count * sizeof(romindex_entry_t))) {
+    DPRINTF("Invalid index file %s. Ignoring it.\n", indexPath);
+    f_close(file);
+    return -1;
+  }
+  return (int)header->count;
+}
+
+static bool readEntry(FIL *file, int idx, romindex_entry_t *entry) {
+  UINT bytesRead;
+  FRESULT res = f_lseek(file, sizeof(romindex_header_t) +
+                                  (FSIZE_t)idx * sizeof(romindex_entry_t));
+  if (res == FR_OK) {
+    res = f_read(file, entry, sizeof(romindex_entry_t), &bytesRead);
+  }
+  return (res == FR_OK) && (bytesRead == sizeof(romindex_entry_t));
+}
+
+static bool writeEntry(FIL *file, const romindex_entry_t *entry) {
+  UINT bytesWritten;
+  FRESULT res = f_write(file, entry, sizeof(romindex_entry_t), &bytesWritten);
+  return (res == FR_OK) && (bytesWritten == sizeof(romindex_entry_t));
+}
+
+// Binary search over the sorted entries on the SD card. The FIL sector buffer
+// absorbs most of the reads once the search narrows down.
+static int searchEntry(FIL *file, int count, const romindex_entry_t *key,
+                       bool *error) {
+  int low = 0;
+  int high = count - 1;
+  while (low <= high) {
+    int mid = low + (high - low) / 2;
+    romindex_entry_t entry;
+    if (!readEntry(file, mid, &entry)) {
+      *error = true;
+      return -1;
+    }
+    int cmp = compareEntries(key, &entry);
+    if (cmp == 0) {
+      return mid;
+    }
+    if (cmp < 0) {
+      high = mid - 1;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return -1;
+}
+
+// Enumerate the folder. Existing entries are marked in the seen bitmap, and
+// up to ROMINDEX_MERGE_CHUNK new entries are returned. If there are more new
+// entries than that, overflow is set and another pass is needed.
+static romindex_status_t scanFolder(const char *folder,
+                                    romindex_filter_t filter, FIL *oldFile,
+                                    int oldCount, uint8_t *seen,
+                                    romindex_entry_t *newEntries,
+                                    int *newCount, bool *overflow) {
+  DIR dir;
+  FILINFO fno;
+  FRESULT res = f_opendir(&dir, folder);
+  if (res != FR_OK) {
+    DPRINTF("Error opening directory %s: %d\n", folder, res);
+    return ROMINDEX_DIR_ERROR;
+  }
+
+  *newCount = 0;
+  *overflow = false;
+  bool error = false;
+  for (;;) {
+    res = f_readdir(&dir, &fno);
+    if (res != FR_OK || fno.fname[0] == 0) {
+      break;  // Break on error or end of directory
+    }
+    if (!isIndexed(&fno, filter)) {
+      continue;
+    }
+    romindex_entry_t key;
+    strncpy(key.filename, fno.fname, ROMINDEX_NAME_LENGTH - 1);
+    key.filename[ROMINDEX_NAME_LENGTH - 1] = '\0';
+
+    int idx = -1;
+    if (oldFile != NULL) {
+      idx = searchEntry(oldFile, oldCount, &key, &error);
+      if (error) {
+        break;
+      }
+    }
+    if (idx >= 0) {
+      if (seen != NULL) {
+        seen[idx / 8] |= (uint8_t)(1 << (idx % 8));
+      }
+    } else if (oldCount + *newCount >= ROMINDEX_MAX_ENTRIES) {
+      DPRINTF("Maximum ROM count reached (%d)\n", ROMINDEX_MAX_ENTRIES);
+    } else if (*newCount < ROMINDEX_MERGE_CHUNK) {
+      newEntries[(*newCount)++] = key;
+    } else {
+      *overflow = true;
+    }
+  }
+  f_closedir(&dir);
+  return error ? ROMINDEX_READ_ERROR : ROMINDEX_OK;
+}
+
+// Merge the old entries still present in the folder with the sorted new
+// entries into a new index file. Both inputs are sorted, so it is a single
+// sequential pass over the old file.
+static romindex_status_t mergeIndex(const char *tmpPath, FIL *oldFile,
+                                    int oldCount, const uint8_t *seen,
+                                    const romindex_entry_t *newEntries,
+                                    int newCount, romindex_header_t *header) {
+  FIL file;
+  UINT bytes;
+  FRESULT res = f_open(&file, tmpPath, FA_CREATE_ALWAYS | FA_WRITE);
+  if (res != FR_OK) {
+    DPRINTF("Error creating index file %s: %d\n", tmpPath, res);
+    return ROMINDEX_WRITE_ERROR;
+  }
+
+  romindex_status_t status = ROMINDEX_UPDATED;
+  header->count = 0;
+  res = f_write(&file, header, sizeof(romindex_header_t), &bytes);
+  if ((res != FR_OK) || (bytes != sizeof(romindex_header_t))) {
+    status = ROMINDEX_WRITE_ERROR;
+  }
+  if ((status >= 0) && (oldFile != NULL)) {
+    if (f_lseek(oldFile, sizeof(romindex_header_t)) != FR_OK) {
+      status = ROMINDEX_READ_ERROR;
+    }
+  }
+
+  int oldIdx = 0;
+  int newIdx = 0;
+  romindex_entry_t oldEntry;
+  bool hasOldEntry = false;
+  while (status >= 0) {
+    // Fetch the next old entry still present in the folder
+    while (!hasOldEntry && (oldFile != NULL) && (oldIdx < oldCount)) {
+      res = f_read(oldFile, &oldEntry, sizeof(romindex_entry_t), &bytes);
+      if ((res != FR_OK) || (bytes != sizeof(romindex_entry_t))) {
+        status = ROMINDEX_READ_ERROR;
+        break;
+      }
+      hasOldEntry = isSeen(seen, oldIdx++);
+    }
+    if ((status < 0) || (!hasOldEntry && (newIdx >= newCount))) {
+      break;
+    }
+    const romindex_entry_t *entry;
+    if (hasOldEntry && ((newIdx >= newCount) ||
+                        (compareEntries(&oldEntry, &newEntries[newIdx]) <= 0))) {
+      entry = &oldEntry;
+      hasOldEntry = false;
+    } else {
+      entry = &newEntries[newIdx++];
+    }
+    if (!writeEntry(&file, entry)) {
+      status = ROMINDEX_WRITE_ERROR;
+      break;
+    }
+    header->count++;
+  }
+
+  // Rewrite the header with the final count
+  if (status >= 0) {
+    res = f_lseek(&file, 0);
+    if (res == FR_OK) {
+      res = f_write(&file, header, sizeof(romindex_header_t), &bytes);
+    }
+    if ((res != FR_OK) || (bytes != sizeof(romindex_header_t))) {
+      status = ROMINDEX_WRITE_ERROR;
+    }
+  }
+  if ((f_close(&file) != FR_OK) && (status >= 0)) {
+    status = ROMINDEX_WRITE_ERROR;
+  }
+  if (status < 0) {
+    DPRINTF("Error writing index file %s: %d\n", tmpPath, status);
+    f_unlink(tmpPath);
+  }
+  return status;
+}
+
+romindex_status_t romindex_sync(const char *folder, romindex_filter_t filter,
+                                int *count) {
+  char indexPath[ROMINDEX_PATH_SIZE];
+  char tmpPath[ROMINDEX_PATH_SIZE];
+  getIndexPath(folder, ROMINDEX_FILENAME, indexPath, sizeof(indexPath));
+  getIndexPath(folder, ROMINDEX_TMP_FILENAME, tmpPath, sizeof(tmpPath));
+  *count = 0;
+
+  uint32_t dirFiles = 0;
+  uint32_t dirHash = 0;
+  bool hasSignature = signFolder(folder, filter, &dirFiles, &dirHash);
+
+  FIL oldFile;
+  romindex_header_t header;
+  int oldCount =
+      openIndex(indexPath, FA_READ | FA_WRITE, &oldFile, &header);
+  bool hasOld = (oldCount >= 0);
+  if (hasOld && hasSignature && (header.dirFiles == dirFiles) &&
+      (header.dirHash == dirHash)) {
+    // Fast path: the folder has not changed since the index was written
+    f_close(&oldFile);
+    DPRINTF("Index %s is up to date. %d entries.\n", indexPath, oldCount);
+    *count = oldCount;
+    return ROMINDEX_OK;
+  }
+  if (!hasOld) {
+    oldCount = 0;
+  }
+
+  // Taken from the scratch arena in this order, so seen can be given back
+  // first
+  romindex_entry_t *newEntries = (romindex_entry_t *)arena_alloc(
+      ARENA_SCRATCH, ROMINDEX_MERGE_CHUNK * sizeof(romindex_entry_t));
+  uint8_t *seen = NULL;
+  if ((oldCount > 0) && (newEntries != NULL)) {
+    seen = (uint8_t *)arena_alloc(ARENA_SCRATCH, (oldCount + 7) / 8);
+    if (seen != NULL) {
+      memset(seen, 0, (oldCount + 7) / 8);
+    }
+  }
+  if (((oldCount > 0) && (seen == NULL)) || (newEntries == NULL)) {
+    DPRINTF("Error allocating memory for the index rescan\n");
+    if (hasOld) {
+      f_close(&oldFile);
+    }
+    arena_free(ARENA_SCRATCH, newEntries);
+    return ROMINDEX_MEMORY_ERROR;
+  }
+
+  romindex_status_t status = ROMINDEX_UPDATED;
+  bool overflow = true;
+  while (overflow) {
+    int newCount = 0;
+    status = scanFolder(folder, filter, hasOld ? &oldFile : NULL, oldCount,
+                        seen, newEntries, &newCount, &overflow);
+    if (status < 0) {
+      break;
+    }
+    int removed = 0;
+    for (int i = 0; i < oldCount; i++) {
+      removed += isSeen(seen, i) ? 0 : 1;
+    }
+    DPRINTF("Index %s rescanned. %d new, %d removed.\n", indexPath, newCount,
+            removed);
+
+    // Only the last pass stores the signature, so an interrupted rebuild is
+    // never taken as valid. A file added meanwhile changes it again.
+    header.magic = ROMINDEX_MAGIC;
+    header.version = ROMINDEX_VERSION;
+    header.recordSize = sizeof(romindex_entry_t);
+    header.dirFiles = (hasSignature && !overflow) ? dirFiles : 0;
+    header.dirHash = (hasSignature && !overflow) ? dirHash : 0;
+
+    if (hasOld && (newCount == 0) && (removed == 0)) {
+      // Nothing changed but the signature. Rewrite the header in place.
+      UINT bytes;
+      header.count = (uint32_t)oldCount;
+      FRESULT res = f_lseek(&oldFile, 0);
+      if (res == FR_OK) {
+        res = f_write(&oldFile, &header, sizeof(header), &bytes);
+      }
+      if ((res != FR_OK) || (bytes != sizeof(header))) {
+        status = ROMINDEX_WRITE_ERROR;
+      }
+      break;
+    }
+
+    qsort(newEntries, newCount, sizeof(romindex_entry_t), compareEntries);
+    status = mergeIndex(tmpPath, hasOld ? &oldFile : NULL, oldCount, seen,
+                        newEntries, newCount, &header);
+    if (hasOld) {
+      f_close(&oldFile);
+      hasOld = false;
+    }
+    if (status < 0) {
+      break;
+    }
+    f_unlink(indexPath);
+    if (f_rename(tmpPath, indexPath) != FR_OK) {
+      DPRINTF("Error renaming index file %s\n", tmpPath);
+      status = ROMINDEX_WRITE_ERROR;
+      break;
+    }
+    oldCount = (int)header.count;
+
+    // Every entry in the new index is present in the folder. Next passes
+    // only look for new files.
+    arena_free(ARENA_SCRATCH, seen);
+    seen = NULL;
+    if (overflow) {
+      oldCount = openIndex(indexPath, FA_READ | FA_WRITE, &oldFile, &header);
+      hasOld = (oldCount >= 0);
+      if (!hasOld) {
+        status = ROMINDEX_READ_ERROR;
+        break;
+      }
+    }
+  }
+  if (hasOld) {
+    f_close(&oldFile);
+  }
+  arena_free(ARENA_SCRATCH, newEntries);  // And seen, taken after it
+
+  if (status >= 0) {
+    *count = oldCount;
+    DPRINTF("Index %s updated. %d entries.\n", indexPath, oldCount);
+  }
+  return status;
+}
+
+int romindex_readEntries(const char *folder, int first,
+                         romindex_entry_t *entries, int maxEntries) {
+  char indexPath[ROMINDEX_PATH_SIZE];
+  getIndexPath(folder, ROMINDEX_FILENAME, indexPath, sizeof(indexPath));
+
+  FIL file;
+  romindex_header_t header;
+  int count = openIndex(indexPath, FA_READ, &file, &header);
+  if (count < 0) {
+    return ROMINDEX_READ_ERROR;
+  }
+  if (first < 0 || first >= count) {
+    f_close(&file);
+    return 0;
+  }
+  if (maxEntries > count - first) {
+    maxEntries = count - first;
+  }
+  UINT bytesRead;
+  UINT size = maxEntries * sizeof(romindex_entry_t);
+  FRESULT res = f_lseek(&file, sizeof(romindex_header_t) +
+                                   (FSIZE_t)first * sizeof(romindex_entry_t));
+  if (res == FR_OK) {
+    res = f_read(&file, entries, size, &bytesRead);
+  }
+  f_close(&file);
+  if ((res != FR_OK) || (bytesRead != size)) {
+    DPRINTF("Error reading index file %s: %d\n", indexPath, res);
+    return ROMINDEX_READ_ERROR;
+  }
+  return maxEntries;
+}
+
+void romindex_invalidate(const char *folder) {
+  char indexPath[ROMINDEX_PATH_SIZE];
+  getIndexPath(folder, ROMINDEX_FILENAME, indexPath, sizeof(indexPath));
+
+  FIL file;
+  FRESULT res = f_open(&file, indexPath, FA_READ | FA_WRITE);
+  if (res != FR_OK) {
+    return;  // No index, nothing to invalidate
+  }
+  // Clear the signature but keep the entries for the incremental rescan
+  romindex_header_t header;
+  UINT bytes;
+  res = f_read(&file, &header, sizeof(header), &bytes);
+  if ((res == FR_OK) && (bytes == sizeof(header))) {
+    header.dirFiles = 0;
+    header.dirHash = 0;
+    res = f_lseek(&file, 0);
+    if (res == FR_OK) {
+      res = f_write(&file, &header, sizeof(header), &bytes);
+    }
+  }
+  f_close(&file);
+  DPRINTF("Index %s invalidated: %d\n", indexPath, res);
+}
@@ -0,0 +1,408 @@
+/**
+ * File: rompush.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: HTTP endpoint that loads a ROM image pushed over the network
+ * straight into the RAM of the ROM emulation, to test a new build of a ROM
+ * without copying it to the microSD card.
+ */
+
+#include "rompush.h"
+
+#define ROMPUSH_HTTP_OK 200
+
+static struct altcp_pcb *listener = NULL;
+static struct altcp_pcb *client = NULL;
+static volatile rompush_state_t state = ROMPUSH_STATE_CLOSED;
+static uint32_t romFlashAddress = 0;
+static int polls = 0;  // Polls without any data received
+static volatile bool loaded = false;
+
+// Request in progress
+static char head[ROMPUSH_HEAD_SIZE];
+static size_t headUsed = 0;
+static uint32_t contentLength = 0;
+static uint32_t received = 0;  // Bytes of the body, header included
+static uint32_t skip = 0;      // Bytes of the header to drop
+static bool persist = false;
+static bool expectContinue = false;
+static uint32_t startUs = 0;
+
+static rompush_stats_t stats;
+
+static err_t recvFn(void *arg, struct altcp_pcb *conn, struct pbuf *p,
+                    err_t err);
+static void errFn(void *arg, err_t err);
+static err_t pollFn(void *arg, struct altcp_pcb *conn);
+
+static const char *reasonPhrase(int status) {
+  switch (status) {
+    case ROMPUSH_HTTP_OK:
+      return "OK";
+    case 404:
+      return "Not Found";
+    case 405:
+      return "Method Not Allowed";
+    case 411:
+      return "Length Required";
+    case 413:
+      return "Payload Too Large";
+    case 503:
+      return "Service Unavailable";
+    default:
+      return "Bad Request";
+  }
+}
+
+static void writeAnswer(struct altcp_pcb *conn, int status, const char *text) {
+  char answer[ROMPUSH_ANSWER_SIZE + ROMPUSH_HEAD_SIZE / 4];
+  int len = snprintf(answer, sizeof(answer),
+                     "HTTP/1.1 %d %s\r\nContent-Type: text/plain\r\n"
+                     "Content-Length: %u\r\nConnection: close\r\n\r\n%s",
+                     status, reasonPhrase(status), (unsigned int)strlen(text),
+                     text);
+  if ((len > 0) && ((size_t)len < sizeof(answer))) {
+    altcp_write(conn, answer, (u16_t)len, TCP_WRITE_FLAG_COPY);
+    altcp_output(conn);
+  }
+}
+
+// Close the client connection. Returns ERR_ABRT if it had to be aborted,
+// which must be returned to lwIP when called from one of its callbacks.
+static err_t closeClient(void) {
+  err_t err = ERR_OK;
+  if (client != NULL) {
+    altcp_arg(client, NULL);
+    altcp_recv(client, NULL);
+    altcp_err(client, NULL);
+    altcp_poll(client, NULL, 0);
+    if (altcp_close(client) != ERR_OK) {
+      altcp_abort(client);
+      err = ERR_ABRT;
+    }
+    client = NULL;
+  }
+  state = (listener != NULL) ? ROMPUSH_STATE_LISTENING : ROMPUSH_STATE_CLOSED;
+  return err;
+}
+
+// The data sent with the answer is still delivered after the close
+static err_t answer(int status, const char *text) {
+  DPRINTF("ROM push answer %d: %s", status, text);
+  if (client != NULL) {
+    writeAnswer(client, status, text);
+  }
+  return closeClient();
+}
+
+// Gather the request line and headers. Returns the bytes used.
+static size_t feedHead(const uint8_t *data, size_t len) {
+  size_t used = 0;
+  while ((used < len) && (headUsed < sizeof(head) - 1)) {
+    head[headUsed++] = (char)data[used++];
+    if ((headUsed >= 4) && (memcmp(&head[headUsed - 4], "\r\n\r\n", 4) == 0)) {
+      head[headUsed] = '\0';
+      state = ROMPUSH_STATE_BODY;
+      break;
+    }
+  }
+  return used;
+}
+
+// Returns ROMPUSH_HTTP_OK if the request is a ROM image to load
+static int parseHead(void) {
+  char *savePtr = NULL;
+  char *line = strtok_r(head, "\r\n", &savePtr);
+  if (line == NULL) {
+    return 400;
+  }
+  char *target = strchr(line, ' ');
+  if (target == NULL) {
+    return 400;
+  }
+  *target++ = '\0';
+  if ((strcmp(line, "PUT") != 0) && (strcmp(line, "POST") != 0)) {
+    return 405;
+  }
+  char *version = strchr(target, ' ');
+  if (version != NULL) {
+    *version = '\0';
+  }
+  char *query = strchr(target, '?');
+  if (query != NULL) {
+    *query++ = '\0';
+  }
+  if (strcmp(target, ROMPUSH_PATH) != 0) {
+    return 404;
+  }
+  persist = (query != NULL) && (strstr(query, ROMPUSH_PERSIST_QUERY) != NULL);
+
+  bool hasLength = false;
+  expectContinue = false;
+  while ((line = strtok_r(NULL, "\r\n", &savePtr)) != NULL) {
+    if (strncasecmp(line, "Content-Length:", 15) == 0) {
+      contentLength = (uint32_t)strtoul(&line[15], NULL, 10);
+      hasLength = true;
+    } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+      return 411;  // The size must be known before writing the RAM
+    } else if (strncasecmp(line, "Expect:", 7) == 0) {
+      expectContinue = (strstr(&line[7], "100") != NULL);
+    }
+  }
+  if (!hasLength) {
+    return 411;
+  }
+  // A STEEM cartridge image is a whole ROM plus a zeroed header
+  skip = ((contentLength % ROM_SIZE_BYTES) == ROMPUSH_HEADER_SIZE)
+             ? ROMPUSH_HEADER_SIZE
+             : 0;
+  if ((contentLength <= skip) || (contentLength - skip > ROMPUSH_MAX_SIZE)) {
+    return 413;
+  }
+  return ROMPUSH_HTTP_OK;
+}
+
+// The bus reads 16-bit big endian words from the RAM, so each pair of bytes
+// is swapped as it is written
+static void writeBody(const uint8_t *data, size_t len) {
+  uint8_t *ram = (uint8_t *)&__rom_in_ram_start__;
+  for (size_t i = 0; i < len; i++, received++) {
+    if (received >= skip) {
+      ram[(received - skip) ^ 1] = data[i];
+    }
+  }
+}
+
+static err_t answerLoaded(void) {
+  char text[ROMPUSH_ANSWER_SIZE];
+  uint32_t kbPerSec =
+      (stats.receiveUs > 0)
+          ? (uint32_t)(((uint64_t)stats.bytes * 1000000u / 1024u) /
+                       stats.receiveUs)
+          : 0;
+  int len = snprintf(text, sizeof(text), "Loaded %u bytes in %u ms (%u KB/s).",
+                     (unsigned int)stats.bytes,
+                     (unsigned int)(stats.receiveUs / 1000),
+                     (unsigned int)kbPerSec);
+  if (persist && (len > 0) && ((size_t)len < sizeof(text))) {
+    snprintf(&text[len], sizeof(text) - len,
+             " Persisted in %u ms, %u sectors written.",
+             (unsigned int)(stats.persistUs / 1000),
+             (unsigned int)stats.sectors);
+  }
+  strncat(text, "\n", sizeof(text) - strlen(text) - 1);
+  return answer(ROMPUSH_HTTP_OK, text);
+}
+
+// The whole image is in the RAM. Clear what is left of the previous one.
+static err_t imageLoaded(void) {
+  uint8_t *ram = (uint8_t *)&__rom_in_ram_start__;
+  uint32_t size = contentLength - skip;
+  for (uint32_t pos = size; pos < ROMPUSH_MAX_SIZE; pos++) {
+    ram[pos ^ 1] = 0;
+  }
+  stats.bytes = size;
+  stats.receiveUs = time_us_32() - startUs;
+  stats.persistUs = 0;
+  stats.sectors = 0;
+  stats.pushes++;
+  loaded = true;
+  if (persist) {
+    // The flash is programmed from the main loop, out of the lwIP callbacks
+    state = ROMPUSH_STATE_PERSISTING;
+    return ERR_OK;
+  }
+  return answerLoaded();
+}
+
+// Program the image into the flash the ROM emulation boots from, skipping
+// the sectors that did not change. The RAM already has the byte order of the
+// flash.
+static void persistImage(void) {
+  uint32_t start = time_us_32();
+  const uint8_t *ram = (const uint8_t *)&__rom_in_ram_start__;
+  for (uint32_t offset = 0; offset < ROMPUSH_MAX_SIZE;
+       offset += FLASH_SECTOR_SIZE) {
+    if (memcmp((const void *)(romFlashAddress + offset), &ram[offset],
+               FLASH_SECTOR_SIZE) == 0) {
+      continue;
+    }
+    uint32_t flashOffset = romFlashAddress - XIP_BASE + offset;
+    // Core1 may be recording the bus from the flash
+    worker_lockoutStart();
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_erase(flashOffset, FLASH_SECTOR_SIZE);
+    flash_range_program(flashOffset, &ram[offset], FLASH_SECTOR_SIZE);
+    restore_interrupts(ints);
+    worker_lockoutEnd();
+    stats.sectors++;
+  }
+  stats.persistUs = time_us_32() - start;
+}
+
+static err_t recvFn(__unused void *arg, struct altcp_pcb *conn,
+                    struct pbuf *p, err_t err) {
+  if (p == NULL) {
+    if (state == ROMPUSH_STATE_PERSISTING) {
+      return ERR_OK;  // Still answered after persisting
+    }
+    if (state == ROMPUSH_STATE_BODY) {
+      DPRINTF("ROM push incomplete: %u of %u bytes\n", (unsigned int)received,
+              (unsigned int)contentLength);
+    }
+    return closeClient();
+  }
+  if ((err != ERR_OK) || (state == ROMPUSH_STATE_PERSISTING)) {
+    altcp_recved(conn, p->tot_len);
+    pbuf_free(p);
+    return ERR_OK;  // Nothing expected after the image
+  }
+
+  polls = 0;
+  err_t result = ERR_OK;
+  for (struct pbuf *q = p; (q != NULL) && (client != NULL) &&
+                           (state != ROMPUSH_STATE_PERSISTING);
+       q = q->next) {
+    const uint8_t *data = (const uint8_t *)q->payload;
+    size_t len = q->len;
+    if (state == ROMPUSH_STATE_HEAD) {
+      size_t used = feedHead(data, len);
+      data += used;
+      len -= used;
+      if (state == ROMPUSH_STATE_HEAD) {
+        if (headUsed >= sizeof(head) - 1) {
+          result = answer(400, "Headers too long.\n");
+        }
+        continue;
+      }
+      int status = parseHead();
+      if (status != ROMPUSH_HTTP_OK) {
+        result = answer(status, "Send the ROM image with PUT to " ROMPUSH_PATH
+                                ", 128KB at most.\n");
+        continue;
+      }
+      DPRINTF("ROM push of %u bytes%s\n", (unsigned int)contentLength,
+              persist ? ", persisted" : "");
+      if (expectContinue) {
+        altcp_write(conn, "HTTP/1.1 100 Continue\r\n\r\n", 25,
+                    TCP_WRITE_FLAG_COPY);
+        altcp_output(conn);
+      }
+      received = 0;
+      startUs = time_us_32();
+    }
+    uint32_t left = contentLength - received;
+    writeBody(data, (len < left) ? len : left);
+    if (received == contentLength) {
+      result = imageLoaded();
+    }
+  }
+  if (client != NULL) {
+    altcp_recved(conn, p->tot_len);
+  }
+  pbuf_free(p);
+  return result;
+}
+
+// The connection is already freed by lwIP
+static void errFn(__unused void *arg, err_t err) {
+  DPRINTF("ROM push connection error: %d\n", err);
+  client = NULL;
+  if (state != ROMPUSH_STATE_PERSISTING) {
+    state =
+        (listener != NULL) ? ROMPUSH_STATE_LISTENING : ROMPUSH_STATE_CLOSED;
+  }
+}
+
+static err_t pollFn(__unused void *arg, __unused struct altcp_pcb *conn) {
+  uint32_t elapsedMs = (uint32_t)(++polls) * ROMPUSH_POLL_MS;
+  if ((state != ROMPUSH_STATE_PERSISTING) &&
+      (elapsedMs >= ROMPUSH_TIMEOUT_MS)) {
+    DPRINTF("ROM push timeout\n");
+    return closeClient();
+  }
+  return ERR_OK;
+}
+
+static err_t acceptFn(__unused void *arg, struct altcp_pcb *conn, err_t err) {
+  if ((err != ERR_OK) || (conn == NULL)) {
+    return ERR_VAL;
+  }
+  if ((client != NULL) || (state == ROMPUSH_STATE_PERSISTING)) {
+    // One image at a time
+    writeAnswer(conn, 503, "Busy loading another image.\n");
+    if (altcp_close(conn) != ERR_OK) {
+      altcp_abort(conn);
+      return ERR_ABRT;
+    }
+    return ERR_OK;
+  }
+  client = conn;
+  altcp_arg(client, NULL);
+  altcp_recv(client, recvFn);
+  altcp_err(client, errFn);
+  altcp_poll(client, pollFn, ROMPUSH_POLL_INTERVAL);
+  headUsed = 0;
+  contentLength = 0;
+  received = 0;
+  skip = 0;
+  persist = false;
+  polls = 0;
+  state = ROMPUSH_STATE_HEAD;
+  return ERR_OK;
+}
+
+rompush_result_t rompush_start(uint16_t port, uint32_t flashAddress) {
+  rompush_stop();
+  romFlashAddress = flashAddress;
+  rompush_result_t result = ROMPUSH_LISTEN_ERROR;
+  cyw43_arch_lwip_begin();
+  struct altcp_pcb *pcb = altcp_new_ip_type(NULL, IPADDR_TYPE_ANY);
+  if (pcb != NULL) {
+    err_t err = altcp_bind(pcb, IP_ANY_TYPE, port);
+    if (err == ERR_OK) {
+      // Frees the pcb if listening
+      listener = altcp_listen(pcb);
+    }
+    if (listener == NULL) {
+      DPRINTF("Error listening on port %u: %d\n", (unsigned int)port, err);
+      altcp_close(pcb);
+    } else {
+      altcp_accept(listener, acceptFn);
+      state = ROMPUSH_STATE_LISTENING;
+      result = ROMPUSH_OK;
+      DPRINTF("Listening for ROM images on port %u\n", (unsigned int)port);
+    }
+  }
+  cyw43_arch_lwip_end();
+  return result;
+}
+
+bool rompush_poll(void) {
+  if (state == ROMPUSH_STATE_PERSISTING) {
+    persistImage();
+    cyw43_arch_lwip_begin();
+    if (answerLoaded() == ERR_ABRT) {
+      DPRINTF("ROM push answer aborted\n");
+    }
+    cyw43_arch_lwip_end();
+  }
+  bool result = loaded;
+  loaded = false;
+  return result;
+}
+
+void rompush_stop(void) {
+  cyw43_arch_lwip_begin();
+  closeClient();
+  if (listener != NULL) {
+    altcp_accept(listener, NULL);
+    altcp_close(listener);
+    listener = NULL;
+  }
+  state = ROMPUSH_STATE_CLOSED;
+  cyw43_arch_lwip_end();
+}
+
+const rompush_stats_t *rompush_getStats(void) { return &stats; }
@@ -0,0 +1,394 @@
+/**
+ * File: romsearch.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Inverted search index of the ROM catalog
+ */
+
+#include "romsearch.h"
+
+// State of the producer of postings fed to the external sort
+typedef struct {
+  romsearch_next_t next;
+  void *context;
+  const char *name;
+  const char *tags;
+  int32_t record;  // Record being split. -1 before the first one.
+} build_state_t;
+
+// Records matched by all the words so far, and by the current word
+static uint8_t matchBits[ROMSEARCH_MAX_RECORDS / 8];
+static uint8_t termBits[ROMSEARCH_MAX_RECORDS / 8];
+
+// Copy the next word of a string as a lowercase token after the prefix.
+// Words are runs of letters and digits. Returns false at the end.
+static bool nextToken(const char **ptr, char *token, size_t prefixLength) {
+  const char *src = *ptr;
+  for (;;) {
+    while (*src && !isalnum((unsigned char)*src)) src++;
+    if (*src == '\0') {
+      *ptr = src;
+      return false;
+    }
+    size_t len = prefixLength;
+    size_t wordLength = 0;
+    while (isalnum((unsigned char)*src)) {
+      if (len < ROMSEARCH_TOKEN_LENGTH - 1) {
+        token[len++] = (char)tolower((unsigned char)*src);
+      }
+      wordLength++;
+      src++;
+    }
+    token[len] = '\0';
+    if (wordLength >= ROMSEARCH_MIN_TOKEN) {
+      *ptr = src;
+      return true;
+    }
+  }
+}
+
+static bool nextPosting(void *record, void *context) {
+  romsearch_posting_t *posting = (romsearch_posting_t *)record;
+  build_state_t *state = (build_state_t *)context;
+  worker_yield();  // Built in core1
+  memset(posting, 0, sizeof(romsearch_posting_t));
+  for (;;) {
+    if ((state->record >= 0) && (state->name != NULL)) {
+      if (nextToken(&state->name, posting->token, 0)) {
+        posting->record = (uint32_t)state->record;
+        return true;
+      }
+      state->name = NULL;
+    }
+    if ((state->record >= 0) && (state->tags != NULL)) {
+      posting->token[0] = ROMSEARCH_TAG_PREFIX;
+      if (nextToken(&state->tags, posting->token, 1)) {
+        posting->record = (uint32_t)state->record;
+        return true;
+      }
+      state->tags = NULL;
+    }
+    if ((state->record + 1 >= ROMSEARCH_MAX_RECORDS) ||
+        !state->next(&state->name, &state->tags, state->context)) {
+      return false;
+    }
+    state->record++;
+  }
+}
+
+static int comparePostings(const void *first, const void *second) {
+  const romsearch_posting_t *postingA = (const romsearch_posting_t *)first;
+  const romsearch_posting_t *postingB = (const romsearch_posting_t *)second;
+  int cmp = strncmp(postingA->token, postingB->token, ROMSEARCH_TOKEN_LENGTH);
+  if (cmp != 0) {
+    return cmp;
+  }
+  return (postingA->record > postingB->record) -
+         (postingA->record < postingB->record);
+}
+
+static bool readPosting(FIL *file, romsearch_posting_t *posting) {
+  UINT bytes;
+  FRESULT res = f_read(file, posting, sizeof(romsearch_posting_t), &bytes);
+  return (res == FR_OK) && (bytes == sizeof(romsearch_posting_t));
+}
+
+static bool writeBytes(FIL *file, const void *data, UINT size) {
+  UINT bytes;
+  FRESULT res = f_write(file, data, size, &bytes);
+  return (res == FR_OK) && (bytes == size);
+}
+
+// Copy the sorted postings after the header, dropping the duplicated ones.
+// The header goes last, so an interrupted build leaves no valid magic.
+static romsearch_status_t writeIndex(const char *sortedPath,
+                                     const char *idxPath, int count,
+                                     const romsearch_stamp_t *stamp) {
+  FIL sortedFile;
+  FIL idxFile;
+  if ((count > 0) && (f_open(&sortedFile, sortedPath, FA_READ) != FR_OK)) {
+    return ROMSEARCH_OPEN_ERROR;
+  }
+  if (f_open(&idxFile, idxPath, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+    if (count > 0) {
+      f_close(&sortedFile);
+    }
+    return ROMSEARCH_WRITE_ERROR;
+  }
+
+  romsearch_header_t header = {
+      .magic = 0,
+      .version = ROMSEARCH_VERSION,
+      .tokenLength = ROMSEARCH_TOKEN_LENGTH,
+      .count = 0,
+      .stamp = *stamp,
+  };
+  romsearch_status_t status = ROMSEARCH_OK;
+  if (!writeBytes(&idxFile, &header, sizeof(header))) {
+    status = ROMSEARCH_WRITE_ERROR;
+  }
+  romsearch_posting_t posting;
+  romsearch_posting_t previous;
+  for (int i = 0; (status == ROMSEARCH_OK) && (i < count); i++) {
+    worker_yield();  // Built in core1
+    if (!readPosting(&sortedFile, &posting)) {
+      status = ROMSEARCH_READ_ERROR;
+      break;
+    }
+    if ((header.count > 0) && (comparePostings(&posting, &previous) == 0)) {
+      continue;
+    }
+    if (!writeBytes(&idxFile, &posting, sizeof(posting))) {
+      status = ROMSEARCH_WRITE_ERROR;
+      break;
+    }
+    previous = posting;
+    header.count++;
+  }
+  if (status == ROMSEARCH_OK) {
+    header.magic = ROMSEARCH_MAGIC;
+    if ((f_lseek(&idxFile, 0) != FR_OK) ||
+        !writeBytes(&idxFile, &header, sizeof(header))) {
+      status = ROMSEARCH_WRITE_ERROR;
+    }
+  }
+  if (count > 0) {
+    f_close(&sortedFile);
+  }
+  if ((f_close(&idxFile) != FR_OK) && (status == ROMSEARCH_OK)) {
+    status = ROMSEARCH_WRITE_ERROR;
+  }
+  return status;
+}
+
+romsearch_status_t romsearch_build(const char *idxPath, const char *tmpPathA,
+                                   const char *tmpPathB,
+                                   const romsearch_stamp_t *stamp,
+                                   romsearch_next_t next, void *context) {
+  f_unlink(idxPath);
+  build_state_t state = {
+      .next = next,
+      .context = context,
+      .name = NULL,
+      .tags = NULL,
+      .record = -1,
+  };
+  int count = 0;
+  const char *sortedPath = tmpPathA;
+  extsort_status_t sortStatus =
+      extsort_sort(tmpPathA, tmpPathB, sizeof(romsearch_posting_t),
+                   nextPosting, &state, comparePostings, &count, &sortedPath);
+  romsearch_status_t status;
+  switch (sortStatus) {
+    case EXTSORT_OK:
+      status = writeIndex(sortedPath, idxPath, count, stamp);
+      break;
+    case EXTSORT_MEMORY_ERROR:
+      status = ROMSEARCH_MEMORY_ERROR;
+      break;
+    case EXTSORT_WRITE_ERROR:
+      status = ROMSEARCH_WRITE_ERROR;
+      break;
+    default:
+      status = ROMSEARCH_READ_ERROR;
+      break;
+  }
+  f_unlink(tmpPathA);
+  f_unlink(tmpPathB);
+  if (status != ROMSEARCH_OK) {
+    DPRINTF("Error building search index %s: %d\n", idxPath, status);
+    f_unlink(idxPath);
+    return status;
+  }
+  DPRINTF("Search index %s built. %d records, %d postings.\n", idxPath,
+          (int)(state.record + 1), count);
+  return ROMSEARCH_OK;
+}
+
+static bool readHeader(FIL *file, romsearch_header_t *header) {
+  UINT bytes;
+  FRESULT res = f_read(file, header, sizeof(romsearch_header_t), &bytes);
+  return (res == FR_OK) && (bytes == sizeof(romsearch_header_t)) &&
+         (header->magic == ROMSEARCH_MAGIC) &&
+         (header->version == ROMSEARCH_VERSION) &&
+         (header->tokenLength == ROMSEARCH_TOKEN_LENGTH) &&
+         (f_size(file) == sizeof(romsearch_header_t) +
+                              (FSIZE_t)header->count *
+                                  sizeof(romsearch_posting_t));
+}
+
+bool romsearch_isValid(const char *idxPath, const romsearch_stamp_t *stamp) {
+  FIL file;
+  if (f_open(&file, idxPath, FA_READ) != FR_OK) {
+    return false;
+  }
+  romsearch_header_t header;
+  bool valid = readHeader(&file, &header) &&
+               (header.stamp.count == stamp->count) &&
+               (header.stamp.size == stamp->size) &&
+               (header.stamp.date == stamp->date) &&
+               (header.stamp.time == stamp->time);
+  f_close(&file);
+  return valid;
+}
+
+// Split a query in lowercase terms. Tag terms keep their prefix.
+static int parseQuery(const char *query,
+                      char terms[ROMSEARCH_MAX_TERMS][ROMSEARCH_TOKEN_LENGTH]) {
+  int count = 0;
+  const char *ptr = query;
+  while (count < ROMSEARCH_MAX_TERMS) {
+    while (*ptr && !isalnum((unsigned char)*ptr) &&
+           (*ptr != ROMSEARCH_TAG_PREFIX)) {
+      ptr++;
+    }
+    if (*ptr == '\0') {
+      break;
+    }
+    size_t len = 0;
+    if (*ptr == ROMSEARCH_TAG_PREFIX) {
+      terms[count][len++] = *ptr++;
+      if (!isalnum((unsigned char)*ptr)) {
+        continue;  // Prefix alone
+      }
+    }
+    while (isalnum((unsigned char)*ptr)) {
+      if (len < ROMSEARCH_TOKEN_LENGTH - 1) {
+        terms[count][len++] = (char)tolower((unsigned char)*ptr);
+      }
+      ptr++;
+    }
+    terms[count][len] = '\0';
+    count++;
+  }
+  return count;
+}
+
+// Mark in termBits the records with a token starting with the prefix
+static romsearch_status_t scanPrefix(FIL *file, uint32_t count,
+                                     const char *prefix) {
+  size_t prefixLength = strlen(prefix);
+  romsearch_posting_t posting;
+
+  // Lower bound of the prefix in the sorted postings
+  uint32_t low = 0;
+  uint32_t high = count;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if ((f_lseek(file, sizeof(romsearch_header_t) +
+                           (FSIZE_t)mid * sizeof(romsearch_posting_t)) !=
+         FR_OK) ||
+        !readPosting(file, &posting)) {
+      return ROMSEARCH_READ_ERROR;
+    }
+    if (strncmp(posting.token, prefix, ROMSEARCH_TOKEN_LENGTH) < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  // The postings matching are consecutive from there
+  if (f_lseek(file, sizeof(romsearch_header_t) +
+                        (FSIZE_t)low * sizeof(romsearch_posting_t)) != FR_OK) {
+    return ROMSEARCH_READ_ERROR;
+  }
+  for (uint32_t i = low; i < count; i++) {
+    if (!readPosting(file, &posting)) {
+      return ROMSEARCH_READ_ERROR;
+    }
+    if (strncmp(posting.token, prefix, prefixLength) != 0) {
+      break;
+    }
+    if (posting.record < ROMSEARCH_MAX_RECORDS) {
+      termBits[posting.record / 8] |= (uint8_t)(1 << (posting.record % 8));
+    }
+  }
+  return ROMSEARCH_OK;
+}
+
+romsearch_status_t romsearch_query(const char *idxPath, const char *query,
+                                   uint16_t *results, int maxResults,
+                                   int *count, bool *truncated) {
+  *count = 0;
+  *truncated = false;
+  char terms[ROMSEARCH_MAX_TERMS][ROMSEARCH_TOKEN_LENGTH];
+  int termsCount = parseQuery(query, terms);
+  if (termsCount == 0) {
+    return ROMSEARCH_QUERY_ERROR;
+  }
+
+  FIL file;
+  if (f_open(&file, idxPath, FA_READ) != FR_OK) {
+    return ROMSEARCH_OPEN_ERROR;
+  }
+  romsearch_header_t header;
+  if (!readHeader(&file, &header)) {
+    f_close(&file);
+    return ROMSEARCH_READ_ERROR;
+  }
+
+  romsearch_status_t status = ROMSEARCH_OK;
+  memset(matchBits, 0xFF, sizeof(matchBits));
+  for (int t = 0; (status == ROMSEARCH_OK) && (t < termsCount); t++) {
+    memset(termBits, 0, sizeof(termBits));
+    status = scanPrefix(&file, header.count, terms[t]);
+    if ((status == ROMSEARCH_OK) && (terms[t][0] != ROMSEARCH_TAG_PREFIX)) {
+      // A plain word matches the tags too
+      char tagTerm[ROMSEARCH_TOKEN_LENGTH];
+      snprintf(tagTerm, sizeof(tagTerm), "%c%s", ROMSEARCH_TAG_PREFIX,
+               terms[t]);
+      status = scanPrefix(&file, header.count, tagTerm);
+    }
+    for (size_t i = 0; i < sizeof(matchBits); i++) {
+      matchBits[i] &= termBits[i];
+    }
+  }
+  f_close(&file);
+  if (status != ROMSEARCH_OK) {
+    return status;
+  }
+
+  uint32_t records = header.stamp.count < ROMSEARCH_MAX_RECORDS
+                         ? header.stamp.count
+                         : ROMSEARCH_MAX_RECORDS;
+  for (uint32_t record = 0; record < records; record++) {
+    if (matchBits[record / 8] & (1 << (record % 8))) {
+      if (*count == maxResults) {
+        *truncated = true;
+        break;
+      }
+      results[(*count)++] = (uint16_t)record;
+    }
+  }
+  return ROMSEARCH_OK;
+}
+
+// True if any word of the text starts with the term
+static bool matchesText(const char *term, const char *text) {
+  char token[ROMSEARCH_TOKEN_LENGTH];
+  const char *ptr = text;
+  while (nextToken(&ptr, token, 0)) {
+    if (strncmp(token, term, strlen(term)) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool romsearch_matches(const char *query, const char *name, const char *tags) {
+  char terms[ROMSEARCH_MAX_TERMS][ROMSEARCH_TOKEN_LENGTH];
+  int termsCount = parseQuery(query, terms);
+  if (termsCount == 0) {
+    return false;
+  }
+  for (int t = 0; t < termsCount; t++) {
+    bool isTag = (terms[t][0] == ROMSEARCH_TAG_PREFIX);
+    const char *term = isTag ? &terms[t][1] : terms[t];
+    if (!matchesText(term, tags) && (isTag || !matchesText(term, name))) {
+      return false;
+    }
+  }
+  return true;
+}
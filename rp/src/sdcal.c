@@ -0,0 +1,332 @@
+/**
+ * File: sdcal.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Benchmark of the SD card and calibration of its SPI clock
+ */
+
+#include "sdcal.h"
+
+static sd_card_t *getSdCard(void) {
+  size_t sdNum = sd_get_num();
+  return (sdNum > 0) ? sd_get_by_num(sdNum - 1) : NULL;
+}
+
+// Applies the clock now, and to the next initialization of the card.
+// Returns the clock the SPI can generate closest to the one asked.
+static uint32_t setSpiClock(uint32_t baudRateKb) {
+  sd_card_t *sdCard = getSdCard();
+  if (sdCard == NULL) {
+    return 0;
+  }
+  spi_t *spi = sdCard->spi_if_p->spi;
+  spi->baud_rate = baudRateKb * SDCARD_KILOBAUD;
+  return spi_set_baudrate(spi->hw_inst, spi->baud_rate) / SDCARD_KILOBAUD;
+}
+
+uint32_t sdcal_getSpiSpeed(void) {
+  sd_card_t *sdCard = getSdCard();
+  if (sdCard == NULL) {
+    return 0;
+  }
+  return spi_get_baudrate(sdCard->spi_if_p->spi->hw_inst) / SDCARD_KILOBAUD;
+}
+
+// FNV-1a of the CID register, read when the card was initialized
+uint32_t sdcal_getCardId(void) {
+  sd_card_t *sdCard = getSdCard();
+  if (sdCard == NULL) {
+    return 0;
+  }
+  const uint8_t *cid = (const uint8_t *)&sdCard->state.CID;
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < sizeof(sdCard->state.CID); i++) {
+    hash = (hash ^ cid[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// CRC-32 (IEEE 802.3), a nibble at a time to keep the table small
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len) {
+  static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+      0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  crc = ~crc;
+  while (len-- > 0) {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+// xorshift32. The state must not be zero.
+static uint32_t nextRandom(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// A different pattern for each seed, so stale data on the card never matches
+static void fillPattern(uint8_t *buffer, size_t len, uint32_t seed) {
+  uint32_t state = seed | 1;
+  for (size_t i = 0; i + sizeof(uint32_t) <= len; i += sizeof(uint32_t)) {
+    uint32_t value = nextRandom(&state);
+    memcpy(&buffer[i], &value, sizeof(value));
+  }
+}
+
+static uint32_t kbPerSec(uint32_t bytes, uint32_t elapsedUs) {
+  if (elapsedUs == 0) {
+    return 0;
+  }
+  return (uint32_t)(((uint64_t)bytes * 1000000u / 1024u) / elapsedUs);
+}
+
+static sdcal_status_t benchSequential(FIL *file, uint8_t *buffer,
+                                      sdcal_bench_t *bench) {
+  uint32_t seed = time_us_32();
+  uint32_t crcWritten = 0;
+  uint32_t elapsedUs = 0;
+  UINT bytes;
+  for (uint32_t offset = 0; offset < SDCAL_BENCH_SIZE;
+       offset += SDCAL_BENCH_CHUNK) {
+    select_poll();  // SELECT still resets during the measure
+    fillPattern(buffer, SDCAL_BENCH_CHUNK, seed ^ offset);
+    crcWritten = crc32Update(crcWritten, buffer, SDCAL_BENCH_CHUNK);
+    uint32_t start = time_us_32();
+    FRESULT res = f_write(file, buffer, SDCAL_BENCH_CHUNK, &bytes);
+    elapsedUs += time_us_32() - start;
+    if ((res != FR_OK) || (bytes != SDCAL_BENCH_CHUNK)) {
+      DPRINTF("Error writing the scratch file: %d\n", res);
+      return SDCAL_IO_ERROR;
+    }
+  }
+  uint32_t start = time_us_32();
+  FRESULT res = f_sync(file);
+  elapsedUs += time_us_32() - start;
+  if (res != FR_OK) {
+    return SDCAL_IO_ERROR;
+  }
+  bench->seqWriteKbs = kbPerSec(SDCAL_BENCH_SIZE, elapsedUs);
+
+  if (f_lseek(file, 0) != FR_OK) {
+    return SDCAL_IO_ERROR;
+  }
+  uint32_t crcRead = 0;
+  elapsedUs = 0;
+  for (uint32_t offset = 0; offset < SDCAL_BENCH_SIZE;
+       offset += SDCAL_BENCH_CHUNK) {
+    select_poll();
+    start = time_us_32();
+    res = f_read(file, buffer, SDCAL_BENCH_CHUNK, &bytes);
+    elapsedUs += time_us_32() - start;
+    if ((res != FR_OK) || (bytes != SDCAL_BENCH_CHUNK)) {
+      DPRINTF("Error reading the scratch file: %d\n", res);
+      return SDCAL_IO_ERROR;
+    }
+    crcRead = crc32Update(crcRead, buffer, SDCAL_BENCH_CHUNK);
+  }
+  bench->seqReadKbs = kbPerSec(SDCAL_BENCH_SIZE, elapsedUs);
+  if (crcRead != crcWritten) {
+    DPRINTF("CRC mismatch: written 0x%08X, read 0x%08X\n",
+            (unsigned int)crcWritten, (unsigned int)crcRead);
+    return SDCAL_VERIFY_ERROR;
+  }
+  return SDCAL_OK;
+}
+
+static sdcal_status_t benchRandom(FIL *file, uint8_t *buffer,
+                                  sdcal_bench_t *bench) {
+  const uint32_t blocks = SDCAL_BENCH_SIZE / SDCAL_BENCH_RANDOM_SIZE;
+  const uint32_t total = SDCAL_BENCH_RANDOM_COUNT * SDCAL_BENCH_RANDOM_SIZE;
+  uint32_t state = time_us_32() | 1;
+  uint32_t elapsedUs = 0;
+  UINT bytes;
+  for (int i = 0; i < SDCAL_BENCH_RANDOM_COUNT; i++) {
+    select_poll();
+    FSIZE_t offset = (FSIZE_t)(nextRandom(&state) % blocks) *
+                     SDCAL_BENCH_RANDOM_SIZE;
+    uint32_t start = time_us_32();
+    FRESULT res = f_lseek(file, offset);
+    if (res == FR_OK) {
+      res = f_read(file, buffer, SDCAL_BENCH_RANDOM_SIZE, &bytes);
+    }
+    elapsedUs += time_us_32() - start;
+    if ((res != FR_OK) || (bytes != SDCAL_BENCH_RANDOM_SIZE)) {
+      return SDCAL_IO_ERROR;
+    }
+  }
+  bench->randReadKbs = kbPerSec(total, elapsedUs);
+
+  elapsedUs = 0;
+  for (int i = 0; i < SDCAL_BENCH_RANDOM_COUNT; i++) {
+    select_poll();
+    FSIZE_t offset = (FSIZE_t)(nextRandom(&state) % blocks) *
+                     SDCAL_BENCH_RANDOM_SIZE;
+    uint32_t start = time_us_32();
+    FRESULT res = f_lseek(file, offset);
+    if (res == FR_OK) {
+      res = f_write(file, buffer, SDCAL_BENCH_RANDOM_SIZE, &bytes);
+    }
+    elapsedUs += time_us_32() - start;
+    if ((res != FR_OK) || (bytes != SDCAL_BENCH_RANDOM_SIZE)) {
+      return SDCAL_IO_ERROR;
+    }
+  }
+  uint32_t start = time_us_32();
+  FRESULT res = f_sync(file);
+  elapsedUs += time_us_32() - start;
+  bench->randWriteKbs = kbPerSec(total, elapsedUs);
+  return (res == FR_OK) ? SDCAL_OK : SDCAL_IO_ERROR;
+}
+
+sdcal_status_t sdcal_bench(const char *path, sdcal_bench_t *bench) {
+  memset(bench, 0, sizeof(sdcal_bench_t));
+  bench->baudRateKb = sdcal_getSpiSpeed();
+  uint8_t *buffer = arena_alloc(ARENA_SCRATCH, SDCAL_BENCH_CHUNK);
+  if (buffer == NULL) {
+    return SDCAL_NOMEM_ERROR;
+  }
+  FIL file;
+  FRESULT res = f_open(&file, path, FA_CREATE_ALWAYS | FA_READ | FA_WRITE);
+  if (res != FR_OK) {
+    DPRINTF("Error creating the scratch file %s: %d\n", path, res);
+    arena_free(ARENA_SCRATCH, buffer);
+    return SDCAL_FILE_ERROR;
+  }
+#if FF_USE_EXPAND
+  // Clusters reserved up front, as the downloads do
+  f_expand(&file, SDCAL_BENCH_SIZE, 0);
+#endif
+  sdcal_status_t status = benchSequential(&file, buffer, bench);
+  if (status == SDCAL_OK) {
+    status = benchRandom(&file, buffer, bench);
+  }
+  f_close(&file);
+  f_unlink(path);
+  arena_free(ARENA_SCRATCH, buffer);
+  DPRINTF("SD bench at %u Kbit/s: %d. Write %u KB/s, read %u KB/s\n",
+          (unsigned int)bench->baudRateKb, status,
+          (unsigned int)bench->seqWriteKbs, (unsigned int)bench->seqReadKbs);
+  return status;
+}
+
+// Write and read back the sectors of the scratch file, checked with a CRC-32
+static bool checkSectors(BYTE pdrv, LBA_t sector, uint8_t *buffer) {
+  const UINT count = SDCAL_BENCH_CHUNK / NUM_BYTES_PER_SECTOR;
+  uint32_t seed = time_us_32();
+  for (int pass = 0; pass < SDCAL_CALIBRATION_PASSES; pass++) {
+    for (uint32_t offset = 0; offset < SDCAL_CALIBRATION_SIZE;
+         offset += SDCAL_BENCH_CHUNK) {
+      select_poll();
+      LBA_t first = sector + offset / NUM_BYTES_PER_SECTOR;
+      fillPattern(buffer, SDCAL_BENCH_CHUNK, seed ^ (offset + pass));
+      uint32_t crc = crc32Update(0, buffer, SDCAL_BENCH_CHUNK);
+      if (disk_write(pdrv, buffer, first, count) != RES_OK) {
+        return false;
+      }
+      memset(buffer, 0, SDCAL_BENCH_CHUNK);
+      if ((disk_read(pdrv, buffer, first, count) != RES_OK) ||
+          (crc32Update(0, buffer, SDCAL_BENCH_CHUNK) != crc)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+sdcal_status_t sdcal_calibrate(FATFS *fsPtr, const char *path, char *record,
+                               size_t size) {
+#if FF_USE_EXPAND
+  uint8_t *buffer = arena_alloc(ARENA_SCRATCH, SDCAL_BENCH_CHUNK);
+  if (buffer == NULL) {
+    return SDCAL_NOMEM_ERROR;
+  }
+  // A contiguous file, so its sectors can be written directly without
+  // touching the FAT or the directory at an unreliable clock
+  FIL file;
+  BYTE pdrv = 0;
+  LBA_t sector = 0;
+  FRESULT res = f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE);
+  if (res == FR_OK) {
+    res = f_expand(&file, SDCAL_CALIBRATION_SIZE, 1);
+    pdrv = file.obj.fs->pdrv;
+    sector = file.obj.fs->database +
+             (LBA_t)(file.obj.sclust - 2) * file.obj.fs->csize;
+    f_close(&file);
+  }
+  if (res != FR_OK) {
+    DPRINTF("Error creating the scratch file %s: %d\n", path, res);
+    f_unlink(path);
+    arena_free(ARENA_SCRATCH, buffer);
+    return SDCAL_FILE_ERROR;
+  }
+
+  uint32_t goodKb = sdcal_getSpiSpeed();
+  sdcal_status_t status = checkSectors(pdrv, sector, buffer)
+                                     ? SDCAL_OK
+                                     : SDCAL_VERIFY_ERROR;
+  // The SPI clock is the peripheral clock divided by an even number
+  uint32_t periKb = clock_get_hz(clk_peri) / SDCARD_KILOBAUD;
+  for (uint32_t divisor = (periKb / goodKb) & ~1u;
+       (status == SDCAL_OK) && (divisor >= 2); divisor -= 2) {
+    uint32_t candidateKb = periKb / divisor;
+    if (candidateKb <= goodKb) {
+      continue;
+    }
+    if (candidateKb > SDCAL_CALIBRATION_MAX_KB) {
+      break;
+    }
+    uint32_t actualKb = setSpiClock(candidateKb);
+    DPRINTF("Checking the SD card at %u Kbit/s\n", (unsigned int)actualKb);
+    if (checkSectors(pdrv, sector, buffer)) {
+      goodKb = actualKb;
+      continue;
+    }
+    DPRINTF("SD card failed at %u Kbit/s\n", (unsigned int)actualKb);
+    // Initialize the card again at the last good clock
+    setSpiClock(goodKb);
+    getSdCard()->state.m_Status |= STA_NOINIT;
+    f_mount(NULL, "0:", 0);
+    if (f_mount(fsPtr, "0:", 1) != FR_OK) {
+      status = SDCAL_MOUNT_ERROR;
+    }
+    break;
+  }
+  f_unlink(path);
+  arena_free(ARENA_SCRATCH, buffer);
+  if (status == SDCAL_OK) {
+    snprintf(record, size, "%08x,%u", (unsigned int)sdcal_getCardId(),
+             (unsigned int)goodKb);
+    DPRINTF("SD card calibrated: %s\n", record);
+  }
+  return status;
+#else
+  return SDCAL_FILE_ERROR;
+#endif
+}
+
+bool sdcal_applyCalibration(const char *record) {
+  unsigned int cardId;
+  unsigned int baudRateKb;
+  if ((record == NULL) ||
+      (sscanf(record, "%8x,%u", &cardId, &baudRateKb) !=
+       SDCAL_CALIBRATION_FIELDS) ||
+      (baudRateKb == 0)) {
+    return false;
+  }
+  if (cardId != sdcal_getCardId()) {
+    DPRINTF("SD card calibration of another card. Ignored.\n");
+    return false;
+  }
+  setSpiClock(baudRateKb);
+  DPRINTF("Calibrated SD card clock: %u Kbit/s\n",
+          (unsigned int)sdcal_getSpiSpeed());
+  return true;
+}
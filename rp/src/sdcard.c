@@ -129,3 +129,16 @@ void sdcard_getInfo(FATFS *fsPtr, uint32_t *totalSizeMb,
   // Convert bytes to megabytes
   *freeSpaceMb = freeSpaceBytes / SDCARD_MEGABYTE;
 }
+
+FRESULT sdcard_getFreeBytes(uint64_t *freeBytes) {
+  DWORD freClust;
+  FATFS *fsPtr;
+  *freeBytes = 0;
+  FRESULT res = f_getfree("", &freClust, &fsPtr);
+  if (res != FR_OK) {
+    DPRINTF("Error getting free space information: %d\n", res);
+    return res;
+  }
+  *freeBytes = (uint64_t)freClust * fsPtr->csize * NUM_BYTES_PER_SECTOR;
+  return FR_OK;
+}
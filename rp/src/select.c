@@ -4,19 +4,95 @@ static reset_callback_t __not_in_flash_func(reset_cb) = NULL;
 static reset_callback_t __not_in_flash_func(reset_long_cb) =
     NULL;  // New long-press callback
 
+// Events written by the interrupts and read by the main loop
+static select_event_t events[SELECT_EVENT_QUEUE_SIZE];
+static volatile uint32_t eventsHead = 0;
+static volatile uint32_t eventsTail = 0;
+
+// State of the button after debouncing
+static volatile bool pressed = false;
+static volatile uint32_t pressUs = 0;
+static volatile bool debouncing = false;
+static volatile alarm_id_t longAlarm = 0;
+
+static void __not_in_flash_func(pushEvent)(select_event_type_t type,
+                                           uint32_t timeUs) {
+  uint32_t next = (eventsHead + 1) % SELECT_EVENT_QUEUE_SIZE;
+  if (next == eventsTail) {
+    return;  // Full. Nobody is reading the events.
+  }
+  uint32_t durationUs = (type == SELECT_EVENT_PRESS) ? 0 : timeUs - pressUs;
+  events[eventsHead].type = type;
+  events[eventsHead].timeUs = timeUs;
+  events[eventsHead].durationUs = durationUs;
+  eventsHead = next;
+  TRACE(TRACE_SELECT_EVENT, type, durationUs);
+}
+
+static int64_t __not_in_flash_func(longPressAlarm)(alarm_id_t id,
+                                                   void *userData) {
+  longAlarm = 0;
+  if (pressed) {
+    pushEvent(SELECT_EVENT_LONG, time_us_32());
+  }
+  return 0;
+}
+
+static void __not_in_flash_func(changeState)(bool level, uint32_t timeUs) {
+  pressed = level;
+  if (level) {
+    pressUs = timeUs;
+    pushEvent(SELECT_EVENT_PRESS, timeUs);
+    longAlarm = add_alarm_in_ms(SELECT_LONG_RESET, longPressAlarm, NULL, true);
+  } else {
+    if (longAlarm > 0) {
+      cancel_alarm(longAlarm);
+      longAlarm = 0;
+    }
+    pushEvent(SELECT_EVENT_RELEASE, timeUs);
+  }
+}
+
+// The contacts bounce for a few ms. The first edge is taken right away, and
+// the level is sampled again when the bouncing is over.
+static int64_t __not_in_flash_func(debounceAlarm)(alarm_id_t id,
+                                                  void *userData) {
+  bool level = select_detectPush();
+  if (level != pressed) {
+    changeState(level, time_us_32());
+    return SELECT_DEBOUNCE_US;  // Sample again after the new edge
+  }
+  debouncing = false;
+  return 0;
+}
+
+static void __not_in_flash_func(selectIrqHandler)(void) {
+  uint32_t mask = gpio_get_irq_event_mask(SELECT_GPIO) &
+                  (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+  if (mask == 0) {
+    return;
+  }
+  gpio_acknowledge_irq(SELECT_GPIO, mask);
+  if (debouncing) {
+    return;
+  }
+  bool level = select_detectPush();
+  if (level != pressed) {
+    changeState(level, time_us_32());
+  }
+  debouncing = (add_alarm_in_us(SELECT_DEBOUNCE_US, debounceAlarm, NULL,
+                                true) > 0);
+}
+
 void __not_in_flash_func(select_waitPush)() {
   DPRINTF("Waiting for SELECT button to be released\n");
-  uint32_t press_duration = 0;
-  while (select_detectPush()) {
-    tight_loop_contents();
-    sleep_ms(SELECT_LOOP_DELAY);
-    press_duration += SELECT_LOOP_DELAY;
-    if (press_duration >= SELECT_LONG_RESET) {
-      break;
-    }
+  select_event_t event;
+  while (!select_getEvent(&event) || (event.type == SELECT_EVENT_PRESS)) {
+    select_sleep();
   }
-  DPRINTF("SELECT button released after %d ms\n", press_duration);
-  if (press_duration >= SELECT_LONG_RESET) {
+  DPRINTF("SELECT button released after %u ms\n",
+          (unsigned int)(event.durationUs / 1000));
+  if (event.type == SELECT_EVENT_LONG) {
     if (reset_long_cb != NULL) {
       DPRINTF("Long press detected. Executing long reset callback\n");
       reset_long_cb();
@@ -36,31 +112,86 @@ void select_configure() {
   gpio_set_dir(SELECT_GPIO, GPIO_IN);
   gpio_set_pulls(SELECT_GPIO, false, true);  // Pull down (false, true)
   gpio_pull_down(SELECT_GPIO);
+
+  // Held at boot: no press is reported, but the long press still counts from
+  // now, for the recovery that holds it down while powering on
+  eventsHead = eventsTail;
+  if (longAlarm > 0) {
+    cancel_alarm(longAlarm);
+    longAlarm = 0;
+  }
+  pressed = select_detectPush();
+  pressUs = time_us_32();
+  debouncing = false;
+  if (pressed) {
+    longAlarm = add_alarm_in_ms(SELECT_LONG_RESET, longPressAlarm, NULL, true);
+  }
+
+  // A raw handler, so it shares the GPIO interrupt with the WiFi chip
+  gpio_add_raw_irq_handler(SELECT_GPIO, selectIrqHandler);
+  gpio_acknowledge_irq(SELECT_GPIO, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+  gpio_set_irq_enabled(SELECT_GPIO, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL,
+                       true);
+  irq_set_enabled(IO_IRQ_BANK0, true);
 }
 
 bool select_detectPush() { return (gpio_get(SELECT_GPIO) != 0); }
 
-void select_coreWaitPush(reset_callback_t reset, reset_callback_t resetLong) {
-  inline void core1_waitPush(void) {
-    DPRINTF("Waiting for SELECT button to be pushed\n");
-    // Wait until the SELECT button is pushed.
-    while (!select_detectPush()) {
-      tight_loop_contents();
-      sleep_ms(SELECT_LOOP_DELAY);
-    }
-    DPRINTF("SELECT button pushed!\n");
-    select_waitPush();
+bool __not_in_flash_func(select_getEvent)(select_event_t *event) {
+  if (eventsTail == eventsHead) {
+    return false;
   }
+  *event = events[eventsTail];
+  eventsTail = (eventsTail + 1) % SELECT_EVENT_QUEUE_SIZE;
+  return true;
+}
 
-  DPRINTF("Launching core 1 to wait for SELECT button push\n");
+void __not_in_flash_func(select_sleep)() {
+  // With the interrupts masked, an interrupt raised after the check still
+  // wakes up __wfi
+  uint32_t ints = save_and_disable_interrupts();
+  if (eventsTail == eventsHead) {
+    __wfi();
+  }
+  restore_interrupts(ints);
+}
+
+void select_coreWaitPush(reset_callback_t reset, reset_callback_t resetLong) {
+  DPRINTF("Handling the SELECT button from the main loop\n");
   reset_cb = reset;
   reset_long_cb = resetLong;
-  multicore_launch_core1(core1_waitPush);
 }
 
 void select_coreWaitPushDisable() {
-  DPRINTF("Disabling core 1\n");
-  multicore_reset_core1();
+  DPRINTF("Disabling the interrupt of the SELECT button\n");
+  gpio_set_irq_enabled(SELECT_GPIO, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL,
+                       false);
+  gpio_remove_raw_irq_handler(SELECT_GPIO, selectIrqHandler);
+  if (longAlarm > 0) {
+    cancel_alarm(longAlarm);
+    longAlarm = 0;
+  }
+  eventsHead = eventsTail;
+}
+
+void select_poll() {
+  select_event_t event;
+  while (select_getEvent(&event)) {
+    if (event.type == SELECT_EVENT_PRESS) {
+      DPRINTF("SELECT button pushed!\n");
+    } else if (event.type == SELECT_EVENT_LONG) {
+      if (reset_long_cb != NULL) {
+        DPRINTF("Long press detected. Executing long reset callback\n");
+        reset_long_cb();
+      }
+    } else if (event.durationUs < SELECT_LONG_RESET * 1000u) {
+      // The release of a long press was already handled
+      if (reset_cb != NULL) {
+        DPRINTF("Short press detected. Executing reset callback\n");
+        reset_cb();
+      }
+    }
+  }
 }
 
 void select_checkPushReset() {
@@ -76,4 +207,4 @@ void select_checkPushReset() {
 void select_setResetCallback(reset_callback_t reset) { reset_cb = reset; }
 void select_setLongResetCallback(reset_callback_t resetLong) {
   reset_long_cb = resetLong;
-}
\ No newline at end of file
+}
@@ -4,12 +4,50 @@
 
 #include "settings.h"
 
+// Entries of the contexts, in fixed slots instead of the heap. A slot holds
+// the whole flash region of a context, so saving needs no other buffer.
+// One more entry rounds the slot up to SETTINGS_POOL_SLOT_SIZE bytes.
+static SettingsConfigEntry
+    settingsPool[SETTINGS_MAX_CONTEXTS]
+                [SETTINGS_POOL_SLOT_SIZE / sizeof(SettingsConfigEntry) + 1];
+static bool settingsPoolUsed[SETTINGS_MAX_CONTEXTS];
+
 /*
  * -----------
  * STATIC HELPER FUNCTIONS
  * -----------
  */
 
+/**
+ * @brief Take a free slot of the pool for the entries of a context.
+ */
+static SettingsConfigEntry *settingsPoolAlloc(uint32_t size) {
+  if (size > SETTINGS_POOL_SLOT_SIZE) {
+    DPRINTF("Error: settings size %lu exceeds SETTINGS_POOL_SLOT_SIZE.\n",
+            (unsigned long)size);
+    return NULL;
+  }
+  for (int i = 0; i < SETTINGS_MAX_CONTEXTS; i++) {
+    if (!settingsPoolUsed[i]) {
+      settingsPoolUsed[i] = true;
+      return settingsPool[i];
+    }
+  }
+  DPRINTF("Error: more than SETTINGS_MAX_CONTEXTS contexts.\n");
+  return NULL;
+}
+
+/**
+ * @brief Give back the slot of the entries of a context.
+ */
+static void settingsPoolFree(SettingsConfigEntry *entries) {
+  for (int i = 0; i < SETTINGS_MAX_CONTEXTS; i++) {
+    if (settingsPool[i] == entries) {
+      settingsPoolUsed[i] = false;
+    }
+  }
+}
+
 /**
  * @brief Verify the format of a given key (uppercase, numbers, or '_').
  */
@@ -57,8 +95,7 @@ static int checkTypeFormat(SettingsDataType type) {
 static void settingsLoadDefaultEntries(SettingsContext *ctx,
                                        const SettingsConfigEntry *entries,
                                        uint16_t numEntries) {
-  // Start with zero count
-  ctx->configData.count = 0;
+  size_t first = ctx->configData.count;
 
   for (uint16_t i = 0; i < numEntries; i++) {
     if (entries[i].key[0] == '\0' || strlen(entries[i].key) == 0) {
@@ -86,11 +123,11 @@ static void settingsLoadDefaultEntries(SettingsContext *ctx,
     }
   }
 
-  if (ctx->configData.count != numEntries) {
+  if (ctx->configData.count - first != numEntries) {
     DPRINTF(
         "WARNING: Mismatch between the number of default entries (%d) "
         "and the number of entries loaded (%zu).\n",
-        numEntries, ctx->configData.count);
+        numEntries, ctx->configData.count - first);
   } else {
     DPRINTF("Loaded %zu default entries.\n", ctx->configData.count);
   }
@@ -100,6 +137,7 @@ static void settingsLoadDefaultEntries(SettingsContext *ctx,
  * @brief Load all entries from FLASH if valid, otherwise use default entries.
  */
 static int settingsLoadAllEntries(SettingsContext *ctx,
+                                  const SettingsConfigEntry *magicEntry,
                                   const SettingsConfigEntry *entries,
                                   uint16_t numEntries, uint16_t maxEntries) {
   uint8_t *currentAddress = (uint8_t *)(ctx->flashSettingsOffset + XIP_BASE);
@@ -113,8 +151,10 @@ static int settingsLoadAllEntries(SettingsContext *ctx,
     numEntries = maxEntries;
   }
 
-  // First, load default entries
-  settingsLoadDefaultEntries(ctx, entries, numEntries);
+  // First, load default entries, after the magic entry
+  ctx->configData.count = 0;
+  settingsLoadDefaultEntries(ctx, magicEntry, 1);
+  settingsLoadDefaultEntries(ctx, entries, numEntries - 1);
 
   // The magic value is stored as a string in the first "entry",
   // i.e. at offset = first entry's value field. By design, your code
@@ -233,8 +273,7 @@ int settings_init(SettingsContext *ctx,
   DPRINTF("Default entries count: %d\n", defaultNumEntries);
 
   // 3) Prepare the configData structure
-  ctx->configData.entries =
-      (SettingsConfigEntry *)malloc(ctx->flashSettingsSize);
+  ctx->configData.entries = settingsPoolAlloc(ctx->flashSettingsSize);
   if (!ctx->configData.entries) {
     DPRINTF("Error: Unable to allocate memory for config entries.\n");
     return -1;
@@ -246,16 +285,8 @@ int settings_init(SettingsContext *ctx,
       ((uint32_t)magic << SETTINGS_SHIFT_LEFT_16_BITS) | version;
   DPRINTF("Combined magic: 0x%08lx\n", (unsigned long)ctx->configData.magic);
 
-  // 5) Create an augmented default array with the MAGICVERSION entry at the
-  // front.
+  // 5) The MAGICVERSION entry goes in front of the defaults
   defaultNumEntries++;  // Add one for the magic entry
-  SettingsConfigEntry *defaultEntriesWithMagic = (SettingsConfigEntry *)malloc(
-      defaultNumEntries * sizeof(SettingsConfigEntry));
-  if (!defaultEntriesWithMagic) {
-    DPRINTF(
-        "Error: Unable to allocate memory for default entries with magic.\n");
-    return -1;
-  }
 
   // Fill the special "MAGICVERSION" entry
   char magicValue[SETTINGS_MAX_VALUE_LENGTH];
@@ -266,17 +297,10 @@ int settings_init(SettingsContext *ctx,
   strncpy(magicEntry.value, magicValue, SETTINGS_MAX_VALUE_LENGTH - 1);
   magicEntry.value[SETTINGS_MAX_VALUE_LENGTH - 1] = '\0';
 
-  // Put the magic entry first, then copy the user’s defaults
-  defaultEntriesWithMagic[0] = magicEntry;
-  memcpy(defaultEntriesWithMagic + 1, defaultEntries,
-         (defaultNumEntries - 1) * sizeof(SettingsConfigEntry));
-
   // 6) Load from flash (or default) into ctx->configData
-  int error =
-      settingsLoadAllEntries(ctx, defaultEntriesWithMagic,
-                             (uint16_t)defaultNumEntries, (uint16_t)maxEntries);
-
-  free(defaultEntriesWithMagic);
+  int error = settingsLoadAllEntries(ctx, &magicEntry, defaultEntries,
+                                     (uint16_t)defaultNumEntries,
+                                     (uint16_t)maxEntries);
 
   // Return the number of entries loaded, or error
   return (error == 0 ? (int)ctx->configData.count : error);
@@ -287,7 +311,7 @@ int settings_deinit(SettingsContext *ctx) {
 
   // Reset the entire structure
   if (ctx->configData.entries) {
-    free(ctx->configData.entries);
+    settingsPoolFree(ctx->configData.entries);
     ctx->configData.entries = NULL;
   }
   ctx->configData.count = 0;
@@ -313,7 +337,7 @@ int __not_in_flash_func(settings_save)(SettingsContext *ctx,
           ctx->configData.count, totalUsed);
 
   size_t programSize = 0;
-  uint8_t *padded = NULL;
+  uint8_t *padded = (uint8_t *)ctx->configData.entries;
 
   if (totalUsed > 0) {
     // Pad to flash page size, but never exceed the reserved region.
@@ -324,14 +348,10 @@ int __not_in_flash_func(settings_save)(SettingsContext *ctx,
       programSize = ctx->flashSettingsSize;
     }
 
-    padded = (uint8_t *)malloc(programSize);
-    if (padded == NULL) {
-      DPRINTF("Error: Unable to allocate padding buffer.\n");
-      return -1;
-    }
-    memset(padded, 0xFF, programSize);  // match erased flash default
-    memcpy(padded, ctx->configData.entries,
-           totalUsed < programSize ? totalUsed : programSize);
+    // The slot of the entries is as large as the region. Its unused tail is
+    // the padding.
+    memset(padded + totalUsed, 0xFF,
+           programSize - totalUsed);  // match erased flash default
   }
 
   uint32_t ints = 0;
@@ -354,10 +374,6 @@ int __not_in_flash_func(settings_save)(SettingsContext *ctx,
     DPRINTF("Interrupts restored after flash programming.\n");
   }
 
-  if (padded) {
-    free(padded);
-  }
-
   return 0;
 }
 
@@ -371,7 +387,7 @@ int settings_erase(SettingsContext *ctx) {
 
   // Free and reset
   if (ctx->configData.entries) {
-    free(ctx->configData.entries);
+    settingsPoolFree(ctx->configData.entries);
     ctx->configData.entries = NULL;
   }
   ctx->configData.count = 0;
@@ -457,21 +473,10 @@ int settings_put_integer(SettingsContext *ctx, const char *key, int value) {
 void settings_print(SettingsContext *ctx, char *buffer) {
   if (!ctx) return;
 
-  // We'll use a fixed-size buffer if none is provided
-  size_t remaining = 2048;
-  char *outputBuffer = NULL;
-
-  if (buffer == NULL) {
-    // Allocate a buffer if none is provided
-    outputBuffer = (char *)malloc(remaining);
-    if (!outputBuffer) {
-      DPRINTF("Error: Unable to allocate memory for output buffer.\n");
-      return;
-    }
-  } else {
-    // Use the provided buffer
-    outputBuffer = buffer;
-  }
+  // Without a buffer, one line at a time
+  char line[SETTINGS_MAX_KEY_LENGTH + SETTINGS_MAX_VALUE_LENGTH + 16];
+  size_t remaining = (buffer != NULL) ? 2048 : sizeof(line);
+  char *outputBuffer = (buffer != NULL) ? buffer : line;
 
   char *ptr = outputBuffer;
   size_t len = 0;
@@ -498,6 +503,10 @@ void settings_print(SettingsContext *ctx, char *buffer) {
     len = snprintf(ptr, remaining, "%s (%s): %s\n",
                    ctx->configData.entries[i].key, typeStr,
                    ctx->configData.entries[i].value);
+    if (buffer == NULL) {
+      DPRINTFRAW("%s", line);
+      continue;
+    }
 
     ptr += len;
     remaining = (len < remaining) ? (remaining - len) : 0;
@@ -507,10 +516,4 @@ void settings_print(SettingsContext *ctx, char *buffer) {
   if (remaining > 0) {
     *ptr = '\0';
   }
-
-  // If no external buffer was provided, print and free
-  if (buffer == NULL) {
-    DPRINTFRAW("%s", outputBuffer);
-    free(outputBuffer);
-  }
 }
@@ -73,6 +73,17 @@
  
  #define SETTINGS_FLASH_PAGE_SIZE 4096
  #define SETTINGS_DEFAULT_FLASH_SIZE 4096
+
+ /**
+  * @brief Static pool of the entries: contexts initialized at the same time,
+  * and the largest flash region of a context.
+  */
+ #ifndef SETTINGS_MAX_CONTEXTS
+ #define SETTINGS_MAX_CONTEXTS 2
+ #endif
+ #ifndef SETTINGS_POOL_SLOT_SIZE
+ #define SETTINGS_POOL_SLOT_SIZE SETTINGS_DEFAULT_FLASH_SIZE
+ #endif
  
  #define SETTINGS_BASE_10 10
  #define SETTINGS_SHIFT_LEFT_16_BITS 16
@@ -126,7 +137,8 @@
   * @param defaultNumEntries Number of default configuration entries.
   * @param flashOffset    Offset in flash memory where settings are stored.
   * @param flashSize      Size of the flash memory region allocated for settings
-  *                       (must be multiple of 4096).
+  *                       (must be multiple of 4096, and at most
+  *                       SETTINGS_POOL_SLOT_SIZE).
   * @param magic          16-bit magic number for settings validation.
   * @param version        16-bit version of the settings structure.
   * @return int           Returns count of loaded entries on success,
@@ -172,8 +184,8 @@
   * @brief Print the current configuration in a tabular format.
   *
   * @param ctx    Pointer to the SettingsContext.
-  * @param buffer Optional buffer for storing output. If NULL, a buffer is
-  *               allocated internally and printed to stderr.
+  * @param buffer Optional buffer of 2048 bytes for storing output. If NULL,
+  *               each entry is printed to stderr.
   */
  void settings_print(SettingsContext *ctx, char *buffer);
  
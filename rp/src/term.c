@@ -46,6 +46,13 @@ void term_setCommands(const Command *cmds, size_t count) {
  */
 static inline void __not_in_flash_func(handle_protocol_command)(
     const TransmissionProtocol *protocol) {
+  perf_count(PERF_EVENT_COMMANDS);
+  TRACE(TRACE_PROTOCOL_COMMAND, protocol->command_id, protocol->payload_size);
+  if (lastProtocolValid) {
+    perf_count(PERF_EVENT_DROPPED);  // The main loop did not read it yet
+    TRACE(TRACE_PROTOCOL_DROPPED, protocol->command_id,
+          lastProtocol.command_id);
+  }
   // Copy the content of protocol to last_protocol
   memcpy(&lastProtocol, protocol, sizeof(TransmissionProtocol));
   lastProtocolValid = true;
@@ -53,12 +60,15 @@ static inline void __not_in_flash_func(handle_protocol_command)(
 
 static inline void __not_in_flash_func(handle_protocol_checksum_error)(
     const TransmissionProtocol *protocol) {
-  DPRINTF("Checksum error detected (ID=%u, Size=%u)\n", protocol->command_id,
-          protocol->payload_size);
+  perf_count(PERF_EVENT_CHECKSUM);
+  // No DPRINTF here: printing from the interrupt delays the next command
+  TRACE(TRACE_PROTOCOL_CHECKSUM, protocol->command_id,
+        protocol->final_checksum);
 }
 
 // Interrupt handler for DMA completion
 void __not_in_flash_func(term_dma_irq_handler_lookup)(void) {
+  uint32_t cycles = perf_irqStart();
   // Read once to avoid redundant hardware access
   uint32_t addr = dma_hw->ch[2].al3_read_addr_trig;
 
@@ -75,6 +85,7 @@ void __not_in_flash_func(term_dma_irq_handler_lookup)(void) {
 
   // Read the rom3 signal and if so then process the command
   dma_hw->ints1 = 1U << 2;
+  perf_irqStop(cycles);
 }
 
 static char screen[TERM_SCREEN_SIZE];
@@ -434,6 +445,7 @@ void __not_in_flash_func(term_loop)() {
     uint32_t randomToken = TPROTO_GET_RANDOM_TOKEN(lastProtocol.payload);
     uint16_t *payloadPtr = ((uint16_t *)(lastProtocol).payload);
     uint16_t commandId = lastProtocol.command_id;
+    TRACE(TRACE_TERM_COMMAND, commandId, lastProtocol.payload_size);
     DPRINTF(
         "Command ID: %d. Size: %d. Random token: 0x%08X, Checksum: 0x%04X\n",
         lastProtocol.command_id, lastProtocol.payload_size, randomToken,
@@ -505,6 +517,25 @@ void __not_in_flash_func(term_loop)() {
         termInputChar(keystroke);
         break;
       }
+      case APP_TERMINAL_SET_SHARED_VAR: {
+        uint16_t *payload = ((uint16_t *)(lastProtocol).payload);
+        // Jump the random token
+        TPROTO_NEXT32_PAYLOAD_PTR(payload);
+        uint32_t index = TPROTO_GET_PAYLOAD_PARAM32(payload);
+        TPROTO_NEXT32_PAYLOAD_PTR(payload);
+        uint32_t value = TPROTO_GET_PAYLOAD_PARAM32(payload);
+        // The variables after them are written by this side
+        if (index >= TERM_PERF_COUNTERS) {
+          DPRINTF("Shared variable %u not writable\n", (unsigned int)index);
+          break;
+        }
+        SET_SHARED_VAR(index, value, memorySharedAddress,
+                       TERM_SHARED_VARIABLES_OFFSET);
+        if (index == TERM_HARDWARE_TYPE) {
+          profile_reportMachine(value);
+        }
+        break;
+      }
       default:
         // Unknown command
         DPRINTF("Unknown command\n");
@@ -540,14 +571,15 @@ void term_cmdSettings(const char *arg) {
 }
 
 void term_cmdPrint(const char *arg) {
-  char *buffer = (char *)malloc(TERM_PRINT_SETTINGS_BUFFER_SIZE);
+  char *buffer =
+      (char *)arena_alloc(ARENA_SCRATCH, TERM_PRINT_SETTINGS_BUFFER_SIZE);
   if (buffer == NULL) {
     term_printString("Error: Out of memory.\n");
     return;
   }
   settings_print(aconfig_getContext(), buffer);
   term_printString(buffer);
-  free(buffer);
+  arena_free(ARENA_SCRATCH, buffer);
 }
 
 void term_cmdClear(const char *arg) { term_clearScreen(); }
@@ -563,12 +595,16 @@ void term_cmdUnknown(const char *arg) {
 }
 
 void term_cmdSave(const char *arg) {
+  worker_lockoutStart();  // Core1 must not run from the flash meanwhile
   settings_save(aconfig_getContext(), true);
+  worker_lockoutEnd();
   term_printString("Settings saved.\n");
 }
 
 void term_cmdErase(const char *arg) {
+  worker_lockoutStart();
   settings_erase(aconfig_getContext());
+  worker_lockoutEnd();
   term_printString("Settings erased.\n");
 }
 
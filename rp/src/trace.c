@@ -0,0 +1,103 @@
+/**
+ * File: trace.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Binary trace of the time-critical paths. Recording is inline
+ * in trace.h; decoding happens here, out of the hot paths, or on the host.
+ */
+
+#include "trace.h"
+
+#define TRACE_DRAIN_BATCH 8  // Records printed per call
+
+#define TRACE_EVENT_NAME(id, arg0, arg1) #id,
+static const char *const eventNames[] = {
+    "TRACE_NONE", TRACE_EVENTS(TRACE_EVENT_NAME)};
+#undef TRACE_EVENT_NAME
+
+const char *trace_getName(trace_event_t event) {
+  return (event < TRACE_EVENTS_COUNT) ? eventNames[event] : "?";
+}
+
+#if defined(_TRACE) && (_TRACE != 0)
+
+trace_ring_t traceRings[NUM_CORES];
+
+void trace_drain(void) {
+#if defined(_DEBUG) && (_DEBUG != 0)
+  for (int core = 0; core < NUM_CORES; core++) {
+    trace_ring_t *ring = &traceRings[core];
+    uint32_t head = ring->head;
+    if (head - ring->tail > TRACE_RING_SIZE) {
+      ring->lost += head - ring->tail - TRACE_RING_SIZE;
+      ring->tail = head - TRACE_RING_SIZE;
+      DPRINTFRAW("TRACE core %d: %u records lost\n", core,
+                 (unsigned int)ring->lost);
+    }
+    for (int i = 0; (i < TRACE_DRAIN_BATCH) && (ring->tail != head); i++) {
+      trace_record_t record;
+      uint32_t ints = save_and_disable_interrupts();
+      record = ring->records[ring->tail & (TRACE_RING_SIZE - 1)];
+      restore_interrupts(ints);
+      ring->tail++;
+      DPRINTFRAW("TRACE %10u c%u %s %u %u\n", (unsigned int)record.timeUs,
+                 (unsigned int)record.core,
+                 trace_getName((trace_event_t)record.event),
+                 (unsigned int)record.arg0, (unsigned int)record.arg1);
+    }
+  }
+#endif
+}
+
+FRESULT trace_save(const char *path, uint32_t *saved) {
+  trace_file_header_t header = {.magic = TRACE_FILE_MAGIC,
+                                .version = TRACE_FILE_VERSION,
+                                .recordSize = sizeof(trace_record_t)};
+  uint32_t heads[NUM_CORES];
+  for (int core = 0; core < NUM_CORES; core++) {
+    heads[core] = traceRings[core].head;
+    header.counts[core] = (heads[core] > TRACE_RING_SIZE) ? TRACE_RING_SIZE
+                                                          : heads[core];
+    header.lost[core] = heads[core] - header.counts[core];
+  }
+  *saved = 0;
+
+  FIL file;
+  FRESULT res = f_open(&file, path, FA_WRITE | FA_CREATE_ALWAYS);
+  if (res != FR_OK) {
+    DPRINTF("Error creating %s: %d\n", path, res);
+    return res;
+  }
+  UINT bytes;
+  res = f_write(&file, &header, sizeof(header), &bytes);
+  // The records of each core, oldest first. A ring wraps in two pieces.
+  for (int core = 0; (core < NUM_CORES) && (res == FR_OK); core++) {
+    uint32_t first = (heads[core] - header.counts[core]) & (TRACE_RING_SIZE - 1);
+    uint32_t count = header.counts[core];
+    uint32_t firstPiece =
+        (first + count > TRACE_RING_SIZE) ? TRACE_RING_SIZE - first : count;
+    const trace_record_t *records = traceRings[core].records;
+    res = f_write(&file, &records[first], firstPiece * sizeof(trace_record_t),
+                  &bytes);
+    if ((res == FR_OK) && (count > firstPiece)) {
+      res = f_write(&file, records, (count - firstPiece) *
+                                        sizeof(trace_record_t),
+                    &bytes);
+    }
+    *saved += count;
+  }
+  FRESULT closeRes = f_close(&file);
+  return (res != FR_OK) ? res : closeRes;
+}
+
+#else
+
+void trace_drain(void) {}
+
+FRESULT trace_save(const char *path, uint32_t *saved) {
+  *saved = 0;
+  return FR_DENIED;
+}
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * File: worker.c
+ * Author: Diego Parrilla Santamaría
+ * Date: October 2026
+ * Copyright: 2026 - GOODDATA LABS SL
+ * Description: Jobs run in the secondary core. Core0 queues the index of the
+ * slot of each job in the FIFO between the cores.
+ */
+
+#include "worker.h"
+
+// Each slot is only written by one core at a time: core0 while it is free or
+// done, core1 while it is queued or running.
+static worker_job_t jobs[WORKER_MAX_JOBS];
+
+static bool started = false;
+static volatile bool lockoutRequested = false;
+static volatile bool lockedOut = false;
+
+static void __not_in_flash_func(park)(void) {
+  lockedOut = true;
+  __dmb();
+  while (lockoutRequested) {
+    __wfe();
+  }
+  lockedOut = false;
+  __dmb();
+}
+
+void __not_in_flash_func(worker_yield)(void) {
+  if (lockoutRequested) {
+    park();
+  }
+}
+
+// Waits for the jobs in RAM. Only the jobs run from the flash.
+static void __not_in_flash_func(workerLoop)(void) {
+  while (true) {
+    worker_yield();
+    if ((sio_hw->fifo_st & SIO_FIFO_ST_VLD_BITS) == 0) {
+      __wfe();
+      continue;
+    }
+    uint32_t slot = sio_hw->fifo_rd % WORKER_MAX_JOBS;
+    worker_job_t *job = &jobs[slot];
+    job->status = WORKER_JOB_RUNNING;
+    TRACE(TRACE_WORKER_JOB_START, slot, job->func);
+    job->func(job->context);
+    TRACE(TRACE_WORKER_JOB_END, slot, 0);
+    __dmb();
+    job->status = WORKER_JOB_DONE;
+  }
+}
+
+void worker_start(void) {
+  if (started) {
+    return;
+  }
+  for (int i = 0; i < WORKER_MAX_JOBS; i++) {
+    jobs[i].status = WORKER_JOB_FREE;
+  }
+  DPRINTF("Launching core 1 to run the jobs of the worker\n");
+  multicore_reset_core1();
+  multicore_fifo_drain();
+  memwatch_paintStack(1);
+  multicore_launch_core1(workerLoop);
+  started = true;
+}
+
+void worker_stop(void) {
+  if (!started) {
+    return;
+  }
+  while (worker_isBusy()) {
+    worker_poll();
+    tight_loop_contents();
+  }
+  DPRINTF("Stopping the worker in core 1\n");
+  multicore_reset_core1();
+  started = false;
+}
+
+worker_status_t worker_submit(worker_func_t func, worker_done_t done,
+                              void *context) {
+  if (!started) {
+    return WORKER_NOT_STARTED_ERROR;
+  }
+  for (uint32_t i = 0; i < WORKER_MAX_JOBS; i++) {
+    worker_job_t *job = &jobs[i];
+    if (job->status == WORKER_JOB_FREE) {
+      job->func = func;
+      job->done = done;
+      job->context = context;
+      job->status = WORKER_JOB_QUEUED;
+      __dmb();
+      multicore_fifo_push_blocking(i);
+      return WORKER_OK;
+    }
+  }
+  DPRINTF("No free slot for the job. Worker full.\n");
+  return WORKER_FULL_ERROR;
+}
+
+void worker_poll(void) {
+  for (int i = 0; i < WORKER_MAX_JOBS; i++) {
+    worker_job_t *job = &jobs[i];
+    if (job->status != WORKER_JOB_DONE) {
+      continue;
+    }
+    __dmb();
+    if (job->done != NULL) {
+      job->done(job->context);
+    }
+    job->status = WORKER_JOB_FREE;
+  }
+}
+
+bool worker_isBusy(void) {
+  for (int i = 0; i < WORKER_MAX_JOBS; i++) {
+    if (jobs[i].status != WORKER_JOB_FREE) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void worker_lockoutStart(void) {
+  if (!started) {
+    return;
+  }
+  lockoutRequested = true;
+  __dmb();
+  __sev();
+  while (!lockedOut) {
+    tight_loop_contents();
+  }
+}
+
+void worker_lockoutEnd(void) {
+  if (!started) {
+    return;
+  }
+  lockoutRequested = false;
+  __dmb();
+  __sev();
+  // Until core1 leaves the RAM, or a new lockout would not wait for it
+  while (lockedOut) {
+    tight_loop_contents();
+  }
+}
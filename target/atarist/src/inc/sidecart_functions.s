@@ -27,6 +27,7 @@ COMMAND_SYNC_USE_DSKBUF                 equ 0       ; Use different disk buffers
 ;
 ; Outputs:
 ;   d0.l contains the hardware type as stored in the shared variable SHARED_VARIABLE_HARDWARE_TYPE
+;   If the Sidecart does not answer, the boot continues without reporting it
 detect_hw:
 	move.l _p_cookies.w,d0      ; Check the cookie-jar to know what type of machine we are running on
 	beq _old_hardware           ; No cookie-jar, so it's a TOS <= 1.04
@@ -47,14 +48,9 @@ _save_hw:
     move.l d4, -(sp)            ; Save the hardware type    
     move.l #SHARED_VARIABLE_HARDWARE_TYPE, d3   ; D3 Variable index
                                                 ; D4 Variable value
-    send_sync CMD_SET_SHARED_VAR, 8
-    tst.w d0
-    bne.s _detect_hw_timeout
+    send_sync CMD_SET_SHARED_VAR, 8    ; Retries CMD_RETRIES_COUNT times. If all fail, the type is not reported
     move.l (sp)+, d0            ; Restore the hardware type in d0.l as result
     rts
-_detect_hw_timeout
-    move.l (sp)+, d4            ; Restore the hardware type in d4.l to retry
-    bra.s _save_hw
 
 ; Get the TOS version
 ; This code reads the TOS version from the ROM and writes it in the shared variable SHARED_VARIABLE_SVERSION
@@ -57,7 +57,7 @@ SHARED_VARIABLES:     	  equ (RANDOM_TOKEN_ADDR + $200)  ; random token + 512 by
 ROMCMD_START_ADDR:        equ $FB0000					  ; We are going to use ROM3 address
 CMD_MAGIC_NUMBER    	  equ ($ABCD) 					  ; Magic number header to identify a command
 CMD_RETRIES_COUNT	  	  equ 3							  ; Number of retries for the command
-CMD_SET_SHARED_VAR		  equ 1							  ; This is a fake command to set the shared variables
+CMD_SET_SHARED_VAR		  equ 2							  ; Command to set the shared variables
 														  ; Used to store the system settings
 ; App commands for the terminal
 APP_TERMINAL 				equ $0 ; The terminal app
@@ -198,6 +198,9 @@ start_rom_code:
 ; We assume the screen memory address is in D0 after the get_screen_base call
 	move.l d0, a6				; Save the screen memory address in A6
 
+; Report the computer, to choose the clock profile of the next boot
+	bsr detect_hw
+
 ; Enable bconin to return shift key status
 	or.b #%1000, _conterm.w
 